@@ -457,6 +457,9 @@ if(FEATURE_aurora_xwayland)
         message(WARNING "You need XCB for Aurora::XWayland")
         set(FEATURE_aurora_xwayland OFF)
     endif()
+    if(NOT TARGET XCB::RES)
+        message(STATUS "XCB X-Resource not found, Aurora::XWayland will tell idleness from client windows")
+    endif()
     if(NOT XKB_FOUND)
         message(WARNING "You need XKB for Aurora::XWayland")
         set(FEATURE_aurora_xwayland OFF)
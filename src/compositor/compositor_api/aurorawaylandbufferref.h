@@ -6,6 +6,8 @@
 #include <LiriAuroraCompositor/liriauroracompositorglobal.h>
 #include <QtGui/QImage>
 
+#include <utility>
+
 #if QT_CONFIG(opengl)
 #include <QtGui/qopengl.h>
 #endif
@@ -28,11 +30,16 @@ namespace Internal
 class LIRIAURORACOMPOSITOR_EXPORT WaylandBufferRef
 {
 public:
-    WaylandBufferRef();
+    WaylandBufferRef() noexcept;
     WaylandBufferRef(const WaylandBufferRef &ref);
+    WaylandBufferRef(WaylandBufferRef &&other) noexcept
+        : m_buffer(std::exchange(other.m_buffer, nullptr)) {}
     ~WaylandBufferRef();
 
     WaylandBufferRef &operator=(const WaylandBufferRef &ref);
+    QT_MOVE_ASSIGNMENT_OPERATOR_IMPL_VIA_PURE_SWAP(WaylandBufferRef)
+    void swap(WaylandBufferRef &other) noexcept { std::swap(m_buffer, other.m_buffer); }
+
     bool isNull() const;
     bool hasBuffer() const;
     bool hasContent() const;
@@ -76,7 +83,11 @@ public:
 private:
     explicit WaylandBufferRef(Internal::ClientBuffer *buffer);
     Internal::ClientBuffer *buffer() const;
-    class WaylandBufferRefPrivate *const d;
+
+    // Takes the place of the d-pointer, the buffer is reference counted
+    // on its own so that references can be passed around without allocating
+    Internal::ClientBuffer *m_buffer = nullptr;
+
     friend class WaylandBufferRefPrivate;
     friend class WaylandSurfacePrivate;
 
@@ -87,6 +98,8 @@ private:
     { return !(lhs == rhs); }
 };
 
+Q_DECLARE_SHARED(WaylandBufferRef)
+
 } // namespace Compositor
 
 } // namespace Aurora
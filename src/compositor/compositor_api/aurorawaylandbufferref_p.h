@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <LiriAuroraCompositor/WaylandBufferRef>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandBufferRefPrivate
+{
+public:
+    static WaylandBufferRef fromBuffer(Internal::ClientBuffer *buffer) { return WaylandBufferRef(buffer); }
+    static Internal::ClientBuffer *buffer(const WaylandBufferRef &ref) { return ref.m_buffer; }
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -35,6 +35,7 @@
 
 #include "extensions/aurorawaylandqtwindowmanager.h"
 
+#include "aurorastartuptrace_p.h"
 #include "aurorawaylandsharedmemoryformathelper_p.h"
 
 #include <QtCore/QCoreApplication>
@@ -141,6 +142,33 @@ public:
     WaylandCompositor *compositor = nullptr;
 };
 
+PendingDone::~PendingDone()
+{
+    cancelDone();
+}
+
+void PendingDone::scheduleDone(WaylandCompositor *compositor)
+{
+    if (m_doneCompositor || !compositor)
+        return;
+
+    m_doneCompositor = compositor;
+    WaylandCompositorPrivate::get(compositor)->pendingDone.append(this);
+}
+
+void PendingDone::cancelDone()
+{
+    if (!m_doneCompositor)
+        return;
+
+    // Only cleared, the list might be flushing
+    auto &pendingDone = WaylandCompositorPrivate::get(m_doneCompositor)->pendingDone;
+    const qsizetype index = pendingDone.indexOf(this);
+    if (index >= 0)
+        pendingDone[index] = nullptr;
+    m_doneCompositor = nullptr;
+}
+
 } // namespace
 
 WaylandCompositorPrivate::WaylandCompositorPrivate(WaylandCompositor *compositor)
@@ -214,6 +242,7 @@ void WaylandCompositorPrivate::verifyXdgRuntimeDir()
 void WaylandCompositorPrivate::init()
 {
     Q_Q(WaylandCompositor);
+    StartupTrace::Span span("compositor", "init");
     QStringList arguments = QCoreApplication::instance()->arguments();
 
     if (socket_name.isEmpty()) {
@@ -267,18 +296,28 @@ void WaylandCompositorPrivate::init()
 
     initialized = true;
 
-    for (const QPointer<QObject> &object : std::exchange(polish_objects, {})) {
-        if (object) {
-            QEvent polishEvent(QEvent::Polish);
-            QCoreApplication::sendEvent(object.data(), &polishEvent);
+    {
+        StartupTrace::Span span("compositor", "extensions");
+        for (const QPointer<QObject> &object : std::exchange(polish_objects, {})) {
+            if (object) {
+                QEvent polishEvent(QEvent::Polish);
+                QCoreApplication::sendEvent(object.data(), &polishEvent);
+            }
         }
     }
 
+    StartupTrace::Span createdSpan("compositor", "createdChanged");
     emit q->createdChanged();
 }
 
 WaylandCompositorPrivate::~WaylandCompositorPrivate()
 {
+    for (Internal::PendingDone *object : std::as_const(pendingDone)) {
+        if (object)
+            object->m_doneCompositor = nullptr;
+    }
+    pendingDone.clear();
+
     // Take copies, since the lists will get modified as elements are deleted
     const auto clientsToDelete = clients;
     qDeleteAll(clientsToDelete);
@@ -340,6 +379,19 @@ void WaylandCompositorPrivate::addPolishObject(QObject *object)
     }
 }
 
+void WaylandCompositorPrivate::flushPendingDone()
+{
+    // Objects can schedule others while sending, they go out with this flush
+    for (qsizetype i = 0; i < pendingDone.size(); ++i) {
+        Internal::PendingDone *object = pendingDone.at(i);
+        if (!object)
+            continue;
+        object->m_doneCompositor = nullptr;
+        object->sendPendingDone();
+    }
+    pendingDone.clear();
+}
+
 void WaylandCompositorPrivate::connectToExternalSockets()
 {
     // Clear out any backlog of user-supplied external socket descriptors
@@ -417,6 +469,7 @@ Internal::ClientBuffer *SharedMemoryClientBufferIntegration::createBufferFor(wl_
 
 void WaylandCompositorPrivate::initializeHardwareIntegration()
 {
+    StartupTrace::Span span("compositor", "hardwareIntegration");
     client_buffer_integrations.prepend(new SharedMemoryClientBufferIntegration); // TODO: clean up the opengl dependency
 
 #if QT_CONFIG(opengl)
@@ -434,6 +487,7 @@ void WaylandCompositorPrivate::initializeHardwareIntegration()
 
 void WaylandCompositorPrivate::initializeSeats()
 {
+    StartupTrace::Span span("compositor", "seats");
     for (WaylandSeat *seat : std::as_const(seats))
         seat->initialize();
 }
@@ -622,6 +676,7 @@ WaylandCompositor::~WaylandCompositor()
 void WaylandCompositor::create()
 {
     Q_D(WaylandCompositor);
+    StartupTrace::Span span("compositor", "create");
     d->preInit();
     d->init();
 }
@@ -889,6 +944,7 @@ void WaylandCompositor::processWaylandEvents()
     int ret = wl_event_loop_dispatch(d->loop, 0);
     if (ret)
         fprintf(stderr, "wl_event_loop_dispatch error: %d\n", ret);
+    d->flushPendingDone();
     wl_display_flush_clients(d->display);
 }
 
@@ -952,6 +1008,42 @@ bool WaylandCompositor::retainedSelectionEnabled() const
     return d->retainSelection;
 }
 
+/*!
+ * \qmlproperty int64 AuroraCompositor::WaylandCompositor::retainedSelectionSizeLimit
+ *
+ * This property holds the maximum size in bytes of the data retained for
+ * each MIME type of the selection. Data exceeding the limit is not retained.
+ * The default value is 0, meaning there is no limit.
+ *
+ * \sa retainedSelection
+ */
+
+/*!
+ * \property WaylandCompositor::retainedSelectionSizeLimit
+ *
+ * This property holds the maximum size in bytes of the data retained for
+ * each MIME type of the selection. Data exceeding the limit is not retained.
+ * The default value is 0, meaning there is no limit.
+ *
+ * \sa retainedSelection
+ */
+void WaylandCompositor::setRetainedSelectionSizeLimit(qint64 limit)
+{
+    Q_D(WaylandCompositor);
+
+    if (d->retainedSelectionSizeLimit == limit)
+        return;
+
+    d->retainedSelectionSizeLimit = limit;
+    emit retainedSelectionSizeLimitChanged(limit);
+}
+
+qint64 WaylandCompositor::retainedSelectionSizeLimit() const
+{
+    Q_D(const WaylandCompositor);
+    return d->retainedSelectionSizeLimit;
+}
+
 /*!
  * \internal
  */
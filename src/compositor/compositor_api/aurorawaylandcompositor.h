@@ -52,6 +52,7 @@ class LIRIAURORACOMPOSITOR_EXPORT WaylandCompositor : public WaylandObject
     Q_PROPERTY(QByteArray socketName READ socketName WRITE setSocketName NOTIFY socketNameChanged)
     Q_PROPERTY(bool created READ isCreated NOTIFY createdChanged)
     Q_PROPERTY(bool retainedSelection READ retainedSelectionEnabled WRITE setRetainedSelectionEnabled NOTIFY retainedSelectionChanged)
+    Q_PROPERTY(qint64 retainedSelectionSizeLimit READ retainedSelectionSizeLimit WRITE setRetainedSelectionSizeLimit NOTIFY retainedSelectionSizeLimitChanged)
     Q_PROPERTY(Aurora::Compositor::WaylandOutput *defaultOutput READ defaultOutput WRITE setDefaultOutput NOTIFY defaultOutputChanged)
     Q_PROPERTY(bool useHardwareIntegrationExtension READ useHardwareIntegrationExtension WRITE setUseHardwareIntegrationExtension NOTIFY useHardwareIntegrationExtensionChanged)
     Q_PROPERTY(Aurora::Compositor::WaylandSeat *defaultSeat READ defaultSeat NOTIFY defaultSeatChanged)
@@ -112,6 +113,8 @@ public:
 
     void setRetainedSelectionEnabled(bool enabled);
     bool retainedSelectionEnabled() const;
+    void setRetainedSelectionSizeLimit(qint64 limit);
+    qint64 retainedSelectionSizeLimit() const;
     void overrideSelection(const QMimeData *data);
 
     WaylandSeat *defaultSeat() const;
@@ -137,6 +140,7 @@ Q_SIGNALS:
     void createdChanged();
     void socketNameChanged(const QByteArray &socketName);
     void retainedSelectionChanged(bool retainedSelection);
+    void retainedSelectionSizeLimitChanged(qint64 retainedSelectionSizeLimit);
 
     void surfaceRequested(Aurora::Compositor::WaylandClient *client, uint id, int version);
     void surfaceCreated(Aurora::Compositor::WaylandSurface *surface);
@@ -37,12 +37,37 @@ namespace Aurora {
 
 namespace Compositor {
 
+class WaylandCompositorPrivate;
+
 namespace Internal {
     class HardwareIntegration;
     class ClientBufferIntegration;
     class ServerBufferIntegration;
     class DataDeviceManager;
     class BufferManager;
+
+/*
+    Protocol objects that send a group of state changes followed by "done".
+    Changes made during one event loop iteration are accumulated and sent
+    together, right before the compositor flushes clients.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT PendingDone
+{
+public:
+    virtual ~PendingDone();
+
+    void scheduleDone(WaylandCompositor *compositor);
+    void cancelDone();
+    bool isDoneScheduled() const { return m_doneCompositor != nullptr; }
+
+protected:
+    virtual void sendPendingDone() = 0;
+
+private:
+    friend class Aurora::Compositor::WaylandCompositorPrivate;
+
+    WaylandCompositor *m_doneCompositor = nullptr;
+};
 }
 
 class WaylandSurface;
@@ -90,6 +115,8 @@ public:
 
     void addPolishObject(QObject *object);
 
+    void flushPendingDone();
+
     inline void addOutput(WaylandOutput *output);
     inline void removeOutput(WaylandOutput *output);
 
@@ -144,14 +171,19 @@ protected:
     QScopedPointer<QWindowSystemEventHandler> eventHandler;
 
     bool retainSelection = false;
+    qint64 retainedSelectionSizeLimit = 0;
     bool preInitialized = false;
     bool initialized = false;
+    qint64 componentBeginTime = 0;
     std::vector<QPointer<QObject> > polish_objects;
+    QList<Internal::PendingDone *> pendingDone;
 
 #if LIRI_FEATURE_aurora_xkbcommon
     XkbCommon::ScopedXKBContext mXkbContext;
 #endif
 
+    friend class Internal::PendingDone;
+
     Q_DECLARE_PUBLIC(WaylandCompositor)
     Q_DISABLE_COPY(WaylandCompositorPrivate)
 };
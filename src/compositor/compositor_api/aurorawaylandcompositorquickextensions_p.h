@@ -26,6 +26,7 @@
 #include <LiriAuroraCompositor/aurorawaylandtextinputmanagerv3.h>
 #include <LiriAuroraCompositor/aurorawaylandqttextinputmethodmanager.h>
 #include <LiriAuroraCompositor/aurorawaylandidleinhibitv1.h>
+#include <LiriAuroraCompositor/aurorawaylandrelativepointerv1.h>
 
 namespace Aurora {
 
@@ -83,6 +84,7 @@ private:
 // Note: These have to be in a header with a Q_OBJECT macro, otherwise we won't run moc on it
 AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandQtWindowManager, QtWindowManager)
 AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandIdleInhibitManagerV1, IdleInhibitManagerV1)
+AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandRelativePointerManagerV1, RelativePointerManagerV1)
 AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandTextInputManager, TextInputManager)
 AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandTextInputManagerV3, TextInputManagerV3)
 AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_NAMED_CLASS(WaylandQtTextInputMethodManager, QtTextInputMethodManager)
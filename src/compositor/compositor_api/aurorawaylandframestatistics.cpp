@@ -0,0 +1,247 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aurorawaylandframestatistics_p.h"
+
+#include <QtCore/QTimerEvent>
+#include <QtCore/QtMath>
+
+#include <algorithm>
+
+namespace Aurora {
+
+namespace Compositor {
+
+// Stages come from QML as plain integers
+static inline bool isValidStage(int stage)
+{
+    return stage >= 0 && stage < Internal::FrameTracer::StageCount;
+}
+
+/*!
+ * \qmltype WaylandFrameStatistics
+ * \inqmlmodule Aurora.Compositor
+ * \preliminary
+ * \brief Reports how long each stage of a frame takes.
+ *
+ * While enabled, the compositor records the time spent handling surface
+ * commits, uploading and importing client buffers, updating the paint nodes,
+ * waiting for page flips and sending frame callbacks. Every \l interval
+ * milliseconds the most recent \l sampleCount durations of each stage are
+ * collected, percentile() returns the statistics and the updated() signal
+ * is emitted.
+ *
+ * Recording is process wide: it goes on while any instance is enabled or
+ * the AURORA_FRAME_TRACE environment variable is set, in which case the
+ * trace is saved when the application quits.
+ *
+ * \qml
+ * WaylandFrameStatistics {
+ *     id: frameStatistics
+ *     enabled: true
+ *     onUpdated: console.log("99th percentile of paint node updates:",
+ *                            percentile(WaylandFrameStatistics.PaintNodeUpdate, 99), "ms")
+ * }
+ * \endqml
+ */
+
+WaylandFrameStatistics::WaylandFrameStatistics(QObject *parent)
+    : QObject(parent)
+{
+}
+
+WaylandFrameStatistics::~WaylandFrameStatistics()
+{
+    if (m_enabled) {
+        if (auto *tracer = Internal::FrameTracer::instance())
+            tracer->release();
+    }
+}
+
+/*!
+ * \qmlproperty bool AuroraCompositor::WaylandFrameStatistics::enabled
+ *
+ * This property holds whether frame stages are recorded.
+ * The default value is \c false.
+ */
+bool WaylandFrameStatistics::isEnabled() const
+{
+    return m_enabled;
+}
+
+void WaylandFrameStatistics::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled)
+        return;
+
+    auto *tracer = Internal::FrameTracer::instance();
+    if (!tracer)
+        return;
+
+    m_enabled = enabled;
+    if (enabled) {
+        tracer->acquire();
+        m_firstFrame = tracer->frame();
+        m_timer.start(m_interval, this);
+    } else {
+        tracer->release();
+        m_timer.stop();
+    }
+    emit enabledChanged();
+}
+
+/*!
+ * \qmlproperty int AuroraCompositor::WaylandFrameStatistics::sampleCount
+ *
+ * This property holds how many of the most recent durations of each stage
+ * are used for the percentiles.
+ * The default value is 300.
+ */
+int WaylandFrameStatistics::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+void WaylandFrameStatistics::setSampleCount(int count)
+{
+    count = qMax(1, count);
+    if (m_sampleCount == count)
+        return;
+
+    m_sampleCount = count;
+    emit sampleCountChanged();
+}
+
+/*!
+ * \qmlproperty int AuroraCompositor::WaylandFrameStatistics::interval
+ *
+ * This property holds how often, in milliseconds, the statistics are updated.
+ * The default value is 1000.
+ */
+int WaylandFrameStatistics::interval() const
+{
+    return m_interval;
+}
+
+void WaylandFrameStatistics::setInterval(int interval)
+{
+    interval = qMax(1, interval);
+    if (m_interval == interval)
+        return;
+
+    m_interval = interval;
+    if (m_timer.isActive())
+        m_timer.start(m_interval, this);
+    emit intervalChanged();
+}
+
+/*!
+ * \qmlproperty int AuroraCompositor::WaylandFrameStatistics::frameCount
+ *
+ * This property holds how many frames were sent since the statistics
+ * were enabled, as of the last update.
+ */
+int WaylandFrameStatistics::frameCount() const
+{
+    auto *tracer = Internal::FrameTracer::instance();
+    if (!m_enabled || !tracer)
+        return 0;
+    return int(tracer->frame() - m_firstFrame);
+}
+
+/*!
+ * \qmlmethod real AuroraCompositor::WaylandFrameStatistics::percentile(enumeration stage, real percentile)
+ *
+ * Returns the duration in milliseconds that the given \a percentile, between 0 and 100,
+ * of the recent events of \a stage don't exceed. Returns 0 when there are no events
+ * or \a stage is not valid.
+ */
+qreal WaylandFrameStatistics::percentile(Stage stage, qreal percentile) const
+{
+    if (!isValidStage(stage))
+        return 0;
+
+    const QVector<qint64> &samples = m_samples[stage];
+    if (samples.isEmpty())
+        return 0;
+
+    // Nearest rank
+    const int rank = qCeil(qBound<qreal>(0, percentile, 100) / 100 * samples.size());
+    const int index = qBound(0, rank - 1, int(samples.size()) - 1);
+    return samples.at(index) / 1000000.0;
+}
+
+/*!
+ * \qmlmethod int AuroraCompositor::WaylandFrameStatistics::samples(enumeration stage)
+ *
+ * Returns how many durations of \a stage the percentiles are based on,
+ * or 0 if \a stage is not valid.
+ */
+int WaylandFrameStatistics::samples(Stage stage) const
+{
+    if (!isValidStage(stage))
+        return 0;
+
+    return int(m_samples[stage].size());
+}
+
+/*!
+ * \qmlmethod bool AuroraCompositor::WaylandFrameStatistics::saveTrace(url fileUrl, enumeration format)
+ *
+ * Saves the events still in the buffer to \a fileUrl, in the given \a format:
+ * \c WaylandFrameStatistics.ChromeTrace is a JSON file that Perfetto and chrome://tracing open,
+ * \c WaylandFrameStatistics.BinaryTrace is a compact binary stream.
+ *
+ * Returns \c true on success.
+ */
+bool WaylandFrameStatistics::saveTrace(const QUrl &fileUrl, TraceFormat format) const
+{
+    auto *tracer = Internal::FrameTracer::instance();
+    if (!tracer)
+        return false;
+
+    const QString fileName = fileUrl.isLocalFile() ? fileUrl.toLocalFile() : fileUrl.path();
+    return tracer->save(fileName, static_cast<Internal::FrameTracer::Format>(format));
+}
+
+/*!
+ * \qmlmethod void AuroraCompositor::WaylandFrameStatistics::update()
+ *
+ * Collects the most recent events now, instead of waiting for the next interval.
+ */
+void WaylandFrameStatistics::update()
+{
+    auto *tracer = Internal::FrameTracer::instance();
+    if (!tracer)
+        return;
+
+    for (auto &samples : m_samples)
+        samples.clear();
+
+    // Walk from the newest event until each stage has enough of them
+    const QVector<Internal::FrameTracer::Event> events = tracer->events();
+    for (auto it = events.crbegin(); it != events.crend(); ++it) {
+        QVector<qint64> &samples = m_samples[it->stage];
+        if (samples.size() < m_sampleCount)
+            samples.append(it->end - it->begin);
+    }
+
+    for (auto &samples : m_samples)
+        std::sort(samples.begin(), samples.end());
+
+    emit updated();
+}
+
+void WaylandFrameStatistics::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_timer.timerId())
+        update();
+    else
+        QObject::timerEvent(event);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawaylandframestatistics_p.cpp"
@@ -0,0 +1,102 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QBasicTimer>
+#include <QtCore/QObject>
+#include <QtCore/QUrl>
+#include <QtCore/QVector>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+#include <LiriAuroraCompositor/auroraqmlinclude.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
+
+#include <array>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class LIRIAURORACOMPOSITOR_EXPORT WaylandFrameStatistics : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int sampleCount READ sampleCount WRITE setSampleCount NOTIFY sampleCountChanged)
+    Q_PROPERTY(int interval READ interval WRITE setInterval NOTIFY intervalChanged)
+    Q_PROPERTY(int frameCount READ frameCount NOTIFY updated)
+    QML_NAMED_ELEMENT(WaylandFrameStatistics)
+public:
+    enum Stage {
+        SurfaceCommit = Internal::FrameTracer::SurfaceCommit,
+        ShmTextureUpload = Internal::FrameTracer::ShmTextureUpload,
+        DmabufTextureImport = Internal::FrameTracer::DmabufTextureImport,
+        PaintNodeUpdate = Internal::FrameTracer::PaintNodeUpdate,
+        WaitForFlip = Internal::FrameTracer::WaitForFlip,
+        FrameCallbacks = Internal::FrameTracer::FrameCallbacks
+    };
+    Q_ENUM(Stage)
+
+    enum TraceFormat {
+        ChromeTrace = Internal::FrameTracer::ChromeTrace,
+        BinaryTrace = Internal::FrameTracer::Binary
+    };
+    Q_ENUM(TraceFormat)
+
+    explicit WaylandFrameStatistics(QObject *parent = nullptr);
+    ~WaylandFrameStatistics() override;
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+
+    int sampleCount() const;
+    void setSampleCount(int count);
+
+    int interval() const;
+    void setInterval(int interval);
+
+    int frameCount() const;
+
+    Q_INVOKABLE qreal percentile(Aurora::Compositor::WaylandFrameStatistics::Stage stage, qreal percentile) const;
+    Q_INVOKABLE int samples(Aurora::Compositor::WaylandFrameStatistics::Stage stage) const;
+
+    Q_INVOKABLE bool saveTrace(const QUrl &fileUrl,
+                               Aurora::Compositor::WaylandFrameStatistics::TraceFormat format = ChromeTrace) const;
+
+public Q_SLOTS:
+    void update();
+
+Q_SIGNALS:
+    void enabledChanged();
+    void sampleCountChanged();
+    void intervalChanged();
+    void updated();
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    bool m_enabled = false;
+    int m_sampleCount = 300;
+    int m_interval = 1000;
+    quint64 m_firstFrame = 0;
+    QBasicTimer m_timer;
+
+    // Durations of the most recent events of each stage, sorted
+    std::array<QVector<qint64>, Internal::FrameTracer::StageCount> m_samples;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
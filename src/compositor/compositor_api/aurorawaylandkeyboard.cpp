@@ -9,15 +9,12 @@
 #include <LiriAuroraCompositor/WaylandSeat>
 #include <LiriAuroraCompositor/WaylandClient>
 
-#include <QtCore/QFile>
-#include <QtCore/QStandardPaths>
+#include "aurorastartuptrace_p.h"
 
 #include <QKeyEvent>
 #include <fcntl.h>
 #include <unistd.h>
 #if LIRI_FEATURE_aurora_xkbcommon
-#include <sys/mman.h>
-#include <sys/types.h>
 #include <xkbcommon/xkbcommon-names.h>
 #endif
 
@@ -32,14 +29,6 @@ WaylandKeyboardPrivate::WaylandKeyboardPrivate(WaylandSeat *seat)
 
 WaylandKeyboardPrivate::~WaylandKeyboardPrivate()
 {
-#if LIRI_FEATURE_aurora_xkbcommon
-    if (xkbContext()) {
-        if (keymap_area)
-            munmap(keymap_area, keymap_size);
-        if (keymap_fd >= 0)
-            close(keymap_fd);
-    }
-#endif
 }
 
 WaylandKeyboardPrivate *WaylandKeyboardPrivate::get(WaylandKeyboard *keyboard)
@@ -105,9 +94,8 @@ void WaylandKeyboardPrivate::keyboard_bind_resource(wl_keyboard::Resource *resou
         send_repeat_info(resource->handle, repeatRate, repeatDelay);
 
 #if LIRI_FEATURE_aurora_xkbcommon
-    if (xkbContext()) {
-        send_keymap(resource->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
-                    keymap_fd, keymap_size);
+    if (xkbContext() && mKeymap && mKeymap->fd() >= 0) {
+        sendKeymap(resource);
     } else
 #endif
     {
@@ -251,9 +239,10 @@ void WaylandKeyboardPrivate::maybeUpdateKeymap()
         return;
 
     createXKBKeymap();
-    const auto resMap = resourceMap();
-    for (Resource *res : resMap) {
-        send_keymap(res->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, keymap_fd, keymap_size);
+    if (mKeymap && mKeymap->fd() >= 0) {
+        const auto resMap = resourceMap();
+        for (Resource *res : resMap)
+            sendKeymap(res);
     }
 
     xkb_state_update_mask(xkbState(), 0, modsLatched, modsLocked, 0, 0, 0);
@@ -298,67 +287,23 @@ uint WaylandKeyboardPrivate::toWaylandKey(const uint nativeScanCode)
 }
 
 #if LIRI_FEATURE_aurora_xkbcommon
-static int createAnonymousFile(size_t size)
+// The file is sealed and shared by all clients of all seats
+void WaylandKeyboardPrivate::sendKeymap(Resource *resource)
 {
-    QString path = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
-    if (path.isEmpty())
-        return -1;
-
-    QByteArray name = QFile::encodeName(path + QStringLiteral("/qtwayland-XXXXXX"));
-
-    int fd = mkstemp(name.data());
-    if (fd < 0)
-        return -1;
-
-    long flags = fcntl(fd, F_GETFD);
-    if (flags == -1 || fcntl(fd, F_SETFD, flags | FD_CLOEXEC) == -1) {
-        close(fd);
-        fd = -1;
-    }
-    unlink(name.constData());
-
-    if (fd < 0)
-        return -1;
-
-    if (ftruncate(fd, size) < 0) {
-        close(fd);
-        return -1;
-    }
-
-    return fd;
+    send_keymap(resource->handle, WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1,
+                mKeymap->fd(), mKeymap->size());
 }
 
-void WaylandKeyboardPrivate::createXKBState(xkb_keymap *keymap)
+void WaylandKeyboardPrivate::createXKBState(std::shared_ptr<XkbKeymap> keymap)
 {
-    char *keymap_str = xkb_keymap_get_as_string(keymap, XKB_KEYMAP_FORMAT_TEXT_V1);
-    if (!keymap_str) {
-        qWarning("Failed to compile global XKB keymap");
-        return;
-    }
-
-    keymap_size = strlen(keymap_str) + 1;
-    if (keymap_fd >= 0)
-        close(keymap_fd);
-    keymap_fd = createAnonymousFile(keymap_size);
-    if (keymap_fd < 0) {
-        qWarning("Failed to create anonymous file of size %lu", static_cast<unsigned long>(keymap_size));
-        return;
-    }
-
-    keymap_area = static_cast<char *>(mmap(nullptr, keymap_size, PROT_READ | PROT_WRITE, MAP_SHARED, keymap_fd, 0));
-    if (keymap_area == MAP_FAILED) {
-        close(keymap_fd);
-        keymap_fd = -1;
-        qWarning("Failed to map shared memory segment");
-        return;
-    }
-
-    strcpy(keymap_area, keymap_str);
-    free(keymap_str);
+    if (keymap->fd() < 0)
+        qWarning("Failed to share the XKB keymap with clients");
 
-    mXkbState.reset(xkb_state_new(keymap));
+    mXkbState = keymap->createState();
     if (!mXkbState)
         qWarning("Failed to create XKB state");
+
+    mKeymap = std::move(keymap);
 }
 
 void WaylandKeyboardPrivate::createXKBKeymap()
@@ -366,33 +311,29 @@ void WaylandKeyboardPrivate::createXKBKeymap()
     if (!xkbContext())
         return;
 
-    WaylandKeymap *keymap = seat->keymap();
-    QByteArray rules = keymap->rules().toLocal8Bit();
-    QByteArray model = keymap->model().toLocal8Bit();
-    QByteArray layout = keymap->layout().toLocal8Bit();
-    QByteArray variant = keymap->variant().toLocal8Bit();
-    QByteArray options = keymap->options().toLocal8Bit();
+    StartupTrace::Span span("input", "keymap");
 
-    if (!layout.isEmpty() && !layout.contains("us")) {
+    WaylandKeymap *keymap = seat->keymap();
+    XkbKeymapCache::RuleNames names;
+    names.rules = keymap->rules().toLocal8Bit();
+    names.model = keymap->model().toLocal8Bit();
+    names.layout = keymap->layout().toLocal8Bit();
+    names.variant = keymap->variant().toLocal8Bit();
+    names.options = keymap->options().toLocal8Bit();
+
+    if (!names.layout.isEmpty() && !names.layout.contains("us")) {
         // This is needed for shortucts like "ctrl+c" to function even when
         // user has selected only non-latin keyboard layouts, e.g. 'ru'.
-        layout.append(",us");
-        variant.append(",");
+        names.layout.append(",us");
+        names.variant.append(",");
     }
 
-    struct xkb_rule_names rule_names = {
-        rules.constData(),
-        model.constData(),
-        layout.constData(),
-        variant.constData(),
-        options.constData()
-    };
-
-    XkbCommon::ScopedXKBKeymap xkbKeymap(xkb_keymap_new_from_names(xkbContext(), &rule_names,
-                                                                    XKB_KEYMAP_COMPILE_NO_FLAGS));
+    // Compiling takes tens of milliseconds, seats and layout
+    // switches reuse what was compiled before
+    std::shared_ptr<XkbKeymap> xkbKeymap = XkbKeymapCache::keymap(names);
     if (xkbKeymap) {
         scanCodesByQtKey.clear();
-        createXKBState(xkbKeymap.get());
+        createXKBState(std::move(xkbKeymap));
     } else {
         qWarning("Failed to load the '%s' XKB keymap.", qPrintable(keymap->layout()));
     }
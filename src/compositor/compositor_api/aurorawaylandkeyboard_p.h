@@ -28,6 +28,7 @@
 #if LIRI_FEATURE_aurora_xkbcommon
 #include <xkbcommon/xkbcommon.h>
 #include <LiriAuroraXkbCommonSupport/private/auroraxkbcommon_p.h>
+#include <LiriAuroraXkbCommonSupport/private/auroraxkbkeymapcache_p.h>
 #endif
 
 
@@ -77,7 +78,8 @@ protected:
 private:
 #if LIRI_FEATURE_aurora_xkbcommon
     void createXKBKeymap();
-    void createXKBState(xkb_keymap *keymap);
+    void createXKBState(std::shared_ptr<XkbKeymap> keymap);
+    void sendKeymap(Resource *resource);
 #endif
     static uint toWaylandKey(const uint nativeScanCode);
     static uint fromWaylandKey(const uint key);
@@ -104,12 +106,11 @@ private:
 
     bool pendingKeymap = false;
 #if LIRI_FEATURE_aurora_xkbcommon
-    size_t keymap_size;
-    int keymap_fd = -1;
-    char *keymap_area = nullptr;
+    // Compiled once and shared with the other keyboards using the same names
+    std::shared_ptr<XkbKeymap> mKeymap;
     using ScanCodeKey = std::pair<uint,int>; // group/layout and QtKey
     QMap<ScanCodeKey, uint> scanCodesByQtKey;
-    XkbCommon::ScopedXKBState mXkbState;
+    XkbKeymap::ScopedState mXkbState;
 #endif
 
     quint32 repeatRate = 40;
@@ -8,12 +8,17 @@
 #include <LiriAuroraCompositor/WaylandCompositor>
 #include <LiriAuroraCompositor/WaylandView>
 
+#include <LiriAuroraCompositor/WaylandSeat>
 #include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandpointer_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandview_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandutils_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandxdgoutputv1_p.h>
 
+#include "auroraframetracer_p.h"
+#include "aurorastartuptracer_p.h"
+
 #include <QtCore/QCoreApplication>
 #include <QtCore/QtMath>
 #include <QtGui/QWindow>
@@ -124,14 +129,14 @@ void WaylandOutputPrivate::sendGeometry(const Resource *resource)
 
 void WaylandOutputPrivate::sendGeometryInfo()
 {
+    if (xdgOutput)
+        WaylandXdgOutputV1Private::get(xdgOutput)->sendChangesBeforeOutputDone();
+
     for (const Resource *resource : resourceMap().values()) {
         sendGeometry(resource);
         if (resource->version() >= 2)
             send_done(resource->handle);
     }
-
-    if (xdgOutput)
-        WaylandXdgOutputV1Private::get(xdgOutput)->sendDone();
 }
 
 void WaylandOutputPrivate::sendMode(const Resource *resource, const WaylandOutputMode &mode)
@@ -149,15 +154,15 @@ void WaylandOutputPrivate::sendMode(const Resource *resource, const WaylandOutpu
 
 void WaylandOutputPrivate::sendModesInfo()
 {
+    if (xdgOutput)
+        WaylandXdgOutputV1Private::get(xdgOutput)->sendChangesBeforeOutputDone();
+
     for (const Resource *resource : resourceMap().values()) {
         for (const WaylandOutputMode &mode : modes)
             sendMode(resource, mode);
         if (resource->version() >= 2)
             send_done(resource->handle);
     }
-
-    if (xdgOutput)
-        WaylandXdgOutputV1Private::get(xdgOutput)->sendDone();
 }
 
 void WaylandOutputPrivate::handleWindowPixelSizeChanged()
@@ -809,6 +814,9 @@ void WaylandOutput::setScaleFactor(int scale)
 
     d->scaleFactor = scale;
 
+    if (d->xdgOutput)
+        WaylandXdgOutputV1Private::get(d->xdgOutput)->sendChangesBeforeOutputDone();
+
     const auto resMap = d->resourceMap();
     for (WaylandOutputPrivate::Resource *resource : resMap) {
         if (resource->version() >= 2) {
@@ -818,9 +826,6 @@ void WaylandOutput::setScaleFactor(int scale)
     }
 
     Q_EMIT scaleFactorChanged();
-
-    if (d->xdgOutput)
-        WaylandXdgOutputV1Private::get(d->xdgOutput)->sendDone();
 }
 
 /*!
@@ -907,25 +912,46 @@ void WaylandOutput::frameStarted()
 }
 
 /*!
- * Sends pending frame callbacks.
+ * Sends pending frame callbacks, and the pointer motion that was held back
+ * until the next frame of this output.
  */
 void WaylandOutput::sendFrameCallbacks()
 {
     Q_D(WaylandOutput);
-    for (int i = 0; i < d->surfaceViews.size(); i++) {
-        const WaylandSurfaceViewMapper &surfacemapper = d->surfaceViews.at(i);
-        if (surfacemapper.surface && surfacemapper.surface->hasContent()) {
-            if (!surfacemapper.has_entered) {
-                surfaceEnter(surfacemapper.surface);
-                d->surfaceViews[i].has_entered = true;
-            }
-            if (auto primaryView = surfacemapper.maybePrimaryView()) {
-                if (!WaylandViewPrivate::get(primaryView)->independentFrameCallback)
-                    surfacemapper.surface->sendFrameCallbacks();
+    {
+        Internal::FrameTracer::Scope trace(Internal::FrameTracer::FrameCallbacks);
+
+        for (int i = 0; i < d->surfaceViews.size(); i++) {
+            const WaylandSurfaceViewMapper &surfacemapper = d->surfaceViews.at(i);
+            if (surfacemapper.surface && surfacemapper.surface->hasContent()) {
+                if (!surfacemapper.has_entered) {
+                    surfaceEnter(surfacemapper.surface);
+                    d->surfaceViews[i].has_entered = true;
+                }
+                if (auto primaryView = surfacemapper.maybePrimaryView()) {
+                    if (!WaylandViewPrivate::get(primaryView)->independentFrameCallback)
+                        surfacemapper.surface->sendFrameCallbacks();
+                }
             }
         }
+
+        // Pointer motion on this output was held back until now
+        const auto seats = d->compositor->seats();
+        for (WaylandSeat *seat : seats) {
+            WaylandPointer *pointer = seat->pointer();
+            if (pointer && pointer->output() == this)
+                WaylandPointerPrivate::get(pointer)->sendPendingMotion();
+        }
+
+        WaylandCompositorPrivate::get(d->compositor)->flushPendingDone();
+        wl_display_flush_clients(d->compositor->display());
     }
-    wl_display_flush_clients(d->compositor->display());
+
+    if (auto *tracer = Internal::FrameTracer::instance())
+        tracer->frameSent();
+
+    if (auto *tracer = Internal::StartupTracer::instance())
+        tracer->frameSent();
 }
 
 /*!
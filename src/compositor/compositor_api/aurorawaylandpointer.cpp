@@ -5,6 +5,8 @@
 #include "aurorawaylandpointer_p.h"
 #include <LiriAuroraCompositor/WaylandClient>
 #include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandOutput>
+#include <LiriAuroraCompositor/private/aurorawaylandrelativepointerv1_p.h>
 
 namespace Aurora {
 
@@ -16,6 +18,16 @@ WaylandPointerPrivate::WaylandPointerPrivate(WaylandPointer *pointer, WaylandSea
     : seat(seat)
 {
     Q_UNUSED(pointer);
+
+    motionTimer.setSingleShot(true);
+    motionTimer.setTimerType(Qt::PreciseTimer);
+}
+
+WaylandPointer *WaylandPointerPrivate::fromResource(wl_resource *resource)
+{
+    if (auto *r = Resource::fromResource(resource))
+        return static_cast<WaylandPointerPrivate *>(r->pointer_object)->q_func();
+    return nullptr;
 }
 
 uint WaylandPointerPrivate::sendButton(Qt::MouseButton button, uint32_t state)
@@ -27,22 +39,83 @@ uint WaylandPointerPrivate::sendButton(Qt::MouseButton button, uint32_t state)
     if (!seat->isInputAllowed(q->mouseFocus()->surface()))
         return 0;
 
+    // The button was pressed where the pointer is now
+    sendPendingMotion();
+
     wl_client *client = q->mouseFocus()->surface()->waylandClient();
     uint32_t time = compositor()->currentTimeMsecs();
     uint32_t serial = compositor()->nextSerial();
-    for (auto resource : resourceMap().values(client))
-        send_button(resource->handle, serial, time, q->toWaylandButton(button), state);
+    const auto range = resourceMap().equal_range(client);
+    for (auto it = range.first; it != range.second; ++it)
+        send_button((*it)->handle, serial, time, q->toWaylandButton(button), state);
+    sendFrame(client);
     return serial;
 }
 
 void WaylandPointerPrivate::sendMotion()
 {
     Q_ASSERT(enteredSurface);
-    uint32_t time = compositor()->currentTimeMsecs();
-    wl_fixed_t x = wl_fixed_from_double(localPosition.x());
-    wl_fixed_t y = wl_fixed_from_double(localPosition.y());
-    for (auto resource : resourceMap().values(enteredSurface->waylandClient()))
-        wl_pointer_send_motion(resource->handle, time, x, y);
+    motionTime = compositor()->currentTimeMsecs();
+    motionPending = true;
+    scheduleMotion();
+}
+
+void WaylandPointerPrivate::scheduleMotion()
+{
+    // Without an output there are no frames to wait for
+    const int refreshRate = output ? output->currentMode().refreshRate() : 0;
+    if (refreshRate <= 0) {
+        sendPendingMotion();
+        return;
+    }
+
+    // Motion is sent with the next frame of the output, or after
+    // a refresh interval when the output doesn't render anything
+    if (!motionTimer.isActive())
+        motionTimer.start(qMax(1, 1000000 / refreshRate));
+}
+
+void WaylandPointerPrivate::sendPendingMotion()
+{
+    motionTimer.stop();
+
+    if (!motionPending && !relativeMotionPending)
+        return;
+
+    if (enteredSurface) {
+        wl_client *client = enteredSurface->waylandClient();
+
+        if (motionPending) {
+            wl_fixed_t x = wl_fixed_from_double(localPosition.x());
+            wl_fixed_t y = wl_fixed_from_double(localPosition.y());
+            const auto range = resourceMap().equal_range(client);
+            for (auto it = range.first; it != range.second; ++it)
+                send_motion((*it)->handle, motionTime, x, y);
+        }
+
+        if (relativeMotionPending) {
+            for (auto *relativePointer : std::as_const(relativePointers)) {
+                if (relativePointer->resource()->client() == client)
+                    relativePointer->sendRelativeMotion(relativeMotionTime, relativeDelta, relativeDeltaUnaccelerated);
+            }
+        }
+
+        sendFrame(client);
+    }
+
+    motionPending = false;
+    relativeMotionPending = false;
+    relativeDelta = QPointF();
+    relativeDeltaUnaccelerated = QPointF();
+}
+
+void WaylandPointerPrivate::sendFrame(wl_client *client)
+{
+    const auto range = resourceMap().equal_range(client);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (wl_resource_get_version((*it)->handle) >= WL_POINTER_FRAME_SINCE_VERSION)
+            send_frame((*it)->handle);
+    }
 }
 
 void WaylandPointerPrivate::sendEnter(WaylandSurface *surface)
@@ -50,14 +123,24 @@ void WaylandPointerPrivate::sendEnter(WaylandSurface *surface)
     Q_ASSERT(surface && !enteredSurface);
     enterSerial = compositor()->nextSerial();
 
+    // The enter event carries the position, and the deltas
+    // happened on another surface
+    motionTimer.stop();
+    motionPending = false;
+    relativeMotionPending = false;
+    relativeDelta = QPointF();
+    relativeDeltaUnaccelerated = QPointF();
+
     WaylandKeyboard *keyboard = seat->keyboard();
     if (keyboard)
         keyboard->sendKeyModifiers(surface->client(), enterSerial);
 
     wl_fixed_t x = wl_fixed_from_double(localPosition.x());
     wl_fixed_t y = wl_fixed_from_double(localPosition.y());
-    for (auto resource : resourceMap().values(surface->waylandClient()))
-        send_enter(resource->handle, enterSerial, surface->resource(), x, y);
+    const auto range = resourceMap().equal_range(surface->waylandClient());
+    for (auto it = range.first; it != range.second; ++it)
+        send_enter((*it)->handle, enterSerial, surface->resource(), x, y);
+    sendFrame(surface->waylandClient());
 
     enteredSurface = surface;
     enteredSurfaceDestroyListener.listenForDestruction(surface->resource());
@@ -66,9 +149,16 @@ void WaylandPointerPrivate::sendEnter(WaylandSurface *surface)
 void WaylandPointerPrivate::sendLeave()
 {
     Q_ASSERT(enteredSurface);
+
+    // Let the surface know where the pointer left
+    sendPendingMotion();
+
     uint32_t serial = compositor()->nextSerial();
-    for (auto resource : resourceMap().values(enteredSurface->waylandClient()))
-        send_leave(resource->handle, serial, enteredSurface->resource());
+    wl_client *client = enteredSurface->waylandClient();
+    const auto range = resourceMap().equal_range(client);
+    for (auto it = range.first; it != range.second; ++it)
+        send_leave((*it)->handle, serial, enteredSurface->resource());
+    sendFrame(client);
     localPosition = QPointF();
     enteredSurfaceDestroyListener.reset();
     enteredSurface = nullptr;
@@ -132,6 +222,9 @@ WaylandPointer::WaylandPointer(WaylandSeat *seat, QObject *parent)
     : WaylandObject(* new WaylandPointerPrivate(this, seat), parent)
 {
     connect(&d_func()->enteredSurfaceDestroyListener, &WaylandDestroyListener::fired, this, &WaylandPointer::enteredSurfaceDestroyed);
+    connect(&d_func()->motionTimer, &QTimer::timeout, this, [this]() {
+        d_func()->sendPendingMotion();
+    });
     connect(seat, &WaylandSeat::mouseFocusChanged, this, &WaylandPointer::pointerFocusChanged);
 }
 
@@ -208,6 +301,9 @@ uint WaylandPointer::sendMouseReleaseEvent(Qt::MouseButton button)
 /*!
  * Sets the current mouse focus to \a view and sends a mouse move event to it with the
  * local position \a localPos in surface coordinates and output space position \a outputSpacePos.
+ *
+ * When the view is on an output, the motion is sent with the next frame of the output,
+ * and the mouse move events received in the meantime are merged.
  */
 void WaylandPointer::sendMouseMoveEvent(WaylandView *view, const QPointF &localPos, const QPointF &outputSpacePos)
 {
@@ -227,14 +323,41 @@ void WaylandPointer::sendMouseMoveEvent(WaylandView *view, const QPointF &localP
         if (d->localPosition.y() == size.height())
             d->localPosition.ry() -= 0.01;
 
-        d->ensureEntered(view->surface());
-        d->sendMotion();
-
         if (view->output())
             setOutput(view->output());
+
+        if (d->enteredSurface == view->surface()) {
+            d->sendMotion();
+        } else {
+            // The enter event carries the position
+            d->ensureEntered(view->surface());
+        }
     }
 }
 
+/*!
+ * Sends a relative motion event with the motion vector \a delta and the motion vector
+ * without acceleration \a deltaUnaccelerated, that happened at \a timestamp in
+ * microseconds, to the relative pointers of the client that holds mouse focus.
+ *
+ * Relative motion is not clipped to the outputs. The deltas received before the next
+ * frame of the output are added up and sent along with the mouse move event.
+ *
+ * \sa WaylandRelativePointerManagerV1
+ */
+void WaylandPointer::sendRelativeMotionEvent(const QPointF &delta, const QPointF &deltaUnaccelerated, quint64 timestamp)
+{
+    Q_D(WaylandPointer);
+    if (!d->enteredSurface || d->relativePointers.isEmpty())
+        return;
+
+    d->relativeDelta += delta;
+    d->relativeDeltaUnaccelerated += deltaUnaccelerated;
+    d->relativeMotionTime = timestamp;
+    d->relativeMotionPending = true;
+    d->scheduleMotion();
+}
+
 /*!
  * Sends a mouse wheel event with the given \a orientation and \a delta to the view that currently holds mouse focus.
  */
@@ -247,12 +370,17 @@ void WaylandPointer::sendMouseWheelEvent(Qt::Orientation orientation, int delta)
     if (!d->seat->isInputAllowed(d->enteredSurface))
         return;
 
+    d->sendPendingMotion();
+
     uint32_t time = d->compositor()->currentTimeMsecs();
     uint32_t axis = orientation == Qt::Horizontal ? WL_POINTER_AXIS_HORIZONTAL_SCROLL
                                                   : WL_POINTER_AXIS_VERTICAL_SCROLL;
 
-    for (auto resource : d->resourceMap().values(d->enteredSurface->waylandClient()))
-        d->send_axis(resource->handle, time, axis, wl_fixed_from_int(-delta / 12));
+    wl_client *client = d->enteredSurface->waylandClient();
+    const auto range = d->resourceMap().equal_range(client);
+    for (auto it = range.first; it != range.second; ++it)
+        d->send_axis((*it)->handle, time, axis, wl_fixed_from_int(-delta / 12));
+    d->sendFrame(client);
 }
 
 /*!
@@ -302,6 +430,8 @@ void WaylandPointer::addClient(WaylandClient *client, uint32_t id, uint32_t vers
         d->send_enter(resource, d->enterSerial, d->enteredSurface->resource(),
                       wl_fixed_from_double(d->localPosition.x()),
                       wl_fixed_from_double(d->localPosition.y()));
+        if (wl_resource_get_version(resource) >= WL_POINTER_FRAME_SINCE_VERSION)
+            d->send_frame(resource);
     }
 }
 
@@ -36,6 +36,7 @@ public:
     virtual uint sendMouseReleaseEvent(Qt::MouseButton button);
     virtual void sendMouseMoveEvent(WaylandView *view, const QPointF &localPos, const QPointF &outputSpacePos);
     virtual void sendMouseWheelEvent(Qt::Orientation orientation, int delta);
+    void sendRelativeMotionEvent(const QPointF &delta, const QPointF &deltaUnaccelerated, quint64 timestamp);
 
     WaylandView *mouseFocus() const;
     QPointF currentLocalPosition() const;
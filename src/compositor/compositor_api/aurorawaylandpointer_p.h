@@ -22,6 +22,7 @@
 #include <QtCore/QList>
 #include <QtCore/QPoint>
 #include <QtCore/QObject>
+#include <QtCore/QTimer>
 #include <QtCore/private/qobject_p.h>
 
 #include <LiriAuroraCompositor/private/aurora-server-wayland.h>
@@ -38,6 +39,7 @@ namespace Aurora {
 namespace Compositor {
 
 class WaylandView;
+class WaylandRelativePointerV1;
 
 class LIRIAURORACOMPOSITOR_EXPORT WaylandPointerPrivate : public QObjectPrivate
                                                  , public PrivateServer::wl_pointer
@@ -46,8 +48,15 @@ class LIRIAURORACOMPOSITOR_EXPORT WaylandPointerPrivate : public QObjectPrivate
 public:
     WaylandPointerPrivate(WaylandPointer *pointer, WaylandSeat *seat);
 
+    static WaylandPointerPrivate *get(WaylandPointer *pointer) { return pointer ? pointer->d_func() : nullptr; }
+    static WaylandPointer *fromResource(wl_resource *resource);
+
     WaylandCompositor *compositor() const { return seat->compositor(); }
 
+    void sendPendingMotion();
+
+    QList<WaylandRelativePointerV1 *> relativePointers;
+
 protected:
     void pointer_set_cursor(Resource *resource, uint32_t serial, wl_resource *surface, int32_t hotspot_x, int32_t hotspot_y) override;
     void pointer_release(Resource *resource) override;
@@ -55,6 +64,8 @@ protected:
 private:
     uint sendButton(Qt::MouseButton button, uint32_t state);
     void sendMotion();
+    void scheduleMotion();
+    void sendFrame(wl_client *client);
     void sendEnter(WaylandSurface *surface);
     void sendLeave();
     void ensureEntered(WaylandSurface *surface);
@@ -68,6 +79,15 @@ private:
 
     uint enterSerial = 0;
 
+    // Motion is sent once per frame of the output, deltas are accumulated
+    bool motionPending = false;
+    bool relativeMotionPending = false;
+    uint32_t motionTime = 0;
+    quint64 relativeMotionTime = 0;
+    QPointF relativeDelta;
+    QPointF relativeDeltaUnaccelerated;
+    QTimer motionTimer;
+
     int buttonCount = 0;
 
     WaylandDestroyListener enteredSurfaceDestroyListener;
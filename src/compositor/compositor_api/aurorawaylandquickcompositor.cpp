@@ -21,6 +21,7 @@
 #include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
 #include <LiriAuroraCompositor/WaylandViewporter>
 #include "aurorawaylandsurfacegrabber.h"
+#include "aurorastartuptrace_p.h"
 
 namespace Aurora {
 
@@ -77,11 +78,21 @@ void WaylandQuickCompositor::create()
 
 void WaylandQuickCompositor::classBegin()
 {
-    WaylandCompositorPrivate::get(this)->preInit();
+    auto *d = WaylandCompositorPrivate::get(this);
+    if (StartupTrace::isActive())
+        d->componentBeginTime = StartupTrace::now();
+    d->preInit();
 }
 
 void WaylandQuickCompositor::componentComplete()
 {
+    // Time spent creating the compositor children from QML
+    auto *d = WaylandCompositorPrivate::get(this);
+    if (d->componentBeginTime > 0) {
+        StartupTrace::addSpan("qml", "compositorComponent", d->componentBeginTime, StartupTrace::now());
+        d->componentBeginTime = 0;
+    }
+
     create();
 }
 
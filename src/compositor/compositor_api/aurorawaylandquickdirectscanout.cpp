@@ -0,0 +1,369 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
+#include <QtQuick/QQuickWindow>
+
+#include "aurorawaylandbufferref_p.h"
+#include "aurorawaylandquickdirectscanout_p.h"
+#include "aurorawaylandquickitem_p.h"
+#include "aurorawaylandquickoutput.h"
+#include "aurorawaylandsurface_p.h"
+#include "wayland_wrapper/aurorawlclientbuffer_p.h"
+
+#if LIRI_FEATURE_aurora_qpa
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+#endif
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+// DRM_FORMAT_MOD_INVALID and DRM_FORMAT_MOD_LINEAR from drm_fourcc.h
+static const quint64 DrmFormatModInvalid = 0x00ffffffffffffffULL;
+static const quint64 DrmFormatModLinear = 0;
+
+static bool hasVisibleContent(QQuickItem *item)
+{
+    return item->flags().testFlag(QQuickItem::ItemHasContents)
+            && item->width() > 0 && item->height() > 0;
+}
+
+// Walks the tree in paint order and returns true when anything
+// is painted over target, after \a found was set
+static bool isPaintedOver(QQuickItem *item, QQuickItem *target, bool *found)
+{
+    if (!item->isVisible() || qFuzzyIsNull(item->opacity()))
+        return false;
+
+    // Children with a negative z are painted before their parent
+    bool selfPainted = false;
+    auto paintSelf = [&]() {
+        selfPainted = true;
+        if (item == target)
+            *found = true;
+        else if (*found && hasVisibleContent(item))
+            return true;
+        return false;
+    };
+
+    const QList<QQuickItem *> children = QQuickItemPrivate::get(item)->paintOrderChildItems();
+    for (QQuickItem *child : children) {
+        if (!selfPainted && child->z() >= 0 && paintSelf())
+            return true;
+        if (isPaintedOver(child, target, found))
+            return true;
+    }
+
+    return !selfPainted && paintSelf();
+}
+
+#if LIRI_FEATURE_aurora_qpa
+static bool toScanoutBuffer(const WaylandBufferRef &buffer, PlatformSupport::ScanoutBuffer *scanoutBuffer)
+{
+    ClientBuffer *clientBuffer = WaylandBufferRefPrivate::buffer(buffer);
+    if (!clientBuffer || clientBuffer->isDestroyed() || buffer.isSharedMemory())
+        return false;
+
+    DmabufAttributes attributes;
+    if (!clientBuffer->dmabufAttributes(&attributes))
+        return false;
+
+    scanoutBuffer->size = attributes.size;
+    scanoutBuffer->drmFormat = attributes.drmFormat;
+    scanoutBuffer->modifier = attributes.modifier;
+    scanoutBuffer->planeCount = attributes.planeCount;
+    for (int i = 0; i < attributes.planeCount; ++i) {
+        scanoutBuffer->fds[i] = attributes.fds[i];
+        scanoutBuffer->offsets[i] = attributes.offsets[i];
+        scanoutBuffer->strides[i] = attributes.strides[i];
+    }
+    scanoutBuffer->cacheKey = quint64(quintptr(clientBuffer));
+    return true;
+}
+#endif
+
+DirectScanout::DirectScanout(WaylandQuickOutput *output)
+    : QObject(output)
+    , m_output(output)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+
+    m_enabled = !qEnvironmentVariableIsSet("QT_WAYLAND_DISABLE_DIRECT_SCANOUT")
+            && QGuiApplication::platformFunction(EglFSFunctions::scanoutBufferIdentifier());
+
+    // Emitted on the GUI thread right before the scene graph is synchronized,
+    // when the scene is rendered for something else than the scanned out item
+    auto *window = qobject_cast<QQuickWindow *>(output->window());
+    if (m_enabled && window)
+        connect(window, &QQuickWindow::afterAnimating, this, &DirectScanout::prepareFrame);
+#endif
+}
+
+DirectScanout::~DirectScanout()
+{
+    // The screen must not send events anymore
+    if (m_item)
+        stop();
+}
+
+DirectScanout *DirectScanout::get(WaylandOutput *output)
+{
+    auto *quickOutput = qobject_cast<WaylandQuickOutput *>(output);
+    return quickOutput ? quickOutput->m_directScanout : nullptr;
+}
+
+/*
+    Returns whether the buffer described by \a candidate can replace the
+    whole frame of an output of \a outputSize pixels: it must fill the
+    output one buffer pixel per output pixel, without being transformed,
+    it must be opaque, and the primary plane must take its format and
+    modifier, according to \a hint.
+*/
+bool DirectScanout::isEligible(const Candidate &candidate, const QSize &outputSize, const ScanoutHint &hint)
+{
+    // Nothing shows through and the buffer goes on the plane as is
+    if (!candidate.opaque)
+        return false;
+    if (candidate.origin != WaylandSurface::OriginTopLeft)
+        return false;
+    if (candidate.contentOrientation != Qt::PrimaryOrientation)
+        return false;
+    if (candidate.transform.type() > QTransform::TxScale
+            || candidate.transform.m11() <= 0 || candidate.transform.m22() <= 0)
+        return false;
+
+    // Fullscreen, one buffer pixel for each pixel of the output
+    const QRectF rect = candidate.transform.mapRect(candidate.rect);
+    const QRect pixelRect(qRound(rect.x()), qRound(rect.y()), qRound(rect.width()), qRound(rect.height()));
+    if (pixelRect != QRect(QPoint(0, 0), outputSize) || candidate.bufferSize != outputSize)
+        return false;
+
+    // Formats without modifiers only take implicit and linear layouts
+    const auto format = hint.formats.constFind(candidate.drmFormat);
+    if (format == hint.formats.cend())
+        return false;
+    if (format->isEmpty())
+        return candidate.modifier == DrmFormatModInvalid || candidate.modifier == DrmFormatModLinear;
+    return format->contains(candidate.modifier);
+}
+
+// Whether the item is painted as is with nothing on top, so that a suitable
+// buffer of its surface could go on the primary plane
+bool DirectScanout::isCandidate(WaylandQuickItem *item) const
+{
+    QQuickWindow *window = item->window();
+    WaylandSurface *surface = item->surface();
+    if (!window || window != m_output->window() || !surface)
+        return false;
+
+    // The item is painted as is, without effects or other items on top
+    const WaylandQuickItemPrivate *d = WaylandQuickItemPrivate::get(item);
+    if (!d->paintEnabled || d->provider || item->view()->isBufferLocked())
+        return false;
+    if (surface->sourceGeometry() != QRectF(QPointF(0, 0), QSizeF(surface->bufferSize()) / surface->bufferScale()))
+        return false;
+
+    // The window is covered, the buffer is checked by isEligible()
+    const QTransform transform = QQuickItemPrivate::get(item)->itemToWindowTransform();
+    if (transform.type() > QTransform::TxScale || transform.m11() <= 0 || transform.m22() <= 0)
+        return false;
+    const QRectF rect = transform.mapRect(QRectF(0, 0, item->width(), item->height()));
+    if (!rect.contains(QRectF(QPointF(0, 0), QSizeF(window->size()))))
+        return false;
+
+    for (QQuickItem *p = item; p; p = p->parentItem()) {
+        if (!p->isVisible() || p->opacity() < 1.0)
+            return false;
+#if QT_CONFIG(quick_shadereffect)
+        QQuickItemLayer *layer = QQuickItemPrivate::get(p)->layer();
+        if (layer && layer->enabled())
+            return false;
+#endif
+    }
+
+    bool found = false;
+    return !isPaintedOver(window->contentItem(), item, &found) && found;
+}
+
+// Tells the client of a candidate which formats the primary plane takes
+void DirectScanout::updateScanoutHint(WaylandSurface *surface, bool candidate)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+    using Aurora::PlatformSupport::ScanoutFormats;
+
+    auto *surfacePrivate = WaylandSurfacePrivate::get(surface);
+    if (!candidate) {
+        surfacePrivate->setScanoutHint(ScanoutHint::PrimaryPlane, ScanoutHint());
+        return;
+    }
+
+    // Planes don't change while the screen is around
+    QScreen *screen = m_output->window()->screen();
+    if (m_hintScreen != screen) {
+        const ScanoutFormats formats = EglFSFunctions::scanoutFormats(screen);
+        m_hintScreen = screen;
+        m_hint.device = formats.device;
+        m_hint.formats = formats.primaryFormats;
+    }
+
+    surfacePrivate->setScanoutHint(ScanoutHint::PrimaryPlane, m_hint);
+#else
+    Q_UNUSED(surface);
+    Q_UNUSED(candidate);
+#endif
+}
+
+// The screen keeps the framebuffer of the buffer until it is destroyed
+void DirectScanout::importOnce(ClientBuffer *clientBuffer)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+
+    if (clientBuffer->hasDestroyCallback(this))
+        return;
+
+    QPointer<QScreen> screen = m_output->window()->screen();
+    const quint64 cacheKey = quint64(quintptr(clientBuffer));
+    clientBuffer->setDestroyCallback(this, [screen, cacheKey]() {
+        if (screen)
+            EglFSFunctions::releaseScanoutBuffer(screen, cacheKey);
+    });
+#else
+    Q_UNUSED(clientBuffer);
+#endif
+}
+
+/*
+    Puts the new buffer of \a item on the primary plane when it can be
+    scanned out, in which case the item doesn't need to be painted and
+    the scene isn't rendered. Returns false when the item has to be
+    painted as usual.
+*/
+bool DirectScanout::scanout(WaylandQuickItem *item)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+    using Aurora::PlatformSupport::ScanoutBuffer;
+
+    if (!m_enabled || !item->surface())
+        return false;
+
+    // Candidates are told what to allocate even when their current buffer
+    // can't be scanned out, so that the next ones can
+    const bool candidate = isCandidate(item);
+    updateScanoutHint(item->surface(), candidate);
+
+    QQuickWindow *window = item->window();
+    WaylandSurface *surface = item->surface();
+    const WaylandBufferRef buffer = WaylandSurfacePrivate::get(surface)->bufferRef;
+    ScanoutBuffer scanoutBuffer;
+    bool eligible = candidate && toScanoutBuffer(buffer, &scanoutBuffer);
+    if (eligible) {
+        const qreal dpr = window->effectiveDevicePixelRatio();
+        Candidate c;
+        c.bufferSize = buffer.size();
+        c.origin = buffer.origin();
+        c.contentOrientation = surface->contentOrientation();
+        c.opaque = surface->isOpaque() || buffer.bufferFormatEgl() == WaylandBufferRef::BufferFormatEgl_RGB;
+        c.drmFormat = scanoutBuffer.drmFormat;
+        c.modifier = scanoutBuffer.modifier;
+        c.transform = QQuickItemPrivate::get(item)->itemToWindowTransform() * QTransform::fromScale(dpr, dpr);
+        c.rect = QRectF(0, 0, item->width(), item->height());
+        eligible = isEligible(c, (QSizeF(window->size()) * dpr).toSize(), m_hint);
+    }
+
+    if (eligible)
+        importOnce(WaylandBufferRefPrivate::buffer(buffer));
+    if (!eligible || !EglFSFunctions::scanoutBuffer(window->screen(), scanoutBuffer, this)) {
+        if (m_item == item)
+            stop();
+        return false;
+    }
+
+    // Another item took over, it wasn't painted anymore
+    if (m_item && m_item != item)
+        m_item->update();
+    m_item = item;
+    m_screen = window->screen();
+
+    m_buffers[m_nextBuffer] = buffer;
+    m_nextBuffer = (m_nextBuffer + 1) % HeldBuffers;
+    return true;
+#else
+    Q_UNUSED(item);
+    return false;
+#endif
+}
+
+// Goes back to rendering the scene, with the current buffer of the item
+void DirectScanout::stop()
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+    using Aurora::PlatformSupport::ScanoutBuffer;
+
+    if (m_screen)
+        EglFSFunctions::scanoutBuffer(m_screen, ScanoutBuffer(), nullptr);
+#endif
+
+    // The buffers stay referenced until the rendered frames replaced them
+    if (m_item)
+        m_item->update();
+    m_item.clear();
+}
+
+// Called when the scene is about to be rendered, which would replace the
+// scanned out buffer if anything changed on top of it
+void DirectScanout::prepareFrame()
+{
+    if (m_item && !isCandidate(m_item))
+        stop();
+
+    // Buffers of the frames before are let go, one per frame
+    if (!m_item) {
+        m_buffers[m_nextBuffer] = WaylandBufferRef();
+        m_nextBuffer = (m_nextBuffer + 1) % HeldBuffers;
+    }
+}
+
+// Nothing is rendered for the item, frame callbacks are sent once its buffer is on screen
+void DirectScanout::scanoutPresented()
+{
+    if (m_item && m_item->surface()) {
+        WaylandSurface *surface = m_item->surface();
+        surface->frameStarted();
+        surface->sendFrameCallbacks();
+    }
+}
+
+bool DirectScanout::event(QEvent *event)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::PresentationEvent;
+
+    if (event->type() == PresentationEvent::registeredType()) {
+        auto *e = static_cast<PresentationEvent *>(event);
+        if (e->flags.testFlag(PresentationEvent::ZeroCopy))
+            scanoutPresented();
+        else if (m_item)
+            stop();
+        return true;
+    }
+#endif
+
+    return QObject::event(event);
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawaylandquickdirectscanout_p.cpp"
@@ -0,0 +1,110 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtGui/QTransform>
+
+#include <LiriAuroraCompositor/WaylandBufferRef>
+#include <LiriAuroraCompositor/WaylandSurface>
+#include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
+
+class QScreen;
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandOutput;
+class WaylandQuickItem;
+class WaylandQuickOutput;
+
+namespace Internal {
+
+class ClientBuffer;
+
+/*
+    Puts the buffer of a single opaque item that covers the whole window
+    straight on the primary plane of the screen, without compositing it.
+    While the buffer is scanned out the scene graph is neither rendered
+    nor swapped for new buffers of the item.
+    Only the Aurora EGLFS platform plugin with atomic modesetting can do it.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT DirectScanout : public QObject
+{
+    Q_OBJECT
+public:
+    // What decides whether a buffer can replace the frame
+    struct Candidate {
+        QSize bufferSize;
+        WaylandSurface::Origin origin = WaylandSurface::OriginTopLeft;
+        Qt::ScreenOrientation contentOrientation = Qt::PrimaryOrientation;
+        bool opaque = false;
+        quint32 drmFormat = 0;
+        quint64 modifier = 0;
+        // Item to window transform and item geometry, in device pixels
+        QTransform transform;
+        QRectF rect;
+    };
+
+    explicit DirectScanout(WaylandQuickOutput *output);
+    ~DirectScanout() override;
+
+    static DirectScanout *get(WaylandOutput *output);
+
+    // Whether the buffer fills the output of \a outputSize pixels
+    // as is, in a format the primary plane described by \a hint takes
+    static bool isEligible(const Candidate &candidate, const QSize &outputSize, const ScanoutHint &hint);
+
+    bool scanout(WaylandQuickItem *item);
+
+protected:
+    bool event(QEvent *event) override;
+
+private:
+    // Frames that can be queued or on screen, plus the one being committed
+    static const int HeldBuffers = 3;
+
+    bool isCandidate(WaylandQuickItem *item) const;
+    void updateScanoutHint(WaylandSurface *surface, bool candidate);
+    void importOnce(ClientBuffer *clientBuffer);
+    void stop();
+    void prepareFrame();
+    void scanoutPresented();
+
+    WaylandQuickOutput *m_output = nullptr;
+    bool m_enabled = false;
+
+    // Item whose buffer is on the primary plane instead of the scene,
+    // and the screen it is shown on
+    QPointer<WaylandQuickItem> m_item;
+    QPointer<QScreen> m_screen;
+
+    // Buffers of the last frames, so that clients don't
+    // draw into a buffer that is scanned out
+    WaylandBufferRef m_buffers[HeldBuffers];
+    int m_nextBuffer = 0;
+
+    // Formats of the primary plane of the screen the hint was made for
+    QPointer<QScreen> m_hintScreen;
+    ScanoutHint m_hint;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
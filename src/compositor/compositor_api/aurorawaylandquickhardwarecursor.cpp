@@ -0,0 +1,227 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtGui/QGuiApplication>
+#include <QtQuick/QQuickWindow>
+
+#include "aurorawaylandbufferref_p.h"
+#include "aurorawaylandquickhardwarecursor_p.h"
+#include "aurorawaylandquickitem_p.h"
+#include "aurorawaylandquickoutput.h"
+#include "aurorawaylandsurface_p.h"
+#include "wayland_wrapper/aurorawlclientbuffer_p.h"
+
+#if LIRI_FEATURE_aurora_qpa
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+#endif
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+HardwareCursor::HardwareCursor(WaylandQuickOutput *output)
+    : QObject(output)
+    , m_output(output)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::EglFSFunctions;
+
+    m_enabled = !qEnvironmentVariableIsSet("QT_WAYLAND_DISABLE_HW_CURSOR")
+            && QGuiApplication::platformFunction(EglFSFunctions::setCursorBufferIdentifier());
+#endif
+}
+
+HardwareCursor::~HardwareCursor()
+{
+    release();
+}
+
+HardwareCursor *HardwareCursor::get(WaylandOutput *output)
+{
+    auto *quickOutput = qobject_cast<WaylandQuickOutput *>(output);
+    return quickOutput ? quickOutput->m_hardwareCursor : nullptr;
+}
+
+// Whether the item shows its cursor surface as is, one buffer pixel for each pixel
+bool HardwareCursor::isCandidate(WaylandQuickItem *item) const
+{
+    QQuickWindow *window = item->window();
+    WaylandSurface *surface = item->surface();
+    if (!window || window != m_output->window() || !surface || !surface->isCursorSurface())
+        return false;
+
+    // Items hidden by the shell stay hidden
+    const WaylandQuickItemPrivate *d = WaylandQuickItemPrivate::get(item);
+    if ((!d->paintEnabled && item != m_item) || d->provider || item->view()->isBufferLocked())
+        return false;
+    if (surface->bufferScale() != qRound(window->effectiveDevicePixelRatio()))
+        return false;
+    if (QQuickItemPrivate::get(item)->itemToWindowTransform().type() > QTransform::TxTranslate)
+        return false;
+
+    for (QQuickItem *p = item; p; p = p->parentItem()) {
+        if (!p->isVisible() || p->opacity() < 1.0)
+            return false;
+    }
+
+    return true;
+}
+
+void HardwareCursor::track(WaylandQuickItem *item)
+{
+    if (m_item == item)
+        return;
+
+    release();
+
+    // Painted again as soon as it can't be on the cursor plane anymore
+    m_item = item;
+    auto untrack = [this]() { release(); };
+    m_connections.append(connect(item, &WaylandQuickItem::surfaceChanged, this, untrack));
+    m_connections.append(connect(item, &QQuickItem::visibleChanged, this, untrack));
+    m_connections.append(connect(item, &QQuickItem::windowChanged, this, untrack));
+    m_connections.append(connect(item, &QObject::destroyed, this, untrack));
+    item->setPaintEnabled(false);
+}
+
+void HardwareCursor::release()
+{
+    for (const auto &connection : std::as_const(m_connections))
+        disconnect(connection);
+    m_connections.clear();
+
+    if (!m_item && m_buffers.isEmpty())
+        return;
+
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::CursorBuffer;
+    using Aurora::PlatformSupport::EglFSFunctions;
+
+    // Back to the cursor of the window
+    if (QWindow *window = m_output->window())
+        EglFSFunctions::setCursorBuffer(window->screen(), CursorBuffer());
+#endif
+
+    if (m_item)
+        m_item->setPaintEnabled(true);
+    m_item = nullptr;
+    m_buffers.clear();
+}
+
+/*
+    Puts the current buffer of the cursor surface shown by \a item on the
+    cursor plane, returns false when the item has to be painted as usual.
+*/
+bool HardwareCursor::update(WaylandQuickItem *item)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::CursorBuffer;
+    using Aurora::PlatformSupport::EglFSFunctions;
+
+    if (!m_enabled || !item->surface())
+        return false;
+
+    if (!isCandidate(item)) {
+        if (m_item == item)
+            release();
+        return false;
+    }
+
+    WaylandSurface *surface = item->surface();
+    const WaylandBufferRef &buffer = WaylandSurfacePrivate::get(surface)->bufferRef;
+    ClientBuffer *clientBuffer = WaylandBufferRefPrivate::buffer(buffer);
+
+    CursorBuffer cursorBuffer;
+    cursorBuffer.hotSpot = QPoint(item->property("hotspotX").toInt(),
+                                  item->property("hotspotY").toInt()) * surface->bufferScale();
+
+    if (!clientBuffer || clientBuffer->isDestroyed()) {
+        // Nothing to show, the cursor is hidden
+        cursorBuffer.image = QImage(1, 1, QImage::Format_ARGB32_Premultiplied);
+        cursorBuffer.image.fill(Qt::transparent);
+    } else if (buffer.isSharedMemory()) {
+        // Copied by the platform plugin right away
+        cursorBuffer.image = buffer.image();
+    } else {
+        DmabufAttributes attributes;
+        if (buffer.origin() != WaylandSurface::OriginTopLeft || !clientBuffer->dmabufAttributes(&attributes)) {
+            if (m_item == item)
+                release();
+            return false;
+        }
+
+        cursorBuffer.buffer.size = attributes.size;
+        cursorBuffer.buffer.drmFormat = attributes.drmFormat;
+        cursorBuffer.buffer.modifier = attributes.modifier;
+        cursorBuffer.buffer.planeCount = attributes.planeCount;
+        for (int i = 0; i < attributes.planeCount; ++i) {
+            cursorBuffer.buffer.fds[i] = attributes.fds[i];
+            cursorBuffer.buffer.offsets[i] = attributes.offsets[i];
+            cursorBuffer.buffer.strides[i] = attributes.strides[i];
+        }
+    }
+
+    // Frame callbacks are sent and buffers released when the cursor reaches the screen
+    if (!EglFSFunctions::setCursorBuffer(item->window()->screen(), cursorBuffer, this)) {
+        if (m_item == item)
+            release();
+        return false;
+    }
+
+    track(item);
+
+    // Shared memory was copied, dmabufs stay referenced while on screen
+    SubmittedBuffer submitted;
+    if (cursorBuffer.buffer.planeCount > 0)
+        submitted.buffer = buffer;
+    m_buffers.append(submitted);
+
+    return true;
+#else
+    Q_UNUSED(item);
+    return false;
+#endif
+}
+
+// Nothing is rendered for the cursor, frame callbacks are sent once it is on screen
+void HardwareCursor::cursorPresented()
+{
+    for (SubmittedBuffer &submitted : m_buffers)
+        ++submitted.flips;
+    while (m_buffers.size() > 1 && m_buffers.at(1).flips >= 2)
+        m_buffers.removeFirst();
+
+    if (m_item && m_item->surface()) {
+        WaylandSurface *surface = m_item->surface();
+        surface->frameStarted();
+        surface->sendFrameCallbacks();
+    }
+}
+
+bool HardwareCursor::event(QEvent *event)
+{
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::CursorPresentationEvent;
+
+    if (event->type() == CursorPresentationEvent::registeredType()) {
+        // The window may have moved to another screen meanwhile
+        auto *e = static_cast<CursorPresentationEvent *>(event);
+        QWindow *window = m_output->window();
+        if (window && e->screen == window->screen())
+            cursorPresented();
+        return true;
+    }
+#endif
+
+    return QObject::event(event);
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawaylandquickhardwarecursor_p.cpp"
@@ -0,0 +1,81 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QList>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+
+#include <LiriAuroraCompositor/WaylandBufferRef>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandOutput;
+class WaylandQuickItem;
+class WaylandQuickOutput;
+
+namespace Internal {
+
+/*
+    Shows the cursor surface of a client on the cursor plane of the screen,
+    instead of painting it with the scene graph. The cursor then moves without
+    rendering a frame. Only the Aurora EGLFS platform plugin can do it.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT HardwareCursor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HardwareCursor(WaylandQuickOutput *output);
+    ~HardwareCursor();
+
+    static HardwareCursor *get(WaylandOutput *output);
+
+    bool update(WaylandQuickItem *item);
+
+protected:
+    bool event(QEvent *event) override;
+
+private:
+    friend class tst_HardwareCursor;
+
+    bool isCandidate(WaylandQuickItem *item) const;
+    void track(WaylandQuickItem *item);
+    void release();
+    void cursorPresented();
+
+    WaylandQuickOutput *m_output = nullptr;
+    bool m_enabled = false;
+
+    // Item of the cursor surface, not painted while the screen shows it
+    QPointer<WaylandQuickItem> m_item;
+    QList<QMetaObject::Connection> m_connections;
+
+    // Buffers given to the screen, the oldest first: a dmabuf is on screen
+    // until a newer buffer was presented, that is after two cursor flips
+    // because the first one may come from a commit made before it was set
+    struct SubmittedBuffer {
+        WaylandBufferRef buffer;
+        int flips = 0;
+    };
+    QList<SubmittedBuffer> m_buffers;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
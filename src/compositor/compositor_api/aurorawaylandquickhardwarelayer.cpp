@@ -65,7 +65,9 @@ Internal::HardwareLayerIntegration *WaylandQuickHardwareLayerPrivate::layerInteg
  * each frame.
  *
  * The preferred hardware layer integration may be overridden by setting the
- * QT_WAYLAND_HARDWARE_LAYER_INTEGRATION environment variable.
+ * QT_WAYLAND_HARDWARE_LAYER_INTEGRATION environment variable. With the \c kms-layers
+ * integration, layers are put on KMS overlay planes when the Aurora EGLFS platform
+ * plugin uses atomic modesetting and fall back to the scene graph otherwise.
  */
 
 WaylandQuickHardwareLayer::WaylandQuickHardwareLayer(QObject *parent)
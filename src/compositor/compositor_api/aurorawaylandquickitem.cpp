@@ -9,6 +9,8 @@
 #include "aurorawaylandtextinputv3.h"
 #include "aurorawaylandqttextinputmethod.h"
 #include "aurorawaylandquickoutput.h"
+#include "aurorawaylandquickdirectscanout_p.h"
+#include "aurorawaylandquickhardwarecursor_p.h"
 #include <LiriAuroraCompositor/aurorawaylandcompositor.h>
 #include <LiriAuroraCompositor/aurorawaylandseat.h>
 #include <LiriAuroraCompositor/aurorawaylandbufferref.h>
@@ -17,6 +19,7 @@
 #endif
 #include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
 
 #if QT_CONFIG(opengl)
 #  include <QtOpenGL/QOpenGLTexture>
@@ -390,7 +393,7 @@ public:
         delete m_sgTex;
         m_sgTex = nullptr;
         if (m_ref.hasBuffer()) {
-            if (buffer.isSharedMemory()) {
+            if (buffer.isSharedMemory() && !useBufferTexture(surfaceItem)) {
                 m_sgTex = surfaceItem->window()->createTextureFromImage(buffer.image());
             } else {
 #if QT_CONFIG(opengl)
@@ -402,7 +405,7 @@ public:
 
                 auto texture = buffer.toOpenGLTexture();
                 GLuint textureId = texture->textureId();
-                auto size = surface->bufferSize();
+                auto size = buffer.size();
                 m_sgTex = QNativeInterface::QSGOpenGLTexture::fromNative(textureId, surfaceItem->window(), size, opt);
 #else
                 qCWarning(gLcAuroraCompositor) << "Without OpenGL support only shared memory textures are supported";
@@ -421,6 +424,18 @@ public:
 
     void setSmooth(bool smooth) { m_smooth = smooth; }
 private:
+    static bool useBufferTexture(WaylandQuickItem *surfaceItem)
+    {
+#if QT_CONFIG(opengl)
+        // Shared memory buffers keep their texture across commits and only
+        // upload the damaged area, which requires the OpenGL backend
+        return surfaceItem->window()->rendererInterface()->graphicsApi() == QSGRendererInterface::OpenGL;
+#else
+        Q_UNUSED(surfaceItem);
+        return false;
+#endif
+    }
+
     bool m_smooth = false;
     QSGTexture *m_sgTex = nullptr;
     WaylandBufferRef m_ref;
@@ -1077,7 +1092,7 @@ void WaylandQuickItem::handleSurfaceChanged()
         disconnect(d->oldSurface.data(), &WaylandSurface::destinationSizeChanged, this, &WaylandQuickItem::updateSize);
         disconnect(d->oldSurface.data(), &WaylandSurface::bufferScaleChanged, this, &WaylandQuickItem::updateSize);
         disconnect(d->oldSurface.data(), &WaylandSurface::configure, this, &WaylandQuickItem::updateBuffer);
-        disconnect(d->oldSurface.data(), &WaylandSurface::redraw, this, &QQuickItem::update);
+        disconnect(d->oldSurface.data(), &WaylandSurface::redraw, this, nullptr);
         disconnect(d->oldSurface.data(), &WaylandSurface::childAdded, this, &WaylandQuickItem::handleSubsurfaceAdded);
         disconnect(d->oldSurface.data(), &WaylandSurface::subsurfacePlaceAbove, this, &WaylandQuickItem::handlePlaceAbove);
         disconnect(d->oldSurface.data(), &WaylandSurface::subsurfacePlaceBelow, this, &WaylandQuickItem::handlePlaceBelow);
@@ -1094,7 +1109,17 @@ void WaylandQuickItem::handleSurfaceChanged()
         connect(newSurface, &WaylandSurface::destinationSizeChanged, this, &WaylandQuickItem::updateSize);
         connect(newSurface, &WaylandSurface::bufferScaleChanged, this, &WaylandQuickItem::updateSize);
         connect(newSurface, &WaylandSurface::configure, this, &WaylandQuickItem::updateBuffer);
-        connect(newSurface, &WaylandSurface::redraw, this, &QQuickItem::update);
+        connect(newSurface, &WaylandSurface::redraw, this, [this, d]() {
+            // Skip the scene graph when the buffer can go straight to the screen
+            WaylandOutput *output = d->view->output();
+            Internal::HardwareCursor *hardwareCursor = output ? Internal::HardwareCursor::get(output) : nullptr;
+            if (hardwareCursor && hardwareCursor->update(this))
+                return;
+            Internal::DirectScanout *directScanout = output ? Internal::DirectScanout::get(output) : nullptr;
+            if (directScanout && directScanout->scanout(this))
+                return;
+            update();
+        });
         connect(newSurface, &WaylandSurface::childAdded, this, &WaylandQuickItem::handleSubsurfaceAdded);
         connect(newSurface, &WaylandSurface::subsurfacePlaceAbove, this, &WaylandQuickItem::handlePlaceAbove);
         connect(newSurface, &WaylandSurface::subsurfacePlaceBelow, this, &WaylandQuickItem::handlePlaceBelow);
@@ -1487,6 +1512,8 @@ void WaylandQuickItem::updateInputMethod(Qt::InputMethodQueries queries)
 QSGNode *WaylandQuickItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
 {
     Q_D(WaylandQuickItem);
+    Internal::FrameTracer::Scope trace(Internal::FrameTracer::PaintNodeUpdate,
+                                       surface() ? surface()->resource() : nullptr);
     d->lastMatrix = data->transformNode->combinedMatrix();
     const bool bufferHasContent = d->view->currentBuffer().hasContent();
 
@@ -4,7 +4,16 @@
 
 #include "aurorawaylandquickoutput.h"
 #include "aurorawaylandquickcompositor.h"
+#include "aurorawaylandquickdirectscanout_p.h"
+#include "aurorawaylandquickhardwarecursor_p.h"
 #include "aurorawaylandquickitem_p.h"
+#if QT_CONFIG(opengl)
+#include "hardware_integration/aurorawltextureorphanage_p.h"
+#include "wayland_wrapper/aurorawlshmtextureuploader_p.h"
+#endif
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
+#include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
+#include <LiriAuroraCompositor/private/aurorawlsynctimeline_p.h>
 
 namespace Aurora {
 
@@ -32,8 +41,47 @@ void WaylandQuickOutput::initialize()
             this, &WaylandQuickOutput::updateStarted,
             Qt::DirectConnection);
 
+#if QT_CONFIG(opengl)
+    // Textures of destroyed buffers are deleted once per frame, with the
+    // context of the render thread current, and so is the memory that
+    // shared memory uploads no longer need
+    connect(quickWindow, &QQuickWindow::beforeSynchronizing, this, [quickWindow]() {
+        if (quickWindow->rendererInterface()->graphicsApi() == QSGRendererInterface::OpenGL) {
+            Internal::WaylandTextureOrphanage::instance()->deleteTextures();
+            Internal::ShmTextureUploader::trimStagingBuffer();
+        }
+    }, Qt::DirectConnection);
+
+    // Release points of explicitly synchronized buffers are signalled with
+    // a fence for the frames that may still use the buffers
+    WaylandCompositor *compositor = this->compositor();
+    connect(quickWindow, &QQuickWindow::beforeSynchronizing, this, [quickWindow, compositor]() {
+        if (quickWindow->rendererInterface()->graphicsApi() != QSGRendererInterface::OpenGL)
+            return;
+        const auto integrations = WaylandCompositorPrivate::get(compositor)->clientBufferIntegrations();
+        for (auto *integration : integrations) {
+            if (auto *backend = integration->syncTimelineBackend())
+                backend->frameStarted();
+        }
+    }, Qt::DirectConnection);
+    connect(quickWindow, &QQuickWindow::afterRendering, this, [quickWindow, compositor]() {
+        if (quickWindow->rendererInterface()->graphicsApi() != QSGRendererInterface::OpenGL)
+            return;
+        const auto integrations = WaylandCompositorPrivate::get(compositor)->clientBufferIntegrations();
+        for (auto *integration : integrations) {
+            if (auto *backend = integration->syncTimelineBackend())
+                backend->frameRendered();
+        }
+    }, Qt::DirectConnection);
+#endif
+
     connect(quickWindow, &QQuickWindow::afterRendering,
             this, &WaylandQuickOutput::doFrameCallbacks);
+
+    if (!m_directScanout)
+        m_directScanout = new Internal::DirectScanout(this);
+    if (!m_hardwareCursor)
+        m_hardwareCursor = new Internal::HardwareCursor(this);
 }
 
 void WaylandQuickOutput::classBegin()
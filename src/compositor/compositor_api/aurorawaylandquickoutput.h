@@ -16,6 +16,11 @@ namespace Compositor {
 
 class WaylandQuickCompositor;
 
+namespace Internal {
+class DirectScanout;
+class HardwareCursor;
+}
+
 class LIRIAURORACOMPOSITOR_EXPORT WaylandQuickOutput : public WaylandOutput, public QQmlParserStatus
 {
     Q_INTERFACES(QQmlParserStatus)
@@ -47,10 +52,15 @@ protected:
     void componentComplete() override;
 
 private:
+    friend class Internal::DirectScanout;
+    friend class Internal::HardwareCursor;
+
     void doFrameCallbacks();
 
     bool m_updateScheduled = false;
     bool m_automaticFrameCallback = true;
+    Internal::DirectScanout *m_directScanout = nullptr;
+    Internal::HardwareCursor *m_hardwareCursor = nullptr;
 };
 
 } // namespace Compositor
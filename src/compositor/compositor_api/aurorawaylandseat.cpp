@@ -190,7 +190,7 @@ WaylandSeat::~WaylandSeat()
 void WaylandSeat::initialize()
 {
     Q_D(WaylandSeat);
-    d->init(d->compositor->display(), 4);
+    d->init(d->compositor->display(), 5);
 
     if (d->capabilities & WaylandSeat::Pointer)
         d->pointer.reset(WaylandCompositorPrivate::get(d->compositor)->callCreatePointerDevice(this));
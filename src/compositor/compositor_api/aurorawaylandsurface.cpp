@@ -23,6 +23,8 @@
 #include <LiriAuroraCompositor/private/aurorawaylandview_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandseat_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandutils_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandlinuxdrmsyncobjv1_p_p.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
 
 #include <QtCore/private/qobject_p.h>
 
@@ -72,6 +74,44 @@ public:
     bool canSend = false;
 };
 }
+// Number of commits for which the buffer damage is remembered
+static const int MaxBufferDamageHistory = 4;
+
+// Maps a rectangle from surface coordinates to the coordinates of a buffer
+// of bufferSize, undoing the buffer transform and scale, like Weston does
+static QRect surfaceToBufferRect(const QRect &rect, int32_t transform, int scale, const QSize &bufferSize)
+{
+    const bool rotated = transform & WL_OUTPUT_TRANSFORM_90;
+    const int width = rotated ? bufferSize.height() : bufferSize.width();
+    const int height = rotated ? bufferSize.width() : bufferSize.height();
+
+    auto map = [transform, width, height](int x, int y) -> QPoint {
+        switch (transform) {
+        case WL_OUTPUT_TRANSFORM_FLIPPED:
+            return QPoint(width - x, y);
+        case WL_OUTPUT_TRANSFORM_90:
+            return QPoint(y, width - x);
+        case WL_OUTPUT_TRANSFORM_FLIPPED_90:
+            return QPoint(y, x);
+        case WL_OUTPUT_TRANSFORM_180:
+            return QPoint(width - x, height - y);
+        case WL_OUTPUT_TRANSFORM_FLIPPED_180:
+            return QPoint(x, height - y);
+        case WL_OUTPUT_TRANSFORM_270:
+            return QPoint(height - y, x);
+        case WL_OUTPUT_TRANSFORM_FLIPPED_270:
+            return QPoint(height - y, width - x);
+        default:
+            return QPoint(x, y);
+        }
+    };
+
+    const QPoint a = map(rect.x() * scale, rect.y() * scale);
+    const QPoint b = map((rect.x() + rect.width()) * scale, (rect.y() + rect.height()) * scale);
+    return QRect(QPoint(qMin(a.x(), b.x()), qMin(a.y(), b.y())),
+                 QSize(qAbs(a.x() - b.x()), qAbs(a.y() - b.y())));
+}
+
 static QRegion infiniteRegion() {
     return QRegion(QRect(QPoint(std::numeric_limits<int>::min(), std::numeric_limits<int>::min()),
                          QPoint(std::numeric_limits<int>::max(), std::numeric_limits<int>::max())));
@@ -82,12 +122,14 @@ QList<WaylandSurfacePrivate *> WaylandSurfacePrivate::uninitializedSurfaces;
 #endif
 
 WaylandSurfacePrivate::WaylandSurfacePrivate()
-    : inputRegion(infiniteRegion())
+    : uploadStatistics(new Internal::BufferUploadStatistics)
+    , inputRegion(infiniteRegion())
 {
     pending.buffer = WaylandBufferRef();
     pending.newlyAttached = false;
     pending.inputRegion = infiniteRegion();
     pending.bufferScale = 1;
+    pending.bufferTransform = WL_OUTPUT_TRANSFORM_NORMAL;
 #ifndef QT_NO_DEBUG
     addUninitializedSurface(this);
 #endif
@@ -104,13 +146,25 @@ WaylandSurfacePrivate::~WaylandSurfacePrivate()
 
     for (Internal::FrameCallback *c : std::as_const(pendingFrameCallbacks))
         c->destroy();
+    for (Internal::FrameCallback *c : std::as_const(cachedFrameCallbacks))
+        c->destroy();
     for (Internal::FrameCallback *c : std::as_const(frameCallbacks))
         c->destroy();
+
+    // Children are not synchronized with a destroyed parent anymore
+    for (const QPointer<WaylandSurface> &child : std::as_const(subsurfaceChildren)) {
+        if (!child)
+            continue;
+        auto *childPrivate = WaylandSurfacePrivate::get(child);
+        if (childPrivate->subsurface && childPrivate->subsurface->parentSurface == this)
+            childPrivate->subsurface->parentSurface = nullptr;
+    }
 }
 
 void WaylandSurfacePrivate::removeFrameCallback(Internal::FrameCallback *callback)
 {
     pendingFrameCallbacks.removeOne(callback);
+    cachedFrameCallbacks.removeOne(callback);
     frameCallbacks.removeOne(callback);
 }
 
@@ -207,33 +261,178 @@ void WaylandSurfacePrivate::surface_set_input_region(Resource *, struct wl_resou
     }
 }
 
-void WaylandSurfacePrivate::surface_commit(Resource *)
+void WaylandSurfacePrivate::surface_commit(Resource *resource)
+{
+    Internal::FrameTracer::Scope trace(Internal::FrameTracer::SurfaceCommit, resource->handle);
+
+    if (syncobjSurface) {
+        struct ::wl_resource *buffer = pending.newlyAttached ? pending.buffer.wl_buffer() : nullptr;
+        if (!syncobjSurface->checkCommit(buffer, pending.acquirePoint, pending.releasePoint))
+            return;
+    }
+
+    cacheState();
+
+    // Synchronized subsurfaces keep their state until the parent state is applied
+    if (isSynchronized())
+        return;
+
+    applyCachedStateWhenReady();
+}
+
+void WaylandSurfacePrivate::cacheState()
+{
+    if (pending.newlyAttached) {
+        // A buffer that was committed but replaced before being used goes back to the client
+        Internal::ClientBuffer *oldBuffer = cached.buffer.buffer();
+        if (oldBuffer && cached.buffer != pending.buffer && cached.buffer != bufferRef)
+            oldBuffer->releaseUnused();
+
+        cached.buffer = std::move(pending.buffer);
+        cached.newlyAttached = true;
+
+        // Timeline points are only set along with a buffer
+        cached.acquirePoint = std::exchange(pending.acquirePoint, Internal::SyncPoint());
+        const Internal::SyncPoint releasePoint = std::exchange(pending.releasePoint, Internal::SyncPoint());
+        if (!releasePoint.isNull())
+            cached.buffer.buffer()->addReleasePoint(releasePoint);
+    }
+    cached.offset += pending.offset;
+    cached.surfaceDamage |= pending.surfaceDamage;
+    cached.bufferDamage |= pending.bufferDamage;
+    cached.inputRegion = pending.inputRegion;
+    cached.bufferScale = pending.bufferScale;
+    cached.bufferTransform = pending.bufferTransform;
+    cached.sourceGeometry = pending.sourceGeometry;
+    cached.destinationSize = pending.destinationSize;
+    cached.opaqueRegion = pending.opaqueRegion;
+    cachedFrameCallbacks << pendingFrameCallbacks;
+    hasCachedState = true;
+
+    // Clear per-commit state
+    pending.buffer = WaylandBufferRef();
+    pending.offset = QPoint();
+    pending.newlyAttached = false;
+    pending.bufferDamage = QRegion();
+    pending.surfaceDamage = QRegion();
+    pendingFrameCallbacks.clear();
+}
+
+void WaylandSurfacePrivate::applyCachedState(bool desynchronized)
+{
+    // Apply the state of the whole tree before emitting any signal, so
+    // that handlers never observe a partially updated tree
+    QList<QPair<QPointer<WaylandSurface>, StateChanges>> applied;
+    applyCachedStateRecursively(applied, desynchronized);
+
+    for (const auto &entry : std::as_const(applied)) {
+        if (entry.first)
+            WaylandSurfacePrivate::get(entry.first)->emitStateChanges(entry.second);
+    }
+}
+
+/*
+    Applies the cached state once the client is done rendering into the buffer,
+    without blocking: explicitly synchronized buffers may not be ready yet. The
+    state of the subsurfaces applied along with the surface waits for their
+    buffers too, so that the tree is still updated at once.
+
+    When \a desynchronized is true the surface just left synchronized mode, the
+    cached state of its descendants was held because of it and is applied too.
+*/
+void WaylandSurfacePrivate::applyCachedStateWhenReady(bool desynchronized)
 {
     Q_Q(WaylandSurface);
 
+    const Internal::SyncPoint acquirePoint = pendingAcquirePoint(desynchronized);
+    if (acquirePoint.isNull()) {
+        applyCachedState(desynchronized);
+        return;
+    }
+
+    acquirePoint.timeline->wait(acquirePoint.point, q, [this, desynchronized]() {
+        // Later commits may have replaced the state meanwhile, whose
+        // buffers are checked again
+        if (!isSynchronized())
+            applyCachedStateWhenReady(desynchronized);
+    });
+}
+
+// Children that are synchronized, by themselves or through an ancestor, are
+// applied along with their parent
+static bool isAppliedWithParent(const WaylandSurfacePrivate *child, bool desynchronized)
+{
+    return child->isSubsurface() && (desynchronized || child->isSynchronized());
+}
+
+/*
+    Returns the first acquire point, among the cached state of the surface
+    and of the subsurfaces applied along with it, that is not signalled yet;
+    or a null point if the state can be applied.
+*/
+Internal::SyncPoint WaylandSurfacePrivate::pendingAcquirePoint(bool desynchronized) const
+{
+    if (hasCachedState && !cached.acquirePoint.isSignalled())
+        return cached.acquirePoint;
+
+    for (const QPointer<WaylandSurface> &child : std::as_const(subsurfaceChildren)) {
+        if (!child)
+            continue;
+        auto *childPrivate = WaylandSurfacePrivate::get(child);
+        if (isAppliedWithParent(childPrivate, desynchronized)) {
+            const Internal::SyncPoint point = childPrivate->pendingAcquirePoint(desynchronized);
+            if (!point.isNull())
+                return point;
+        }
+    }
+
+    return Internal::SyncPoint();
+}
+
+void WaylandSurfacePrivate::applyCachedStateRecursively(QList<QPair<QPointer<WaylandSurface>, StateChanges>> &applied,
+                                                        bool desynchronized)
+{
+    if (hasCachedState)
+        applied.append(qMakePair(QPointer<WaylandSurface>(q_func()), applyState()));
+
+    for (const QPointer<WaylandSurface> &child : std::as_const(subsurfaceChildren)) {
+        if (!child)
+            continue;
+        auto *childPrivate = WaylandSurfacePrivate::get(child);
+        if (isAppliedWithParent(childPrivate, desynchronized))
+            childPrivate->applyCachedStateRecursively(applied, desynchronized);
+    }
+}
+
+WaylandSurfacePrivate::StateChanges WaylandSurfacePrivate::applyState()
+{
+    State &state = cached;
+
     // Needed in order to know whether we want to emit signals later
-    QSize oldBufferSize = bufferSize;
-    QRectF oldSourceGeometry = sourceGeometry;
-    QSize oldDestinationSize = destinationSize;
-    bool oldHasContent = hasContent;
-    int oldBufferScale = bufferScale;
+    StateChanges changes;
+    changes.oldBufferSize = bufferSize;
+    changes.oldSourceGeometry = sourceGeometry;
+    changes.oldDestinationSize = destinationSize;
+    changes.oldHasContent = hasContent;
+    changes.oldBufferScale = bufferScale;
 
     // Update all internal state
-    if (pending.buffer.hasBuffer() || pending.newlyAttached)
-        bufferRef = pending.buffer;
-    bufferScale = pending.bufferScale;
+    if (state.buffer.hasBuffer() || state.newlyAttached)
+        bufferRef = std::move(state.buffer);
+    bufferScale = state.bufferScale;
+    bufferTransform = state.bufferTransform;
     bufferSize = bufferRef.size();
     QSize surfaceSize = bufferSize / bufferScale;
-    sourceGeometry = !pending.sourceGeometry.isValid() ? QRect(QPoint(), surfaceSize) : pending.sourceGeometry;
-    destinationSize = pending.destinationSize.isEmpty() ? sourceGeometry.size().toSize() : pending.destinationSize;
+    sourceGeometry = !state.sourceGeometry.isValid() ? QRect(QPoint(), surfaceSize) : state.sourceGeometry;
+    destinationSize = state.destinationSize.isEmpty() ? sourceGeometry.size().toSize() : state.destinationSize;
     QRect destinationRect(QPoint(), destinationSize);
-    // pending.damage is already in surface coordinates
-    damage = pending.surfaceDamage.intersected(destinationRect);
-    if (!pending.bufferDamage.isNull()) {
+    // state.surfaceDamage is already in surface coordinates
+    damage = state.surfaceDamage.intersected(destinationRect);
+    if (!state.bufferDamage.isNull()) {
         if (bufferScale == 1) {
-            damage |= pending.bufferDamage.intersected(destinationRect); // Already in surface coordinates
+            damage |= state.bufferDamage.intersected(destinationRect); // Already in surface coordinates
         } else {
-            // We must transform pending.damage from buffer coordinate system to surface coordinates
+            // We must transform state.bufferDamage from buffer coordinate system to surface coordinates
             // TODO(QTBUG-85461): Also support wp_viewport setting more complex transformations
             auto xform = [](const QRect &r, int scale) -> QRect {
                 QRect res{
@@ -242,62 +441,107 @@ void WaylandSurfacePrivate::surface_commit(Resource *)
                 };
                 return res;
             };
-            for (const QRect &r : pending.bufferDamage)
+            for (const QRect &r : state.bufferDamage)
                 damage |= xform(r, bufferScale).intersected(destinationRect);
         }
     }
     hasContent = bufferRef.hasContent();
-    frameCallbacks << pendingFrameCallbacks;
-    inputRegion = pending.inputRegion.intersected(destinationRect);
-    opaqueRegion = pending.opaqueRegion.intersected(destinationRect);
+    frameCallbacks << cachedFrameCallbacks;
+    inputRegion = state.inputRegion.intersected(destinationRect);
+    opaqueRegion = state.opaqueRegion.intersected(destinationRect);
     bool becameOpaque = opaqueRegion.boundingRect().contains(destinationRect);
     if (becameOpaque != isOpaque) {
         isOpaque = becameOpaque;
-        emit q->isOpaqueChanged();
+        changes.opaqueChanged = true;
+    }
+
+    // Keep track of the damage in buffer coordinates, so that buffers that are
+    // committed again only need to update what changed in the meantime
+    const QRect bufferRect(QPoint(), bufferSize);
+    const bool newlyAttached = state.newlyAttached;
+    QRegion bufferDamage;
+    if (bufferScale == 1 && bufferTransform == WL_OUTPUT_TRANSFORM_NORMAL
+            && sourceGeometry == QRectF(bufferRect) && destinationSize == bufferSize) {
+        bufferDamage = state.surfaceDamage | state.bufferDamage;
+    } else if (state.sourceGeometry.isValid() || !state.destinationSize.isEmpty()) {
+        // Surface coordinates cannot be mapped back to the buffer trivially
+        bufferDamage = bufferRect;
+    } else {
+        bufferDamage = state.bufferDamage;
+        for (const QRect &r : state.surfaceDamage)
+            bufferDamage |= surfaceToBufferRect(r, bufferTransform, bufferScale, bufferSize);
+    }
+    bufferDamage &= bufferRect;
+    if (newlyAttached) {
+        ++commitSerial;
+        bufferDamageHistory.append(bufferDamage);
+        if (bufferDamageHistory.size() > MaxBufferDamageHistory)
+            bufferDamageHistory.removeFirst();
     }
 
-    QPoint offsetForNextFrame = pending.offset;
+    changes.offsetForNextFrame = state.offset;
 
     if (viewport)
-        viewport->checkCommittedState();
+        viewport->checkCommittedState(state.destinationSize, state.sourceGeometry);
 
     // Clear per-commit state
-    pending.buffer = WaylandBufferRef();
-    pending.offset = QPoint();
-    pending.newlyAttached = false;
-    pending.bufferDamage = QRegion();
-    pending.surfaceDamage = QRegion();
-    pendingFrameCallbacks.clear();
+    state.buffer = WaylandBufferRef();
+    state.offset = QPoint();
+    state.newlyAttached = false;
+    state.bufferDamage = QRegion();
+    state.surfaceDamage = QRegion();
+    state.acquirePoint = Internal::SyncPoint();
+    cachedFrameCallbacks.clear();
+    hasCachedState = false;
 
     // Notify buffers and views
-    if (auto *buffer = bufferRef.buffer())
-        buffer->setCommitted(damage);
+    if (auto *buffer = bufferRef.buffer()) {
+        QRegion committedDamage;
+        if (newlyAttached) {
+            if (buffer->uploadStatistics() == uploadStatistics)
+                committedDamage = bufferDamageSince(buffer->commitSerial());
+            else
+                committedDamage = bufferRect;
+            buffer->setCommitSerial(uploadStatistics, commitSerial);
+        }
+        buffer->setCommitted(committedDamage);
+    }
     for (auto *view : std::as_const(views))
         view->bufferCommitted(bufferRef, damage);
 
+    return changes;
+}
+
+void WaylandSurfacePrivate::emitStateChanges(const StateChanges &changes)
+{
+    Q_Q(WaylandSurface);
+
     // Now all double-buffered state has been applied so it's safe to emit general signals
     // i.e. we won't have inconsistensies such as mismatched surface size and buffer scale in
     // signal handlers.
 
+    if (changes.opaqueChanged)
+        emit q->isOpaqueChanged();
+
     emit q->damaged(damage);
 
-    if (oldBufferSize != bufferSize)
+    if (changes.oldBufferSize != bufferSize)
         emit q->bufferSizeChanged();
 
-    if (oldBufferScale != bufferScale)
+    if (changes.oldBufferScale != bufferScale)
         emit q->bufferScaleChanged();
 
-    if (oldDestinationSize != destinationSize)
+    if (changes.oldDestinationSize != destinationSize)
         emit q->destinationSizeChanged();
 
-    if (oldSourceGeometry != sourceGeometry)
+    if (changes.oldSourceGeometry != sourceGeometry)
         emit q->sourceGeometryChanged();
 
-    if (oldHasContent != hasContent)
+    if (changes.oldHasContent != hasContent)
         emit q->hasContentChanged();
 
-    if (!offsetForNextFrame.isNull())
-        emit q->offsetForNextFrame(offsetForNextFrame);
+    if (!changes.offsetForNextFrame.isNull())
+        emit q->offsetForNextFrame(changes.offsetForNextFrame);
 
     emit q->redraw();
 }
@@ -306,6 +550,7 @@ void WaylandSurfacePrivate::surface_set_buffer_transform(Resource *resource, int
 {
     Q_UNUSED(resource);
     Q_Q(WaylandSurface);
+    pending.bufferTransform = orientation;
     QScreen *screen = QGuiApplication::primaryScreen();
     bool isPortrait = screen->primaryOrientation() == Qt::PortraitOrientation;
     Qt::ScreenOrientation oldOrientation = contentOrientation;
@@ -338,6 +583,22 @@ Internal::ClientBuffer *WaylandSurfacePrivate::getBuffer(struct ::wl_resource *b
     return bufMan->getBuffer(buffer);
 }
 
+/*
+    Returns the region of the buffer that changed since the commit identified by
+    \a serial, or the whole buffer when that commit is too old to be known.
+*/
+QRegion WaylandSurfacePrivate::bufferDamageSince(quint32 serial) const
+{
+    const quint32 age = commitSerial - serial;
+    if (age == 0 || age > quint32(bufferDamageHistory.size()))
+        return QRect(QPoint(), bufferSize);
+
+    QRegion result;
+    for (qsizetype i = bufferDamageHistory.size() - age; i < bufferDamageHistory.size(); ++i)
+        result |= bufferDamageHistory.at(i);
+    return result;
+}
+
 /*!
  * \class WaylandSurfaceRole
  * \inmodule AuroraCompositor
@@ -459,6 +720,7 @@ void WaylandSurface::initialize(WaylandCompositor *compositor, WaylandClient *cl
     d->compositor = compositor;
     d->client = client;
     d->init(client->client(), id, version);
+    d->uploadStatistics->surfaceId = id;
     d->isInitialized = true;
 #if QT_CONFIG(im)
     d->inputMethodControl = new WaylandInputMethodControl(this);
@@ -1029,6 +1291,47 @@ void WaylandSurfacePrivate::derefView(WaylandView *view)
     }
 }
 
+/*
+    Returns true if the surface is a subsurface in synchronized mode, or if any
+    of its ancestors is: its state is then applied with the parent state.
+*/
+bool WaylandSurfacePrivate::isSynchronized() const
+{
+    for (const WaylandSurfacePrivate *s = this; s && s->subsurface; s = s->subsurface->parentSurface) {
+        if (s->subsurface->synchronized)
+            return true;
+    }
+    return false;
+}
+
+/*
+    Returns the formats of the plane that could scan out the surface, with
+    the primary plane taking precedence over the overlay planes.
+*/
+const Internal::ScanoutHint &WaylandSurfacePrivate::scanoutHint() const
+{
+    const Internal::ScanoutHint &primary = scanoutHints[Internal::ScanoutHint::PrimaryPlane];
+    return primary.isNull() ? scanoutHints[Internal::ScanoutHint::OverlayPlane] : primary;
+}
+
+void WaylandSurfacePrivate::setScanoutHint(Internal::ScanoutHint::Plane plane, const Internal::ScanoutHint &hint)
+{
+    Q_Q(WaylandSurface);
+
+    if (scanoutHints[plane] == hint)
+        return;
+
+    const Internal::ScanoutHint previous = scanoutHint();
+    scanoutHints[plane] = hint;
+    if (scanoutHint() == previous || !compositor)
+        return;
+
+    // Integrations that can allocate for a plane tell the client
+    const auto integrations = WaylandCompositorPrivate::get(compositor)->clientBufferIntegrations();
+    for (Internal::ClientBufferIntegration *integration : integrations)
+        integration->scanoutHintChanged(q);
+}
+
 void WaylandSurfacePrivate::initSubsurface(WaylandSurface *parent, wl_client *client, int id, int version)
 {
     Q_Q(WaylandSurface);
@@ -1064,15 +1367,20 @@ void WaylandSurfacePrivate::Subsurface::subsurface_place_below(wl_subsurface::Re
 void WaylandSurfacePrivate::Subsurface::subsurface_set_sync(wl_subsurface::Resource *resource)
 {
     Q_UNUSED(resource);
-    // TODO: sync/desync implementation
-    qDebug() << Q_FUNC_INFO;
+    synchronized = true;
 }
 
 void WaylandSurfacePrivate::Subsurface::subsurface_set_desync(wl_subsurface::Resource *resource)
 {
     Q_UNUSED(resource);
-    // TODO: sync/desync implementation
-    qDebug() << Q_FUNC_INFO;
+    const bool wasSynchronized = surface->isSynchronized();
+    synchronized = false;
+
+    // The cached state is applied as soon as the surface is not synchronized anymore,
+    // which doesn't happen if an ancestor is still synchronized; so is the state of
+    // the descendants that were synchronized only because of this surface
+    if (wasSynchronized && !surface->isSynchronized())
+        surface->applyCachedStateWhenReady(true);
 }
 
 /*!
@@ -19,6 +19,7 @@
 #include <private/qobject_p.h>
 
 #include <private/aurorawlclientbuffer_p.h>
+#include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
 #include <LiriAuroraCompositor/aurorawaylandsurface.h>
 #include <LiriAuroraCompositor/aurorawaylandbufferref.h>
 
@@ -49,6 +50,7 @@ class WaylandCompositor;
 class WaylandSurface;
 class WaylandView;
 class WaylandInputMethodControl;
+class LinuxDrmSyncobjSurfaceV1;
 
 namespace Internal {
 class FrameCallback;
@@ -83,6 +85,10 @@ public:
     void initSubsurface(WaylandSurface *parent, struct ::wl_client *client, int id, int version);
     bool isSubsurface() const { return subsurface; }
     WaylandSurfacePrivate *parentSurface() const { return subsurface ? subsurface->parentSurface : nullptr; }
+    bool isSynchronized() const;
+
+    const Internal::ScanoutHint &scanoutHint() const;
+    void setScanoutHint(Internal::ScanoutHint::Plane plane, const Internal::ScanoutHint &hint);
 
 protected:
     void surface_destroy_resource(Resource *resource) override;
@@ -104,6 +110,26 @@ protected:
     void surface_set_buffer_scale(Resource *resource, int32_t bufferScale) override;
 
     Internal::ClientBuffer *getBuffer(struct ::wl_resource *buffer);
+    QRegion bufferDamageSince(quint32 serial) const;
+
+    struct StateChanges {
+        QSize oldBufferSize;
+        QRectF oldSourceGeometry;
+        QSize oldDestinationSize;
+        bool oldHasContent = false;
+        int oldBufferScale = 1;
+        bool opaqueChanged = false;
+        QPoint offsetForNextFrame;
+    };
+
+    void cacheState();
+    void applyCachedState(bool desynchronized = false);
+    void applyCachedStateWhenReady(bool desynchronized = false);
+    Internal::SyncPoint pendingAcquirePoint(bool desynchronized) const;
+    void applyCachedStateRecursively(QList<QPair<QPointer<WaylandSurface>, StateChanges>> &applied,
+                                     bool desynchronized);
+    StateChanges applyState();
+    void emitStateChanges(const StateChanges &changes);
 
 public: //member variables
     WaylandCompositor *compositor = nullptr;
@@ -114,8 +140,9 @@ public: //member variables
     WaylandBufferRef bufferRef;
     WaylandSurfaceRole *role = nullptr;
     WaylandViewporterPrivate::Viewport *viewport = nullptr;
+    LinuxDrmSyncobjSurfaceV1 *syncobjSurface = nullptr;
 
-    struct {
+    struct State {
         WaylandBufferRef buffer;
         QRegion surfaceDamage;
         QRegion bufferDamage;
@@ -123,21 +150,40 @@ public: //member variables
         bool newlyAttached = false;
         QRegion inputRegion;
         int bufferScale = 1;
+        int32_t bufferTransform = WL_OUTPUT_TRANSFORM_NORMAL;
         QRectF sourceGeometry;
         QSize destinationSize;
         QRegion opaqueRegion;
-    } pending;
+        Internal::SyncPoint acquirePoint;
+        Internal::SyncPoint releasePoint;
+    };
+
+    // State set by requests, and state committed but not applied yet
+    // because the surface is a synchronized subsurface
+    State pending;
+    State cached;
+    bool hasCachedState = false;
 
     QPoint lastLocalMousePos;
     QPoint lastGlobalMousePos;
 
     QList<Internal::FrameCallback *> pendingFrameCallbacks;
+    QList<Internal::FrameCallback *> cachedFrameCallbacks;
     QList<Internal::FrameCallback *> frameCallbacks;
 
     QList<QPointer<WaylandSurface>> subsurfaceChildren;
 
     QList<WaylandIdleInhibitManagerV1Private::Inhibitor *> idleInhibitors;
 
+    // Damage in buffer coordinates of the last commits, newest last, used to
+    // compute what changed since a buffer was last committed to this surface
+    QList<QRegion> bufferDamageHistory;
+    quint32 commitSerial = 0;
+    QSharedPointer<Internal::BufferUploadStatistics> uploadStatistics;
+
+    // Set while the surface could be put on a plane of that kind
+    Internal::ScanoutHint scanoutHints[2];
+
     QRegion inputRegion;
     QRegion opaqueRegion;
 
@@ -145,6 +191,7 @@ public: //member variables
     QSize destinationSize;
     QSize bufferSize;
     int bufferScale = 1;
+    int32_t bufferTransform = WL_OUTPUT_TRANSFORM_NORMAL;
     bool isCursorSurface = false;
     bool destroyed = false;
     bool hasContent = false;
@@ -174,6 +221,7 @@ public: //member variables
         WaylandSurfacePrivate *surface = nullptr;
         WaylandSurfacePrivate *parentSurface = nullptr;
         QPoint position;
+        bool synchronized = true;
     };
 
     Subsurface *subsurface = nullptr;
@@ -183,6 +231,7 @@ public: //member variables
 #endif
     Q_DECLARE_PUBLIC(WaylandSurface)
     Q_DISABLE_COPY(WaylandSurfacePrivate)
+    friend class tst_WaylandCompositor;
 };
 
 } // namespace Compositor
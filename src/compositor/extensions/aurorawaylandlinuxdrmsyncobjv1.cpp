@@ -0,0 +1,317 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aurorawaylandlinuxdrmsyncobjv1_p.h"
+#include "aurorawaylandlinuxdrmsyncobjv1_p_p.h"
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandSurface>
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
+#include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+/*!
+ * \class WaylandLinuxDrmSyncobjManagerV1
+ * \inmodule AuroraCompositor
+ * \brief Provides explicit synchronization of client buffers.
+ *
+ * Clients attach an acquire point, that the compositor waits for before the
+ * content of the buffer is used, and a release point, that the compositor
+ * signals when it is done with the buffer.
+ *
+ * The timelines are imported by the backend of the client buffer integration.
+ * The global is only advertised when there is a backend.
+ *
+ * WaylandLinuxDrmSyncobjManagerV1 corresponds to the Wayland
+ * \c wp_linux_drm_syncobj_manager_v1 interface.
+ */
+
+/*!
+ * Constructs a WaylandLinuxDrmSyncobjManagerV1 object for \a compositor.
+ */
+WaylandLinuxDrmSyncobjManagerV1::WaylandLinuxDrmSyncobjManagerV1(WaylandCompositor *compositor)
+    : WaylandCompositorExtensionTemplate(compositor, *new WaylandLinuxDrmSyncobjManagerV1Private)
+{
+}
+
+/*!
+ * Constructs an empty WaylandLinuxDrmSyncobjManagerV1 object.
+ */
+WaylandLinuxDrmSyncobjManagerV1::WaylandLinuxDrmSyncobjManagerV1()
+    : WaylandCompositorExtensionTemplate(*new WaylandLinuxDrmSyncobjManagerV1Private)
+{
+}
+
+/*!
+ * Initializes the extension.
+ */
+void WaylandLinuxDrmSyncobjManagerV1::initialize()
+{
+    Q_D(WaylandLinuxDrmSyncobjManagerV1);
+
+    WaylandCompositorExtensionTemplate::initialize();
+
+    WaylandCompositor *compositor = this->compositor();
+    if (!compositor) {
+        qWarning() << "Failed to find WaylandCompositor when initializing WaylandLinuxDrmSyncobjManagerV1";
+        return;
+    }
+
+    if (!d->backend) {
+        const auto integrations = WaylandCompositorPrivate::get(compositor)->clientBufferIntegrations();
+        for (auto *integration : integrations) {
+            d->backend = integration->syncTimelineBackend();
+            if (d->backend)
+                break;
+        }
+    }
+
+    // Clients fall back to implicit synchronization
+    if (!d->backend) {
+        qCDebug(gLcAuroraCompositorHardwareIntegration,
+                "Synchronization objects are not supported, explicit synchronization is disabled");
+        return;
+    }
+
+    d->init(compositor->display(), 1);
+}
+
+WaylandCompositor *WaylandLinuxDrmSyncobjManagerV1::compositor() const
+{
+    return qobject_cast<WaylandCompositor *>(extensionContainer());
+}
+
+/*!
+ * Returns the backend that imports timelines.
+ */
+Internal::SyncTimelineBackend *WaylandLinuxDrmSyncobjManagerV1::backend() const
+{
+    Q_D(const WaylandLinuxDrmSyncobjManagerV1);
+    return d->backend;
+}
+
+/*!
+ * Sets the \a backend that imports timelines, instead of the one
+ * of the client buffer integration.
+ *
+ * The backend must be set before the extension is initialized and
+ * outlive it.
+ */
+void WaylandLinuxDrmSyncobjManagerV1::setBackend(Internal::SyncTimelineBackend *backend)
+{
+    Q_D(WaylandLinuxDrmSyncobjManagerV1);
+
+    if (isInitialized()) {
+        qWarning("Setting the backend of WaylandLinuxDrmSyncobjManagerV1 after initialization has no effect");
+        return;
+    }
+
+    d->backend = backend;
+}
+
+/*!
+ * Returns the Wayland interface for the WaylandLinuxDrmSyncobjManagerV1.
+ */
+const struct wl_interface *WaylandLinuxDrmSyncobjManagerV1::interface()
+{
+    return WaylandLinuxDrmSyncobjManagerV1Private::interface();
+}
+
+/*!
+ * \internal
+ */
+QByteArray WaylandLinuxDrmSyncobjManagerV1::interfaceName()
+{
+    return WaylandLinuxDrmSyncobjManagerV1Private::interfaceName();
+}
+
+void WaylandLinuxDrmSyncobjManagerV1Private::wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource)
+{
+    // Timelines and surfaces are allowed to outlive the manager
+    wl_resource_destroy(resource->handle);
+}
+
+void WaylandLinuxDrmSyncobjManagerV1Private::wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id, struct ::wl_resource *surfaceResource)
+{
+    auto *surface = WaylandSurface::fromResource(surfaceResource);
+    if (!surface) {
+        qWarning() << "Couldn't find surface for wp_linux_drm_syncobj_manager_v1";
+        return;
+    }
+
+    auto *surfacePrivate = WaylandSurfacePrivate::get(surface);
+    if (surfacePrivate->syncobjSurface) {
+        wl_resource_post_error(resource->handle, error_surface_exists,
+                               "surface already has a synchronization object");
+        return;
+    }
+
+    surfacePrivate->syncobjSurface =
+            new LinuxDrmSyncobjSurfaceV1(backend, surface, resource->client(), id,
+                                         wl_resource_get_version(resource->handle));
+}
+
+void WaylandLinuxDrmSyncobjManagerV1Private::wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id, int32_t fd)
+{
+    auto timeline = backend->importTimeline(fd);
+    if (!timeline) {
+        wl_resource_post_error(resource->handle, error_invalid_timeline,
+                               "failed to import the timeline");
+        return;
+    }
+
+    new LinuxDrmSyncobjTimelineV1(timeline, resource->client(), id,
+                                  wl_resource_get_version(resource->handle));
+}
+
+LinuxDrmSyncobjTimelineV1::LinuxDrmSyncobjTimelineV1(const QSharedPointer<Internal::SyncTimeline> &timeline,
+                                                     struct ::wl_client *client, int id, int version)
+    : PrivateServer::wp_linux_drm_syncobj_timeline_v1(client, id, version)
+    , m_timeline(timeline)
+{
+}
+
+LinuxDrmSyncobjTimelineV1 *LinuxDrmSyncobjTimelineV1::fromResource(struct ::wl_resource *resource)
+{
+    if (auto *r = Resource::fromResource(resource))
+        return static_cast<LinuxDrmSyncobjTimelineV1 *>(r->wp_linux_drm_syncobj_timeline_v1_object);
+    return nullptr;
+}
+
+void LinuxDrmSyncobjTimelineV1::wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource);
+    // Points that were set keep a reference to the timeline
+    delete this;
+}
+
+void LinuxDrmSyncobjTimelineV1::wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+LinuxDrmSyncobjSurfaceV1::LinuxDrmSyncobjSurfaceV1(Internal::SyncTimelineBackend *backend, WaylandSurface *surface,
+                                                   struct ::wl_client *client, int id, int version)
+    : PrivateServer::wp_linux_drm_syncobj_surface_v1(client, id, version)
+    , m_backend(backend)
+    , m_surface(surface)
+{
+    Q_ASSERT(surface);
+}
+
+LinuxDrmSyncobjSurfaceV1::~LinuxDrmSyncobjSurfaceV1()
+{
+    if (m_surface) {
+        auto *surfacePrivate = WaylandSurfacePrivate::get(m_surface);
+        Q_ASSERT(surfacePrivate->syncobjSurface == this);
+        surfacePrivate->syncobjSurface = nullptr;
+    }
+}
+
+// This function has to be called when the surface is committed, with the
+// pending buffer and points, before they are cached
+bool LinuxDrmSyncobjSurfaceV1::checkCommit(struct ::wl_resource *buffer, const Internal::SyncPoint &acquire,
+                                           const Internal::SyncPoint &release)
+{
+    if (!buffer) {
+        if (!acquire.isNull() || !release.isNull()) {
+            wl_resource_post_error(resource()->handle, error_no_buffer,
+                                   "timeline points set without a buffer");
+            return false;
+        }
+        return true;
+    }
+
+    if (!m_backend->supportsBuffer(buffer)) {
+        wl_resource_post_error(resource()->handle, error_unsupported_buffer,
+                               "the buffer does not support explicit synchronization");
+        return false;
+    }
+
+    if (acquire.isNull()) {
+        wl_resource_post_error(resource()->handle, error_no_acquire_point,
+                               "buffer attached without an acquire point");
+        return false;
+    }
+
+    if (release.isNull()) {
+        wl_resource_post_error(resource()->handle, error_no_release_point,
+                               "buffer attached without a release point");
+        return false;
+    }
+
+    if (acquire.timeline == release.timeline && acquire.point >= release.point) {
+        wl_resource_post_error(resource()->handle, error_conflicting_points,
+                               "acquire point %llu is not before release point %llu",
+                               static_cast<unsigned long long>(acquire.point),
+                               static_cast<unsigned long long>(release.point));
+        return false;
+    }
+
+    return true;
+}
+
+void LinuxDrmSyncobjSurfaceV1::wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource);
+    delete this;
+}
+
+void LinuxDrmSyncobjSurfaceV1::wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource)
+{
+    // Points set since the last commit are discarded
+    if (m_surface) {
+        auto *surfacePrivate = WaylandSurfacePrivate::get(m_surface);
+        surfacePrivate->pending.acquirePoint = Internal::SyncPoint();
+        surfacePrivate->pending.releasePoint = Internal::SyncPoint();
+    }
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDrmSyncobjSurfaceV1::wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, struct ::wl_resource *timeline,
+                                                                                 uint32_t point_hi, uint32_t point_lo)
+{
+    if (m_surface) {
+        auto *surfacePrivate = WaylandSurfacePrivate::get(m_surface);
+        setPoint(resource, timeline, point_hi, point_lo, &surfacePrivate->pending.acquirePoint);
+    } else {
+        setPoint(resource, timeline, point_hi, point_lo, nullptr);
+    }
+}
+
+void LinuxDrmSyncobjSurfaceV1::wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, struct ::wl_resource *timeline,
+                                                                                 uint32_t point_hi, uint32_t point_lo)
+{
+    if (m_surface) {
+        auto *surfacePrivate = WaylandSurfacePrivate::get(m_surface);
+        setPoint(resource, timeline, point_hi, point_lo, &surfacePrivate->pending.releasePoint);
+    } else {
+        setPoint(resource, timeline, point_hi, point_lo, nullptr);
+    }
+}
+
+void LinuxDrmSyncobjSurfaceV1::setPoint(Resource *resource, struct ::wl_resource *timeline,
+                                        uint32_t point_hi, uint32_t point_lo, Internal::SyncPoint *point)
+{
+    if (!point) {
+        wl_resource_post_error(resource->handle, error_no_surface,
+                               "timeline point set for destroyed surface");
+        return;
+    }
+
+    auto *syncobjTimeline = LinuxDrmSyncobjTimelineV1::fromResource(timeline);
+    Q_ASSERT(syncobjTimeline);
+
+    point->timeline = syncobjTimeline->timeline();
+    point->point = (quint64(point_hi) << 32) | point_lo;
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawaylandlinuxdrmsyncobjv1_p.cpp"
@@ -0,0 +1,49 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <LiriAuroraCompositor/aurorawaylandcompositorextension.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+class SyncTimelineBackend;
+}
+
+class WaylandLinuxDrmSyncobjManagerV1Private;
+
+class LIRIAURORACOMPOSITOR_EXPORT WaylandLinuxDrmSyncobjManagerV1 : public WaylandCompositorExtensionTemplate<WaylandLinuxDrmSyncobjManagerV1>
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(WaylandLinuxDrmSyncobjManagerV1)
+public:
+    WaylandLinuxDrmSyncobjManagerV1();
+    WaylandLinuxDrmSyncobjManagerV1(WaylandCompositor *compositor);
+
+    WaylandCompositor *compositor() const;
+    void initialize() override;
+
+    Internal::SyncTimelineBackend *backend() const;
+    void setBackend(Internal::SyncTimelineBackend *backend);
+
+    static const struct wl_interface *interface();
+    static QByteArray interfaceName();
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
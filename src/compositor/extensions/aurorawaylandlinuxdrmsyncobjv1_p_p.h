@@ -0,0 +1,97 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandlinuxdrmsyncobjv1_p.h>
+#include <LiriAuroraCompositor/private/aurorawlsynctimeline_p.h>
+#include <LiriAuroraCompositor/private/aurora-server-linux-drm-syncobj-v1.h>
+
+#include <QPointer>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandSurface;
+
+class LinuxDrmSyncobjTimelineV1 : public PrivateServer::wp_linux_drm_syncobj_timeline_v1
+{
+public:
+    LinuxDrmSyncobjTimelineV1(const QSharedPointer<Internal::SyncTimeline> &timeline,
+                              struct ::wl_client *client, int id, int version);
+
+    QSharedPointer<Internal::SyncTimeline> timeline() const { return m_timeline; }
+
+    static LinuxDrmSyncobjTimelineV1 *fromResource(struct ::wl_resource *resource);
+
+protected:
+    void wp_linux_drm_syncobj_timeline_v1_destroy_resource(Resource *resource) override;
+    void wp_linux_drm_syncobj_timeline_v1_destroy(Resource *resource) override;
+
+private:
+    QSharedPointer<Internal::SyncTimeline> m_timeline;
+};
+
+class LIRIAURORACOMPOSITOR_EXPORT LinuxDrmSyncobjSurfaceV1 : public PrivateServer::wp_linux_drm_syncobj_surface_v1
+{
+public:
+    LinuxDrmSyncobjSurfaceV1(Internal::SyncTimelineBackend *backend, WaylandSurface *surface,
+                             struct ::wl_client *client, int id, int version);
+    ~LinuxDrmSyncobjSurfaceV1() override;
+
+    // Posts an error and returns false if the points don't match the attached buffer
+    bool checkCommit(struct ::wl_resource *buffer, const Internal::SyncPoint &acquire,
+                     const Internal::SyncPoint &release);
+
+protected:
+    void wp_linux_drm_syncobj_surface_v1_destroy_resource(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_surface_v1_set_acquire_point(Resource *resource, struct ::wl_resource *timeline,
+                                                           uint32_t point_hi, uint32_t point_lo) override;
+    void wp_linux_drm_syncobj_surface_v1_set_release_point(Resource *resource, struct ::wl_resource *timeline,
+                                                           uint32_t point_hi, uint32_t point_lo) override;
+
+private:
+    void setPoint(Resource *resource, struct ::wl_resource *timeline,
+                  uint32_t point_hi, uint32_t point_lo, Internal::SyncPoint *point);
+
+    Internal::SyncTimelineBackend *m_backend = nullptr;
+    QPointer<WaylandSurface> m_surface;
+};
+
+class WaylandLinuxDrmSyncobjManagerV1Private
+        : public WaylandCompositorExtensionPrivate
+        , public PrivateServer::wp_linux_drm_syncobj_manager_v1
+{
+    Q_DECLARE_PUBLIC(WaylandLinuxDrmSyncobjManagerV1)
+public:
+    WaylandLinuxDrmSyncobjManagerV1Private() = default;
+
+    static WaylandLinuxDrmSyncobjManagerV1Private *get(WaylandLinuxDrmSyncobjManagerV1 *manager) { return manager->d_func(); }
+
+    Internal::SyncTimelineBackend *backend = nullptr;
+
+protected:
+    void wp_linux_drm_syncobj_manager_v1_destroy(Resource *resource) override;
+    void wp_linux_drm_syncobj_manager_v1_get_surface(Resource *resource, uint32_t id,
+                                                     struct ::wl_resource *surface) override;
+    void wp_linux_drm_syncobj_manager_v1_import_timeline(Resource *resource, uint32_t id,
+                                                         int32_t fd) override;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
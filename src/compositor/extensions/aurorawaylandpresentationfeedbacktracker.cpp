@@ -0,0 +1,224 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aurorawaylandpresentationfeedbacktracker_p.h"
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+void PresentationFeedbackList::append(PresentationFeedbackNode *node)
+{
+    Q_ASSERT(!node->m_list);
+
+    node->m_list = this;
+    node->m_prev = m_last;
+    node->m_next = nullptr;
+    if (m_last)
+        m_last->m_next = node;
+    else
+        m_first = node;
+    m_last = node;
+    ++m_size;
+}
+
+void PresentationFeedbackList::append(PresentationFeedbackList &other)
+{
+    if (other.isEmpty())
+        return;
+
+    for (PresentationFeedbackNode *node = other.m_first; node; node = node->m_next)
+        node->m_list = this;
+
+    other.m_first->m_prev = m_last;
+    if (m_last)
+        m_last->m_next = other.m_first;
+    else
+        m_first = other.m_first;
+    m_last = other.m_last;
+    m_size += other.m_size;
+
+    other.m_first = other.m_last = nullptr;
+    other.m_size = 0;
+}
+
+void PresentationFeedbackList::remove(PresentationFeedbackNode *node)
+{
+    Q_ASSERT(node->m_list == this);
+
+    if (node->m_prev)
+        node->m_prev->m_next = node->m_next;
+    else
+        m_first = node->m_next;
+    if (node->m_next)
+        node->m_next->m_prev = node->m_prev;
+    else
+        m_last = node->m_prev;
+
+    node->m_prev = node->m_next = nullptr;
+    node->m_list = nullptr;
+    --m_size;
+}
+
+PresentationFeedbackNode *PresentationFeedbackList::takeFirst()
+{
+    PresentationFeedbackNode *node = m_first;
+    if (node)
+        remove(node);
+    return node;
+}
+
+PresentationFeedbackTracker::~PresentationFeedbackTracker()
+{
+    // Feedback is owned by subclasses, just unlink it
+    for (SurfaceEntry *entry : std::as_const(m_surfaces)) {
+        while (entry->pending.takeFirst()) {}
+        while (entry->committed.takeFirst()) {}
+        delete entry;
+    }
+    for (WindowEntry *entry : std::as_const(m_windows)) {
+        for (PresentationFeedbackList &frame : entry->frames) {
+            while (frame.takeFirst()) {}
+        }
+        delete entry;
+    }
+}
+
+/*
+    Adds \a node to the feedback of the next content update of \a surface.
+*/
+void PresentationFeedbackTracker::addFeedback(PresentationFeedbackNode *node, const void *surface)
+{
+    removeFeedback(node);
+
+    SurfaceEntry *&entry = m_surfaces[surface];
+    if (!entry)
+        entry = new SurfaceEntry;
+    entry->pending.append(node);
+}
+
+/*
+    Stops tracking \a node without sending anything, for example
+    because the client is gone.
+*/
+void PresentationFeedbackTracker::removeFeedback(PresentationFeedbackNode *node)
+{
+    if (node->m_list)
+        node->m_list->remove(node);
+}
+
+void PresentationFeedbackTracker::surfaceCommitted(const void *surface)
+{
+    SurfaceEntry *entry = m_surfaces.value(surface);
+    if (!entry)
+        return;
+
+    // The previous content update was replaced before being shown
+    const bool wasCommitted = !entry->committed.isEmpty();
+    discardAll(entry->committed);
+
+    if (entry->pending.isEmpty())
+        return;
+
+    entry->committed.append(entry->pending);
+    if (!wasCommitted)
+        m_committedSurfaces.append(surface);
+
+    if (const void *window = windowForSurface(surface)) {
+        if (!m_windows.contains(window)) {
+            m_windows.insert(window, new WindowEntry);
+            windowAdded(window);
+        }
+    }
+}
+
+void PresentationFeedbackTracker::surfaceDestroyed(const void *surface)
+{
+    SurfaceEntry *entry = m_surfaces.take(surface);
+    if (!entry)
+        return;
+
+    m_committedSurfaces.removeAll(surface);
+    discardAll(entry->pending);
+    discardAll(entry->committed);
+    delete entry;
+}
+
+/*
+    Starts a new frame of \a window, with the committed content updates of
+    the surfaces it shows. Must be called once for every frame, even when
+    no surface was committed, so that frames match presentation events.
+*/
+void PresentationFeedbackTracker::synchronize(const void *window)
+{
+    WindowEntry *entry = m_windows.value(window);
+    if (!entry)
+        return;
+
+    // Too many frames without presentation, merge with the last one
+    PresentationFeedbackList *frame;
+    if (entry->count == MaxQueuedFrames) {
+        frame = &entry->frames[(entry->first + entry->count - 1) % MaxQueuedFrames];
+    } else {
+        frame = &entry->frames[(entry->first + entry->count) % MaxQueuedFrames];
+        ++entry->count;
+    }
+
+    // Compact the list in place, without allocating
+    qsizetype kept = 0;
+    for (qsizetype i = 0, size = m_committedSurfaces.size(); i < size; ++i) {
+        const void *surface = m_committedSurfaces.at(i);
+        SurfaceEntry *surfaceEntry = m_surfaces.value(surface);
+        if (!surfaceEntry || surfaceEntry->committed.isEmpty())
+            continue;
+
+        if (windowForSurface(surface) == window)
+            frame->append(surfaceEntry->committed);
+        else
+            m_committedSurfaces[kept++] = surface;
+    }
+    m_committedSurfaces.resize(kept);
+}
+
+/*
+    Sends \a presentation to the feedback of the oldest frame of \a window
+    that was not presented yet.
+*/
+void PresentationFeedbackTracker::present(const void *window, const Presentation &presentation)
+{
+    WindowEntry *entry = m_windows.value(window);
+    if (!entry || entry->count == 0)
+        return;
+
+    PresentationFeedbackList &frame = entry->frames[entry->first];
+    entry->first = (entry->first + 1) % MaxQueuedFrames;
+    --entry->count;
+
+    while (PresentationFeedbackNode *node = frame.takeFirst())
+        feedbackPresented(node, window, presentation);
+}
+
+void PresentationFeedbackTracker::windowDestroyed(const void *window)
+{
+    WindowEntry *entry = m_windows.take(window);
+    if (!entry)
+        return;
+
+    for (PresentationFeedbackList &frame : entry->frames)
+        discardAll(frame);
+    delete entry;
+}
+
+void PresentationFeedbackTracker::discardAll(PresentationFeedbackList &list)
+{
+    while (PresentationFeedbackNode *node = list.takeFirst())
+        feedbackDiscarded(node);
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -0,0 +1,133 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+class PresentationFeedbackList;
+class PresentationFeedbackTracker;
+
+class LIRIAURORACOMPOSITOR_EXPORT PresentationFeedbackNode
+{
+public:
+    bool isTracked() const { return m_list != nullptr; }
+
+private:
+    friend class PresentationFeedbackList;
+    friend class PresentationFeedbackTracker;
+
+    PresentationFeedbackNode *m_prev = nullptr;
+    PresentationFeedbackNode *m_next = nullptr;
+    PresentationFeedbackList *m_list = nullptr;
+};
+
+// Intrusive list, so that feedback moves from one list to another without allocating
+class LIRIAURORACOMPOSITOR_EXPORT PresentationFeedbackList
+{
+public:
+    PresentationFeedbackList() = default;
+    Q_DISABLE_COPY_MOVE(PresentationFeedbackList)
+
+    bool isEmpty() const { return !m_first; }
+    int size() const { return m_size; }
+
+    void append(PresentationFeedbackNode *node);
+    void append(PresentationFeedbackList &other);
+    void remove(PresentationFeedbackNode *node);
+    PresentationFeedbackNode *takeFirst();
+
+private:
+    PresentationFeedbackNode *m_first = nullptr;
+    PresentationFeedbackNode *m_last = nullptr;
+    int m_size = 0;
+};
+
+/*
+    Tracks presentation feedback from the request to the presentation of the
+    frame that shows the content update, with per-surface and per-window lists
+    that are resolved in one pass. Surfaces and windows are opaque keys, the
+    subclass maps surfaces to windows and sends the events.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT PresentationFeedbackTracker
+{
+public:
+    // Frames that can be synchronized but not presented yet, per window
+    static const int MaxQueuedFrames = 3;
+
+    struct Presentation {
+        quint64 sequence = 0;
+        quint64 tv_sec = 0;
+        quint32 tv_nsec = 0;
+        quint32 refresh_nsec = 0;
+        quint32 flags = 0;
+    };
+
+    PresentationFeedbackTracker() = default;
+    virtual ~PresentationFeedbackTracker();
+    Q_DISABLE_COPY_MOVE(PresentationFeedbackTracker)
+
+    bool isTrackingSurface(const void *surface) const { return m_surfaces.contains(surface); }
+    bool isTrackingWindow(const void *window) const { return m_windows.contains(window); }
+
+    void addFeedback(PresentationFeedbackNode *node, const void *surface);
+    void removeFeedback(PresentationFeedbackNode *node);
+
+    void surfaceCommitted(const void *surface);
+    void surfaceDestroyed(const void *surface);
+
+    void synchronize(const void *window);
+    void present(const void *window, const Presentation &presentation);
+    void windowDestroyed(const void *window);
+
+protected:
+    virtual const void *windowForSurface(const void *surface) const = 0;
+    virtual void windowAdded(const void *window) { Q_UNUSED(window); }
+    virtual void feedbackPresented(PresentationFeedbackNode *node, const void *window,
+                                   const Presentation &presentation) = 0;
+    virtual void feedbackDiscarded(PresentationFeedbackNode *node) = 0;
+
+private:
+    struct SurfaceEntry {
+        PresentationFeedbackList pending;
+        PresentationFeedbackList committed;
+    };
+
+    struct WindowEntry {
+        PresentationFeedbackList frames[MaxQueuedFrames];
+        int first = 0;
+        int count = 0;
+    };
+
+    void discardAll(PresentationFeedbackList &list);
+
+    QHash<const void *, SurfaceEntry *> m_surfaces;
+    QHash<const void *, WindowEntry *> m_windows;
+    QList<const void *> m_committedSurfaces;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
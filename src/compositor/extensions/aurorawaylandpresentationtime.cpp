@@ -5,10 +5,15 @@
 #include "aurorawaylandpresentationtime_p_p.h"
 
 #include <time.h>
+#include <QGuiApplication>
 #include <QQuickWindow>
 #include <LiriAuroraCompositor/WaylandView>
 #include <LiriAuroraCompositor/WaylandQuickItem>
 
+#if LIRI_FEATURE_aurora_qpa
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+#endif
+
 namespace Aurora {
 
 namespace Compositor {
@@ -33,6 +38,8 @@ namespace Compositor {
  *
  * Then, call sendFeedback() when a surface is presented on screen.
  * Usually, the timing can be obtained from drm page flip event.
+ * With the Aurora EGLFS platform plugin, feedback is sent automatically
+ * with the timestamps of the page flip events of each output.
  *
  * \qml
  * import Aurora.Compositor.PresentationTime
@@ -98,6 +105,10 @@ void WaylandPresentationTime::initialize()
     WaylandCompositorExtensionTemplate::initialize();
 
     d->init(compositor->display(), /* version */ 1);
+
+    // Presentation events are posted by the platform plugin for each page flip
+    if (QCoreApplication::instance())
+        QCoreApplication::instance()->installEventFilter(this);
 }
 
 WaylandCompositor *WaylandPresentationTime::compositor() const
@@ -112,6 +123,9 @@ WaylandCompositor *WaylandPresentationTime::compositor() const
  * If your platform supports DRM events, \c page_flip_handler is the proper timing to send it.
  * The \a sequence is the refresh counter. \a sec and \a nsec hold the
  * seconds and nanoseconds parts of the presentation timestamp, respectively.
+ *
+ * The refresh duration is derived from the screen refresh rate, and the
+ * presentation is only reported as synchronized to the vertical retrace.
  */
 
 /*!
@@ -119,6 +133,9 @@ WaylandCompositor *WaylandPresentationTime::compositor() const
  * If your platform supports DRM events, \c page_flip_handler is the proper timing to send it.
  * The \a sequence is the refresh counter. \a tv_sec and \a tv_nsec hold the
  * seconds and nanoseconds parts of the presentation timestamp, respectively.
+ *
+ * The refresh duration is derived from the screen refresh rate, and the
+ * presentation is only reported as synchronized to the vertical retrace.
  */
 void WaylandPresentationTime::sendFeedback(QQuickWindow *window, quint64 sequence, quint64 tv_sec, quint32 tv_nsec)
 {
@@ -127,147 +144,125 @@ void WaylandPresentationTime::sendFeedback(QQuickWindow *window, quint64 sequenc
 
     quint32 refresh_nsec = window->screen()->refreshRate() != 0 ? 1000000000 / window->screen()->refreshRate() : 0;
 
-    emit presented(sequence, tv_sec, tv_nsec, refresh_nsec);
+    sendFeedback(window, sequence, tv_sec, tv_nsec, refresh_nsec, Vsync);
 }
 
 /*!
- * Returns the Wayland interface for the WaylandPresentationTime.
+ * \qmlmethod void PresentationTime::sendFeedback(Window window, int sequence, int sec, int nsec, int refreshNsec, PresentationFlags flags)
+ *
+ * Interface to notify that a frame is presented on screen using \a window.
+ * The \a sequence is the refresh counter. \a sec and \a nsec hold the
+ * seconds and nanoseconds parts of the presentation timestamp, respectively,
+ * in the \c CLOCK_MONOTONIC domain. \a refreshNsec is the exact duration of a
+ * refresh cycle or 0 if unknown, and \a flags describe how the presentation
+ * timestamp was obtained.
  */
-const struct wl_interface *WaylandPresentationTime::interface()
-{
-    return WaylandPresentationTimePrivate::interface();
-}
 
 /*!
- * \internal
+ * Interface to notify that a frame is presented on screen using \a window.
+ * The \a sequence is the refresh counter. \a tv_sec and \a tv_nsec hold the
+ * seconds and nanoseconds parts of the presentation timestamp, respectively,
+ * in the \c CLOCK_MONOTONIC domain. \a refresh_nsec is the exact duration of a
+ * refresh cycle or 0 if unknown, and \a flags describe how the presentation
+ * timestamp was obtained: only set the flags that are actually true.
  */
-QByteArray WaylandPresentationTime::interfaceName()
+void WaylandPresentationTime::sendFeedback(QQuickWindow *window, quint64 sequence, quint64 tv_sec, quint32 tv_nsec,
+                                           quint32 refresh_nsec, PresentationFlags flags)
 {
-    return WaylandPresentationTimePrivate::interfaceName();
-}
-
-PresentationFeedback::PresentationFeedback(WaylandPresentationTime *pTime, WaylandSurface *surface, struct ::wl_client *client, uint32_t id, int version)
-    : wp_presentation_feedback(client, id, version)
-    , m_presentationTime(pTime)
-{
-    setSurface(surface);
-}
-
-void PresentationFeedback::setSurface(WaylandSurface *qwls)
-{
-    if (!qwls) {
-        discard();
-        return;
-    }
-
-    m_surface = qwls;
-
-    connect(qwls, &WaylandSurface::damaged, this, &PresentationFeedback::onSurfaceCommit);
-    connect(qwls, &WaylandSurface::destroyed, this, &PresentationFeedback::discard);
+    Q_D(WaylandPresentationTime);
 
-    WaylandView *view = qwls ? qwls->primaryView() : nullptr;
-    //The surface has not committed yet.
-    if (!view) {
-        connect(qwls, &WaylandSurface::hasContentChanged, this, &PresentationFeedback::onSurfaceMapped);
+    if (!window)
         return;
-    }
 
-    maybeConnectToWindow(view);
-}
+    emit presented(window, sequence, tv_sec, tv_nsec, refresh_nsec, flags);
 
-void PresentationFeedback::onSurfaceCommit()
-{
-    // There is a new commit before sync so that discard this feedback.
-    if (m_committed) {
-        discard();
-        return;
-    }
-    m_committed = true;
+    Internal::PresentationFeedbackTracker::Presentation presentation;
+    presentation.sequence = sequence;
+    presentation.tv_sec = tv_sec;
+    presentation.tv_nsec = tv_nsec;
+    presentation.refresh_nsec = refresh_nsec;
+    presentation.flags = flags.toInt();
+    d->present(window, presentation);
 }
 
-void PresentationFeedback::onSurfaceMapped()
+/*!
+ * \internal
+ */
+bool WaylandPresentationTime::eventFilter(QObject *watched, QEvent *event)
 {
-    WaylandView *view = m_surface->primaryView();
-    if (!view) {
-        qWarning() << "The mapped surface has no view";
-        discard();
-        return;
+#if LIRI_FEATURE_aurora_qpa
+    using Aurora::PlatformSupport::PresentationEvent;
+
+    if (event->type() == PresentationEvent::registeredType()) {
+        auto *e = static_cast<PresentationEvent *>(event);
+
+        PresentationFlags flags;
+        if (e->flags.testFlag(PresentationEvent::Vsync))
+            flags |= Vsync;
+        if (e->flags.testFlag(PresentationEvent::HwClock))
+            flags |= HwClock;
+        if (e->flags.testFlag(PresentationEvent::HwCompletion))
+            flags |= HwCompletion;
+        if (e->flags.testFlag(PresentationEvent::ZeroCopy))
+            flags |= ZeroCopy;
+
+        // Only the windows on the output that was flipped were presented
+        const auto windows = QGuiApplication::topLevelWindows();
+        for (QWindow *window : windows) {
+            auto *quickWindow = qobject_cast<QQuickWindow *>(window);
+            if (quickWindow && quickWindow->screen() == e->screen)
+                sendFeedback(quickWindow, e->sequence, e->tv_sec, e->tv_nsec, e->refresh_nsec, flags);
+        }
     }
+#endif
 
-    maybeConnectToWindow(view);
+    return WaylandCompositorExtensionTemplate::eventFilter(watched, event);
 }
 
-void PresentationFeedback::maybeConnectToWindow(WaylandView *view)
+/*!
+ * Returns the Wayland interface for the WaylandPresentationTime.
+ */
+const struct wl_interface *WaylandPresentationTime::interface()
 {
-    WaylandQuickItem *item = view ? qobject_cast<WaylandQuickItem *>(view->renderObject()) : nullptr;
-    if (!item) {
-        qWarning() << "WaylandPresentationTime only works with QtQuick compositors" << view;
-        discard();
-        return;
-    }
-
-    connect(item, &QQuickItem::windowChanged, this, &PresentationFeedback::onWindowChanged);
-    // wait for having window
-    if (!item->window()) {
-       return;
-    }
-
-    connectToWindow(item->window());
+    return WaylandPresentationTimePrivate::interface();
 }
 
-void PresentationFeedback::onWindowChanged()
+/*!
+ * \internal
+ */
+QByteArray WaylandPresentationTime::interfaceName()
 {
-    WaylandQuickItem *item = qobject_cast<WaylandQuickItem *>(sender());
-    QQuickWindow *window = item ? item->window() : nullptr;
-
-    if (!window) {
-        qWarning() << "WaylandPresentationTime only works with QtQuick compositors" << item;
-        discard();
-        /* Actually, the commit is not discarded yet. If the related item has new window,
-           the commit can be presented on screen. So we can choose not to discard the feedback
-           until item has new window or the surface is destroyed. */
-        return;
-    }
-
-    // Check if the connected window is changed
-    if (m_connectedWindow && m_connectedWindow != window)
-        m_connectedWindow->disconnect(this);
-
-    connectToWindow(window);
+    return WaylandPresentationTimePrivate::interfaceName();
 }
 
-void PresentationFeedback::connectToWindow(QQuickWindow *window)
+PresentationFeedback::PresentationFeedback(WaylandPresentationTime *presentationTime)
+    : m_presentationTime(presentationTime)
 {
-    if (!window) {
-        discard();
-        return;
-    }
-
-    m_connectedWindow = window;
-
-    connect(window, &QQuickWindow::beforeSynchronizing, this, &PresentationFeedback::onSync);
-    connect(window, &QQuickWindow::afterFrameEnd, this, &PresentationFeedback::onSwapped);
 }
 
-void PresentationFeedback::onSync()
+void PresentationFeedback::sendPresented(QQuickWindow *window, const Internal::PresentationFeedbackTracker::Presentation &presentation)
 {
-    QQuickWindow *window = qobject_cast<QQuickWindow *>(sender());
+    WaylandCompositor *compositor = m_presentationTime->compositor();
+    WaylandOutput *output = compositor ? compositor->outputFor(window) : nullptr;
+    struct ::wl_resource *r = output ? output->resourceForClient(WaylandClient::fromWlClient(compositor, resource()->client())) : nullptr;
+    if (r)
+        send_sync_output(r);
 
-    if (m_committed) {
-        disconnect(m_surface, &WaylandSurface::damaged, this, &PresentationFeedback::onSurfaceCommit);
-        disconnect(window, &QQuickWindow::beforeSynchronizing, this, &PresentationFeedback::onSync);
-        m_sync = true;
-    }
-}
+    const auto flags = WaylandPresentationTime::PresentationFlags::fromInt(presentation.flags);
+    uint32_t kind = 0;
+    if (flags.testFlag(WaylandPresentationTime::Vsync))
+        kind |= PrivateServer::wp_presentation_feedback::kind_vsync;
+    if (flags.testFlag(WaylandPresentationTime::HwClock))
+        kind |= PrivateServer::wp_presentation_feedback::kind_hw_clock;
+    if (flags.testFlag(WaylandPresentationTime::HwCompletion))
+        kind |= PrivateServer::wp_presentation_feedback::kind_hw_completion;
+    if (flags.testFlag(WaylandPresentationTime::ZeroCopy))
+        kind |= PrivateServer::wp_presentation_feedback::kind_zero_copy;
 
-void PresentationFeedback::onSwapped()
-{
-    QQuickWindow *window = qobject_cast<QQuickWindow *>(sender());
+    send_presented(presentation.tv_sec >> 32, presentation.tv_sec, presentation.tv_nsec,
+                   presentation.refresh_nsec, presentation.sequence >> 32, presentation.sequence, kind);
 
-    if (m_sync) {
-        disconnect(window, &QQuickWindow::afterFrameEnd, this, &PresentationFeedback::onSwapped);
-        connect(m_presentationTime, &WaylandPresentationTime::presented, this, &PresentationFeedback::sendPresented);
-    }
+    destroy();
 }
 
 void PresentationFeedback::discard()
@@ -276,47 +271,41 @@ void PresentationFeedback::discard()
     destroy();
 }
 
-void PresentationFeedback::sendSyncOutput()
+void PresentationFeedback::destroy()
 {
-    WaylandCompositor *compositor = presentationTime()->compositor();
-    if (!compositor) {
-        qWarning() << "No compositor container to send sync_output";
-        return;
-    }
-
-    WaylandView *view = surface()->primaryView();
-    WaylandOutput *output = view ? view->output() : nullptr;
-    struct ::wl_resource *r = output ? output->resourceForClient(WaylandClient::fromWlClient(compositor, resource()->client())) : nullptr;
-
-    if (r)
-        send_sync_output(r);
+    wl_resource_destroy(resource()->handle);
 }
 
-void PresentationFeedback::sendPresented(quint64 sequence, quint64 tv_sec, quint32 tv_nsec, quint32 refresh_nsec)
+void PresentationFeedback::wp_presentation_feedback_destroy_resource(Resource *resource)
 {
-    sendSyncOutput();
-
-    send_presented(tv_sec >> 32, tv_sec, tv_nsec, refresh_nsec, sequence >> 32, sequence,
-            PrivateServer::wp_presentation_feedback::kind_vsync
-            | PrivateServer::wp_presentation_feedback::kind_hw_clock
-            | PrivateServer::wp_presentation_feedback::kind_hw_completion);
+    Q_UNUSED(resource);
 
-    destroy();
+    // The extension might be gone already when the display is destroyed
+    if (m_presentationTime)
+        WaylandPresentationTimePrivate::get(m_presentationTime)->recycleFeedback(this);
+    else
+        delete this;
 }
 
-void PresentationFeedback::destroy()
+WaylandPresentationTimePrivate::WaylandPresentationTimePrivate()
 {
-    wl_resource_destroy(resource()->handle);
 }
 
-void PresentationFeedback::wp_presentation_feedback_destroy_resource(Resource *resource)
+WaylandPresentationTimePrivate::~WaylandPresentationTimePrivate()
 {
-    Q_UNUSED(resource);
-    delete this;
+    qDeleteAll(m_freeFeedback);
 }
 
-WaylandPresentationTimePrivate::WaylandPresentationTimePrivate()
+void WaylandPresentationTimePrivate::recycleFeedback(PresentationFeedback *feedback)
 {
+    // The client went away before the feedback was sent
+    removeFeedback(feedback);
+
+    // Keep enough objects around for a few busy frames
+    if (m_freeFeedback.size() < 1024)
+        m_freeFeedback.append(feedback);
+    else
+        delete feedback;
 }
 
 void WaylandPresentationTimePrivate::wp_presentation_bind_resource(Resource *resource)
@@ -332,13 +321,60 @@ void WaylandPresentationTimePrivate::wp_presentation_feedback(Resource *resource
     if (!qwls)
         return;
 
-    new PresentationFeedback(q, qwls, resource->client(), callback, /* version */ 1);
+    // One set of connections per surface, regardless of how many feedbacks are requested
+    if (!isTrackingSurface(qwls)) {
+        QObject::connect(qwls, &WaylandSurface::damaged, q, [this, qwls]() {
+            surfaceCommitted(qwls);
+        });
+        QObject::connect(qwls, &QObject::destroyed, q, [this, qwls]() {
+            surfaceDestroyed(qwls);
+        });
+    }
+
+    PresentationFeedback *feedback = m_freeFeedback.isEmpty()
+            ? new PresentationFeedback(q) : m_freeFeedback.takeLast();
+    feedback->init(resource->client(), callback, /* version */ 1);
+    addFeedback(feedback, qwls);
+}
+
+const void *WaylandPresentationTimePrivate::windowForSurface(const void *surface) const
+{
+    auto *qwls = static_cast<const WaylandSurface *>(surface);
+    WaylandView *view = qwls->primaryView();
+    WaylandQuickItem *item = view ? qobject_cast<WaylandQuickItem *>(view->renderObject()) : nullptr;
+    return item ? item->window() : nullptr;
+}
+
+void WaylandPresentationTimePrivate::windowAdded(const void *window)
+{
+    Q_Q(WaylandPresentationTime);
+
+    auto *quickWindow = static_cast<QQuickWindow *>(const_cast<void *>(window));
+
+    // The GUI thread is blocked while the scene graph synchronizes, so
+    // the committed state of the surfaces is what this frame shows
+    QObject::connect(quickWindow, &QQuickWindow::beforeSynchronizing, q, [this, window]() {
+        synchronize(window);
+    }, Qt::DirectConnection);
+    QObject::connect(quickWindow, &QObject::destroyed, q, [this, window]() {
+        windowDestroyed(window);
+    });
+}
+
+void WaylandPresentationTimePrivate::feedbackPresented(Internal::PresentationFeedbackNode *node, const void *window,
+                                                       const Presentation &presentation)
+{
+    auto *quickWindow = static_cast<QQuickWindow *>(const_cast<void *>(window));
+    static_cast<PresentationFeedback *>(node)->sendPresented(quickWindow, presentation);
+}
+
+void WaylandPresentationTimePrivate::feedbackDiscarded(Internal::PresentationFeedbackNode *node)
+{
+    static_cast<PresentationFeedback *>(node)->discard();
 }
 
 } // namespace Compositor
 
 } // namespace Aurora
 
-#include "moc_aurorawaylandpresentationtime_p_p.cpp"
-
 #include "moc_aurorawaylandpresentationtime_p.cpp"
@@ -31,6 +31,15 @@ class LIRIAURORACOMPOSITOR_EXPORT WaylandPresentationTime : public WaylandCompos
     Q_OBJECT
     Q_DECLARE_PRIVATE(WaylandPresentationTime)
 public:
+    enum PresentationFlag {
+        Vsync = 0x1,
+        HwClock = 0x2,
+        HwCompletion = 0x4,
+        ZeroCopy = 0x8
+    };
+    Q_DECLARE_FLAGS(PresentationFlags, PresentationFlag)
+    Q_FLAG(PresentationFlags)
+
     WaylandPresentationTime();
     WaylandPresentationTime(WaylandCompositor *compositor);
 
@@ -38,14 +47,22 @@ public:
     void initialize() override;
 
     Q_INVOKABLE void sendFeedback(QQuickWindow *window, quint64 sequence, quint64 tv_sec, quint32 tv_nsec);
+    Q_INVOKABLE void sendFeedback(QQuickWindow *window, quint64 sequence, quint64 tv_sec, quint32 tv_nsec,
+                                  quint32 refresh_nsec, Aurora::Compositor::WaylandPresentationTime::PresentationFlags flags);
 
     static const struct wl_interface *interface();
     static QByteArray interfaceName();
 
 Q_SIGNALS:
-    void presented(quint64 sequence, quint64 tv_sec, quint32 tv_nsec, quint32 refresh_nsec);
+    void presented(QQuickWindow *window, quint64 sequence, quint64 tv_sec, quint32 tv_nsec, quint32 refresh_nsec,
+                   Aurora::Compositor::WaylandPresentationTime::PresentationFlags flags);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(WaylandPresentationTime::PresentationFlags)
+
 } // namespace Compositor
 
 } // namespace Aurora
@@ -15,11 +15,10 @@
 //
 
 #include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandpresentationfeedbacktracker_p.h>
 #include <LiriAuroraCompositor/private/aurora-server-presentation-time.h>
 
-#include <QObject>
 #include <QPointer>
-#include <QMultiMap>
 
 class QQuickWindow;
 
@@ -29,57 +28,52 @@ namespace Compositor {
 
 
 class WaylandSurface;
-class WaylandView;
 
-class PresentationFeedback : public QObject, public PrivateServer::wp_presentation_feedback
+// Feedback objects are recycled, which is why they are not QObjects
+class PresentationFeedback : public PrivateServer::wp_presentation_feedback, public Internal::PresentationFeedbackNode
 {
-    Q_OBJECT
 public:
-    PresentationFeedback(WaylandPresentationTime *, WaylandSurface *, struct ::wl_client *, uint32_t, int);
+    explicit PresentationFeedback(WaylandPresentationTime *presentationTime);
 
-    void setSurface(WaylandSurface *);
-    WaylandSurface *surface() { return m_surface; }
-
-    void destroy();
-    void sendSyncOutput();
-
-private Q_SLOTS:
+    void sendPresented(QQuickWindow *window, const Internal::PresentationFeedbackTracker::Presentation &presentation);
     void discard();
-    void onSurfaceCommit();
-    void onSurfaceMapped();
-    void onWindowChanged();
-    void onSync();
-    void onSwapped();
-    void sendPresented(quint64 sequence, quint64 tv_sec, quint32 tv_nsec, quint32 refresh_nsec);
 
 private:
-    WaylandPresentationTime *presentationTime() { return m_presentationTime; }
-    void maybeConnectToWindow(WaylandView *);
-    void connectToWindow(QQuickWindow *);
+    void destroy();
 
     void wp_presentation_feedback_destroy_resource(Resource *resource) override;
 
-public:
-    WaylandPresentationTime *m_presentationTime = nullptr;
-    WaylandSurface *m_surface = nullptr;
-    QQuickWindow *m_connectedWindow = nullptr;
-
-    bool m_committed = false;
-    bool m_sync = false;
+    QPointer<WaylandPresentationTime> m_presentationTime;
 };
 
-class WaylandPresentationTimePrivate : public WaylandCompositorExtensionPrivate, public PrivateServer::wp_presentation
+class WaylandPresentationTimePrivate
+        : public WaylandCompositorExtensionPrivate
+        , public PrivateServer::wp_presentation
+        , public Internal::PresentationFeedbackTracker
 {
     Q_DECLARE_PUBLIC(WaylandPresentationTime)
 public:
     WaylandPresentationTimePrivate();
+    ~WaylandPresentationTimePrivate();
+
+    void recycleFeedback(PresentationFeedback *feedback);
+
+    static WaylandPresentationTimePrivate *get(WaylandPresentationTime *presentationTime) { return presentationTime->d_func(); }
 
 protected:
     void wp_presentation_feedback(Resource *resource, struct ::wl_resource *surface, uint32_t callback) override;
     void wp_presentation_bind_resource(Resource *resource) override;
+
+    const void *windowForSurface(const void *surface) const override;
+    void windowAdded(const void *window) override;
+    void feedbackPresented(Internal::PresentationFeedbackNode *node, const void *window,
+                           const Presentation &presentation) override;
+    void feedbackDiscarded(Internal::PresentationFeedbackNode *node) override;
+
+private:
+    QList<PresentationFeedback *> m_freeFeedback;
 };
 
 } // namespace Compositor
 
 } // namespace Aurora
-
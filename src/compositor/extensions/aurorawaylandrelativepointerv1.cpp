@@ -0,0 +1,194 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QCoreApplication>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandPointer>
+#include <LiriAuroraCompositor/WaylandSeat>
+#include <LiriAuroraCompositor/private/aurorawaylandpointer_p.h>
+
+#include "aurorawaylandrelativepointerv1_p.h"
+
+#if LIRI_FEATURE_aurora_qpa && LIRI_FEATURE_aurora_compositor_quick
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+#endif
+
+namespace Aurora {
+
+namespace Compositor {
+
+/*!
+ * \class WaylandRelativePointerManagerV1
+ * \inmodule AuroraCompositor
+ * \brief Provides relative pointer motion events.
+ *
+ * The WaylandRelativePointerManagerV1 extension lets clients receive pointer motion
+ * that is not clipped to the edges of the outputs, along with the motion before
+ * acceleration, which is what games and 3D applications need.
+ *
+ * Motion is sent to the client with mouse focus by WaylandPointer::sendRelativeMotionEvent().
+ * With the Aurora platform plugin, the deltas of the input devices are sent automatically
+ * to the pointer of the default seat.
+ *
+ * WaylandRelativePointerManagerV1 corresponds to the Wayland interface,
+ * \c zwp_relative_pointer_manager_v1.
+ */
+
+/*!
+ * \qmltype RelativePointerManagerV1
+ * \instantiates WaylandRelativePointerManagerV1
+ * \inqmlmodule Aurora.Compositor
+ * \brief Provides relative pointer motion events.
+ *
+ * The RelativePointerManagerV1 extension lets clients receive pointer motion
+ * that is not clipped to the edges of the outputs, along with the motion before
+ * acceleration.
+ *
+ * RelativePointerManagerV1 corresponds to the Wayland interface,
+ * \c zwp_relative_pointer_manager_v1.
+ *
+ * To provide the functionality of the extension in a compositor, create an instance of the
+ * RelativePointerManagerV1 component and add it to the list of extensions supported by the
+ * compositor:
+ *
+ * \qml
+ * import Aurora.Compositor
+ *
+ * WaylandCompositor {
+ *     RelativePointerManagerV1 {
+ *         // ...
+ *     }
+ * }
+ * \endqml
+ */
+
+/*!
+ * Constructs a WaylandRelativePointerManagerV1 object.
+ */
+WaylandRelativePointerManagerV1::WaylandRelativePointerManagerV1()
+    : WaylandCompositorExtensionTemplate<WaylandRelativePointerManagerV1>(*new WaylandRelativePointerManagerV1Private())
+{
+}
+
+/*!
+ * Constructs a WaylandRelativePointerManagerV1 object for the provided \a compositor.
+ */
+WaylandRelativePointerManagerV1::WaylandRelativePointerManagerV1(WaylandCompositor *compositor)
+    : WaylandCompositorExtensionTemplate<WaylandRelativePointerManagerV1>(compositor, *new WaylandRelativePointerManagerV1Private())
+{
+}
+
+/*!
+ * Initializes the extension.
+ */
+void WaylandRelativePointerManagerV1::initialize()
+{
+    Q_D(WaylandRelativePointerManagerV1);
+
+    WaylandCompositorExtensionTemplate::initialize();
+    WaylandCompositor *compositor = static_cast<WaylandCompositor *>(extensionContainer());
+    if (!compositor) {
+        qCWarning(gLcAuroraCompositor) << "Failed to find WaylandCompositor when initializing WaylandRelativePointerManagerV1";
+        return;
+    }
+    d->init(compositor->display(), d->interfaceVersion());
+
+    // Relative motion events are posted by the platform plugin
+    // once for all the motion events read at the same time
+    if (QCoreApplication::instance())
+        QCoreApplication::instance()->installEventFilter(this);
+}
+
+/*!
+ * Returns the Wayland interface for the WaylandRelativePointerManagerV1.
+ */
+const wl_interface *WaylandRelativePointerManagerV1::interface()
+{
+    return WaylandRelativePointerManagerV1Private::interface();
+}
+
+/*!
+ * \internal
+ */
+QByteArray WaylandRelativePointerManagerV1::interfaceName()
+{
+    return WaylandRelativePointerManagerV1Private::interfaceName();
+}
+
+/*!
+ * \internal
+ */
+bool WaylandRelativePointerManagerV1::eventFilter(QObject *watched, QEvent *event)
+{
+#if LIRI_FEATURE_aurora_qpa && LIRI_FEATURE_aurora_compositor_quick
+    using Aurora::PlatformSupport::RelativeMotionEvent;
+
+    if (event->type() == RelativeMotionEvent::registeredType()) {
+        auto *e = static_cast<RelativeMotionEvent *>(event);
+
+        auto *compositor = static_cast<WaylandCompositor *>(extensionContainer());
+        WaylandSeat *seat = compositor ? compositor->defaultSeat() : nullptr;
+        if (seat && seat->pointer())
+            seat->pointer()->sendRelativeMotionEvent(e->delta, e->deltaUnaccelerated, e->timestamp);
+    }
+#endif
+
+    return WaylandCompositorExtensionTemplate::eventFilter(watched, event);
+}
+
+void WaylandRelativePointerManagerV1Private::zwp_relative_pointer_manager_v1_destroy(Resource *resource)
+{
+    // Relative pointers are allowed to outlive the manager
+    wl_resource_destroy(resource->handle);
+}
+
+void WaylandRelativePointerManagerV1Private::zwp_relative_pointer_manager_v1_get_relative_pointer(Resource *resource, uint32_t id, wl_resource *pointerResource)
+{
+    auto *pointer = WaylandPointerPrivate::fromResource(pointerResource);
+    if (!pointer) {
+        wl_resource_post_error(resource->handle, WL_DISPLAY_ERROR_INVALID_OBJECT,
+                               "invalid wl_pointer@%d", wl_resource_get_id(pointerResource));
+        return;
+    }
+
+    auto *relativePointer = new WaylandRelativePointerV1(pointer, resource->client(), id, resource->version());
+    WaylandPointerPrivate::get(pointer)->relativePointers.append(relativePointer);
+}
+
+
+WaylandRelativePointerV1::WaylandRelativePointerV1(WaylandPointer *pointer, wl_client *client, int id, int version)
+    : PrivateServer::zwp_relative_pointer_v1(client, id, qMin<int>(version, interfaceVersion()))
+    , m_pointer(pointer)
+{
+    Q_ASSERT(pointer);
+}
+
+void WaylandRelativePointerV1::sendRelativeMotion(quint64 timestamp, const QPointF &delta, const QPointF &deltaUnaccelerated)
+{
+    send_relative_motion(quint32(timestamp >> 32), quint32(timestamp & 0xffffffff),
+                         wl_fixed_from_double(delta.x()), wl_fixed_from_double(delta.y()),
+                         wl_fixed_from_double(deltaUnaccelerated.x()),
+                         wl_fixed_from_double(deltaUnaccelerated.y()));
+}
+
+void WaylandRelativePointerV1::zwp_relative_pointer_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource);
+
+    if (m_pointer)
+        WaylandPointerPrivate::get(m_pointer)->relativePointers.removeOne(this);
+
+    delete this;
+}
+
+void WaylandRelativePointerV1::zwp_relative_pointer_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawaylandrelativepointerv1.cpp"
@@ -0,0 +1,34 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <LiriAuroraCompositor/WaylandCompositorExtension>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandRelativePointerManagerV1Private;
+
+class LIRIAURORACOMPOSITOR_EXPORT WaylandRelativePointerManagerV1
+        : public WaylandCompositorExtensionTemplate<WaylandRelativePointerManagerV1>
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(WaylandRelativePointerManagerV1)
+public:
+    WaylandRelativePointerManagerV1();
+    explicit WaylandRelativePointerManagerV1(WaylandCompositor *compositor);
+
+    void initialize() override;
+
+    static const struct wl_interface *interface();
+    static QByteArray interfaceName();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
+#include <LiriAuroraCompositor/private/aurora-server-relative-pointer-unstable-v1.h>
+#include <LiriAuroraCompositor/aurorawaylandrelativepointerv1.h>
+
+#include <QtCore/QPointer>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandPointer;
+
+class LIRIAURORACOMPOSITOR_EXPORT WaylandRelativePointerV1
+        : public PrivateServer::zwp_relative_pointer_v1
+{
+public:
+    WaylandRelativePointerV1(WaylandPointer *pointer, wl_client *client, int id, int version);
+
+    void sendRelativeMotion(quint64 timestamp, const QPointF &delta, const QPointF &deltaUnaccelerated);
+
+protected:
+    void zwp_relative_pointer_v1_destroy_resource(Resource *resource) override;
+    void zwp_relative_pointer_v1_destroy(Resource *resource) override;
+
+private:
+    QPointer<WaylandPointer> m_pointer;
+};
+
+class LIRIAURORACOMPOSITOR_EXPORT WaylandRelativePointerManagerV1Private
+        : public WaylandCompositorExtensionPrivate
+        , public PrivateServer::zwp_relative_pointer_manager_v1
+{
+    Q_DECLARE_PUBLIC(WaylandRelativePointerManagerV1)
+public:
+    WaylandRelativePointerManagerV1Private() = default;
+
+protected:
+    void zwp_relative_pointer_manager_v1_destroy(Resource *resource) override;
+    void zwp_relative_pointer_manager_v1_get_relative_pointer(Resource *resource, uint32_t id,
+                                                              wl_resource *pointerResource) override;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -104,20 +104,12 @@ WaylandViewporterPrivate::Viewport::~Viewport()
     }
 }
 
-// This function has to be called immediately after a surface is committed, before no
-// other client events have been dispatched, or we may incorrectly error out on an
-// incomplete pending state. See comment below.
-void WaylandViewporterPrivate::Viewport::checkCommittedState()
+// This function has to be called when the committed state of a surface is applied,
+// with the destination and source that were committed. We can't use the current
+// state for destination/source when checking, as that has fallbacks to the buffer
+// size so we can't distinguish between the set/unset case.
+void WaylandViewporterPrivate::Viewport::checkCommittedState(const QSize &destination, const QRectF &source)
 {
-    auto *surfacePrivate = WaylandSurfacePrivate::get(m_surface);
-
-    // We can't use the current state for destination/source when checking,
-    // as that has fallbacks to the buffer size so we can't distinguish
-    // between the set/unset case. We use the pending state because no other
-    // requests has modified it yet.
-    QSize destination = surfacePrivate->pending.destinationSize;
-    QRectF source = surfacePrivate->pending.sourceGeometry;
-
     if (!destination.isValid() && source.size() != source.size().toSize()) {
         wl_resource_post_error(resource()->handle, error_bad_size,
                                "non-integer size (%fx%f) with unset destination",
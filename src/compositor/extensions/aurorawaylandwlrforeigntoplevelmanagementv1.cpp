@@ -195,6 +195,33 @@ void WaylandWlrForeignToplevelHandleV1Private::zwlr_foreign_toplevel_handle_v1_u
     emit q->unfullscreenRequested();
 }
 
+void WaylandWlrForeignToplevelHandleV1Private::markChanged(Changes changed)
+{
+    changes |= changed;
+    if (initialized)
+        scheduleDone(compositor);
+}
+
+// Sends what changed since the last time, followed by a single done
+void WaylandWlrForeignToplevelHandleV1Private::sendPendingDone()
+{
+    const auto statesBytes = QByteArray::fromRawData(reinterpret_cast<const char *>(states.data()),
+                                                     states.size() * static_cast<int>(sizeof(state)));
+
+    const auto values = resourceMap().values();
+    for (auto resource : values) {
+        if (changes & TitleChanged)
+            send_title(resource->handle, title);
+        if (changes & AppIdChanged)
+            send_app_id(resource->handle, appId);
+        if (changes & StatesChanged)
+            send_state(resource->handle, statesBytes);
+        send_done(resource->handle);
+    }
+
+    changes = NoChanges;
+}
+
 /*
  * WaylandWlrForeignToplevelHandleV1
  */
@@ -281,14 +308,7 @@ void WaylandWlrForeignToplevelHandleV1::setMaximized(bool maximized)
             d->states.removeAll(WaylandWlrForeignToplevelHandleV1Private::state_maximized);
         emit maximizedChanged();
 
-        auto statesBytes = QByteArray::fromRawData(reinterpret_cast<const char *>(d->states.data()),
-                                                   d->states.size() * static_cast<int>(sizeof(WaylandWlrForeignToplevelHandleV1Private::state)));
-
-        const auto values = d->resourceMap().values();
-        for (auto resource : values) {
-            d->send_state(resource->handle, statesBytes);
-            d->send_done(resource->handle);
-        }
+        d->markChanged(WaylandWlrForeignToplevelHandleV1Private::StatesChanged);
     }
 }
 
@@ -315,14 +335,7 @@ void WaylandWlrForeignToplevelHandleV1::setMinimized(bool minimized)
             d->states.removeAll(WaylandWlrForeignToplevelHandleV1Private::state_minimized);
         emit minimizedChanged();
 
-        auto statesBytes = QByteArray::fromRawData(reinterpret_cast<const char *>(d->states.data()),
-                                                   d->states.size() * static_cast<int>(sizeof(WaylandWlrForeignToplevelHandleV1Private::state)));
-
-        const auto values = d->resourceMap().values();
-        for (auto resource : values) {
-            d->send_state(resource->handle, statesBytes);
-            d->send_done(resource->handle);
-        }
+        d->markChanged(WaylandWlrForeignToplevelHandleV1Private::StatesChanged);
     }
 }
 
@@ -349,14 +362,7 @@ void WaylandWlrForeignToplevelHandleV1::setFullscreen(bool fullscreen)
             d->states.removeAll(WaylandWlrForeignToplevelHandleV1Private::state_fullscreen);
         emit fullscreenChanged();
 
-        auto statesBytes = QByteArray::fromRawData(reinterpret_cast<const char *>(d->states.data()),
-                                                   d->states.size() * static_cast<int>(sizeof(WaylandWlrForeignToplevelHandleV1Private::state)));
-
-        const auto values = d->resourceMap().values();
-        for (auto resource : values) {
-            d->send_state(resource->handle, statesBytes);
-            d->send_done(resource->handle);
-        }
+        d->markChanged(WaylandWlrForeignToplevelHandleV1Private::StatesChanged);
     }
 }
 
@@ -383,14 +389,7 @@ void WaylandWlrForeignToplevelHandleV1::setActivated(bool activated)
             d->states.removeAll(WaylandWlrForeignToplevelHandleV1Private::state_activated);
         emit activatedChanged();
 
-        auto statesBytes = QByteArray::fromRawData(reinterpret_cast<const char *>(d->states.data()),
-                                                   d->states.size() * static_cast<int>(sizeof(WaylandWlrForeignToplevelHandleV1Private::state)));
-
-        const auto values = d->resourceMap().values();
-        for (auto resource : values) {
-            d->send_state(resource->handle, statesBytes);
-            d->send_done(resource->handle);
-        }
+        d->markChanged(WaylandWlrForeignToplevelHandleV1Private::StatesChanged);
     }
 }
 
@@ -410,11 +409,7 @@ void WaylandWlrForeignToplevelHandleV1::setTitle(const QString &title)
     d->title = title;
     emit titleChanged();
 
-    const auto values = d->resourceMap().values();
-    for (auto resource : values) {
-        d->send_title(resource->handle, title);
-        d->send_done(resource->handle);
-    }
+    d->markChanged(WaylandWlrForeignToplevelHandleV1Private::TitleChanged);
 }
 
 QString WaylandWlrForeignToplevelHandleV1::appId() const
@@ -433,11 +428,7 @@ void WaylandWlrForeignToplevelHandleV1::setAppId(const QString &appId)
     d->appId = appId;
     emit appIdChanged();
 
-    const auto values = d->resourceMap().values();
-    for (auto resource : values) {
-        d->send_app_id(resource->handle, appId);
-        d->send_done(resource->handle);
-    }
+    d->markChanged(WaylandWlrForeignToplevelHandleV1Private::AppIdChanged);
 }
 
 WaylandSurface *WaylandWlrForeignToplevelHandleV1::rectangleSurface() const
@@ -495,6 +486,7 @@ void WaylandWlrForeignToplevelHandleV1::setParent(WaylandWlrForeignToplevelHandl
         const auto handleRes = handlePriv->resourceMap().value(resource->client());
         d->send_parent(resource->handle, handleRes->handle);
     }
+    d->markChanged(WaylandWlrForeignToplevelHandleV1Private::NoChanges);
 
     d->parentHandle = parentHandle;
     Q_EMIT parentChanged();
@@ -511,6 +503,7 @@ void WaylandWlrForeignToplevelHandleV1::sendOutputEnter(WaylandOutput *output)
         auto client = WaylandClient::fromWlClient(output->compositor(), resource->client());
         d->send_output_enter(resource->handle, output->resourceForClient(client));
     }
+    d->markChanged(WaylandWlrForeignToplevelHandleV1Private::NoChanges);
 }
 
 void WaylandWlrForeignToplevelHandleV1::sendOutputLeave(WaylandOutput *output)
@@ -524,12 +517,19 @@ void WaylandWlrForeignToplevelHandleV1::sendOutputLeave(WaylandOutput *output)
         auto client = WaylandClient::fromWlClient(output->compositor(), resource->client());
         d->send_output_leave(resource->handle, output->resourceForClient(client));
     }
+    d->markChanged(WaylandWlrForeignToplevelHandleV1Private::NoChanges);
 }
 
 void WaylandWlrForeignToplevelHandleV1::sendClosed()
 {
     Q_D(WaylandWlrForeignToplevelHandleV1);
 
+    // Nothing can be sent after closed
+    if (d->isDoneScheduled()) {
+        d->cancelDone();
+        d->sendPendingDone();
+    }
+
     const auto values = d->resourceMap().values();
     for (auto resource : values)
         d->send_closed(resource->handle);
@@ -592,6 +592,10 @@ void WaylandWlrForeignToplevelHandleV1::initialize()
         }
     }
 
+    // Everything was just sent
+    d->cancelDone();
+    d->changes = WaylandWlrForeignToplevelHandleV1Private::NoChanges;
+
     managerPrivate->toplevels.append(this);
     emit d->manager->handleAdded(this);
 }
@@ -10,6 +10,7 @@
 #include <LiriAuroraCompositor/WaylandSeat>
 #include <LiriAuroraCompositor/WaylandSurface>
 #include <LiriAuroraCompositor/WaylandWlrForeignToplevelManagerV1>
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
 #include <LiriAuroraCompositor/private/aurora-server-wlr-foreign-toplevel-management-unstable-v1.h>
 
@@ -50,11 +51,23 @@ protected:
 class LIRIAURORACOMPOSITOR_EXPORT WaylandWlrForeignToplevelHandleV1Private
         : public QObjectPrivate
         , public PrivateServer::zwlr_foreign_toplevel_handle_v1
+        , public Internal::PendingDone
 {
     Q_DECLARE_PUBLIC(WaylandWlrForeignToplevelHandleV1)
 public:
+    enum Change {
+        NoChanges = 0,
+        StatesChanged = 0x1,
+        TitleChanged = 0x2,
+        AppIdChanged = 0x4
+    };
+    Q_DECLARE_FLAGS(Changes, Change)
+
     WaylandWlrForeignToplevelHandleV1Private();
 
+    void markChanged(Changes changed);
+    void sendPendingDone() override;
+
     static WaylandWlrForeignToplevelHandleV1Private *get(WaylandWlrForeignToplevelHandleV1 *self) { return self->d_func(); }
 
     bool initialized = false;
@@ -67,6 +80,7 @@ public:
     WaylandSurface *rectSurface = nullptr;
     QRect rect;
     WaylandWlrForeignToplevelHandleV1 *parentHandle = nullptr;
+    Changes changes = NoChanges;
 
 protected:
     void zwlr_foreign_toplevel_handle_v1_set_maximized(Resource *resource) override;
@@ -40,6 +40,18 @@ void WaylandWlrOutputManagerV1Private::registerHead(WaylandWlrOutputHeadV1 *head
     Q_EMIT q->headAdded(head);
 }
 
+// Changes to any head are completed by a single done
+void WaylandWlrOutputManagerV1Private::sendPendingDone()
+{
+    if (!compositor)
+        return;
+
+    const quint32 serial = compositor->nextSerial();
+    const auto values = resourceMap().values();
+    for (auto *resource : values)
+        send_done(resource->handle, serial);
+}
+
 void WaylandWlrOutputManagerV1Private::zwlr_output_manager_v1_bind_resource(Resource *resource)
 {
     if (!compositor)
@@ -158,6 +170,8 @@ void WaylandWlrOutputManagerV1::done(quint32 serial)
 {
     Q_D(WaylandWlrOutputManagerV1);
 
+    d->cancelDone();
+
     const auto values = d->resourceMap().values();
     for (auto *resource : values)
         d->send_done(resource->handle, serial);
@@ -234,6 +248,13 @@ void WaylandWlrOutputHeadV1Private::sendInfo(Resource *resource)
     }
 }
 
+void WaylandWlrOutputHeadV1Private::scheduleDone()
+{
+    auto *managerPrivate = WaylandWlrOutputManagerV1Private::get(manager);
+    if (managerPrivate->compositor)
+        managerPrivate->scheduleDone(managerPrivate->compositor);
+}
+
 WaylandWlrOutputHeadV1 *WaylandWlrOutputHeadV1Private::fromResource(wl_resource *resource)
 {
     return static_cast<WaylandWlrOutputHeadV1Private *>(WaylandWlrOutputHeadV1Private::Resource::fromResource(resource)->zwlr_output_head_v1_object)->q_func();
@@ -309,7 +330,7 @@ void WaylandWlrOutputHeadV1::setEnabled(bool enabled)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_enabled(resource->handle, enabled ? 1 : 0);
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT enabledChanged();
@@ -384,7 +405,7 @@ void WaylandWlrOutputHeadV1::setPhysicalSize(const QSize &physicalSize)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_physical_size(resource->handle, physicalSize.width(), physicalSize.height());
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT physicalSizeChanged();
@@ -414,7 +435,7 @@ void WaylandWlrOutputHeadV1::setPosition(const QPoint &position)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_position(resource->handle, position.x(), position.y());
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT positionChanged();
@@ -465,7 +486,7 @@ void WaylandWlrOutputHeadV1::setCurrentMode(WaylandWlrOutputModeV1 *mode)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_current_mode(resource->handle, WaylandWlrOutputModeV1Private::get(mode)->resource()->handle);
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT currentModeChanged();
@@ -525,7 +546,7 @@ void WaylandWlrOutputHeadV1::setTransform(WaylandOutput::Transform transform)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_transform(resource->handle, static_cast<int32_t>(transform));
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT transformChanged();
@@ -555,7 +576,7 @@ void WaylandWlrOutputHeadV1::setScale(qreal scale)
         const auto values = d->resourceMap().values();
         for (auto *resource : values)
             d->send_scale(resource->handle, wl_fixed_from_double(scale));
-        manager()->done(manager()->compositor()->nextSerial());
+        d->scheduleDone();
     }
 
     Q_EMIT scaleChanged();
@@ -9,6 +9,7 @@
 #include <QSize>
 
 #include <LiriAuroraCompositor/WaylandWlrOutputManagerV1>
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
 #include <LiriAuroraCompositor/private/aurora-server-wlr-output-management-unstable-v1.h>
 
@@ -32,6 +33,7 @@ Q_DECLARE_LOGGING_CATEGORY(gLcWaylandWlrOutputManagementV1)
 class LIRIAURORACOMPOSITOR_EXPORT WaylandWlrOutputManagerV1Private
         : public WaylandCompositorExtensionPrivate
         , public PrivateServer::zwlr_output_manager_v1
+        , public Internal::PendingDone
 {
     Q_DECLARE_PUBLIC(WaylandWlrOutputManagerV1)
 public:
@@ -39,6 +41,7 @@ public:
     ~WaylandWlrOutputManagerV1Private();
 
     void registerHead(WaylandWlrOutputHeadV1 *head);
+    void sendPendingDone() override;
 
     static WaylandWlrOutputManagerV1Private *get(WaylandWlrOutputManagerV1 *manager) { return manager->d_func(); }
 
@@ -63,6 +66,7 @@ public:
     ~WaylandWlrOutputHeadV1Private();
 
     void sendInfo(Resource *resource);
+    void scheduleDone();
 
     static WaylandWlrOutputHeadV1 *fromResource(wl_resource *resource);
 
@@ -0,0 +1,578 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLExtraFunctions>
+#include <QtOpenGL/QOpenGLTexture>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/QSGRendererInterface>
+#include <QtQuick/private/qquickitem_p.h>
+#include <QtQuick/private/qquickwindow_p.h>
+
+#include "aurorawaylandbufferref_p.h"
+#include "aurorawaylandwlrscreencopyreadback_p.h"
+#include "aurorawaylandwlrscreencopyv1_p.h"
+#include "wayland_wrapper/aurorawlclientbuffer_p.h"
+
+#include <wayland-server-core.h>
+
+#include <time.h>
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+#ifndef GL_READ_FRAMEBUFFER
+#define GL_READ_FRAMEBUFFER 0x8CA8
+#endif
+#ifndef GL_DRAW_FRAMEBUFFER
+#define GL_DRAW_FRAMEBUFFER 0x8CA9
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+#ifndef GL_WAIT_FAILED
+#define GL_WAIT_FAILED 0x911D
+#endif
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+// Pixel buffer objects, fences and blits
+static bool hasAsyncReadback(const QSurfaceFormat &format)
+{
+    if (format.renderableType() == QSurfaceFormat::OpenGLES)
+        return format.version() >= qMakePair(3, 0);
+    return format.version() >= qMakePair(3, 2);
+}
+
+// Rows read from OpenGL are bottom to top
+static void copyRowsFlipped(const uchar *src, uchar *dst, qsizetype bytesPerLine, int height)
+{
+    for (int y = 0; y < height; ++y)
+        memcpy(dst + y * bytesPerLine, src + (height - y - 1) * bytesPerLine, bytesPerLine);
+}
+
+static bool isInEffect(QQuickItem *item)
+{
+    for (; item; item = item->parentItem()) {
+        QQuickItemPrivate *d = QQuickItemPrivate::get(item);
+        if (!d->extra.isAllocated())
+            continue;
+        // Rendered again by a ShaderEffectSource or a layer without being dirty
+        if (d->extra->effectRefCount > 0)
+            return true;
+#if QT_CONFIG(quick_shadereffect)
+        if (d->extra->layer && d->extra->layer->enabled())
+            return true;
+#endif
+    }
+    return false;
+}
+
+ScreencopyReadback::ScreencopyReadback(QQuickWindow *window)
+    : QObject(window)
+    , m_window(window)
+{
+    connect(window, &QQuickWindow::beforeSynchronizing,
+            this, &ScreencopyReadback::handleBeforeSynchronizing, Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering,
+            this, &ScreencopyReadback::handleAfterRendering, Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped,
+            this, &ScreencopyReadback::handleFrameSwapped, Qt::DirectConnection);
+    connect(window, &QQuickWindow::sceneGraphInvalidated,
+            this, &ScreencopyReadback::handleSceneGraphInvalidated, Qt::DirectConnection);
+}
+
+ScreencopyReadback::~ScreencopyReadback()
+{
+    for (TrackedResource *tracked : std::as_const(m_resources)) {
+        wl_list_remove(&tracked->listener.link);
+        delete tracked;
+    }
+
+    // The scene graph is gone, OpenGL resources went away with it
+    qDeleteAll(m_queued);
+    qDeleteAll(m_recording);
+    qDeleteAll(m_inflight);
+    qDeleteAll(m_completed);
+}
+
+ScreencopyReadback *ScreencopyReadback::get(QQuickWindow *window)
+{
+    auto *readback = window->findChild<ScreencopyReadback *>(QString(), Qt::FindDirectChildrenOnly);
+    if (!readback)
+        readback = new ScreencopyReadback(window);
+    return readback;
+}
+
+bool ScreencopyReadback::canReadback(QQuickWindow *window)
+{
+    return window && window->isSceneGraphInitialized()
+            && window->rendererInterface()->graphicsApi() == QSGRendererInterface::OpenGL;
+}
+
+bool ScreencopyReadback::canBlit(QQuickWindow *window)
+{
+    return canReadback(window) && hasAsyncReadback(window->format());
+}
+
+void ScreencopyReadback::queue(WaylandWlrScreencopyFrameV1 *frame, const WaylandBufferRef &buffer)
+{
+    auto *d = WaylandWlrScreencopyFrameV1Private::get(frame);
+    if (buffer.isDestroyed()) {
+        d->send_failed();
+        return;
+    }
+
+    Job *job = new Job;
+    job->frame = frame;
+    job->buffer = buffer;
+    job->manager = d->managerResource;
+    job->withDamage = d->withDamage;
+    job->rect = d->pixelRect;
+    if (!buffer.isSharedMemory())
+        job->dmabuf = WaylandBufferRefPrivate::buffer(buffer);
+
+    TrackedResource *client = track(job->manager);
+    track(buffer.wl_buffer());
+    m_queued.append(job);
+
+    // Damage that happened before the request is copied from the next frame
+    if (!job->withDamage || !damageSince(client->sequence, job->rect).isEmpty())
+        m_window->update();
+}
+
+ScreencopyReadback::TrackedResource *ScreencopyReadback::track(struct ::wl_resource *resource)
+{
+    TrackedResource *tracked = m_resources.value(resource);
+    if (!tracked) {
+        tracked = new TrackedResource;
+        tracked->readback = this;
+        tracked->resource = resource;
+        tracked->listener.notify = resourceDestroyed;
+        wl_resource_add_destroy_listener(resource, &tracked->listener);
+        m_resources.insert(resource, tracked);
+    }
+    return tracked;
+}
+
+void ScreencopyReadback::resourceDestroyed(wl_listener *listener, void *data)
+{
+    Q_UNUSED(data);
+
+    TrackedResource *tracked = wl_container_of(listener, tracked, listener);
+    wl_list_remove(&tracked->listener.link);
+    tracked->readback->m_resources.remove(tracked->resource);
+    delete tracked;
+}
+
+QRect ScreencopyReadback::damageSince(quint64 sequence, const QRect &rect) const
+{
+    if (sequence == 0 || m_sequence - sequence >= DamageHistorySize)
+        return rect;
+
+    QRect damage;
+    for (quint64 i = sequence + 1; i <= m_sequence; ++i)
+        damage |= m_damage[i % DamageHistorySize];
+    return damage & rect;
+}
+
+bool ScreencopyReadback::subtreeRect(QQuickItem *item, QRectF *rect, int *budget)
+{
+    if (--(*budget) < 0)
+        return false;
+
+    // Where descendants were is not known anymore
+    m_itemRects.remove(item);
+
+    if (!item->isVisible() || qFuzzyIsNull(item->opacity()))
+        return true;
+
+    if (item->flags().testFlag(QQuickItem::ItemHasContents))
+        *rect |= item->mapRectToScene(item->boundingRect());
+
+    const auto children = item->childItems();
+    for (QQuickItem *child : children) {
+        if (!subtreeRect(child, rect, budget))
+            return false;
+    }
+
+    return true;
+}
+
+bool ScreencopyReadback::addItemDamage(QQuickItem *item, QRectF *damage)
+{
+    QQuickItemPrivate *d = QQuickItemPrivate::get(item);
+
+    // After these the subtree may not be drawn where it was anymore
+    const quint32 geometryChanges = QQuickItemPrivate::Position | QQuickItemPrivate::Size
+            | QQuickItemPrivate::Visible | QQuickItemPrivate::OpacityValue;
+    const quint32 supportedChanges = geometryChanges | QQuickItemPrivate::Content;
+    if ((d->dirtyAttributes & ~supportedChanges) || isInEffect(item))
+        return false;
+
+    QRectF rect;
+    int budget = MaxSubtreeItems;
+    const CachedRect previous = m_itemRects.value(item);
+    if (!subtreeRect(item, &rect, &budget))
+        return false;
+
+    // Items that moved or were hidden damage where they were as well
+    if (d->dirtyAttributes & geometryChanges) {
+        if (previous.item != item)
+            return false;
+        *damage |= previous.rect;
+    }
+
+    *damage |= rect;
+    m_itemRects.insert(item, { item, rect });
+    return true;
+}
+
+QRect ScreencopyReadback::frameDamage()
+{
+    const QRect windowRect(QPoint(0, 0), m_pixelSize);
+    QQuickWindowPrivate *wd = QQuickWindowPrivate::get(m_window);
+
+    QRectF damage;
+    bool fullDamage = m_pixelSize != m_lastPixelSize || !wd->dirtyItemList;
+    for (QQuickItem *item = wd->dirtyItemList; item && !fullDamage;
+         item = QQuickItemPrivate::get(item)->nextDirtyItem)
+        fullDamage = !addItemDamage(item, &damage);
+
+    m_lastPixelSize = m_pixelSize;
+    if (fullDamage) {
+        m_itemRects.clear();
+        return windowRect;
+    }
+
+    const qreal dpr = m_window->effectiveDevicePixelRatio();
+    const QRectF scaled(damage.topLeft() * dpr, damage.size() * dpr);
+    return scaled.toAlignedRect() & windowRect;
+}
+
+void ScreencopyReadback::handleBeforeSynchronizing()
+{
+    // The GUI thread is blocked
+    const qreal dpr = m_window->effectiveDevicePixelRatio();
+    m_pixelSize = QSize(qRound(m_window->width() * dpr), qRound(m_window->height() * dpr));
+
+    ++m_sequence;
+    m_damage[m_sequence % DamageHistorySize] = frameDamage();
+
+    if (m_itemRects.size() > MaxSubtreeItems * 4) {
+        for (auto it = m_itemRects.begin(); it != m_itemRects.end();) {
+            if (it->item.isNull())
+                it = m_itemRects.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    const QRect windowRect(QPoint(0, 0), m_pixelSize);
+    for (auto it = m_queued.begin(); it != m_queued.end();) {
+        Job *job = *it;
+
+        if (job->frame.isNull() || job->buffer.isDestroyed()) {
+            job->failed = true;
+            complete(job);
+            it = m_queued.erase(it);
+            continue;
+        }
+
+        TrackedResource *client = m_resources.value(job->manager);
+        TrackedResource *target = m_resources.value(job->buffer.wl_buffer());
+        const QRect clientDamage = damageSince(client ? client->sequence : 0, job->rect);
+        if (job->withDamage && clientDamage.isEmpty()) {
+            ++it;
+            continue;
+        }
+
+        job->damage = clientDamage.translated(-job->rect.topLeft());
+        job->readRect = job->withDamage
+                ? damageSince(target ? target->sequence : 0, job->rect)
+                : job->rect;
+        job->readRect &= windowRect;
+        if (client)
+            client->sequence = m_sequence;
+        if (target)
+            target->sequence = m_sequence;
+
+        m_recording.append(job);
+        it = m_queued.erase(it);
+    }
+}
+
+void ScreencopyReadback::handleAfterRendering()
+{
+    if (m_recording.isEmpty() && m_inflight.isEmpty())
+        return;
+
+    m_window->beginExternalCommands();
+
+    m_async = hasAsyncReadback(QOpenGLContext::currentContext()->format());
+    collectAll();
+    for (Job *job : std::as_const(m_recording))
+        record(job);
+
+    m_window->endExternalCommands();
+}
+
+void ScreencopyReadback::handleFrameSwapped()
+{
+    if (m_recording.isEmpty() && m_inflight.isEmpty())
+        return;
+
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    for (Job *job : std::as_const(m_recording)) {
+        job->tv_sec = ts.tv_sec;
+        job->tv_nsec = ts.tv_nsec;
+    }
+    m_inflight.append(m_recording);
+    m_recording.clear();
+
+    if (QOpenGLContext::currentContext())
+        collectAll();
+
+    // Fences are checked again when the next frame is rendered
+    if (!m_inflight.isEmpty())
+        QMetaObject::invokeMethod(m_window, &QQuickWindow::update, Qt::QueuedConnection);
+}
+
+void ScreencopyReadback::handleSceneGraphInvalidated()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLExtraFunctions *gl = context ? context->extraFunctions() : nullptr;
+
+    m_inflight.append(m_recording);
+    m_recording.clear();
+    for (Job *job : std::as_const(m_inflight)) {
+        if (gl && job->fence)
+            gl->glDeleteSync(job->fence);
+        if (gl && job->pbo.id)
+            gl->glDeleteBuffers(1, &job->pbo.id);
+        job->fence = nullptr;
+        job->pbo = {};
+        job->failed = true;
+        complete(job);
+    }
+    m_inflight.clear();
+
+    if (gl) {
+        for (const Pbo &pbo : std::as_const(m_pbos))
+            gl->glDeleteBuffers(1, &pbo.id);
+        if (m_fbo)
+            gl->glDeleteFramebuffers(1, &m_fbo);
+    }
+    m_pbos.clear();
+    m_fbo = 0;
+}
+
+void ScreencopyReadback::record(Job *job)
+{
+    const QRect &r = job->readRect;
+    if (r.isEmpty())
+        return;
+
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    QOpenGLExtraFunctions *gl = context->extraFunctions();
+    const GLuint defaultFbo = context->defaultFramebufferObject();
+    const int y = m_pixelSize.height() - r.y() - r.height();
+    const qsizetype bytesPerLine = qsizetype(r.width()) * 4;
+    const qsizetype size = bytesPerLine * r.height();
+
+    if (job->dmabuf) {
+        // External textures can't be attached to a framebuffer
+        QOpenGLTexture *texture = m_async ? job->dmabuf->toOpenGlTexture(0) : nullptr;
+        if (!texture || texture->target() != QOpenGLTexture::Target2D) {
+            job->failed = true;
+            return;
+        }
+
+        if (!m_fbo)
+            gl->glGenFramebuffers(1, &m_fbo);
+
+        // Flip while blitting, so that the buffer is top to bottom
+        const QPoint target = r.topLeft() - job->rect.topLeft();
+        gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, defaultFbo);
+        gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, m_fbo);
+        gl->glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                                   texture->textureId(), 0);
+        const bool renderable = gl->glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (renderable) {
+            gl->glBlitFramebuffer(r.x(), y, r.x() + r.width(), y + r.height(),
+                                  target.x(), target.y() + r.height(), target.x() + r.width(), target.y(),
+                                  GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        gl->glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, defaultFbo);
+
+        // Formats that can't be rendered to
+        if (!renderable) {
+            job->failed = true;
+            return;
+        }
+    } else if (m_async) {
+        for (int i = 0; i < m_pbos.size(); ++i) {
+            if (m_pbos.at(i).size >= size) {
+                job->pbo = m_pbos.takeAt(i);
+                break;
+            }
+        }
+        if (!job->pbo.id) {
+            gl->glGenBuffers(1, &job->pbo.id);
+            job->pbo.size = size;
+            gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, job->pbo.id);
+            gl->glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        } else {
+            gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, job->pbo.id);
+        }
+
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, defaultFbo);
+        gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        gl->glReadPixels(r.x(), y, r.width(), r.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    } else {
+        // Without pixel buffer objects the read blocks until the frame is rendered
+        QByteArray rows(size, Qt::Uninitialized);
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, defaultFbo);
+        gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        gl->glReadPixels(r.x(), y, r.width(), r.height(), GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+
+        job->pixels.resize(size);
+        copyRowsFlipped(reinterpret_cast<const uchar *>(rows.constData()),
+                        reinterpret_cast<uchar *>(job->pixels.data()), bytesPerLine, r.height());
+        return;
+    }
+
+    job->fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void ScreencopyReadback::collectAll()
+{
+    for (auto it = m_inflight.begin(); it != m_inflight.end();) {
+        if (collect(*it)) {
+            complete(*it);
+            it = m_inflight.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ScreencopyReadback::collect(Job *job)
+{
+    if (!job->fence)
+        return true;
+
+    QOpenGLExtraFunctions *gl = QOpenGLContext::currentContext()->extraFunctions();
+    const GLenum status = gl->glClientWaitSync(job->fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    gl->glDeleteSync(job->fence);
+    job->fence = nullptr;
+    if (status == GL_WAIT_FAILED)
+        job->failed = true;
+
+    if (job->pbo.id) {
+        const QRect &r = job->readRect;
+        const qsizetype bytesPerLine = qsizetype(r.width()) * 4;
+        const qsizetype size = bytesPerLine * r.height();
+
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, job->pbo.id);
+        const void *data = job->failed ? nullptr
+                                       : gl->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+        if (data) {
+            job->pixels.resize(size);
+            copyRowsFlipped(static_cast<const uchar *>(data),
+                            reinterpret_cast<uchar *>(job->pixels.data()), bytesPerLine, r.height());
+            gl->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        } else {
+            job->failed = true;
+        }
+        gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        m_pbos.append(job->pbo);
+        job->pbo = {};
+    }
+
+    return true;
+}
+
+void ScreencopyReadback::complete(Job *job)
+{
+    // Protocol objects and buffer references belong to the GUI thread
+    QMutexLocker locker(&m_completedMutex);
+    m_completed.append(job);
+    if (m_completed.size() == 1)
+        QMetaObject::invokeMethod(this, &ScreencopyReadback::finishCompleted, Qt::QueuedConnection);
+}
+
+void ScreencopyReadback::finishCompleted()
+{
+    QList<Job *> jobs;
+    {
+        QMutexLocker locker(&m_completedMutex);
+        jobs.swap(m_completed);
+    }
+
+    for (Job *job : std::as_const(jobs))
+        finish(job);
+}
+
+void ScreencopyReadback::finish(Job *job)
+{
+    auto *d = WaylandWlrScreencopyFrameV1Private::get(job->frame.data());
+    if (!d || !d->resource()) {
+        delete job;
+        return;
+    }
+
+    bool failed = job->failed || job->buffer.isDestroyed();
+
+    const QRect &r = job->readRect;
+    if (!failed && !job->dmabuf && !r.isEmpty()) {
+        auto *shmBuffer = wl_shm_buffer_get(job->buffer.wl_buffer());
+        if (shmBuffer && job->pixels.size() == qsizetype(r.width()) * r.height() * 4) {
+            const qsizetype bytesPerLine = qsizetype(r.width()) * 4;
+            const qsizetype stride = wl_shm_buffer_get_stride(shmBuffer);
+            const QPoint offset = r.topLeft() - job->rect.topLeft();
+
+            wl_shm_buffer_begin_access(shmBuffer);
+            uchar *data = static_cast<uchar *>(wl_shm_buffer_get_data(shmBuffer))
+                    + offset.y() * stride + offset.x() * 4;
+            for (int y = 0; y < r.height(); ++y)
+                memcpy(data + y * stride, job->pixels.constData() + y * bytesPerLine, bytesPerLine);
+            wl_shm_buffer_end_access(shmBuffer);
+        } else {
+            failed = true;
+        }
+    }
+
+    if (failed)
+        d->send_failed();
+    else
+        d->sendReady(job->damage, job->tv_sec, job->tv_nsec);
+
+    delete job;
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -0,0 +1,160 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QRect>
+#include <QtGui/qopengl.h>
+
+#include <LiriAuroraCompositor/WaylandBufferRef>
+
+#include <wayland-server-core.h>
+
+class QQuickItem;
+class QQuickWindow;
+
+namespace Aurora {
+
+namespace Compositor {
+
+class WaylandWlrScreencopyFrameV1;
+class tst_ScreencopyReadback;
+
+namespace Internal {
+
+class ClientBuffer;
+
+/*
+    Reads back screencopy frames from what the scene graph renders for a window,
+    with an asynchronous readback into pixel buffer objects for shm targets and
+    a blit for dmabuf targets. Frames copied with damage only read the area that
+    changed since the target buffer was last filled.
+
+    Damage is taken from the items that are dirty when the scene graph is
+    synchronized. Anything that can't be accounted for damages the whole window.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT ScreencopyReadback : public QObject
+{
+    Q_OBJECT
+public:
+    // Frames of damage that are remembered, older buffers are filled entirely
+    static const int DamageHistorySize = 16;
+    // Dirty items with more descendants than this damage the whole window
+    static const int MaxSubtreeItems = 64;
+
+    explicit ScreencopyReadback(QQuickWindow *window);
+    ~ScreencopyReadback();
+
+    static ScreencopyReadback *get(QQuickWindow *window);
+    static bool canReadback(QQuickWindow *window);
+    static bool canBlit(QQuickWindow *window);
+
+    void queue(WaylandWlrScreencopyFrameV1 *frame, const WaylandBufferRef &buffer);
+
+private:
+    friend class Compositor::tst_ScreencopyReadback;
+
+    struct Pbo {
+        GLuint id = 0;
+        qsizetype size = 0;
+    };
+
+    struct Job {
+        QPointer<WaylandWlrScreencopyFrameV1> frame;
+        WaylandBufferRef buffer;
+        ClientBuffer *dmabuf = nullptr;
+        struct ::wl_resource *manager = nullptr;
+        bool withDamage = false;
+        bool failed = false;
+        // Window pixels
+        QRect rect;
+        QRect readRect;
+        // Buffer coordinates
+        QRect damage;
+        QByteArray pixels;
+        Pbo pbo;
+        GLsync fence = nullptr;
+        quint64 tv_sec = 0;
+        quint32 tv_nsec = 0;
+    };
+
+    struct TrackedResource {
+        wl_listener listener;
+        ScreencopyReadback *readback = nullptr;
+        struct ::wl_resource *resource = nullptr;
+        quint64 sequence = 0;
+    };
+
+    struct CachedRect {
+        QPointer<QQuickItem> item;
+        QRectF rect;
+    };
+
+    void handleBeforeSynchronizing();
+    void handleAfterRendering();
+    void handleFrameSwapped();
+    void handleSceneGraphInvalidated();
+
+    QRect frameDamage();
+    bool addItemDamage(QQuickItem *item, QRectF *damage);
+    bool subtreeRect(QQuickItem *item, QRectF *rect, int *budget);
+    QRect damageSince(quint64 sequence, const QRect &rect) const;
+
+    void record(Job *job);
+    void collectAll();
+    bool collect(Job *job);
+    void complete(Job *job);
+    void finishCompleted();
+    void finish(Job *job);
+
+    TrackedResource *track(struct ::wl_resource *resource);
+    static void resourceDestroyed(wl_listener *listener, void *data);
+
+    QQuickWindow *m_window = nullptr;
+    QSize m_pixelSize;
+    QSize m_lastPixelSize;
+
+    // Damage of the last frames in window pixels, indexed by sequence
+    QRect m_damage[DamageHistorySize];
+    quint64 m_sequence = 0;
+    QHash<QQuickItem *, CachedRect> m_itemRects;
+
+    // Sequence of the last frame copied per manager and per buffer
+    QHash<struct ::wl_resource *, TrackedResource *> m_resources;
+
+    // Owned by the GUI thread, handed over while synchronizing
+    QList<Job *> m_queued;
+    // Owned by the render thread
+    QList<Job *> m_recording;
+    QList<Job *> m_inflight;
+    QList<Pbo> m_pbos;
+    GLuint m_fbo = 0;
+    bool m_async = false;
+
+    // Handed back to the GUI thread, deleted with the readback if
+    // it goes away before they are finished
+    QMutex m_completedMutex;
+    QList<Job *> m_completed;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
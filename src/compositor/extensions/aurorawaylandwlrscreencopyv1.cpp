@@ -2,18 +2,30 @@
 //
 // SPDX-License-Identifier: GPL-3.0-or-later
 
-#include <QDateTime>
 #include <QPainter>
 #include <QQuickItem>
 #include <QQuickItemGrabResult>
 #include <QQuickWindow>
 
+#include "aurorawaylandbufferref_p.h"
 #include "aurorawaylandcompositor.h"
+#include "aurorawaylandcompositor_p.h"
 #include "aurorawaylandoutput.h"
 #include "aurorawaylandwlrscreencopyv1_p.h"
+#include "hardware_integration/aurorawlclientbufferintegration_p.h"
+#include "wayland_wrapper/aurorawlbuffermanager_p.h"
+#include "wayland_wrapper/aurorawlclientbuffer_p.h"
+#if QT_CONFIG(opengl)
+#include "aurorawaylandwlrscreencopyreadback_p.h"
+#endif
 
 #include <GL/gl.h>
 
+#include <time.h>
+
+// DRM_FORMAT_XRGB8888 from drm_fourcc.h
+static const uint32_t DrmFormatXrgb8888 = 0x34325258;
+
 static inline QImage::Format fromWaylandShmFormat(wl_shm_format format)
 {
     switch (format) {
@@ -39,30 +51,6 @@ namespace Aurora {
 
 namespace Compositor {
 
-/*
- * WaylandWlrScreencopyFrameEventFilter
- */
-
-WaylandWlrScreencopyFrameEventFilter::WaylandWlrScreencopyFrameEventFilter(QObject *parent)
-    : QObject(parent)
-{
-}
-
-bool WaylandWlrScreencopyFrameEventFilter::eventFilter(QObject *watched, QEvent *event)
-{
-    if (event->type() == QEvent::Expose) {
-        auto *exposeEvent = static_cast<QExposeEvent *>(event);
-        if (!exposeEvent->region().isEmpty()) {
-            frame->output->window()->removeEventFilter(this);
-            frame->damageRect = exposeEvent->region().boundingRect();
-            frame->copy(resource, buffer_res);
-            return true;
-        }
-    }
-
-    return QObject::eventFilter(watched, event);
-}
-
 /*
  * WaylandWlrScreencopyManagerV1Private
  */
@@ -90,8 +78,8 @@ void WaylandWlrScreencopyManagerV1Private::zwlr_screencopy_manager_v1_capture_ou
     auto *screencopyFramePriv = WaylandWlrScreencopyFrameV1Private::get(screencopyFrame);
     screencopyFramePriv->overlayCursor = overlay_cursor == 1;
     screencopyFramePriv->output = output;
+    screencopyFramePriv->managerResource = resource->handle;
     screencopyFramePriv->rect = QRect(QPoint(0, 0), output->geometry().size());
-    screencopyFramePriv->stride = 4 * output->geometry().width();
     screencopyFramePriv->init(resource->client(), frame, resource->version());
 
     emit q->captureOutputRequested(screencopyFrame);
@@ -123,8 +111,8 @@ void WaylandWlrScreencopyManagerV1Private::zwlr_screencopy_manager_v1_capture_ou
     auto *screencopyFramePriv = WaylandWlrScreencopyFrameV1Private::get(screencopyFrame);
     screencopyFramePriv->overlayCursor = overlay_cursor == 1;
     screencopyFramePriv->output = output;
+    screencopyFramePriv->managerResource = resource->handle;
     screencopyFramePriv->rect = QRect(x, y, width, height);
-    screencopyFramePriv->stride = 4 * width;
     screencopyFramePriv->init(resource->client(), frame, resource->version());
 
     emit q->captureOutputRequested(screencopyFrame);
@@ -189,24 +177,43 @@ WaylandWlrScreencopyFrameV1Private::WaylandWlrScreencopyFrameV1Private()
 
 WaylandWlrScreencopyFrameV1Private::~WaylandWlrScreencopyFrameV1Private()
 {
-    if (filterObject)
-        filterObject->deleteLater();
 }
 
 void WaylandWlrScreencopyFrameV1Private::setup()
 {
-    send_buffer(requestedBufferFormat, rect.width(), rect.height(), stride);
+    // Buffers have the size of the area in pixels
+    QWindow *window = output->window();
+    const qreal dpr = window ? window->devicePixelRatio() : 1.0;
+    pixelRect = QRect(rect.topLeft() * dpr, (QSizeF(rect.size()) * dpr).toSize());
+    stride = 4 * pixelRect.width();
+
+#if QT_CONFIG(opengl)
+    if (Internal::ScreencopyReadback::canBlit(qobject_cast<QQuickWindow *>(window))) {
+        const auto integrations = WaylandCompositorPrivate::get(output->compositor())->clientBufferIntegrations();
+        for (auto *integration : integrations)
+            dmabufSupported = dmabufSupported || integration->supportsDmabufTargets();
+    }
+#endif
 
-    QDateTime dateTime(QDateTime::currentDateTimeUtc());
-    qint64 secs = dateTime.toSecsSinceEpoch();
-    tv_sec_hi = secs >> 32;
-    tv_sec_lo = secs & 0xffffffff;
+    send_buffer(requestedBufferFormat, pixelRect.width(), pixelRect.height(), stride);
+
+    if (resource()->version() >= 3) {
+        if (dmabufSupported)
+            send_linux_dmabuf(DrmFormatXrgb8888, pixelRect.width(), pixelRect.height());
+        send_buffer_done();
+    }
 }
 
 void WaylandWlrScreencopyFrameV1Private::copy(Resource *resource, wl_resource *buffer_res)
 {
     Q_Q(WaylandWlrScreencopyFrameV1);
 
+    if (ready || buffer.hasBuffer()) {
+        wl_resource_post_error(resource->handle, error_already_used,
+                               "frame already used");
+        return;
+    }
+
     QVariant enabledValue = output->property("enabled");
     if (enabledValue.isValid()) {
         const bool isEnabled = enabledValue.toBool();
@@ -217,35 +224,61 @@ void WaylandWlrScreencopyFrameV1Private::copy(Resource *resource, wl_resource *b
         }
     }
 
-    auto *shmBuffer = wl_shm_buffer_get(buffer_res);
-    if (!shmBuffer) {
-        qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Unsupported buffer type, only shm buffers are supported");
+    if (auto *shmBuffer = wl_shm_buffer_get(buffer_res)) {
+        uint32_t bufferFormat = wl_shm_buffer_get_format(shmBuffer);
+        int32_t bufferWidth = wl_shm_buffer_get_width(shmBuffer);
+        int32_t bufferHeight = wl_shm_buffer_get_height(shmBuffer);
+        int32_t bufferStride = wl_shm_buffer_get_stride(shmBuffer);
+
+        if (bufferFormat != requestedBufferFormat || bufferWidth != pixelRect.width() ||
+                bufferHeight != pixelRect.height() || bufferStride != int32_t(stride)) {
+            qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Invalid buffer attributes");
+            wl_resource_post_error(resource->handle, error_invalid_buffer,
+                                   "invalid buffer attributes");
+            return;
+        }
+    }
+
+    auto *bufferManager = WaylandCompositorPrivate::get(output->compositor())->bufferManager();
+    Internal::ClientBuffer *clientBuffer = bufferManager->getBuffer(buffer_res);
+    if (!clientBuffer) {
+        qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Unsupported buffer type");
         wl_resource_post_error(resource->handle, error_invalid_buffer,
                                "unsupported buffer type");
         return;
     }
 
-    uint32_t bufferFormat = wl_shm_buffer_get_format(shmBuffer);
-    int32_t bufferWidth = wl_shm_buffer_get_width(shmBuffer);
-    int32_t bufferHeight = wl_shm_buffer_get_height(shmBuffer);
-    int32_t bufferStride = wl_shm_buffer_get_stride(shmBuffer);
+    if (!clientBuffer->isSharedMemory()) {
+        Internal::DmabufAttributes attributes;
+        if (!dmabufSupported || !clientBuffer->dmabufAttributes(&attributes)) {
+            qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Unsupported buffer type, only shm and dmabuf buffers are supported");
+            wl_resource_post_error(resource->handle, error_invalid_buffer,
+                                   "unsupported buffer type");
+            return;
+        }
 
-    if (bufferFormat != requestedBufferFormat || bufferWidth != rect.width() ||
-            bufferHeight != rect.height() || bufferStride != stride) {
-        qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Invalid buffer attributes");
-        wl_resource_post_error(resource->handle, error_invalid_buffer,
-                               "invalid buffer attributes");
-        return;
+        if (attributes.size != pixelRect.size()) {
+            qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Invalid buffer attributes");
+            wl_resource_post_error(resource->handle, error_invalid_buffer,
+                                   "invalid buffer attributes");
+            return;
+        }
     }
 
-    if (withDamage)
-        send_damage(damageRect.x(), damageRect.y(), damageRect.width(), damageRect.height());
-
     ready = true;
-    buffer = shmBuffer;
+    buffer = WaylandBufferRefPrivate::fromBuffer(clientBuffer);
     emit q->ready();
 }
 
+void WaylandWlrScreencopyFrameV1Private::sendReady(const QRect &damage, quint64 tv_sec, quint32 tv_nsec)
+{
+    if (withDamage)
+        send_damage(damage.x(), damage.y(), damage.width(), damage.height());
+
+    send_flags(static_cast<uint32_t>(flags));
+    send_ready(tv_sec >> 32, tv_sec & 0xffffffff, tv_nsec);
+}
+
 void WaylandWlrScreencopyFrameV1Private::zwlr_screencopy_frame_v1_destroy_resource(Resource *resource)
 {
     Q_UNUSED(resource)
@@ -268,13 +301,9 @@ void WaylandWlrScreencopyFrameV1Private::zwlr_screencopy_frame_v1_destroy(Resour
 void WaylandWlrScreencopyFrameV1Private::zwlr_screencopy_frame_v1_copy_with_damage(
         Resource *resource, struct ::wl_resource *buffer_res)
 {
+    // Waiting for damage is up to the readback
     withDamage = true;
-
-    filterObject = new WaylandWlrScreencopyFrameEventFilter();
-    filterObject->resource = resource;
-    filterObject->buffer_res = buffer_res;
-    filterObject->frame = this;
-    output->window()->installEventFilter(filterObject);
+    copy(resource, buffer_res);
 }
 
 /*
@@ -329,67 +358,86 @@ void WaylandWlrScreencopyFrameV1::copy(const QString &childToCapture)
 {
     Q_D(WaylandWlrScreencopyFrameV1);
 
-    if (d->ready) {
-        wl_shm_buffer_begin_access(d->buffer);
-        void *data = wl_shm_buffer_get_data(d->buffer);
+    if (!d->ready) {
+        qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Cannot copy a frame that is not ready");
+        return;
+    }
 
-        auto sendReadyFunc = [d]() {
-            wl_shm_buffer_end_access(d->buffer);
+    d->ready = false;
 
-            d->send_flags(static_cast<uint32_t>(d->flags));
-            d->send_ready(d->tv_sec_hi, d->tv_sec_lo, 0);
-        };
+    auto *quickWindow = qobject_cast<QQuickWindow *>(d->output->window());
 
-        auto *quickWindow = qobject_cast<QQuickWindow *>(d->output->window());
-        if (quickWindow) {
-            // QtQuick compositors draw the software cursor as an item on top of the UI,
-            // if we capture the UI layer we'll avoid the cursor
-            auto *item = quickWindow->contentItem();
-            auto *uiItem = d->overlayCursor ? item : quickWindow->findChild<QQuickItem *>(childToCapture);
-
-            QSharedPointer<QQuickItemGrabResult> result = uiItem->grabToImage();
-
-            auto captureFunc = [this, d, data, item, uiItem, result]() {
-                QImage finalImage = result->image();
-
-                if (d->rect.x() > 0 || d->rect.y() > 0)
-                    finalImage = finalImage.copy(d->rect);
-
-                // The buffer format is decided before grabbing the window contents,
-                // we don't know the QImage format at that time, so we convert it
-                // if needed
-#if QT_VERSION >= QT_VERSION_CHECK(5,13,0)
-                auto bufferFormat = static_cast<wl_shm_format>(wl_shm_buffer_get_format(d->buffer));
-                auto imageFormat = fromWaylandShmFormat(bufferFormat);
-                if (finalImage.format() != imageFormat)
-                    finalImage.convertTo(imageFormat);
-#else
-#warning "Image format conversion is not supported, please upgrade to Qt >= 5.13"
+#if QT_CONFIG(opengl)
+    // The whole window is read back from what is rendered anyway,
+    // a child item without the cursor needs to be grabbed instead
+    if ((d->overlayCursor || childToCapture.isEmpty())
+            && Internal::ScreencopyReadback::canReadback(quickWindow)) {
+        Internal::ScreencopyReadback::get(quickWindow)->queue(this, d->buffer);
+        return;
+    }
 #endif
 
-                memcpy(data, finalImage.bits(), finalImage.sizeInBytes());
-            };
+    auto *shmBuffer = d->buffer.isDestroyed() ? nullptr : wl_shm_buffer_get(d->buffer.wl_buffer());
+    if (!shmBuffer) {
+        // Only the readback fills dmabufs
+        d->send_failed();
+        return;
+    }
+
+    wl_shm_buffer_begin_access(shmBuffer);
+    void *data = wl_shm_buffer_get_data(shmBuffer);
+
+    auto sendReadyFunc = [d, shmBuffer]() {
+        wl_shm_buffer_end_access(shmBuffer);
+
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        d->sendReady(QRect(QPoint(0, 0), d->pixelRect.size()), ts.tv_sec, ts.tv_nsec);
+    };
+
+    if (quickWindow) {
+        // QtQuick compositors draw the software cursor as an item on top of the UI,
+        // if we capture the UI layer we'll avoid the cursor
+        auto *item = quickWindow->contentItem();
+        auto *uiItem = d->overlayCursor ? item : quickWindow->findChild<QQuickItem *>(childToCapture);
+
+        QSharedPointer<QQuickItemGrabResult> result = uiItem->grabToImage();
+
+        auto captureFunc = [d, data, result]() {
+            QImage finalImage = result->image();
+
+            if (finalImage.size() != d->pixelRect.size())
+                finalImage = finalImage.copy(d->pixelRect);
 
-            if (result.isNull() || result->image().isNull()) {
-                connect(result.data(), &QQuickItemGrabResult::ready, this, [captureFunc, sendReadyFunc] {
-                    captureFunc();
-                    sendReadyFunc();
-                });
-            } else {
+            // The buffer format is decided before grabbing the window contents,
+            // we don't know the QImage format at that time, so we convert it
+            // if needed
+            auto imageFormat = fromWaylandShmFormat(d->requestedBufferFormat);
+            if (finalImage.format() != imageFormat)
+                finalImage.convertTo(imageFormat);
+
+            const qsizetype bytesPerLine = qMin(finalImage.bytesPerLine(), qsizetype(d->stride));
+            for (int y = 0; y < finalImage.height(); ++y)
+                memcpy(static_cast<uchar *>(data) + y * d->stride, finalImage.constScanLine(y), bytesPerLine);
+        };
+
+        if (result.isNull() || result->image().isNull()) {
+            connect(result.data(), &QQuickItemGrabResult::ready, this, [captureFunc, sendReadyFunc] {
                 captureFunc();
                 sendReadyFunc();
-            }
+            });
         } else {
-            QRect rect = d->rect.translated(d->output->position());
-
-            // Read window pixels, including the cursor if rendered
-            glPixelStorei(GL_PACK_ALIGNMENT, 1);
-            glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, data);
-
+            captureFunc();
             sendReadyFunc();
         }
     } else {
-        qCWarning(gLcAuroraCompositorWlrScreencopyV1, "Cannot copy a frame that is not ready");
+        QRect rect(d->pixelRect.topLeft() + d->output->position(), d->pixelRect.size());
+
+        // Read window pixels, including the cursor if rendered
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+        sendReadyFunc();
     }
 }
 
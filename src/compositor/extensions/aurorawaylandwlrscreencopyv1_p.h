@@ -6,6 +6,7 @@
 
 #include <QRect>
 
+#include <LiriAuroraCompositor/WaylandBufferRef>
 #include <LiriAuroraCompositor/WaylandWlrScreencopyManagerV1>
 #include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
 #include <LiriAuroraCompositor/private/aurora-server-wlr-screencopy-unstable-v1.h>
@@ -27,8 +28,6 @@ namespace Aurora {
 
 namespace Compositor {
 
-class WaylandWlrScreencopyFrameEventFilter;
-
 class LIRIAURORACOMPOSITOR_EXPORT WaylandWlrScreencopyManagerV1Private
         : public WaylandCompositorExtensionPrivate
         , public PrivateServer::zwlr_screencopy_manager_v1
@@ -62,18 +61,20 @@ public:
 
     void setup();
     void copy(Resource *resource, struct ::wl_resource *buffer_res);
+    void sendReady(const QRect &damage, quint64 tv_sec, quint32 tv_nsec);
 
-    WaylandWlrScreencopyFrameEventFilter *filterObject = nullptr;
     bool overlayCursor = false;
     WaylandOutput *output = nullptr;
+    struct ::wl_resource *managerResource = nullptr;
+    // Captured area in output coordinates and in window pixels
     QRect rect;
+    QRect pixelRect;
     WaylandWlrScreencopyFrameV1::Flags flags;
     bool withDamage = false;
-    QRect damageRect;
     uint32_t stride = 0;
     wl_shm_format requestedBufferFormat = WL_SHM_FORMAT_ABGR8888;
-    struct ::wl_shm_buffer *buffer = nullptr;
-    quint32 tv_sec_hi = 0, tv_sec_lo = 0;
+    bool dmabufSupported = false;
+    WaylandBufferRef buffer;
     bool ready = false;
 
     static WaylandWlrScreencopyFrameV1Private *get(WaylandWlrScreencopyFrameV1 *frame) { return frame ? frame->d_func() : nullptr; }
@@ -87,21 +88,6 @@ protected:
                                                    struct ::wl_resource *buffer_res) override;
 };
 
-class LIRIAURORACOMPOSITOR_EXPORT WaylandWlrScreencopyFrameEventFilter
-        : public QObject
-{
-    Q_OBJECT
-public:
-    explicit WaylandWlrScreencopyFrameEventFilter(QObject *parent = nullptr);
-
-    WaylandWlrScreencopyFrameV1Private::Resource *resource = nullptr;
-    struct ::wl_resource *buffer_res = nullptr;
-    WaylandWlrScreencopyFrameV1Private *frame = nullptr;
-
-protected:
-    bool eventFilter(QObject *watched, QEvent *event) override;
-};
-
 } // namespace Compositor
 
 } // namespace Aurora
@@ -364,8 +364,8 @@ void WaylandXdgOutputV1::setLogicalPosition(const QPoint &position)
 
     d->logicalPos = position;
     if (d->initialized) {
-        d->sendLogicalPosition(position);
-        d->sendDone();
+        d->logicalPosChanged = true;
+        d->scheduleChanges();
     }
     emit logicalPositionChanged();
     emit logicalGeometryChanged();
@@ -416,8 +416,8 @@ void WaylandXdgOutputV1::setLogicalSize(const QSize &size)
 
     d->logicalSize = size;
     if (d->initialized) {
-        d->sendLogicalSize(size);
-        d->sendDone();
+        d->logicalSizeChanged = true;
+        d->scheduleChanges();
     }
     emit logicalSizeChanged();
     emit logicalGeometryChanged();
@@ -451,34 +451,60 @@ QRect WaylandXdgOutputV1::logicalGeometry() const
 
 // WaylandXdgOutputV1Private
 
-void WaylandXdgOutputV1Private::sendLogicalPosition(const QPoint &position)
+void WaylandXdgOutputV1Private::scheduleChanges()
 {
-    const auto values = resourceMap().values();
-    for (auto *resource : values)
-        send_logical_position(resource->handle, position.x(), position.y());
-    needToSendDone = true;
+    // Position and size usually change together, send them with one done
+    if (output && output->compositor())
+        scheduleDone(output->compositor());
+    else
+        sendChanges();
 }
 
-void WaylandXdgOutputV1Private::sendLogicalSize(const QSize &size)
+void WaylandXdgOutputV1Private::sendChanges(bool outputDoneFollows)
 {
+    if (!logicalPosChanged && !logicalSizeChanged)
+        return;
+
+    auto *outputPrivate = output ? WaylandOutputPrivate::get(output) : nullptr;
+
     const auto values = resourceMap().values();
-    for (auto *resource : values)
-        send_logical_size(resource->handle, size.width(), size.height());
-    needToSendDone = true;
+    for (auto *resource : values) {
+        if (logicalPosChanged)
+            send_logical_position(resource->handle, logicalPos.x(), logicalPos.y());
+        if (logicalSizeChanged)
+            send_logical_size(resource->handle, logicalSize.width(), logicalSize.height());
+
+        // Since version 3 the atomic update is completed by wl_output.done
+        if (resource->version() < 3) {
+            send_done(resource->handle);
+        } else if (outputPrivate && !outputDoneFollows) {
+            const auto outputResources = outputPrivate->resourceMap().values(resource->client());
+            for (auto *outputResource : outputResources) {
+                if (outputResource->version() >= 2)
+                    outputPrivate->send_done(outputResource->handle);
+            }
+        }
+    }
+
+    logicalPosChanged = false;
+    logicalSizeChanged = false;
 }
 
-void WaylandXdgOutputV1Private::sendDone()
+// Called by WaylandOutput right before it sends its own changes, the
+// wl_output.done that follows completes ours too
+void WaylandXdgOutputV1Private::sendChangesBeforeOutputDone()
 {
-    if (needToSendDone) {
-        const auto values = resourceMap().values();
-        for (auto *resource : values) {
-            if (resource->version() < 3)
-                send_done(resource->handle);
-        }
-        needToSendDone = false;
+    if (isDoneScheduled()) {
+        cancelDone();
+        sendChanges(true);
     }
 }
 
+void WaylandXdgOutputV1Private::sendPendingDone()
+{
+    sendChanges();
+}
+
 void WaylandXdgOutputV1Private::setManager(WaylandXdgOutputManagerV1 *_manager)
 {
     Q_Q(WaylandXdgOutputV1);
@@ -7,6 +7,7 @@
 
 #include <LiriAuroraCompositor/WaylandOutput>
 #include <LiriAuroraCompositor/WaylandXdgOutputV1>
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandcompositorextension_p.h>
 #include <LiriAuroraCompositor/private/aurora-server-xdg-output-unstable-v1.h>
 
@@ -49,14 +50,16 @@ private:
 class LIRIAURORACOMPOSITOR_EXPORT WaylandXdgOutputV1Private
         : public QObjectPrivate
         , public PrivateServer::zxdg_output_v1
+        , public Internal::PendingDone
 {
     Q_DECLARE_PUBLIC(WaylandXdgOutputV1)
 public:
     explicit WaylandXdgOutputV1Private() = default;
 
-    void sendLogicalPosition(const QPoint &position);
-    void sendLogicalSize(const QSize &size);
-    void sendDone();
+    void scheduleChanges();
+    void sendChanges(bool outputDoneFollows = false);
+    void sendChangesBeforeOutputDone();
+    void sendPendingDone() override;
 
     void setManager(WaylandXdgOutputManagerV1 *manager);
     void setOutput(WaylandOutput *output);
@@ -70,7 +73,8 @@ public:
     QSize logicalSize;
     QString name;
     QString description;
-    bool needToSendDone = false;
+    bool logicalPosChanged = false;
+    bool logicalSizeChanged = false;
 
 protected:
     void zxdg_output_v1_bind_resource(Resource *resource) override;
@@ -712,8 +712,14 @@ WaylandQuickShellIntegration *WaylandXdgSurface::createIntegration(WaylandQuickS
 WaylandXdgToplevel::WaylandXdgToplevel(WaylandXdgSurface *xdgSurface, WaylandResource &resource)
     : QObject(*new WaylandXdgToplevelPrivate(xdgSurface, resource))
 {
+    Q_D(WaylandXdgToplevel);
+
     QList<WaylandXdgToplevel::State> states;
     sendConfigure({0, 0}, states);
+
+    connect(xdgSurface->surface(), &WaylandSurface::redraw, this, [d]() {
+        d->handleCommit();
+    });
 }
 
 WaylandXdgToplevel::~WaylandXdgToplevel()
@@ -1292,6 +1298,12 @@ void WaylandXdgToplevelPrivate::handleAckConfigure(uint serial)
 
     m_lastAckedConfigure = config;
 
+    // Acking a later configure acks the resize too
+    if (m_resizeSerial != 0 && !m_resizeAcked) {
+        auto isResize = [this](const ConfigureEvent &c) { return c.serial == m_resizeSerial; };
+        m_resizeAcked = std::none_of(m_pendingConfigures.cbegin(), m_pendingConfigures.cend(), isResize);
+    }
+
     for (uint state : changedStates) {
         switch (state) {
         case state_maximized:
@@ -1313,6 +1325,50 @@ void WaylandXdgToplevelPrivate::handleAckConfigure(uint serial)
         emit q->statesChanged();
 }
 
+/*
+    Sends a resizing configure for \a size, unless one is in flight: then
+    the size is sent once the client is done with the previous one.
+*/
+void WaylandXdgToplevelPrivate::requestResize(const QSize &size)
+{
+    m_resizePendingSize = size;
+    flushResize();
+}
+
+/*
+    Sends the newest size if the client acked and committed the previous
+    configure. With \a frame set an ack is enough, for clients that ack
+    without committing a new buffer.
+*/
+void WaylandXdgToplevelPrivate::flushResize(bool frame)
+{
+    Q_Q(WaylandXdgToplevel);
+
+    if (!m_resizePendingSize.isValid())
+        return;
+    if (m_resizeSerial != 0 && !(m_resizeAcked && frame))
+        return;
+
+    const QSize size = m_resizePendingSize;
+    m_resizePendingSize = QSize();
+    const ConfigureEvent last = lastSentConfigure();
+    if (size == last.size && last.states.contains(WaylandXdgToplevel::State::ResizingState))
+        return;
+
+    m_resizeSerial = q->sendResizing(size);
+    m_resizeAcked = false;
+}
+
+void WaylandXdgToplevelPrivate::handleCommit()
+{
+    // The state of the acked configure is now on screen
+    if (m_resizeSerial != 0 && m_resizeAcked) {
+        m_resizeSerial = 0;
+        m_resizeAcked = false;
+        flushResize();
+    }
+}
+
 void WaylandXdgToplevelPrivate::handleFocusLost()
 {
     Q_Q(WaylandXdgToplevel);
@@ -122,6 +122,12 @@ public:
     void handleFocusLost();
     void handleFocusReceived();
 
+    // Interactive resize: the newest size waits until the client acked and
+    // committed the previous one, sizes in between are dropped
+    void requestResize(const QSize &size);
+    void flushResize(bool frame = false);
+    void handleCommit();
+
     static WaylandXdgToplevelPrivate *get(WaylandXdgToplevel *toplevel) { return toplevel->d_func(); }
     static Qt::Edges convertToEdges(resize_edge edge);
 
@@ -155,6 +161,11 @@ public:
     QSize m_minSize = {0, 0};
     WaylandXdgToplevelDecorationV1 *m_decoration = nullptr;
 
+    // At most one resize configure in flight
+    QSize m_resizePendingSize;
+    uint m_resizeSerial = 0;
+    bool m_resizeAcked = false;
+
     static WaylandSurfaceRole s_role;
 };
 
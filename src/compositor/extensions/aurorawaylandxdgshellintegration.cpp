@@ -2,11 +2,15 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 #include "aurorawaylandxdgshellintegration_p.h"
+#include "aurorawaylandxdgshell_p.h"
 
 #include <LiriAuroraCompositor/WaylandXdgSurface>
 #include <LiriAuroraCompositor/WaylandCompositor>
 #include <LiriAuroraCompositor/WaylandSeat>
 
+#include <QtCore/QPointer>
+#include <QtQuick/QQuickWindow>
+
 namespace Aurora {
 
 namespace Compositor {
@@ -70,7 +74,8 @@ bool XdgToplevelIntegration::filterPointerMoveEvent(const QPointF &scenePosition
         }
         QPointF delta = m_item->mapToSurface(scenePosition - resizeState.initialMousePos);
         QSize newSize = m_toplevel->sizeForResize(resizeState.initialWindowSize, delta, resizeState.resizeEdges);
-        m_toplevel->sendResizing(newSize);
+        // Paced by the client, pointers move much faster than it can redraw
+        WaylandXdgToplevelPrivate::get(m_toplevel)->requestResize(newSize);
     } else if (grabberState == GrabberState::Move) {
         QQuickItem *moveItem = m_item->moveItem();
         if (!moveState.initialized) {
@@ -110,6 +115,7 @@ bool XdgToplevelIntegration::filterPointerReleaseEvent()
 {
     if (grabberState != GrabberState::Default) {
         grabberState = GrabberState::Default;
+        disconnect(resizeState.frameConnection);
         return true;
     }
     return false;
@@ -131,6 +137,17 @@ void XdgToplevelIntegration::handleStartResize(WaylandSeat *seat, Qt::Edges edge
     resizeState.initialPosition = m_item->moveItem()->position();
     resizeState.initialSurfaceSize = m_item->surface()->destinationSize();
     resizeState.initialized = false;
+
+    // Clients that ack without a new buffer get the next size with the next frame
+    disconnect(resizeState.frameConnection);
+    if (QQuickWindow *window = m_item->window()) {
+        // Queued from the render thread, the toplevel may be gone meanwhile
+        QPointer<WaylandXdgToplevel> toplevel = m_toplevel;
+        resizeState.frameConnection = connect(window, &QQuickWindow::frameSwapped, this, [toplevel]() {
+            if (toplevel)
+                WaylandXdgToplevelPrivate::get(toplevel)->flushResize(true);
+        });
+    }
 }
 
 void XdgToplevelIntegration::handleSetMaximized()
@@ -270,6 +287,7 @@ void XdgToplevelIntegration::handleToplevelDestroyed()
     // Disarm any handlers that might fire on the now-stale toplevel pointer
     nonwindowedState.output = nullptr;
     disconnect(nonwindowedState.sizeChangedConnection);
+    disconnect(resizeState.frameConnection);
 }
 
 XdgPopupIntegration::XdgPopupIntegration(WaylandQuickShellSurfaceItem *item)
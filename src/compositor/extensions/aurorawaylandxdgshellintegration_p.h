@@ -76,6 +76,7 @@ private:
         QPointF initialPosition;
         QSize initialSurfaceSize;
         bool initialized;
+        QMetaObject::Connection frameConnection;
     } resizeState;
 
     struct {
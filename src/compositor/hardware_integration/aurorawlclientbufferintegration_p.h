@@ -17,6 +17,8 @@
 #include <LiriAuroraCompositor/liriauroracompositorglobal.h>
 #include <LiriAuroraCompositor/aurorawaylandsurface.h>
 #include <LiriAuroraCompositor/aurorawaylandbufferref.h>
+#include <QtCore/QHash>
+#include <QtCore/QList>
 #include <QtCore/QSize>
 #include <QtCore/private/qglobal_p.h>
 #include <wayland-server-core.h>
@@ -31,6 +33,30 @@ class WaylandCompositor;
 
 namespace Internal {
 class Display;
+class SyncTimelineBackend;
+
+// Formats and modifiers that a plane of the KMS device can scan out, for
+// surfaces that could be put on that plane if their buffers allowed it
+struct ScanoutHint
+{
+    enum Plane {
+        PrimaryPlane = 0,
+        OverlayPlane
+    };
+
+    // dev_t of the KMS device
+    quint64 device = 0;
+    // A format without modifiers supports implicit and linear layouts
+    QHash<quint32, QList<quint64>> formats;
+
+    bool isNull() const { return device == 0 || formats.isEmpty(); }
+
+    bool operator==(const ScanoutHint &other) const
+    {
+        return device == other.device && formats == other.formats;
+    }
+    bool operator!=(const ScanoutHint &other) const { return !operator==(other); }
+};
 
 class LIRIAURORACOMPOSITOR_EXPORT ClientBufferIntegration
 {
@@ -46,6 +72,15 @@ public:
     virtual ClientBuffer *createBufferFor(struct ::wl_resource *buffer) = 0;
     virtual bool isProtected(struct ::wl_resource *buffer) { Q_UNUSED(buffer); return false; }
 
+    // Whether dmabufs imported by this integration can also be rendered to
+    virtual bool supportsDmabufTargets() const { return false; }
+
+    // The planes that could scan out the surface changed
+    virtual void scanoutHintChanged(WaylandSurface *surface) { Q_UNUSED(surface); }
+
+    // Imports the timelines of explicitly synchronized clients, if supported
+    virtual SyncTimelineBackend *syncTimelineBackend() { return nullptr; }
+
 protected:
     WaylandCompositor *m_compositor = nullptr;
 };
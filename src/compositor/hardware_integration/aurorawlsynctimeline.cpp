@@ -0,0 +1,116 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aurorawlsynctimeline_p.h"
+
+#include <QtCore/QMutexLocker>
+
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+SyncTimeline::~SyncTimeline()
+{
+}
+
+SyncTimelineBackend::~SyncTimelineBackend()
+{
+}
+
+bool SyncTimelineBackend::supportsBuffer(struct ::wl_resource *buffer) const
+{
+    // Shared memory is read by the CPU when the buffer is committed
+    return !wl_shm_buffer_get(buffer);
+}
+
+quint64 SoftwareSyncTimeline::value() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_value;
+}
+
+bool SoftwareSyncTimeline::isSignalled(quint64 point) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_value >= point;
+}
+
+void SoftwareSyncTimeline::wait(quint64 point, QObject *context, std::function<void()> callback)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_value >= point) {
+        locker.unlock();
+        QMetaObject::invokeMethod(context, std::move(callback), Qt::QueuedConnection);
+        return;
+    }
+
+    m_waiters.append({ point, context, std::move(callback) });
+}
+
+void SoftwareSyncTimeline::signal(quint64 point, int fenceFd)
+{
+    // Without a GPU there is nothing to wait for
+    if (fenceFd >= 0)
+        ::close(fenceFd);
+
+    QList<Waiter> ready;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (point <= m_value)
+            return;
+        m_value = point;
+
+        for (auto it = m_waiters.begin(); it != m_waiters.end();) {
+            if (it->point <= m_value) {
+                ready.append(std::move(*it));
+                it = m_waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // Waiters may be called from another thread than the one that signals
+    for (Waiter &waiter : ready) {
+        if (waiter.context)
+            QMetaObject::invokeMethod(waiter.context, std::move(waiter.callback), Qt::AutoConnection);
+    }
+}
+
+QSharedPointer<SyncTimeline> SoftwareSyncTimelineBackend::importTimeline(int fd)
+{
+    // The file descriptor is only a handle from the client's point of view
+    if (fd >= 0)
+        ::close(fd);
+
+    auto timeline = QSharedPointer<SoftwareSyncTimeline>::create();
+    m_timelines.removeIf([](const QWeakPointer<SoftwareSyncTimeline> &t) { return t.isNull(); });
+    m_timelines.append(timeline);
+    return timeline;
+}
+
+bool SoftwareSyncTimelineBackend::supportsBuffer(struct ::wl_resource *buffer) const
+{
+    Q_UNUSED(buffer);
+    return true;
+}
+
+QList<QSharedPointer<SoftwareSyncTimeline>> SoftwareSyncTimelineBackend::timelines() const
+{
+    QList<QSharedPointer<SoftwareSyncTimeline>> result;
+    for (const auto &timeline : m_timelines) {
+        if (auto strong = timeline.toStrongRef())
+            result.append(strong);
+    }
+    return result;
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
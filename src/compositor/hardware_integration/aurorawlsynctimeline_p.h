@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QWeakPointer>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+
+#include <wayland-server-core.h>
+
+#include <functional>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+/*
+    Timeline of a synchronization object imported from a client, whose points
+    are signalled in increasing order.
+
+    Timelines may be signalled from the render thread, waiters are always
+    called on the thread of their context object.
+*/
+class LIRIAURORACOMPOSITOR_EXPORT SyncTimeline
+{
+public:
+    virtual ~SyncTimeline();
+
+    virtual bool isSignalled(quint64 point) const = 0;
+
+    // Calls the callback once the point is signalled, unless the context is destroyed first
+    virtual void wait(quint64 point, QObject *context, std::function<void()> callback) = 0;
+
+    // Signals the point once the fence is signalled, or right away without a fence.
+    // Takes ownership of the fence file descriptor.
+    virtual void signal(quint64 point, int fenceFd = -1) = 0;
+
+    // Signals the point once the GPU is done with the frames that may still use
+    // the buffer that was just released, including a frame being rendered
+    virtual void release(quint64 point) { signal(point); }
+};
+
+struct SyncPoint
+{
+    QSharedPointer<SyncTimeline> timeline;
+    quint64 point = 0;
+
+    bool isNull() const { return timeline.isNull(); }
+    bool isSignalled() const { return !timeline || timeline->isSignalled(point); }
+};
+
+class LIRIAURORACOMPOSITOR_EXPORT SyncTimelineBackend
+{
+public:
+    virtual ~SyncTimelineBackend();
+
+    // Takes ownership of the file descriptor, returns null if it can't be imported
+    virtual QSharedPointer<SyncTimeline> importTimeline(int fd) = 0;
+
+    // Whether buffers of this kind can be synchronized with the timelines
+    virtual bool supportsBuffer(struct ::wl_resource *buffer) const;
+
+    // Called on the render thread, with the context current, before the
+    // scene of a frame is synchronized
+    virtual void frameStarted() {}
+
+    // Called on the render thread, with the context current, after the
+    // commands of a frame were submitted
+    virtual void frameRendered() {}
+};
+
+// Timelines without a kernel object, signalled explicitly from the compositor,
+// for platforms without DRM synchronization objects and for tests
+class LIRIAURORACOMPOSITOR_EXPORT SoftwareSyncTimeline : public SyncTimeline
+{
+public:
+    SoftwareSyncTimeline() = default;
+
+    quint64 value() const;
+
+    bool isSignalled(quint64 point) const override;
+    void wait(quint64 point, QObject *context, std::function<void()> callback) override;
+    void signal(quint64 point, int fenceFd = -1) override;
+
+private:
+    struct Waiter {
+        quint64 point = 0;
+        QPointer<QObject> context;
+        std::function<void()> callback;
+    };
+
+    mutable QMutex m_mutex;
+    quint64 m_value = 0;
+    QList<Waiter> m_waiters;
+};
+
+class LIRIAURORACOMPOSITOR_EXPORT SoftwareSyncTimelineBackend : public SyncTimelineBackend
+{
+public:
+    SoftwareSyncTimelineBackend() = default;
+
+    QSharedPointer<SyncTimeline> importTimeline(int fd) override;
+    bool supportsBuffer(struct ::wl_resource *buffer) const override;
+
+    // Timelines that are still referenced, in import order
+    QList<QSharedPointer<SoftwareSyncTimeline>> timelines() const;
+
+private:
+    QList<QWeakPointer<SoftwareSyncTimeline>> m_timelines;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
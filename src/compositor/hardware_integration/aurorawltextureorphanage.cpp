@@ -41,6 +41,7 @@ void WaylandTextureOrphanage::admitTexture(QOpenGLTexture *tex, QOpenGLContext *
     {
         QMutexLocker locker(&m_containerLock);
         m_orphanedTextures.insert(ctx, tex);
+        m_orphanCount.storeRelease(m_orphanedTextures.size());
     }
 
     connect(ctx, &QOpenGLContext::aboutToBeDestroyed, this,
@@ -50,6 +51,10 @@ void WaylandTextureOrphanage::admitTexture(QOpenGLTexture *tex, QOpenGLContext *
 
 void WaylandTextureOrphanage::deleteTextures()
 {
+    // Called at least once per frame, usually with nothing to do
+    if (!hasOrphans())
+        return;
+
     QOpenGLContext *cCtx = QOpenGLContext::currentContext();
 
     if (cCtx == nullptr) {
@@ -96,6 +101,7 @@ void WaylandTextureOrphanage::deleteTexturesByContext(QOpenGLContext *ctx)
 
     QList<QOpenGLTexture *> texturesToDelete = m_orphanedTextures.values(ctx);
     m_orphanedTextures.remove(ctx);
+    m_orphanCount.storeRelease(m_orphanedTextures.size());
 
     for (QOpenGLTexture *tex : texturesToDelete) {
         delete tex;
@@ -15,6 +15,7 @@
 //
 
 #include <QObject>
+#include <QAtomicInt>
 #include <QMutex>
 #include <QLoggingCategory>
 #include <LiriAuroraCompositor/liriauroracompositorglobal.h>
@@ -46,6 +47,8 @@ public:
     // uses QOpenGLContext::currentContext to call deleteTexturesByContext on all shared ctx
     void deleteTextures();
 
+    bool hasOrphans() const { return m_orphanCount.loadAcquire() > 0; }
+
 public Q_SLOTS:
     // uses sender() to call deleteTexturesByContext
     void onContextAboutToBeDestroyed(QOpenGLContext *ctx);
@@ -55,6 +58,8 @@ private:
 
     // tracks all the orphanes that need to be deleted
     QMultiHash<QOpenGLContext *, QOpenGLTexture *> m_orphanedTextures;
+    // Size of m_orphanedTextures, read without locking
+    QAtomicInt m_orphanCount;
 
     QMutex m_containerLock;
 };
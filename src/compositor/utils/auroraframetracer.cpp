@@ -0,0 +1,319 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+
+#include "auroraframetrace_p.h"
+#include "auroraframetracer_p.h"
+
+#include <wayland-server-core.h>
+
+#include <limits>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static_assert(Aurora::Compositor::Internal::FrameTracer::SurfaceCommit == Aurora::FrameTrace::SurfaceCommit);
+static_assert(Aurora::Compositor::Internal::FrameTracer::ShmTextureUpload == Aurora::FrameTrace::ShmTextureUpload);
+static_assert(Aurora::Compositor::Internal::FrameTracer::DmabufTextureImport == Aurora::FrameTrace::DmabufTextureImport);
+static_assert(Aurora::Compositor::Internal::FrameTracer::PaintNodeUpdate == Aurora::FrameTrace::PaintNodeUpdate);
+static_assert(Aurora::Compositor::Internal::FrameTracer::WaitForFlip == Aurora::FrameTrace::WaitForFlip);
+static_assert(Aurora::Compositor::Internal::FrameTracer::FrameCallbacks == Aurora::FrameTrace::FrameCallbacks);
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+Q_GLOBAL_STATIC(FrameTracer, s_frameTracer)
+
+static const quint16 BinaryVersion = 1;
+
+static quint32 currentThreadId()
+{
+    static thread_local const quint32 threadId = static_cast<quint32>(::syscall(SYS_gettid));
+    return threadId;
+}
+
+FrameTracer::Scope::Scope(Stage stage, quint32 surfaceId, struct ::wl_resource *resource)
+    : m_stage(stage)
+    , m_begin(FrameTracer::isRecording() ? StartupTrace::now() : 0)
+{
+    // The client may be gone when the scope ends on another thread
+    if (m_begin > 0) {
+        m_surfaceId = surfaceId;
+        if (resource)
+            m_clientId = FrameTracer::clientId(wl_resource_get_client(resource));
+    }
+}
+
+FrameTracer::Scope::Scope(Stage stage, struct ::wl_resource *surface)
+    : Scope(stage, 0, surface)
+{
+    if (m_begin > 0 && surface)
+        m_surfaceId = wl_resource_get_id(surface);
+}
+
+FrameTracer::Scope::~Scope()
+{
+    if (m_begin > 0) {
+        const qint64 end = StartupTrace::now();
+        if (auto *tracer = FrameTracer::instance())
+            tracer->record(m_stage, m_begin, end, m_surfaceId, m_clientId);
+    }
+}
+
+FrameTracer::FrameTracer()
+{
+    m_fileName = qEnvironmentVariable("AURORA_FRAME_TRACE");
+    if (!m_fileName.isEmpty())
+        acquire();
+}
+
+FrameTracer::~FrameTracer()
+{
+    if (!m_fileName.isEmpty()) {
+        const Format format = m_fileName.endsWith(QLatin1String(".json")) ? ChromeTrace : Binary;
+        save(m_fileName, format);
+    }
+}
+
+FrameTracer *FrameTracer::instance()
+{
+    return s_frameTracer();
+}
+
+bool FrameTracer::isRecording()
+{
+    auto *tracer = instance();
+    return tracer && tracer->isActive();
+}
+
+const char *FrameTracer::stageName(Stage stage)
+{
+    switch (stage) {
+    case SurfaceCommit:
+        return "surfaceCommit";
+    case ShmTextureUpload:
+        return "shmTextureUpload";
+    case DmabufTextureImport:
+        return "dmabufTextureImport";
+    case PaintNodeUpdate:
+        return "paintNodeUpdate";
+    case WaitForFlip:
+        return "waitForFlip";
+    case FrameCallbacks:
+        return "frameCallbacks";
+    default:
+        return "unknown";
+    }
+}
+
+quint32 FrameTracer::clientId(struct ::wl_client *client)
+{
+    if (!client)
+        return 0;
+
+    pid_t pid = 0;
+    wl_client_get_credentials(client, &pid, nullptr, nullptr);
+    return static_cast<quint32>(pid);
+}
+
+void FrameTracer::acquire()
+{
+    if (m_activations++ == 0)
+        setActive(true);
+}
+
+void FrameTracer::release()
+{
+    Q_ASSERT(m_activations > 0);
+    if (m_activations > 0 && --m_activations == 0)
+        setActive(false);
+}
+
+void FrameTracer::setActive(bool active)
+{
+    // Allocated only once, recording threads may still be using it
+    if (active && !m_slots)
+        m_slots.reset(new Slot[Capacity]);
+
+    m_active.store(active, std::memory_order_release);
+}
+
+void FrameTracer::record(Stage stage, qint64 begin, qint64 end, quint32 surfaceId, quint32 clientId)
+{
+    if (!isActive())
+        return;
+
+    const quint64 index = m_head.fetch_add(1, std::memory_order_relaxed);
+    Slot &slot = m_slots[index & (Capacity - 1)];
+
+    slot.sequence.store(index * 2 + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    slot.begin.store(begin, std::memory_order_relaxed);
+    slot.end.store(end, std::memory_order_relaxed);
+    slot.frame.store(m_frame.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    slot.ids.store(quint64(surfaceId) << 32 | clientId, std::memory_order_relaxed);
+    slot.threadId.store(currentThreadId(), std::memory_order_relaxed);
+    slot.stage.store(stage, std::memory_order_relaxed);
+
+    slot.sequence.store(index * 2 + 2, std::memory_order_release);
+}
+
+void FrameTracer::frameSent()
+{
+    if (isActive())
+        m_frame.fetch_add(1, std::memory_order_relaxed);
+}
+
+QVector<FrameTracer::Event> FrameTracer::events() const
+{
+    QVector<Event> events;
+    if (!m_slots)
+        return events;
+
+    const quint64 head = m_head.load(std::memory_order_acquire);
+    const quint64 first = head > Capacity ? head - Capacity : 0;
+    events.reserve(int(head - first));
+
+    for (quint64 index = first; index < head; ++index) {
+        const Slot &slot = m_slots[index & (Capacity - 1)];
+
+        // Skip events that are being written or were overwritten meanwhile
+        const quint64 sequence = slot.sequence.load(std::memory_order_acquire);
+        if (sequence != index * 2 + 2)
+            continue;
+
+        Event event;
+        event.begin = slot.begin.load(std::memory_order_relaxed);
+        event.end = slot.end.load(std::memory_order_relaxed);
+        event.frame = slot.frame.load(std::memory_order_relaxed);
+        const quint64 ids = slot.ids.load(std::memory_order_relaxed);
+        event.surfaceId = quint32(ids >> 32);
+        event.clientId = quint32(ids);
+        event.threadId = slot.threadId.load(std::memory_order_relaxed);
+        event.stage = static_cast<Stage>(slot.stage.load(std::memory_order_relaxed));
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+            continue;
+
+        events.append(event);
+    }
+
+    return events;
+}
+
+bool FrameTracer::save(const QString &fileName, Format format) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(gLcAuroraCompositor, "Failed to save frame trace to \"%s\": %s",
+                  qPrintable(fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    const QVector<Event> events = this->events();
+    const bool saved = format == ChromeTrace
+            ? saveChromeTrace(events, &file)
+            : saveBinary(events, &file);
+    if (saved)
+        qCInfo(gLcAuroraCompositor, "Frame trace with %d events saved to \"%s\"",
+               int(events.size()), qPrintable(fileName));
+    return saved;
+}
+
+bool FrameTracer::saveChromeTrace(const QVector<Event> &events, QIODevice *device) const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    // Timestamps are in microseconds
+    QJsonArray traceEvents;
+
+    traceEvents.append(QJsonObject{
+        { QStringLiteral("name"), QStringLiteral("process_name") },
+        { QStringLiteral("ph"), QStringLiteral("M") },
+        { QStringLiteral("pid"), pid },
+        { QStringLiteral("args"), QJsonObject{
+              { QStringLiteral("name"), QCoreApplication::applicationName() } } },
+    });
+
+    for (const Event &event : events) {
+        traceEvents.append(QJsonObject{
+            { QStringLiteral("name"), QString::fromLatin1(stageName(event.stage)) },
+            { QStringLiteral("cat"), QStringLiteral("frame") },
+            { QStringLiteral("ph"), QStringLiteral("X") },
+            { QStringLiteral("ts"), event.begin / 1000.0 },
+            { QStringLiteral("dur"), (event.end - event.begin) / 1000.0 },
+            { QStringLiteral("pid"), pid },
+            { QStringLiteral("tid"), qint64(event.threadId) },
+            { QStringLiteral("args"), QJsonObject{
+                  { QStringLiteral("frame"), qint64(event.frame) },
+                  { QStringLiteral("surface"), qint64(event.surfaceId) },
+                  { QStringLiteral("client"), qint64(event.clientId) } } },
+        });
+    }
+
+    const QJsonObject trace{
+        { QStringLiteral("traceEvents"), traceEvents },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ms") },
+    };
+
+    return device->write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) >= 0;
+}
+
+bool FrameTracer::saveBinary(const QVector<Event> &events, QIODevice *device) const
+{
+    QDataStream stream(device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream.writeRawData("AFTR", 4);
+    stream << BinaryVersion << quint16(StageCount);
+    for (int stage = 0; stage < StageCount; ++stage)
+        stream << QByteArray(stageName(static_cast<Stage>(stage)));
+
+    stream << quint32(events.size());
+    for (const Event &event : events) {
+        const qint64 duration = qBound<qint64>(0, event.end - event.begin, std::numeric_limits<quint32>::max());
+        stream << event.begin << quint32(duration) << quint32(event.frame)
+               << event.surfaceId << event.clientId << event.threadId
+               << quint8(event.stage);
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+using namespace Aurora::Compositor::Internal;
+
+// Entry points for the modules that don't link to the compositor library
+
+extern "C" LIRIAURORACOMPOSITOR_EXPORT bool aurora_frame_trace_is_active()
+{
+    return FrameTracer::isRecording();
+}
+
+extern "C" LIRIAURORACOMPOSITOR_EXPORT void aurora_frame_trace_record(quint8 stage, qint64 beginNs, qint64 endNs,
+                                                                     quint32 surfaceId, quint32 clientId)
+{
+    if (stage >= FrameTracer::StageCount)
+        return;
+
+    if (auto *tracer = FrameTracer::instance())
+        tracer->record(static_cast<FrameTracer::Stage>(stage), beginNs, endNs, surfaceId, clientId);
+}
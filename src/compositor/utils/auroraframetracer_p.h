@@ -0,0 +1,162 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+
+#include <atomic>
+#include <memory>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
+
+struct wl_client;
+struct wl_resource;
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+/*
+ * Records how long each stage of a frame takes, with the surface and
+ * client it was spent on.
+ *
+ * Events go into a fixed size ring buffer that any thread can write
+ * without locking, the oldest ones are overwritten. Events are recorded
+ * while at least one user holds a reference taken with acquire(). The
+ * AURORA_FRAME_TRACE environment variable set to a file name holds one
+ * for the lifetime of the process: in this case the trace is saved there
+ * when the application quits, as a Chrome trace if the name ends with
+ * ".json", otherwise in the binary format.
+ *
+ * The binary format is little endian: the "AFTR" magic, the quint16
+ * version and stage count, the stage names as QByteArray, the quint32
+ * event count, then for each event the qint64 begin in nanoseconds and
+ * the quint32 duration, frame, surface, client and thread ids, and the
+ * quint8 stage.
+ */
+class LIRIAURORACOMPOSITOR_EXPORT FrameTracer
+{
+public:
+    // Keep in sync with FrameTrace::Stage
+    enum Stage : quint8 {
+        SurfaceCommit = 0,
+        ShmTextureUpload,
+        DmabufTextureImport,
+        PaintNodeUpdate,
+        WaitForFlip,
+        FrameCallbacks,
+        StageCount
+    };
+
+    enum Format {
+        ChromeTrace,
+        Binary
+    };
+
+    struct Event {
+        qint64 begin = 0;
+        qint64 end = 0;
+        quint64 frame = 0;
+        quint32 surfaceId = 0;
+        quint32 clientId = 0;
+        quint32 threadId = 0;
+        Stage stage = SurfaceCommit;
+    };
+
+    // Records the lifetime of the object as the given stage, for the client
+    // that owns the resource; resources are only looked up while recording
+    class LIRIAURORACOMPOSITOR_EXPORT Scope
+    {
+    public:
+        explicit Scope(Stage stage, quint32 surfaceId = 0, struct ::wl_resource *resource = nullptr);
+        Scope(Stage stage, struct ::wl_resource *surface);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+
+        const Stage m_stage;
+        const qint64 m_begin;
+        quint32 m_surfaceId = 0;
+        quint32 m_clientId = 0;
+    };
+
+    // Must be a power of two
+    static constexpr quint64 Capacity = 16384;
+
+    FrameTracer();
+    ~FrameTracer();
+
+    // Returns nullptr when the application is quitting
+    static FrameTracer *instance();
+    static bool isRecording();
+
+    static const char *stageName(Stage stage);
+    static quint32 clientId(struct ::wl_client *client);
+
+    bool isActive() const { return m_active.load(std::memory_order_acquire); }
+
+    // Call them from the main thread
+    void acquire();
+    void release();
+
+    quint64 frame() const { return m_frame.load(std::memory_order_relaxed); }
+
+    void record(Stage stage, qint64 begin, qint64 end, quint32 surfaceId, quint32 clientId);
+    void frameSent();
+
+    // Events still in the buffer, from the oldest
+    QVector<Event> events() const;
+
+    bool save(const QString &fileName, Format format) const;
+
+private:
+    Q_DISABLE_COPY(FrameTracer)
+
+    // Fields are written by a thread while others may read them, the
+    // sequence is odd during the write and tells readers to skip the slot
+    struct Slot {
+        std::atomic<quint64> sequence = 0;
+        std::atomic<qint64> begin = 0;
+        std::atomic<qint64> end = 0;
+        std::atomic<quint64> frame = 0;
+        std::atomic<quint64> ids = 0;
+        std::atomic<quint32> threadId = 0;
+        std::atomic<quint8> stage = 0;
+    };
+
+    bool saveChromeTrace(const QVector<Event> &events, QIODevice *device) const;
+    bool saveBinary(const QVector<Event> &events, QIODevice *device) const;
+
+    void setActive(bool active);
+
+    int m_activations = 0;
+    std::atomic<bool> m_active = false;
+    std::atomic<quint64> m_head = 0;
+    std::atomic<quint64> m_frame = 0;
+    std::unique_ptr<Slot[]> m_slots;
+    QString m_fileName;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -0,0 +1,184 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+
+#include "aurorastartuptrace_p.h"
+#include "aurorastartuptracer_p.h"
+
+#include <utility>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+Q_GLOBAL_STATIC(StartupTracer, s_startupTracer)
+
+StartupTracer::StartupTracer()
+{
+    const QString fileName = qEnvironmentVariable("AURORA_STARTUP_TRACE");
+    if (!fileName.isEmpty())
+        start(fileName);
+}
+
+StartupTracer::~StartupTracer()
+{
+    // No frame was ever sent, save what we have
+    if (isActive())
+        finish();
+}
+
+StartupTracer *StartupTracer::instance()
+{
+    return s_startupTracer();
+}
+
+void StartupTracer::start(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_fileName = fileName;
+    m_events.clear();
+    m_events.reserve(64);
+    m_active.store(true, std::memory_order_relaxed);
+}
+
+bool StartupTracer::finish()
+{
+    QVector<Event> events;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (!m_active.exchange(false, std::memory_order_relaxed))
+            return false;
+
+        events = std::exchange(m_events, {});
+    }
+
+    return save(events, 0);
+}
+
+void StartupTracer::addSpan(const char *category, const char *name, qint64 begin, qint64 end)
+{
+    if (!isActive())
+        return;
+
+    const qint64 threadId = static_cast<qint64>(::syscall(SYS_gettid));
+
+    QMutexLocker locker(&m_mutex);
+    if (isActive())
+        m_events.append(Event{ category, name, begin, end, threadId });
+}
+
+// Startup is over when the first frame is sent
+void StartupTracer::frameSent()
+{
+    if (!isActive())
+        return;
+
+    const qint64 firstFrame = StartupTrace::now();
+    QVector<Event> events;
+
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (!m_active.exchange(false, std::memory_order_relaxed))
+            return;
+
+        events = std::exchange(m_events, {});
+    }
+
+    save(events, firstFrame);
+}
+
+bool StartupTracer::save(const QVector<Event> &events, qint64 firstFrame) const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    const qint64 mainThreadId = pid;
+
+    // Timestamps are in microseconds
+    QJsonArray traceEvents;
+
+    traceEvents.append(QJsonObject{
+        { QStringLiteral("name"), QStringLiteral("process_name") },
+        { QStringLiteral("ph"), QStringLiteral("M") },
+        { QStringLiteral("pid"), pid },
+        { QStringLiteral("args"), QJsonObject{
+              { QStringLiteral("name"), QCoreApplication::applicationName() } } },
+    });
+
+    for (const Event &event : events) {
+        traceEvents.append(QJsonObject{
+            { QStringLiteral("name"), QString::fromLatin1(event.name) },
+            { QStringLiteral("cat"), QString::fromLatin1(event.category) },
+            { QStringLiteral("ph"), QStringLiteral("X") },
+            { QStringLiteral("ts"), event.begin / 1000.0 },
+            { QStringLiteral("dur"), (event.end - event.begin) / 1000.0 },
+            { QStringLiteral("pid"), pid },
+            { QStringLiteral("tid"), event.threadId },
+        });
+    }
+
+    if (firstFrame > 0) {
+        traceEvents.append(QJsonObject{
+            { QStringLiteral("name"), QStringLiteral("firstFrame") },
+            { QStringLiteral("cat"), QStringLiteral("compositor") },
+            { QStringLiteral("ph"), QStringLiteral("i") },
+            { QStringLiteral("s"), QStringLiteral("g") },
+            { QStringLiteral("ts"), firstFrame / 1000.0 },
+            { QStringLiteral("pid"), pid },
+            { QStringLiteral("tid"), mainThreadId },
+        });
+    }
+
+    const QJsonObject trace{
+        { QStringLiteral("traceEvents"), traceEvents },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ms") },
+    };
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qCWarning(gLcAuroraCompositor, "Failed to save startup trace to \"%s\": %s",
+                  qPrintable(m_fileName), qPrintable(file.errorString()));
+        return false;
+    }
+
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    qCInfo(gLcAuroraCompositor, "Startup trace saved to \"%s\"", qPrintable(m_fileName));
+    return true;
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+using namespace Aurora::Compositor::Internal;
+
+// Entry points for the modules that don't link to the compositor library
+
+extern "C" LIRIAURORACOMPOSITOR_EXPORT bool aurora_startup_trace_is_active()
+{
+    StartupTracer *tracer = StartupTracer::instance();
+    return tracer && tracer->isActive();
+}
+
+extern "C" LIRIAURORACOMPOSITOR_EXPORT void aurora_startup_trace_add_span(const char *category, const char *name,
+                                                                         qint64 beginNs, qint64 endNs)
+{
+    if (StartupTracer *tracer = StartupTracer::instance())
+        tracer->addSpan(category, name, beginNs, endNs);
+}
@@ -0,0 +1,79 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+
+#include <atomic>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+/*
+ * Collects the startup phases of all the modules and saves them
+ * as a Chrome trace, that can be opened with Perfetto or
+ * chrome://tracing.
+ *
+ * Recording starts when the process starts with AURORA_STARTUP_TRACE
+ * set to the file name, and stops with the first frame.
+ */
+class LIRIAURORACOMPOSITOR_EXPORT StartupTracer
+{
+public:
+    struct Event {
+        const char *category = nullptr;
+        const char *name = nullptr;
+        qint64 begin = 0;
+        qint64 end = 0;
+        qint64 threadId = 0;
+    };
+
+    StartupTracer();
+    ~StartupTracer();
+
+    // Returns nullptr when the application is quitting
+    static StartupTracer *instance();
+
+    bool isActive() const { return m_active.load(std::memory_order_relaxed); }
+
+    void start(const QString &fileName);
+    bool finish();
+
+    void addSpan(const char *category, const char *name, qint64 begin, qint64 end);
+    void frameSent();
+
+private:
+    Q_DISABLE_COPY(StartupTracer)
+
+    bool save(const QVector<Event> &events, qint64 firstFrame) const;
+
+    std::atomic<bool> m_active = false;
+    QMutex m_mutex;
+    QString m_fileName;
+    QVector<Event> m_events;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
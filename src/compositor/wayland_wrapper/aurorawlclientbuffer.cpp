@@ -5,7 +5,10 @@
 
 #if QT_CONFIG(opengl)
 #include "hardware_integration/aurorawlclientbufferintegration_p.h"
+#include "hardware_integration/aurorawltextureorphanage_p.h"
+#include "aurorawlshmtextureuploader_p.h"
 #include <qpa/qplatformopenglcontext.h>
+#include <QOpenGLContext>
 #include <QOpenGLTexture>
 #endif
 
@@ -15,6 +18,7 @@
 #include "aurorawaylandsharedmemoryformathelper_p.h"
 
 #include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
 
 namespace Aurora {
 
@@ -32,6 +36,16 @@ ClientBuffer::~ClientBuffer()
 {
     if (m_buffer && m_committed && !m_destroyed)
         sendRelease();
+    // The client still waits for the points of a destroyed buffer
+    signalReleasePoints();
+
+    for (const auto &callback : std::as_const(m_destroyCallbacks))
+        callback();
+}
+
+void ClientBuffer::setDestroyCallback(const void *owner, std::function<void()> callback)
+{
+    m_destroyCallbacks.insert(owner, std::move(callback));
 }
 
 void ClientBuffer::sendRelease()
@@ -39,6 +53,30 @@ void ClientBuffer::sendRelease()
     Q_ASSERT(m_buffer);
     wl_buffer_send_release(m_buffer);
     m_committed = false;
+    signalReleasePoints();
+}
+
+void ClientBuffer::addReleasePoint(const SyncPoint &point)
+{
+    m_releasePoints.append(point);
+}
+
+void ClientBuffer::signalReleasePoints()
+{
+    // Frames that sampled the buffer may still be executing on the GPU
+    for (const SyncPoint &point : std::as_const(m_releasePoints))
+        point.timeline->release(point.point);
+    m_releasePoints.clear();
+}
+
+// Gives back a buffer that was replaced before the compositor used it,
+// the client may be waiting on its release points even if it destroyed it
+void ClientBuffer::releaseUnused()
+{
+    if (m_buffer && !m_destroyed)
+        sendRelease();
+    else
+        signalReleasePoints();
 }
 
 void ClientBuffer::setDestroyed()
@@ -73,6 +111,12 @@ void ClientBuffer::setCommitted(QRegion &damage)
      m_textureDirty = true;
 }
 
+void ClientBuffer::setCommitSerial(const QSharedPointer<BufferUploadStatistics> &statistics, quint32 serial)
+{
+    m_uploadStatistics = statistics;
+    m_commitSerial = serial;
+}
+
 WaylandBufferRef::BufferFormatEgl ClientBuffer::bufferFormatEgl() const
 {
     return WaylandBufferRef::BufferFormatEgl_Null;
@@ -84,6 +128,27 @@ SharedMemoryBuffer::SharedMemoryBuffer(wl_resource *bufferResource)
 
 }
 
+SharedMemoryBuffer::~SharedMemoryBuffer()
+{
+#if QT_CONFIG(opengl)
+    // The texture can only be deleted with its context current, which is not
+    // the case here: leave it to the orphanage
+    if (m_shmTexture && m_shmTextureContext)
+        WaylandTextureOrphanage::instance()->admitTexture(m_shmTexture, m_shmTextureContext);
+    m_shmTexture = nullptr;
+#endif
+}
+
+void SharedMemoryBuffer::setCommitted(QRegion &damage)
+{
+    ClientBuffer::setCommitted(damage);
+#if QT_CONFIG(opengl)
+    // Damage is accumulated until the next upload, commits may happen
+    // more often than the texture is used
+    m_uploadDamage |= damage;
+#endif
+}
+
 QSize SharedMemoryBuffer::size() const
 {
     if (wl_shm_buffer *shmBuffer = wl_shm_buffer_get(m_buffer)) {
@@ -112,7 +177,6 @@ QImage SharedMemoryBuffer::image() const
         int height = wl_shm_buffer_get_height(shmBuffer);
         int bytesPerLine = wl_shm_buffer_get_stride(shmBuffer);
 
-        // TODO: try to avoid QImage::convertToFormat()
         wl_shm_format shmFormat = wl_shm_format(wl_shm_buffer_get_format(shmBuffer));
         QImage::Format format = WaylandSharedMemoryFormatHelper::fromWaylandShmFormat(shmFormat);
 
@@ -125,6 +189,9 @@ QImage SharedMemoryBuffer::image() const
 }
 
 #if QT_CONFIG(opengl)
+// Above this many rectangles the damage is uploaded as its bounding rectangle
+static const int MaxUploadRects = 16;
+
 QOpenGLTexture *SharedMemoryBuffer::toOpenGlTexture(int plane)
 {
     Q_UNUSED(plane);
@@ -132,25 +199,45 @@ QOpenGLTexture *SharedMemoryBuffer::toOpenGlTexture(int plane)
         if (!m_shmTexture) {
             m_shmTexture = new QOpenGLTexture(QOpenGLTexture::Target2D);
             m_shmTexture->create();
+            m_shmTextureContext = QOpenGLContext::currentContext();
         }
         if (m_textureDirty) {
+            FrameTracer::Scope trace(FrameTracer::ShmTextureUpload,
+                                     m_uploadStatistics ? m_uploadStatistics->surfaceId : 0,
+                                     m_buffer);
+
             m_textureDirty = false;
             m_shmTexture->bind();
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-            // TODO: partial texture upload
-            QImage image = this->image();
-            m_shmTexture->setSize(image.width(), image.height());
-            if (image.hasAlphaChannel()) {
-                m_shmTexture->setFormat(QOpenGLTexture::RGBAFormat);
-                if (image.format() != QImage::Format_RGBA8888)
-                    image = image.convertToFormat(QImage::Format_RGBA8888);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width(), image.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.constBits());
-            } else {
-                m_shmTexture->setFormat(QOpenGLTexture::RGBFormat);
-                if (image.format() != QImage::Format_RGBX8888)
-                    image = image.convertToFormat(QImage::Format_RGBX8888);
-                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0, GL_RGB, GL_UNSIGNED_BYTE, image.constBits());
+
+            const QImage image = this->image();
+            const QRect bufferRect(QPoint(0, 0), image.size());
+            QRegion damage = m_uploadDamage.intersected(bufferRect);
+            m_uploadDamage = QRegion();
+
+            qsizetype uploaded = 0;
+            if (image.size() != m_textureSize || image.format() != m_textureSourceFormat) {
+                // Texture storage has to be (re)allocated
+                m_textureSize = image.size();
+                m_textureSourceFormat = image.format();
+                m_uploader.prepare(QOpenGLContext::currentContext(), image.format());
+                m_shmTexture->setFormat(m_uploader.hasAlphaChannel() ? QOpenGLTexture::RGBAFormat : QOpenGLTexture::RGBFormat);
+                m_shmTexture->setSize(image.width(), image.height());
+                uploaded = m_uploader.upload(image, bufferRect, true);
+                if (m_uploadStatistics)
+                    m_uploadStatistics->fullUploads.fetchAndAddRelaxed(1);
+            } else if (!damage.isEmpty()) {
+                if (damage.rectCount() > MaxUploadRects)
+                    damage = damage.boundingRect();
+                for (const QRect &rect : damage)
+                    uploaded += m_uploader.upload(image, rect, false);
+                if (m_uploadStatistics)
+                    m_uploadStatistics->partialUploads.fetchAndAddRelaxed(1);
             }
+
+            if (m_uploadStatistics)
+                m_uploadStatistics->bytesUploaded.fetchAndAddRelaxed(quint64(uploaded));
+
             //we can release the buffer after uploading, since we have a copy
             if (isCommitted())
                 sendRelease();
@@ -14,17 +14,25 @@
 // We mean it.
 //
 
+#include <QtCore/QHash>
 #include <QtCore/QRect>
 #include <QtGui/qopengl.h>
 #include <QImage>
 #include <QAtomicInt>
+#include <QPointer>
+#include <QSharedPointer>
 
 #include <LiriAuroraCompositor/WaylandSurface>
 #include <LiriAuroraCompositor/WaylandBufferRef>
+#include <LiriAuroraCompositor/private/aurorawlsynctimeline_p.h>
 #include <QtCore/private/qglobal_p.h>
+#if QT_CONFIG(opengl)
+#include <LiriAuroraCompositor/private/aurorawlshmtextureuploader_p.h>
+#endif
 
 #include <wayland-server-core.h>
 
+class QOpenGLContext;
 class QOpenGLTexture;
 
 namespace Aurora {
@@ -34,6 +42,7 @@ namespace Compositor {
 class WaylandClientBufferIntegration;
 class WaylandBufferRef;
 class WaylandCompositor;
+class WaylandSurfacePrivate;
 
 namespace Internal {
 
@@ -43,6 +52,31 @@ struct surface_buffer_destroy_listener
     class ClientBuffer *surfaceBuffer = nullptr;
 };
 
+// Texture upload counters, shared between a surface and the buffers committed to it
+struct LIRIAURORACOMPOSITOR_EXPORT BufferUploadStatistics
+{
+    QAtomicInteger<quint64> bytesUploaded;
+    QAtomicInteger<quint64> fullUploads;
+    QAtomicInteger<quint64> partialUploads;
+    // Textures of imported buffers that were reused or had to be created
+    QAtomicInteger<quint64> importHits;
+    QAtomicInteger<quint64> importMisses;
+    // Identifies the surface in frame traces
+    quint32 surfaceId = 0;
+};
+
+// Memory layout of a buffer that can be imported by other devices
+struct DmabufAttributes
+{
+    QSize size;
+    quint32 drmFormat = 0;
+    quint64 modifier = 0;
+    int planeCount = 0;
+    int fds[4] = { -1, -1, -1, -1 };
+    quint32 offsets[4] = { 0, 0, 0, 0 };
+    quint32 strides[4] = { 0, 0, 0, 0 };
+};
+
 class LIRIAURORACOMPOSITOR_EXPORT ClientBuffer
 {
 public:
@@ -59,12 +93,27 @@ public:
 
     virtual QImage image() const { return QImage(); }
 
+    // Returns false unless the buffer is backed by dmabufs
+    virtual bool dmabufAttributes(DmabufAttributes *attributes) const { Q_UNUSED(attributes); return false; }
+
     inline bool isCommitted() const { return m_committed; }
     virtual void setCommitted(QRegion &damage);
     bool isDestroyed() { return m_destroyed; }
 
+    QSharedPointer<BufferUploadStatistics> uploadStatistics() const { return m_uploadStatistics; }
+    quint32 commitSerial() const { return m_commitSerial; }
+    void setCommitSerial(const QSharedPointer<BufferUploadStatistics> &statistics, quint32 serial);
+
     virtual bool isProtected() { return false; }
 
+    // Points signalled when the buffer is released, for explicitly synchronized surfaces
+    void addReleasePoint(const SyncPoint &point);
+
+    // Calls the callback when the buffer is deleted, on the thread that deletes it,
+    // to free what \a owner imported from it, such as the framebuffer of the screen
+    void setDestroyCallback(const void *owner, std::function<void()> callback);
+    bool hasDestroyCallback(const void *owner) const { return m_destroyCallbacks.contains(owner); }
+
     inline struct ::wl_resource *waylandBufferHandle() const { return m_buffer; }
 
     bool isSharedMemory() const { return wl_shm_buffer_get(m_buffer); }
@@ -80,11 +129,17 @@ protected:
     void ref();
     void deref();
     void sendRelease();
+    void signalReleasePoints();
+    void releaseUnused();
     virtual void setDestroyed();
 
     struct ::wl_resource *m_buffer = nullptr;
     QRegion m_damage;
     bool m_textureDirty = false;
+    QSharedPointer<BufferUploadStatistics> m_uploadStatistics;
+    quint32 m_commitSerial = 0;
+    QList<SyncPoint> m_releasePoints;
+    QHash<const void *, std::function<void()>> m_destroyCallbacks;
 
 private:
     bool m_committed = false;
@@ -93,6 +148,7 @@ private:
     QAtomicInt m_refCount;
 
     friend class Aurora::Compositor::WaylandBufferRef;
+    friend class Aurora::Compositor::WaylandSurfacePrivate;
     friend class BufferManager;
 };
 
@@ -100,16 +156,23 @@ class LIRIAURORACOMPOSITOR_EXPORT SharedMemoryBuffer : public ClientBuffer
 {
 public:
     SharedMemoryBuffer(struct ::wl_resource *bufferResource);
+    ~SharedMemoryBuffer() override;
 
     QSize size() const override;
     WaylandSurface::Origin origin() const  override;
     QImage image() const override;
+    void setCommitted(QRegion &damage) override;
 
 #if QT_CONFIG(opengl)
     QOpenGLTexture *toOpenGlTexture(int plane = 0) override;
 
 private:
     QOpenGLTexture *m_shmTexture = nullptr;
+    QPointer<QOpenGLContext> m_shmTextureContext;
+    ShmTextureUploader m_uploader;
+    QSize m_textureSize;
+    QImage::Format m_textureSourceFormat = QImage::Format_Invalid;
+    QRegion m_uploadDamage;
 #endif
 };
 
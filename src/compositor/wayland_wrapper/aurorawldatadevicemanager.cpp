@@ -10,13 +10,12 @@
 #include "aurorawldatadevice_p.h"
 #include "aurorawldatasource_p.h"
 #include "aurorawldataoffer_p.h"
+#include "aurorawldatatransfer_p.h"
 #include "aurorawaylandmimehelper_p.h"
 
 #include <QtCore/QDebug>
-#include <QtCore/QSocketNotifier>
 #include <fcntl.h>
-#include <QtCore/private/qcore_unix_p.h>
-#include <QtCore/QFile>
+#include <unistd.h>
 
 namespace Aurora {
 
@@ -40,7 +39,7 @@ void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
 
     m_compositorOwnsSelection = false;
 
-    finishReadFromClient();
+    abandonRetainedReads();
 
     m_current_selection_source = source;
     if (source)
@@ -54,7 +53,6 @@ void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
     // explicitly in the compositors.
     if (source && m_compositor->retainedSelectionEnabled()) {
         m_retainedData.clear();
-        m_retainedReadIndex = 0;
         retain();
     }
 }
@@ -62,82 +60,57 @@ void DataDeviceManager::setCurrentSelectionSource(DataSource *source)
 void DataDeviceManager::sourceDestroyed(DataSource *source)
 {
     if (m_current_selection_source == source)
-        finishReadFromClient();
+        abandonRetainedReads();
 }
 
 void DataDeviceManager::retain()
 {
-    QList<QString> offers = m_current_selection_source->mimeTypes();
-    finishReadFromClient();
-    if (m_retainedReadIndex >= offers.size()) {
-        WaylandCompositorPrivate::get(m_compositor)->feedRetainedSelectionData(&m_retainedData);
-        return;
-    }
-    QString mimeType = offers.at(m_retainedReadIndex);
-    m_retainedReadBuf.clear();
-    int fd[2];
-    if (pipe(fd) == -1) {
-        qWarning("Clipboard: Failed to create pipe");
-        return;
-    }
-    fcntl(fd[0], F_SETFL, fcntl(fd[0], F_GETFL, 0) | O_NONBLOCK);
-    m_current_selection_source->send(mimeType, fd[1]);
-    m_retainedReadNotifier = new QSocketNotifier(fd[0], QSocketNotifier::Read, this);
-    connect(m_retainedReadNotifier, &QSocketNotifier::activated, this, &DataDeviceManager::readFromClient);
-}
-
-void DataDeviceManager::finishReadFromClient(bool exhausted)
-{
-    Q_UNUSED(exhausted);
-    if (m_retainedReadNotifier) {
-        if (exhausted) {
-            int fd = m_retainedReadNotifier->socket();
-            delete m_retainedReadNotifier;
-            close(fd);
-        } else {
-            // Do not close the handle or destroy the read notifier here
-            // or else clients may SIGPIPE.
-            m_obsoleteRetainedReadNotifiers.append(m_retainedReadNotifier);
+    abandonRetainedReads();
+
+    // All MIME types are read at the same time, a slow one
+    // doesn't hold back the others
+    const qint64 sizeLimit = m_compositor->retainedSelectionSizeLimit();
+    const QList<QString> offers = m_current_selection_source->mimeTypes();
+    for (const QString &mimeType : offers) {
+        int fd[2];
+        if (pipe2(fd, O_CLOEXEC) == -1) {
+            qWarning("Clipboard: Failed to create pipe");
+            break;
         }
-        m_retainedReadNotifier = nullptr;
+        auto *reader = new DataTransferReader(mimeType, fd[0], sizeLimit, this);
+        connect(reader, &DataTransferReader::finished, this, &DataDeviceManager::retainedReadFinished);
+        m_retainedReaders.append(reader);
+        m_current_selection_source->send(mimeType, fd[1]);
     }
+
+    if (m_retainedReaders.isEmpty())
+        WaylandCompositorPrivate::get(m_compositor)->feedRetainedSelectionData(&m_retainedData);
 }
 
-void DataDeviceManager::readFromClient(int fd)
-{
-    static char buf[4096];
-    int obsCount = m_obsoleteRetainedReadNotifiers.size();
-    for (int i = 0; i < obsCount; ++i) {
-        QSocketNotifier *sn = m_obsoleteRetainedReadNotifiers.at(i);
-        if (sn->socket() == fd) {
-            // Read and drop the data, stopping to read and closing the handle
-            // is not yet safe because that could kill the client with SIGPIPE
-            // when it still tries to write.
-            int n;
-            do {
-                n = QT_READ(fd, buf, sizeof buf);
-            } while (n > 0);
-            if (n != -1 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
-                m_obsoleteRetainedReadNotifiers.removeAt(i);
-                delete sn;
-                close(fd);
-            }
+void DataDeviceManager::abandonRetainedReads()
+{
+    for (DataTransferReader *reader : std::as_const(m_retainedReaders)) {
+        disconnect(reader, nullptr, this, nullptr);
+        reader->abandon();
+    }
+    m_retainedReaders.clear();
+}
+
+void DataDeviceManager::retainedReadFinished()
+{
+    for (DataTransferReader *reader : std::as_const(m_retainedReaders)) {
+        if (!reader->isFinished())
             return;
-        }
     }
-    int n = QT_READ(fd, buf, sizeof buf);
-    if (n <= 0) {
-        if (n != -1 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
-            finishReadFromClient(true);
-            QList<QString> offers = m_current_selection_source->mimeTypes();
-            QString mimeType = offers.at(m_retainedReadIndex);
-            m_retainedData.setData(mimeType, m_retainedReadBuf);
-            ++m_retainedReadIndex;
-            retain();
-        }
-    } else {
-        m_retainedReadBuf.append(buf, n);
+
+    // Keep the order of the offers
+    for (DataTransferReader *reader : std::as_const(m_retainedReaders)) {
+        if (!reader->isDiscarded())
+            m_retainedData.setData(reader->mimeType(), reader->data());
     }
+    abandonRetainedReads();
+
+    WaylandCompositorPrivate::get(m_compositor)->feedRetainedSelectionData(&m_retainedData);
 }
 
 DataSource *DataDeviceManager::currentSelectionSource()
@@ -223,12 +196,14 @@ void DataDeviceManager::comp_receive(wl_client *client, wl_resource *resource, c
     DataDeviceManager *self = static_cast<DataDeviceManager *>(wl_resource_get_user_data(resource));
     //qDebug("client %p wants data for type %s from compositor", client, mime_type);
     QByteArray content = WaylandMimeHelper::getByteArray(&self->m_retainedData, QString::fromLatin1(mime_type));
-    if (!content.isEmpty()) {
-        QFile f;
-        if (f.open(fd, QIODevice::WriteOnly))
-            f.write(content);
+    if (content.isEmpty()) {
+        close(fd);
+        return;
     }
-    close(fd);
+
+    // Written as the client reads, a client that doesn't read
+    // doesn't block the compositor
+    new DataTransferWriter(fd, content, self);
 }
 
 void DataDeviceManager::comp_destroy(wl_client *, wl_resource *)
@@ -23,8 +23,6 @@
 
 #include <LiriAuroraCompositor/private/aurora-server-wayland.h>
 
-class QSocketNotifier;
-
 namespace Aurora {
 
 namespace Compositor {
@@ -33,6 +31,7 @@ namespace Internal {
 
 class DataDevice;
 class DataSource;
+class DataTransferReader;
 
 class DataDeviceManager : public QObject, public PrivateServer::wl_data_device_manager
 {
@@ -56,12 +55,10 @@ protected:
     void data_device_manager_create_data_source(Resource *resource, uint32_t id) override;
     void data_device_manager_get_data_device(Resource *resource, uint32_t id, struct ::wl_resource *seat) override;
 
-private Q_SLOTS:
-    void readFromClient(int fd);
-
 private:
     void retain();
-    void finishReadFromClient(bool exhausted = false);
+    void abandonRetainedReads();
+    void retainedReadFinished();
 
     WaylandCompositor *m_compositor = nullptr;
     QList<DataDevice *> m_data_device_list;
@@ -69,10 +66,7 @@ private:
     DataSource *m_current_selection_source = nullptr;
 
     QMimeData m_retainedData;
-    QSocketNotifier *m_retainedReadNotifier = nullptr;
-    QList<QSocketNotifier *> m_obsoleteRetainedReadNotifiers;
-    int m_retainedReadIndex = 0;
-    QByteArray m_retainedReadBuf;
+    QList<DataTransferReader *> m_retainedReaders;
 
     bool m_compositorOwnsSelection = false;
 
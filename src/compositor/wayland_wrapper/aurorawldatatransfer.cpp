@@ -0,0 +1,194 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QSocketNotifier>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+
+#include "aurorawldatatransfer_p.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+// Pipes hold 64 KiB by default: a bigger buffer means fewer wakeups
+// for large transfers, the kernel caps it to fs.pipe-max-size
+static const int pipeSize = 1024 * 1024;
+
+// Data is read in chunks, up to a limit before letting the event loop run again
+static const qsizetype readChunkSize = 1024 * 1024;
+static const qsizetype maxReadPerActivation = 16 * readChunkSize;
+
+static void growPipe(int fd)
+{
+    // Not a pipe or above the limit, the default size will do
+    fcntl(fd, F_SETPIPE_SZ, pipeSize);
+}
+
+/*
+ * DataTransferReader
+ */
+
+DataTransferReader::DataTransferReader(const QString &mimeType, int fd, qint64 sizeLimit, QObject *parent)
+    : QObject(parent)
+    , m_mimeType(mimeType)
+    , m_fd(fd)
+    , m_sizeLimit(sizeLimit)
+{
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+    growPipe(m_fd);
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &DataTransferReader::readData);
+}
+
+DataTransferReader::~DataTransferReader()
+{
+    delete m_notifier;
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+void DataTransferReader::abandon()
+{
+    m_abandoned = true;
+    m_data = QByteArray();
+
+    if (m_fd < 0)
+        deleteLater();
+}
+
+void DataTransferReader::readData()
+{
+    qsizetype readBytes = 0;
+
+    while (readBytes < maxReadPerActivation) {
+        ssize_t n;
+
+        if (m_abandoned || m_discarded) {
+            char buffer[16384];
+            n = read(m_fd, buffer, sizeof(buffer));
+        } else {
+            // Grow geometrically and read straight into the data
+            const qsizetype offset = m_data.size();
+            if (m_data.capacity() < offset + readChunkSize)
+                m_data.reserve(qMax(m_data.capacity() * 2, offset + readChunkSize));
+            m_data.resize(offset + readChunkSize);
+            n = read(m_fd, m_data.data() + offset, readChunkSize);
+            m_data.resize(offset + qMax<ssize_t>(n, 0));
+        }
+
+        if (n > 0) {
+            readBytes += n;
+            if (!m_abandoned && !m_discarded && m_sizeLimit > 0 && m_data.size() > m_sizeLimit)
+                discard();
+            continue;
+        }
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+
+        if (n < 0)
+            qCWarning(gLcAuroraCompositor, "Clipboard: Failed to read \"%s\": %s",
+                      qPrintable(m_mimeType), strerror(errno));
+
+        // End of data, or the source is gone
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+        close(m_fd);
+        m_fd = -1;
+
+        if (m_abandoned)
+            deleteLater();
+        else if (!m_discarded)
+            finish();
+        return;
+    }
+}
+
+void DataTransferReader::discard()
+{
+    qCDebug(gLcAuroraCompositor, "Clipboard: \"%s\" exceeds %lld bytes, not retained",
+            qPrintable(m_mimeType), static_cast<long long>(m_sizeLimit));
+
+    // Report now, no need to wait until the source is done
+    m_discarded = true;
+    m_data = QByteArray();
+    finish();
+}
+
+void DataTransferReader::finish()
+{
+    m_finished = true;
+    Q_EMIT finished();
+}
+
+/*
+ * DataTransferWriter
+ */
+
+DataTransferWriter::DataTransferWriter(int fd, const QByteArray &data, QObject *parent)
+    : QObject(parent)
+    , m_fd(fd)
+    , m_data(data)
+{
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+    growPipe(m_fd);
+
+    m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Write, this);
+    m_notifier->setEnabled(false);
+    connect(m_notifier, &QSocketNotifier::activated, this, &DataTransferWriter::writeData);
+
+    // Most of the time everything fits in the pipe right away
+    writeData();
+}
+
+DataTransferWriter::~DataTransferWriter()
+{
+    delete m_notifier;
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+void DataTransferWriter::writeData()
+{
+    while (m_offset < m_data.size()) {
+        const ssize_t n = write(m_fd, m_data.constData() + m_offset, m_data.size() - m_offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Wait for the client to read
+                m_notifier->setEnabled(true);
+                return;
+            }
+
+            qCWarning(gLcAuroraCompositor, "Clipboard: Failed to write: %s", strerror(errno));
+            break;
+        }
+
+        m_offset += n;
+    }
+
+    // Done, or the client is gone
+    m_notifier->setEnabled(false);
+    deleteLater();
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_aurorawldatatransfer_p.cpp"
@@ -0,0 +1,98 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+
+class QSocketNotifier;
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+/*
+ * Reads what a data source sends for one MIME type.
+ *
+ * The pipe is drained from the event loop as data arrives, a source
+ * that writes slowly doesn't hold back the compositor.
+ */
+class DataTransferReader : public QObject
+{
+    Q_OBJECT
+public:
+    // Takes ownership of the read end of the pipe, sizeLimit <= 0 means no limit
+    DataTransferReader(const QString &mimeType, int fd, qint64 sizeLimit, QObject *parent = nullptr);
+    ~DataTransferReader();
+
+    QString mimeType() const { return m_mimeType; }
+    QByteArray data() const { return m_data; }
+
+    bool isFinished() const { return m_finished; }
+    // The data was larger than the limit and thrown away
+    bool isDiscarded() const { return m_discarded; }
+
+    // Data is no longer needed: the pipe is drained until the source is
+    // done writing, closing it earlier would kill the source with SIGPIPE
+    void abandon();
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    void readData();
+    void discard();
+    void finish();
+
+    QString m_mimeType;
+    int m_fd = -1;
+    qint64 m_sizeLimit = 0;
+    QSocketNotifier *m_notifier = nullptr;
+    QByteArray m_data;
+    bool m_finished = false;
+    bool m_discarded = false;
+    bool m_abandoned = false;
+};
+
+/*
+ * Writes data to a client pipe without blocking.
+ *
+ * Whatever the pipe can't take is written when the client reads,
+ * the writer deletes itself once done.
+ */
+class DataTransferWriter : public QObject
+{
+    Q_OBJECT
+public:
+    // Takes ownership of the write end of the pipe
+    DataTransferWriter(int fd, const QByteArray &data, QObject *parent = nullptr);
+    ~DataTransferWriter();
+
+private:
+    void writeData();
+
+    int m_fd = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QByteArray m_data;
+    qsizetype m_offset = 0;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -0,0 +1,315 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "aurorawlshmtextureuploader_p.h"
+
+#include <QtCore/private/qsimd_p.h>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QPainter>
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+#ifndef GL_UNSIGNED_SHORT_5_6_5
+#define GL_UNSIGNED_SHORT_5_6_5 0x8363
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_R
+#define GL_TEXTURE_SWIZZLE_R 0x8E42
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_B
+#define GL_TEXTURE_SWIZZLE_B 0x8E44
+#endif
+#ifndef GL_TEXTURE_SWIZZLE_A
+#define GL_TEXTURE_SWIZZLE_A 0x8E45
+#endif
+#ifndef GL_RED
+#define GL_RED 0x1903
+#endif
+#ifndef GL_BLUE
+#define GL_BLUE 0x1905
+#endif
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+static inline quint32 convertRgb32Pixel(quint32 p, bool swapRedBlue, quint32 alpha)
+{
+    if (swapRedBlue)
+        p = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+    return p | alpha;
+}
+
+void convertRgb32PixelsScalar(const uchar *src, qsizetype srcBytesPerLine,
+                              uchar *dst, qsizetype dstBytesPerLine,
+                              int width, int height,
+                              bool swapRedBlue, bool forceOpaque)
+{
+    const quint32 alpha = forceOpaque ? 0xff000000 : 0;
+
+    for (int y = 0; y < height; ++y) {
+        const quint32 *s = reinterpret_cast<const quint32 *>(src + y * srcBytesPerLine);
+        quint32 *d = reinterpret_cast<quint32 *>(dst + y * dstBytesPerLine);
+        for (int x = 0; x < width; ++x)
+            d[x] = convertRgb32Pixel(s[x], swapRedBlue, alpha);
+    }
+}
+
+void convertRgb32Pixels(const uchar *src, qsizetype srcBytesPerLine,
+                        uchar *dst, qsizetype dstBytesPerLine,
+                        int width, int height,
+                        bool swapRedBlue, bool forceOpaque)
+{
+    // Alpha is the most significant byte in both layouts
+    const quint32 alpha = forceOpaque ? 0xff000000 : 0;
+
+    for (int y = 0; y < height; ++y) {
+        const quint32 *s = reinterpret_cast<const quint32 *>(src + y * srcBytesPerLine);
+        quint32 *d = reinterpret_cast<quint32 *>(dst + y * dstBytesPerLine);
+        int x = 0;
+
+#if defined(__SSE2__)
+        const __m128i agMask = _mm_set1_epi32(int(0xff00ff00));
+        const __m128i lowMask = _mm_set1_epi32(0xff);
+        const __m128i alphaMask = _mm_set1_epi32(int(alpha));
+        for (; x + 4 <= width; x += 4) {
+            __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + x));
+            if (swapRedBlue) {
+                const __m128i red = _mm_and_si128(_mm_srli_epi32(p, 16), lowMask);
+                const __m128i blue = _mm_slli_epi32(_mm_and_si128(p, lowMask), 16);
+                p = _mm_or_si128(_mm_and_si128(p, agMask), _mm_or_si128(red, blue));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(d + x), _mm_or_si128(p, alphaMask));
+        }
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+        const uint32x4_t agMask = vdupq_n_u32(0xff00ff00);
+        const uint32x4_t lowMask = vdupq_n_u32(0xff);
+        const uint32x4_t alphaMask = vdupq_n_u32(alpha);
+        for (; x + 4 <= width; x += 4) {
+            uint32x4_t p = vld1q_u32(s + x);
+            if (swapRedBlue) {
+                const uint32x4_t red = vandq_u32(vshrq_n_u32(p, 16), lowMask);
+                const uint32x4_t blue = vshlq_n_u32(vandq_u32(p, lowMask), 16);
+                p = vorrq_u32(vandq_u32(p, agMask), vorrq_u32(red, blue));
+            }
+            vst1q_u32(d + x, vorrq_u32(p, alphaMask));
+        }
+#endif
+
+        for (; x < width; ++x)
+            d[x] = convertRgb32Pixel(s[x], swapRedBlue, alpha);
+    }
+}
+
+// One buffer per render thread, reused by all uploads
+struct StagingBuffer
+{
+    QByteArray data;
+    // Frames since an upload needed more than the retained size
+    int idleFrames = 0;
+};
+static thread_local StagingBuffer s_stagingBuffer;
+
+// Larger buffers are freed once no upload needed them for a while,
+// a 1080p RGBA frame fits
+static const qsizetype MaxRetainedStagingSize = 1920 * 1080 * 4;
+static const int StagingBufferTrimFrames = 60;
+
+static uchar *stagingBuffer(qsizetype size)
+{
+    if (size > MaxRetainedStagingSize)
+        s_stagingBuffer.idleFrames = 0;
+    if (s_stagingBuffer.data.size() < size)
+        s_stagingBuffer.data.resize(size);
+    return reinterpret_cast<uchar *>(s_stagingBuffer.data.data());
+}
+
+static inline qsizetype alignedBytesPerLine(qsizetype bytes, int alignment)
+{
+    return (bytes + alignment - 1) & ~qsizetype(alignment - 1);
+}
+
+void ShmTextureUploader::prepare(QOpenGLContext *context, QImage::Format sourceFormat)
+{
+    const bool isGles = context->isOpenGLES();
+    const auto version = context->format().version();
+    const bool hasBgra = !isGles || context->hasExtension(QByteArrayLiteral("GL_EXT_texture_format_BGRA8888"));
+    const bool hasSwizzle = isGles
+            ? version >= qMakePair(3, 0)
+            : version >= qMakePair(3, 3) || context->hasExtension(QByteArrayLiteral("GL_ARB_texture_swizzle"));
+
+    m_canUseRowLength = !isGles || version >= qMakePair(3, 0)
+            || context->hasExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
+    m_sourceFormat = sourceFormat;
+    m_hasAlpha = QImage::toPixelFormat(sourceFormat).alphaUsage() == QPixelFormat::UsesAlpha;
+    m_stagingFormat = m_hasAlpha ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGBX8888;
+    m_path = ConvertedUpload;
+    m_internalFormat = GL_RGBA;
+    m_format = GL_RGBA;
+    m_type = GL_UNSIGNED_BYTE;
+    m_bytesPerPixel = 4;
+
+    // Opaque formats may carry anything in the padding byte
+    const GLenum alpha = m_hasAlpha ? GL_ALPHA : GL_ONE;
+    bool swapRedBlue = false;
+
+    switch (sourceFormat) {
+    case QImage::Format_RGBA8888_Premultiplied:
+    case QImage::Format_RGBA8888:
+        m_path = NativeUpload;
+        break;
+    case QImage::Format_RGBX8888:
+        if (hasSwizzle)
+            m_path = SwizzledUpload;
+        break;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+        if (hasBgra && (m_hasAlpha || hasSwizzle)) {
+            m_path = m_hasAlpha ? NativeUpload : SwizzledUpload;
+            m_internalFormat = isGles ? GL_BGRA : GL_RGBA;
+            m_format = GL_BGRA;
+        } else if (hasSwizzle) {
+            m_path = SwizzledUpload;
+            swapRedBlue = true;
+        }
+        break;
+#endif
+    case QImage::Format_RGB16:
+        m_path = NativeUpload;
+        m_internalFormat = GL_RGB;
+        m_format = GL_RGB;
+        m_type = GL_UNSIGNED_SHORT_5_6_5;
+        m_bytesPerPixel = 2;
+        break;
+    default:
+        break;
+    }
+
+    // Swizzling is part of the texture state, always set it when possible
+    // because the texture might have been used with another format
+    if (hasSwizzle) {
+        if (m_path == SwizzledUpload)
+            setSwizzle(swapRedBlue ? GL_BLUE : GL_RED, swapRedBlue ? GL_RED : GL_BLUE, alpha);
+        else
+            setSwizzle(GL_RED, GL_BLUE, GL_ALPHA);
+    }
+}
+
+void ShmTextureUploader::setSwizzle(GLenum red, GLenum blue, GLenum alpha)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, red);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, blue);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, alpha);
+}
+
+const uchar *ShmTextureUploader::convert(const QImage &image, const QRect &rect, qsizetype *bytesPerLine)
+{
+    const qsizetype dstBytesPerLine = qsizetype(rect.width()) * 4;
+    uchar *staging = stagingBuffer(dstBytesPerLine * rect.height());
+    const uchar *src = image.constBits() + rect.y() * image.bytesPerLine() + rect.x() * (image.depth() / 8);
+
+    switch (m_sourceFormat) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    case QImage::Format_ARGB32_Premultiplied:
+    case QImage::Format_RGB32:
+        convertRgb32Pixels(src, image.bytesPerLine(), staging, dstBytesPerLine,
+                           rect.width(), rect.height(), true, !m_hasAlpha);
+        break;
+#endif
+    case QImage::Format_RGBX8888:
+        convertRgb32Pixels(src, image.bytesPerLine(), staging, dstBytesPerLine,
+                           rect.width(), rect.height(), false, true);
+        break;
+    default: {
+        // Let Qt pick its optimized routines to convert straight into the staging buffer
+        const QImage area(src, rect.width(), rect.height(), image.bytesPerLine(), image.format());
+        QImage target(staging, rect.width(), rect.height(), dstBytesPerLine, m_stagingFormat);
+        QPainter painter(&target);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(0, 0, area);
+        break;
+    }
+    }
+
+    *bytesPerLine = dstBytesPerLine;
+    return staging;
+}
+
+/*
+    Uploads the \a rect area of \a image to the currently bound texture, allocating
+    the texture storage when \a allocate is true. Returns the number of bytes uploaded.
+*/
+qsizetype ShmTextureUploader::upload(const QImage &image, const QRect &rect, bool allocate)
+{
+    const uchar *pixels = nullptr;
+    qsizetype bytesPerLine = 0;
+
+    if (m_path == ConvertedUpload) {
+        pixels = convert(image, rect, &bytesPerLine);
+    } else {
+        pixels = image.constBits() + rect.y() * image.bytesPerLine() + rect.x() * m_bytesPerPixel;
+        bytesPerLine = image.bytesPerLine();
+    }
+
+    int alignment = bytesPerLine % 4 == 0 ? 4 : (bytesPerLine % 2 == 0 ? 2 : 1);
+    const qsizetype packedBytesPerLine = qsizetype(rect.width()) * m_bytesPerPixel;
+    bool needsRowLength = alignedBytesPerLine(packedBytesPerLine, alignment) != bytesPerLine;
+
+    if (needsRowLength && !m_canUseRowLength) {
+        // Rows of the area are not contiguous in client memory, repack them
+        const qsizetype stagingBytesPerLine = alignedBytesPerLine(packedBytesPerLine, 4);
+        uchar *staging = stagingBuffer(stagingBytesPerLine * rect.height());
+        for (int y = 0; y < rect.height(); ++y)
+            memcpy(staging + y * stagingBytesPerLine, pixels + y * bytesPerLine, packedBytesPerLine);
+        pixels = staging;
+        bytesPerLine = stagingBytesPerLine;
+        alignment = 4;
+        needsRowLength = false;
+    }
+
+    if (alignment != 4)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    if (needsRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bytesPerLine / m_bytesPerPixel);
+
+    if (allocate)
+        glTexImage2D(GL_TEXTURE_2D, 0, m_internalFormat, rect.width(), rect.height(), 0, m_format, m_type, pixels);
+    else
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x(), rect.y(), rect.width(), rect.height(), m_format, m_type, pixels);
+
+    if (needsRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    if (alignment != 4)
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    return packedBytesPerLine * rect.height();
+}
+
+/*
+    Frees the staging buffer of the calling thread when it's larger than
+    a 1080p frame and no upload needed that much for a few frames, so an
+    occasional large upload doesn't hold on to the memory. Called on the
+    render thread once per frame.
+*/
+void ShmTextureUploader::trimStagingBuffer()
+{
+    if (s_stagingBuffer.data.capacity() <= MaxRetainedStagingSize)
+        return;
+
+    if (++s_stagingBuffer.idleFrames >= StagingBufferTrimFrames) {
+        s_stagingBuffer.data = QByteArray();
+        s_stagingBuffer.idleFrames = 0;
+    }
+}
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
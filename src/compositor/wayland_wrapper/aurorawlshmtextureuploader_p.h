@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QRect>
+#include <QtGui/QImage>
+#include <QtGui/qopengl.h>
+
+#include <LiriAuroraCompositor/liriauroracompositorglobal.h>
+
+class QOpenGLContext;
+
+namespace Aurora {
+
+namespace Compositor {
+
+namespace Internal {
+
+/*
+    Converts 32-bit pixels from the ARGB32 memory layout (BGRA bytes on little
+    endian) to RGBA8888 when \a swapRedBlue is true, optionally forcing alpha to
+    opaque. Source and destination can have different strides.
+*/
+LIRIAURORACOMPOSITOR_EXPORT void convertRgb32Pixels(const uchar *src, qsizetype srcBytesPerLine,
+                                                    uchar *dst, qsizetype dstBytesPerLine,
+                                                    int width, int height,
+                                                    bool swapRedBlue, bool forceOpaque);
+
+// Converts one pixel at a time, what convertRgb32Pixels() is checked against
+LIRIAURORACOMPOSITOR_EXPORT void convertRgb32PixelsScalar(const uchar *src, qsizetype srcBytesPerLine,
+                                                          uchar *dst, qsizetype dstBytesPerLine,
+                                                          int width, int height,
+                                                          bool swapRedBlue, bool forceOpaque);
+
+class LIRIAURORACOMPOSITOR_EXPORT ShmTextureUploader
+{
+public:
+    enum UploadPath {
+        // Client memory is uploaded as is
+        NativeUpload,
+        // Client memory is uploaded as is and channels are swizzled by the sampler
+        SwizzledUpload,
+        // Pixels are converted into a staging buffer before the upload
+        ConvertedUpload
+    };
+
+    void prepare(QOpenGLContext *context, QImage::Format sourceFormat);
+
+    UploadPath uploadPath() const { return m_path; }
+    bool hasAlphaChannel() const { return m_hasAlpha; }
+
+    qsizetype upload(const QImage &image, const QRect &rect, bool allocate);
+
+    static void trimStagingBuffer();
+
+private:
+    void setSwizzle(GLenum red, GLenum blue, GLenum alpha);
+    const uchar *convert(const QImage &image, const QRect &rect, qsizetype *bytesPerLine);
+
+    UploadPath m_path = ConvertedUpload;
+    QImage::Format m_sourceFormat = QImage::Format_Invalid;
+    QImage::Format m_stagingFormat = QImage::Format_Invalid;
+    GLint m_internalFormat = 0;
+    GLenum m_format = 0;
+    GLenum m_type = 0;
+    int m_bytesPerPixel = 4;
+    bool m_hasAlpha = false;
+    bool m_canUseRowLength = false;
+};
+
+} // namespace Internal
+
+} // namespace Compositor
+
+} // namespace Aurora
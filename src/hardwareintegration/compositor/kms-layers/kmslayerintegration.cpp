@@ -0,0 +1,236 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/private/qquickitem_p.h>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/private/aurorawaylandbufferref_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandquickhardwarelayer_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
+#include <LiriAuroraCompositor/private/aurorawlclientbuffer_p.h>
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+
+#include "kmslayerintegration.h"
+
+using namespace Aurora::PlatformSupport;
+
+namespace Aurora {
+
+namespace Compositor {
+
+KmsLayerIntegration::KmsLayerIntegration(QObject *parent)
+    : Internal::HardwareLayerIntegration(parent)
+    , m_enabled(QGuiApplication::platformFunction(EglFSFunctions::setOverlayLayersIdentifier()) != nullptr)
+{
+    if (!m_enabled)
+        qCWarning(gLcAuroraCompositorHardwareIntegration,
+                  "The platform plugin cannot use overlay planes, hardware layers are composited");
+}
+
+KmsLayerIntegration::~KmsLayerIntegration()
+{
+    qDeleteAll(m_layers);
+}
+
+void KmsLayerIntegration::add(WaylandQuickHardwareLayer *layer)
+{
+    auto *entry = new Layer;
+    entry->layer = layer;
+    entry->item = layer->waylandItem();
+    m_layers.append(entry);
+
+    if (!m_enabled || !entry->item)
+        return;
+
+    if (QQuickWindow *window = entry->item->window())
+        watchWindow(window);
+    connect(entry->item, &QQuickItem::windowChanged, this, [this](QQuickWindow *window) {
+        if (window)
+            watchWindow(window);
+    });
+}
+
+void KmsLayerIntegration::remove(WaylandQuickHardwareLayer *layer)
+{
+    for (auto it = m_layers.begin(); it != m_layers.end(); ++it) {
+        Layer *entry = *it;
+        if (entry->layer != layer)
+            continue;
+
+        // The plane is turned off with the next frame
+        if (entry->item) {
+            disconnect(entry->item, &QQuickItem::windowChanged, this, nullptr);
+            setOnPlane(entry, false);
+            if (WaylandSurface *surface = entry->item->surface())
+                WaylandSurfacePrivate::get(surface)->setScanoutHint(Internal::ScanoutHint::OverlayPlane,
+                                                                    Internal::ScanoutHint());
+        }
+
+        m_layers.erase(it);
+        delete entry;
+        return;
+    }
+}
+
+void KmsLayerIntegration::watchWindow(QQuickWindow *window)
+{
+    for (const Window &w : std::as_const(m_windows)) {
+        if (w.window == window)
+            return;
+    }
+
+    Window w;
+    w.window = window;
+    m_windows.append(w);
+
+    // Emitted on the GUI thread after polishing and right before the
+    // scene graph is synchronized, so the paint state of the items
+    // makes it into the same frame
+    connect(window, &QQuickWindow::afterAnimating, this, [this, window]() {
+        assignPlanes(window);
+    });
+    connect(window, &QObject::destroyed, this, [this, window]() {
+        m_windows.removeIf([window](const Window &w) {
+            return w.window.isNull() || w.window == window;
+        });
+    });
+}
+
+void KmsLayerIntegration::assignPlanes(QQuickWindow *window)
+{
+    auto windowIt = std::find_if(m_windows.begin(), m_windows.end(), [window](const Window &w) {
+        return w.window == window;
+    });
+    if (windowIt == m_windows.end() || !window->screen())
+        return;
+
+    // Planes don't change while the screen is around
+    if (windowIt->hintScreen != window->screen()) {
+        const ScanoutFormats formats = EglFSFunctions::scanoutFormats(window->screen());
+        windowIt->hintScreen = window->screen();
+        windowIt->hint.device = formats.device;
+        windowIt->hint.formats = formats.overlayFormats;
+    }
+
+    QVector<OverlayLayer> overlays;
+    QVector<Layer *> candidates;
+
+    for (Layer *layer : std::as_const(m_layers)) {
+        if (!layer->item || layer->item->window() != window)
+            continue;
+
+        // Clients of layers that could go on a plane are told which
+        // formats the planes take, whatever buffer they attached
+        const bool candidate = isCandidate(layer);
+        if (WaylandSurface *surface = layer->item->surface())
+            WaylandSurfacePrivate::get(surface)->setScanoutHint(Internal::ScanoutHint::OverlayPlane,
+                                                                candidate ? windowIt->hint : Internal::ScanoutHint());
+
+        OverlayLayer overlay;
+        if (candidate && prepareLayer(layer, &overlay)) {
+            overlays.append(overlay);
+            candidates.append(layer);
+        } else {
+            setOnPlane(layer, false);
+            layer->buffers[layer->nextBuffer] = WaylandBufferRef();
+            layer->nextBuffer = (layer->nextBuffer + 1) % HeldBuffers;
+        }
+    }
+
+    // Planes used by the previous frame have to be turned off
+    if (overlays.isEmpty() && !windowIt->hasPlanes)
+        return;
+
+    EglFSFunctions::setOverlayLayers(window->screen(), overlays);
+
+    windowIt->hasPlanes = false;
+    for (int i = 0; i < candidates.size(); ++i) {
+        Layer *layer = candidates.at(i);
+        const bool assigned = overlays.at(i).assigned;
+
+        setOnPlane(layer, assigned);
+        windowIt->hasPlanes |= assigned;
+
+        WaylandSurface *surface = layer->item->surface();
+        layer->buffers[layer->nextBuffer] = assigned
+                ? WaylandSurfacePrivate::get(surface)->bufferRef : WaylandBufferRef();
+        layer->nextBuffer = (layer->nextBuffer + 1) % HeldBuffers;
+    }
+}
+
+bool KmsLayerIntegration::isCandidate(Layer *layer) const
+{
+    WaylandQuickItem *item = layer->item;
+
+    // Layers below the scene are not supported
+    if (!item->surface() || layer->layer->stackingLevel() < 0)
+        return false;
+
+    // Planes have no opacity, translucent items are blended by the scene graph
+    for (QQuickItem *p = item; p; p = p->parentItem()) {
+        if (!p->isVisible() || p->opacity() < 1.0)
+            return false;
+    }
+
+    const QTransform transform = QQuickItemPrivate::get(item)->itemToWindowTransform();
+    return transform.type() <= QTransform::TxScale && transform.m11() > 0 && transform.m22() > 0;
+}
+
+bool KmsLayerIntegration::prepareLayer(Layer *layer, OverlayLayer *overlay) const
+{
+    WaylandQuickItem *item = layer->item;
+    WaylandSurface *surface = item->surface();
+    QQuickWindow *window = item->window();
+
+    const WaylandBufferRef &buffer = WaylandSurfacePrivate::get(surface)->bufferRef;
+    Internal::ClientBuffer *clientBuffer = WaylandBufferRefPrivate::buffer(buffer);
+    if (!clientBuffer || clientBuffer->isDestroyed() || buffer.isSharedMemory())
+        return false;
+    if (buffer.origin() != WaylandSurface::OriginTopLeft)
+        return false;
+
+    Internal::DmabufAttributes attributes;
+    if (!clientBuffer->dmabufAttributes(&attributes))
+        return false;
+
+    const QTransform transform = QQuickItemPrivate::get(item)->itemToWindowTransform();
+    const qreal dpr = window->effectiveDevicePixelRatio();
+    const QPointF offset = window->position() - window->screen()->geometry().topLeft();
+    const QRectF rect = transform.mapRect(QRectF(0, 0, item->width(), item->height())).translated(offset);
+    const QRectF source(surface->sourceGeometry().topLeft() * surface->bufferScale(),
+                        surface->sourceGeometry().size() * surface->bufferScale());
+
+    overlay->destinationRect = QRect(qRound(rect.x() * dpr), qRound(rect.y() * dpr),
+                                     qRound(rect.width() * dpr), qRound(rect.height() * dpr));
+    overlay->sourceRect = source.toRect();
+    overlay->stackingLevel = layer->layer->stackingLevel();
+    overlay->buffer.size = attributes.size;
+    overlay->buffer.drmFormat = attributes.drmFormat;
+    overlay->buffer.modifier = attributes.modifier;
+    overlay->buffer.planeCount = attributes.planeCount;
+    for (int i = 0; i < attributes.planeCount; ++i) {
+        overlay->buffer.fds[i] = attributes.fds[i];
+        overlay->buffer.offsets[i] = attributes.offsets[i];
+        overlay->buffer.strides[i] = attributes.strides[i];
+    }
+
+    return true;
+}
+
+void KmsLayerIntegration::setOnPlane(Layer *layer, bool onPlane)
+{
+    if (layer->onPlane == onPlane)
+        return;
+
+    layer->onPlane = onPlane;
+    layer->layer->setSceneGraphPainting(!onPlane);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "moc_kmslayerintegration.cpp"
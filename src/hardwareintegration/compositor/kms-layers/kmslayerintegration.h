@@ -0,0 +1,78 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QtCore/QList>
+#include <QtCore/QPointer>
+
+#include <LiriAuroraCompositor/WaylandBufferRef>
+#include <LiriAuroraCompositor/WaylandQuickItem>
+#include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
+#include <LiriAuroraCompositor/private/aurorawlhardwarelayerintegration_p.h>
+
+class QQuickWindow;
+class QScreen;
+
+namespace Aurora {
+
+namespace PlatformSupport {
+class OverlayLayer;
+}
+
+namespace Compositor {
+
+/*
+    Puts the surfaces of hardware layers on KMS overlay planes on top of the
+    composited frame. Each frame the layers are tested with the current
+    configuration of the screen and those that don't fit any plane are
+    composited by the scene graph as usual.
+*/
+class KmsLayerIntegration : public Internal::HardwareLayerIntegration
+{
+    Q_OBJECT
+public:
+    explicit KmsLayerIntegration(QObject *parent = nullptr);
+    ~KmsLayerIntegration() override;
+
+    void add(WaylandQuickHardwareLayer *layer) override;
+    void remove(WaylandQuickHardwareLayer *layer) override;
+
+private:
+    friend class tst_KmsLayerIntegration;
+
+    // Frames that can be queued or on screen, plus the one being prepared
+    static const int HeldBuffers = 3;
+
+    struct Layer {
+        WaylandQuickHardwareLayer *layer = nullptr;
+        // Cleared before the layer, that is usually a child of the item
+        QPointer<WaylandQuickItem> item;
+        bool onPlane = false;
+        // Buffers of the last frames, so that clients don't
+        // draw into a buffer that is scanned out
+        WaylandBufferRef buffers[HeldBuffers];
+        int nextBuffer = 0;
+    };
+
+    void watchWindow(QQuickWindow *window);
+    void assignPlanes(QQuickWindow *window);
+    bool isCandidate(Layer *layer) const;
+    bool prepareLayer(Layer *layer, PlatformSupport::OverlayLayer *overlay) const;
+    void setOnPlane(Layer *layer, bool onPlane);
+
+    bool m_enabled = false;
+    QList<Layer *> m_layers;
+    struct Window {
+        QPointer<QQuickWindow> window;
+        bool hasPlanes = false;
+        // Formats of the overlay planes of the screen the hint was made for
+        QPointer<QScreen> hintScreen;
+        Internal::ScanoutHint hint;
+    };
+    QList<Window> m_windows;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
@@ -5,30 +5,164 @@
 #include "linuxdmabufclientbufferintegration.h"
 
 #include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
 #include <LiriAuroraCompositor/private/aurorawltextureorphanage_p.h>
 
 #include <drm_fourcc.h>
 #include <drm_mode.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 namespace Aurora {
 
 namespace Compositor {
 
-LinuxDmabuf::LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration)
-    : zwp_linux_dmabuf_v1(display, 3 /*version*/)
+LinuxDmabuf::LinuxDmabuf(wl_display *display, int version, LinuxDmabufClientBufferIntegration *clientBufferIntegration)
+    : zwp_linux_dmabuf_v1(display, version)
     , m_clientBufferIntegration(clientBufferIntegration)
 {
 }
 
+LinuxDmabuf::~LinuxDmabuf()
+{
+    for (LinuxDmabufFeedback *feedback : std::as_const(m_surfaceFeedbacks))
+        feedback->m_linuxDmabuf = nullptr;
+
+    if (m_tableFd != -1)
+        close(m_tableFd);
+}
+
 void LinuxDmabuf::setSupportedModifiers(const QHash<uint32_t, QList<uint64_t>> &modifiers)
 {
     Q_ASSERT(resourceMap().isEmpty());
     m_modifiers = modifiers;
+    createFormatTable();
+}
+
+void LinuxDmabuf::createFormatTable()
+{
+    m_table.clear();
+    for (auto it = m_modifiers.constBegin(); it != m_modifiers.constEnd(); ++it) {
+        // DRM_FORMAT_MOD_INVALID when no modifiers are supported for a format
+        const QList<uint64_t> modifiers = it.value().isEmpty() ? QList<uint64_t>{ DRM_FORMAT_MOD_INVALID } : it.value();
+        for (uint64_t modifier : modifiers)
+            m_table.append({ it.key(), 0, modifier });
+    }
+
+    // Tranches refer to entries with 16-bit indices
+    if (m_table.size() > std::numeric_limits<uint16_t>::max() + 1)
+        m_table.resize(std::numeric_limits<uint16_t>::max() + 1);
+
+    if (m_tableFd != -1) {
+        close(m_tableFd);
+        m_tableFd = -1;
+    }
+
+    const size_t size = m_table.size() * sizeof(TableEntry);
+    int fd = memfd_create("aurora-dmabuf-format-table", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd == -1) {
+        qCWarning(gLcAuroraCompositorHardwareIntegration, "Failed to create the dmabuf format table: %s",
+                  strerror(errno));
+        return;
+    }
+
+    if (ftruncate(fd, size) == -1 || pwrite(fd, m_table.constData(), size, 0) != ssize_t(size)
+            || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == -1) {
+        qCWarning(gLcAuroraCompositorHardwareIntegration, "Failed to write the dmabuf format table: %s",
+                  strerror(errno));
+        close(fd);
+        return;
+    }
+
+    m_tableFd = fd;
+}
+
+static void sendDevice(void (LinuxDmabufFeedback::*sendFunc)(struct ::wl_resource *, const QByteArray &),
+                       LinuxDmabufFeedback *feedback, dev_t device)
+{
+    (feedback->*sendFunc)(feedback->resource()->handle,
+                          QByteArray(reinterpret_cast<const char *>(&device), sizeof(device)));
+}
+
+// A format without modifiers in the hint supports implicit and linear layouts
+static bool hintSupports(const Internal::ScanoutHint &hint, uint32_t format, uint64_t modifier)
+{
+    auto it = hint.formats.constFind(format);
+    if (it == hint.formats.constEnd())
+        return false;
+    if (modifier == DRM_FORMAT_MOD_INVALID)
+        return true;
+    if (it->isEmpty())
+        return modifier == DRM_FORMAT_MOD_LINEAR;
+    return it->contains(modifier);
+}
+
+void LinuxDmabuf::sendFeedback(LinuxDmabufFeedback *feedback)
+{
+    sendDevice(&LinuxDmabufFeedback::send_main_device, feedback, m_mainDevice);
+
+    if (m_tableFd != -1) {
+        feedback->send_format_table(m_tableFd, m_table.size() * sizeof(TableEntry));
+
+        // Buffers that a plane can scan out are preferred for surfaces
+        // that would be put on that plane
+        const Internal::ScanoutHint hint = feedback->surface()
+                ? WaylandSurfacePrivate::get(feedback->surface())->scanoutHint()
+                : Internal::ScanoutHint();
+        if (!hint.isNull()) {
+            QByteArray indices;
+            for (int i = 0; i < m_table.size(); ++i) {
+                const TableEntry &entry = m_table.at(i);
+                if (hintSupports(hint, entry.format, entry.modifier)) {
+                    const uint16_t index = i;
+                    indices.append(reinterpret_cast<const char *>(&index), sizeof(index));
+                }
+            }
+
+            if (!indices.isEmpty()) {
+                sendDevice(&LinuxDmabufFeedback::send_tranche_target_device, feedback, hint.device);
+                feedback->send_tranche_formats(indices);
+                feedback->send_tranche_flags(ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT);
+                feedback->send_tranche_done();
+            }
+        }
+
+        QByteArray indices(m_table.size() * sizeof(uint16_t), Qt::Uninitialized);
+        auto *data = reinterpret_cast<uint16_t *>(indices.data());
+        for (int i = 0; i < m_table.size(); ++i)
+            data[i] = i;
+
+        sendDevice(&LinuxDmabufFeedback::send_tranche_target_device, feedback, m_mainDevice);
+        feedback->send_tranche_formats(indices);
+        feedback->send_tranche_flags(0);
+        feedback->send_tranche_done();
+    }
+
+    feedback->send_done();
+}
+
+void LinuxDmabuf::sendSurfaceFeedback(WaylandSurface *surface)
+{
+    const auto feedbacks = m_surfaceFeedbacks.values(surface);
+    for (LinuxDmabufFeedback *feedback : feedbacks)
+        sendFeedback(feedback);
+}
+
+void LinuxDmabuf::removeFeedback(WaylandSurface *surface, LinuxDmabufFeedback *feedback)
+{
+    m_surfaceFeedbacks.remove(surface, feedback);
 }
 
 void LinuxDmabuf::zwp_linux_dmabuf_v1_bind_resource(Resource *resource)
 {
+    // Version 4 clients get formats and modifiers with feedback objects
+    if (resource->version() >= ZWP_LINUX_DMABUF_V1_GET_DEFAULT_FEEDBACK_SINCE_VERSION)
+        return;
+
     for (auto it = m_modifiers.constBegin(); it != m_modifiers.constEnd(); ++it) {
         auto format = it.key();
         auto modifiers = it.value();
@@ -47,6 +181,25 @@ void LinuxDmabuf::zwp_linux_dmabuf_v1_bind_resource(Resource *resource)
     }
 }
 
+void LinuxDmabuf::zwp_linux_dmabuf_v1_get_default_feedback(Resource *resource, uint32_t id)
+{
+    wl_resource *r = wl_resource_create(resource->client(), &zwp_linux_dmabuf_feedback_v1_interface,
+                                        wl_resource_get_version(resource->handle), id);
+    auto *feedback = new LinuxDmabufFeedback(this, nullptr, r); // deleted by the client, or when it disconnects
+    sendFeedback(feedback);
+}
+
+void LinuxDmabuf::zwp_linux_dmabuf_v1_get_surface_feedback(Resource *resource, uint32_t id, struct ::wl_resource *surface)
+{
+    wl_resource *r = wl_resource_create(resource->client(), &zwp_linux_dmabuf_feedback_v1_interface,
+                                        wl_resource_get_version(resource->handle), id);
+    auto *waylandSurface = WaylandSurface::fromResource(surface);
+    auto *feedback = new LinuxDmabufFeedback(this, waylandSurface, r); // deleted by the client, or when it disconnects
+    if (waylandSurface)
+        m_surfaceFeedbacks.insert(waylandSurface, feedback);
+    sendFeedback(feedback);
+}
+
 void LinuxDmabuf::zwp_linux_dmabuf_v1_create_params(Resource *resource, uint32_t params_id)
 {
     wl_resource *r = wl_resource_create(resource->client(), &zwp_linux_buffer_params_v1_interface,
@@ -54,6 +207,39 @@ void LinuxDmabuf::zwp_linux_dmabuf_v1_create_params(Resource *resource, uint32_t
     new LinuxDmabufParams(m_clientBufferIntegration, r); // deleted by the client, or when it disconnects
 }
 
+LinuxDmabufFeedback::LinuxDmabufFeedback(LinuxDmabuf *linuxDmabuf, WaylandSurface *surface, wl_resource *resource)
+    : zwp_linux_dmabuf_feedback_v1(resource)
+    , m_linuxDmabuf(linuxDmabuf)
+    , m_surface(surface)
+{
+    // The object becomes inert with the surface
+    if (surface) {
+        m_surfaceDestroyedConnection = QObject::connect(surface, &QObject::destroyed, [this, surface]() {
+            if (m_linuxDmabuf)
+                m_linuxDmabuf->removeFeedback(surface, this);
+            m_surface = nullptr;
+        });
+    }
+}
+
+LinuxDmabufFeedback::~LinuxDmabufFeedback()
+{
+    QObject::disconnect(m_surfaceDestroyedConnection);
+    if (m_linuxDmabuf && m_surface)
+        m_linuxDmabuf->removeFeedback(m_surface, this);
+}
+
+void LinuxDmabufFeedback::zwp_linux_dmabuf_feedback_v1_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void LinuxDmabufFeedback::zwp_linux_dmabuf_feedback_v1_destroy_resource(Resource *resource)
+{
+    Q_UNUSED(resource);
+    delete this;
+}
+
 LinuxDmabufParams::LinuxDmabufParams(LinuxDmabufClientBufferIntegration *clientBufferIntegration, wl_resource *resource)
     : zwp_linux_buffer_params_v1(resource)
     , m_clientBufferIntegration(clientBufferIntegration)
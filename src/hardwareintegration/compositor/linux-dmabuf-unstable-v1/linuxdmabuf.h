@@ -11,6 +11,8 @@
 #include <QtOpenGL/QOpenGLTexture>
 #include <QtCore/QObject>
 #include <QtCore/QHash>
+#include <QtCore/QMultiHash>
+#include <QtCore/QPointer>
 #include <QtCore/QSize>
 #include <QtCore/QTextStream>
 
@@ -48,7 +50,9 @@ namespace Compositor {
 class WaylandCompositor;
 class WaylandResource;
 class LinuxDmabufParams;
+class LinuxDmabufFeedback;
 class LinuxDmabufClientBufferIntegration;
+class WaylandSurface;
 
 struct Plane {
     int fd = -1;
@@ -60,17 +64,61 @@ struct Plane {
 class LinuxDmabuf : public PrivateServer::zwp_linux_dmabuf_v1
 {
 public:
-    explicit LinuxDmabuf(wl_display *display, LinuxDmabufClientBufferIntegration *clientBufferIntegration);
+    explicit LinuxDmabuf(wl_display *display, int version, LinuxDmabufClientBufferIntegration *clientBufferIntegration);
+    ~LinuxDmabuf() override;
 
+    void setMainDevice(dev_t device) { m_mainDevice = device; }
     void setSupportedModifiers(const QHash<uint32_t, QList<uint64_t>> &modifiers);
 
+    void sendFeedback(LinuxDmabufFeedback *feedback);
+    void sendSurfaceFeedback(WaylandSurface *surface);
+    void removeFeedback(WaylandSurface *surface, LinuxDmabufFeedback *feedback);
+
 protected:
     void zwp_linux_dmabuf_v1_bind_resource(Resource *resource) override;
     void zwp_linux_dmabuf_v1_create_params(Resource *resource, uint32_t params_id) override;
+    void zwp_linux_dmabuf_v1_get_default_feedback(Resource *resource, uint32_t id) override;
+    void zwp_linux_dmabuf_v1_get_surface_feedback(Resource *resource, uint32_t id, struct ::wl_resource *surface) override;
 
 private:
+    void createFormatTable();
+
     QHash<uint32_t, QList<uint64_t>> m_modifiers; // key=DRM format, value=supported DRM modifiers for format
     LinuxDmabufClientBufferIntegration *m_clientBufferIntegration;
+
+    // Format and modifier pairs shared by all feedback objects, in a sealed
+    // memfd so that clients can map it but nobody can change it
+    struct TableEntry {
+        uint32_t format;
+        uint32_t padding;
+        uint64_t modifier;
+    };
+    QList<TableEntry> m_table;
+    int m_tableFd = -1;
+    dev_t m_mainDevice = 0;
+
+    // Feedback objects by surface, default feedback is not tracked
+    QMultiHash<WaylandSurface *, LinuxDmabufFeedback *> m_surfaceFeedbacks;
+};
+
+class LinuxDmabufFeedback : public PrivateServer::zwp_linux_dmabuf_feedback_v1
+{
+public:
+    explicit LinuxDmabufFeedback(LinuxDmabuf *linuxDmabuf, WaylandSurface *surface, wl_resource *resource);
+    ~LinuxDmabufFeedback() override;
+
+    WaylandSurface *surface() const { return m_surface; }
+
+protected:
+    void zwp_linux_dmabuf_feedback_v1_destroy(Resource *resource) override;
+    void zwp_linux_dmabuf_feedback_v1_destroy_resource(Resource *resource) override;
+
+private:
+    friend class LinuxDmabuf;
+
+    LinuxDmabuf *m_linuxDmabuf = nullptr;
+    QPointer<WaylandSurface> m_surface;
+    QMetaObject::Connection m_surfaceDestroyedConnection;
 };
 
 class LinuxDmabufParams : public PrivateServer::zwp_linux_buffer_params_v1
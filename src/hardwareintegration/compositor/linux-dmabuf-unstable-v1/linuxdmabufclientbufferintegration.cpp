@@ -7,6 +7,7 @@
 #include <LiriAuroraCompositor/WaylandCompositor>
 #include <LiriAuroraCompositor/private/aurora-server-wayland.h>
 #include <LiriAuroraCompositor/private/aurorawltextureorphanage_p.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
 #include <qpa/qplatformnativeinterface.h>
 #include <QtOpenGL/QOpenGLTexture>
 #include <QtCore/QVarLengthArray>
@@ -15,9 +16,14 @@
 
 #include <EGL/egl.h>
 #include <EGL/eglext.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <drm_fourcc.h>
 
+#ifndef EGL_DRM_RENDER_NODE_FILE_EXT
+#define EGL_DRM_RENDER_NODE_FILE_EXT 0x3377
+#endif
+
 namespace Aurora {
 
 namespace Compositor {
@@ -254,8 +260,6 @@ LinuxDmabufClientBufferIntegration::~LinuxDmabufClientBufferIntegration()
 
 void LinuxDmabufClientBufferIntegration::initializeHardware(struct ::wl_display *display)
 {
-    m_linuxDmabuf.reset(new LinuxDmabuf(display, this));
-
     const bool ignoreBindDisplay = !qgetenv("QT_WAYLAND_IGNORE_BIND_DISPLAY").isEmpty() && qgetenv("QT_WAYLAND_IGNORE_BIND_DISPLAY").toInt() != 0;
 
     // initialize hardware extensions
@@ -308,12 +312,59 @@ void LinuxDmabufClientBufferIntegration::initializeHardware(struct ::wl_display
         m_wlDisplay = display;
     }
 
+    // Feedback needs the device buffers are imported into, older
+    // clients only get the formats
+    const QByteArray devicePath = queryDevicePath();
+    struct stat st;
+    const dev_t mainDevice = !devicePath.isEmpty() && stat(devicePath.constData(), &st) == 0 ? st.st_rdev : 0;
+    if (mainDevice == 0)
+        qCDebug(gLcAuroraCompositorHardwareIntegration) << "Unknown DRM device of the EGL display, dmabuf feedback is disabled.";
+    m_linuxDmabuf.reset(new LinuxDmabuf(display, mainDevice != 0 ? 4 : 3, this));
+    m_linuxDmabuf->setMainDevice(mainDevice);
+
     // request and sent formats/modifiers only after egl_display is bound
     QHash<uint32_t, QList<uint64_t>> modifiers;
     for (const auto &format : supportedDrmFormats()) {
         modifiers[format] = supportedDrmModifiers(format);
     }
     m_linuxDmabuf->setSupportedModifiers(modifiers);
+
+    // Explicit synchronization imports timelines on the same device
+    m_syncobjBackend.reset(LinuxDrmSyncobjBackend::create(devicePath, m_eglDisplay));
+    if (!m_syncobjBackend)
+        qCDebug(gLcAuroraCompositorHardwareIntegration) << "DRM timeline synchronization objects are not supported.";
+
+    m_initialized = true;
+}
+
+QByteArray LinuxDmabufClientBufferIntegration::queryDevicePath() const
+{
+    auto queryDisplayAttrib = reinterpret_cast<PFNEGLQUERYDISPLAYATTRIBEXTPROC>(eglGetProcAddress("eglQueryDisplayAttribEXT"));
+    auto queryDeviceString = reinterpret_cast<PFNEGLQUERYDEVICESTRINGEXTPROC>(eglGetProcAddress("eglQueryDeviceStringEXT"));
+    if (!queryDisplayAttrib || !queryDeviceString)
+        return QByteArray();
+
+    EGLAttrib attrib = 0;
+    if (!queryDisplayAttrib(m_eglDisplay, EGL_DEVICE_EXT, &attrib) || !attrib)
+        return QByteArray();
+    auto device = reinterpret_cast<EGLDeviceEXT>(attrib);
+
+    // The render node is preferred, clients don't need to be
+    // authenticated to allocate on it
+    const char *extensions = queryDeviceString(device, EGL_EXTENSIONS);
+    const char *path = nullptr;
+    if (extensions && strstr(extensions, "EGL_EXT_device_drm_render_node"))
+        path = queryDeviceString(device, EGL_DRM_RENDER_NODE_FILE_EXT);
+    if (!path && extensions && strstr(extensions, "EGL_EXT_device_drm"))
+        path = queryDeviceString(device, EGL_DRM_DEVICE_FILE_EXT);
+
+    return QByteArray(path);
+}
+
+void LinuxDmabufClientBufferIntegration::scanoutHintChanged(WaylandSurface *surface)
+{
+    if (m_linuxDmabuf)
+        m_linuxDmabuf->sendSurfaceFeedback(surface);
 }
 
 QList<uint32_t> LinuxDmabufClientBufferIntegration::supportedDrmFormats()
@@ -398,30 +449,41 @@ LinuxDmabufClientBuffer::LinuxDmabufClientBuffer(LinuxDmabufClientBufferIntegrat
 
 QOpenGLTexture *LinuxDmabufClientBuffer::toOpenGlTexture(int plane)
 {
-    // At this point we should have a valid OpenGL context, so it's safe to destroy textures
-    Internal::WaylandTextureOrphanage::instance()->deleteTextures();
-
     if (!m_buffer)
         return nullptr;
 
+    // Textures live as long as the buffer and sample its EGLImage, what the
+    // client draws shows up without binding the image again on commit
     QOpenGLTexture *texture = d->texture(plane);
+    if (texture) {
+        if (m_uploadStatistics)
+            m_uploadStatistics->importHits.fetchAndAddRelaxed(1);
+        return texture;
+    }
+
+    Internal::FrameTracer::Scope trace(Internal::FrameTracer::DmabufTextureImport,
+                                       m_uploadStatistics ? m_uploadStatistics->surfaceId : 0,
+                                       m_buffer);
+
+    // Orphaned textures are otherwise deleted once per frame by the outputs,
+    // do it here too for compositors that don't render with Qt Quick
+    Internal::WaylandTextureOrphanage::instance()->deleteTextures();
 
     const auto target = static_cast<QOpenGLTexture::Target>(GL_TEXTURE_2D);
 
-    if (!texture) {
-        texture = new QOpenGLTexture(target);
-        texture->setFormat(openGLFormatFromBufferFormat(formatFromDrmFormat(d->drmFormat())));
-        texture->setSize(d->size().width(), d->size().height());
-        texture->create();
-        d->initTexture(plane, texture);
-    }
+    texture = new QOpenGLTexture(target);
+    texture->setFormat(openGLFormatFromBufferFormat(formatFromDrmFormat(d->drmFormat())));
+    texture->setSize(d->size().width(), d->size().height());
+    texture->create();
+    d->initTexture(plane, texture);
+
+    texture->bind();
+    glTexParameterf(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    m_integration->gl_egl_image_target_texture_2d(target, d->image(plane));
+
+    if (m_uploadStatistics)
+        m_uploadStatistics->importMisses.fetchAndAddRelaxed(1);
 
-    if (m_textureDirty) {
-        m_textureDirty = false;
-        texture->bind();
-        glTexParameterf(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-        m_integration->gl_egl_image_target_texture_2d(target, d->image(plane));
-    }
     return texture;
 }
 
@@ -453,6 +515,21 @@ WaylandSurface::Origin LinuxDmabufClientBuffer::origin() const
     return (d->flags() & PrivateServer::zwp_linux_buffer_params_v1::flags_y_invert) ? WaylandSurface::OriginBottomLeft : WaylandSurface::OriginTopLeft;
 }
 
+bool LinuxDmabufClientBuffer::dmabufAttributes(Internal::DmabufAttributes *attributes) const
+{
+    attributes->size = d->size();
+    attributes->drmFormat = d->drmFormat();
+    attributes->planeCount = int(d->planesNumber());
+    for (uint32_t i = 0; i < d->planesNumber(); ++i) {
+        const Plane &plane = d->plane(i);
+        attributes->fds[i] = plane.fd;
+        attributes->offsets[i] = plane.offset;
+        attributes->strides[i] = plane.stride;
+        attributes->modifier = plane.modifiers;
+    }
+    return true;
+}
+
 } // namespace Compositor
 
 } // namespace Aurora
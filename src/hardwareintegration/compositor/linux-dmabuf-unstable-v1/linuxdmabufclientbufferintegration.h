@@ -4,6 +4,7 @@
 #pragma once
 
 #include "linuxdmabuf.h"
+#include "linuxdrmsyncobj.h"
 
 #include <LiriAuroraCompositor/private/aurorawlclientbufferintegration_p.h>
 #include <LiriAuroraCompositor/private/aurorawlclientbuffer_p.h>
@@ -45,6 +46,9 @@ public:
 
     void initializeHardware(struct ::wl_display *display) override;
     Internal::ClientBuffer *createBufferFor(wl_resource *resource) override;
+    bool supportsDmabufTargets() const override { return m_initialized; }
+    void scanoutHintChanged(WaylandSurface *surface) override;
+    Internal::SyncTimelineBackend *syncTimelineBackend() override { return m_syncobjBackend.data(); }
     bool importBuffer(wl_resource *resource, LinuxDmabufWlBuffer *linuxDmabufBuffer);
     void removeBuffer(wl_resource *resource);
     void deleteImage(EGLImageKHR image);
@@ -52,6 +56,7 @@ public:
 
 private:
     Q_DISABLE_COPY(LinuxDmabufClientBufferIntegration)
+    friend class tst_LinuxDmabuf;
 
     PFNEGLBINDWAYLANDDISPLAYWL egl_bind_wayland_display = nullptr;
     PFNEGLUNBINDWAYLANDDISPLAYWL egl_unbind_wayland_display = nullptr;
@@ -64,15 +69,18 @@ private:
     bool initYuvTexture(LinuxDmabufWlBuffer *dmabufBuffer);
     QList<uint32_t> supportedDrmFormats();
     QList<uint64_t> supportedDrmModifiers(uint32_t format);
+    QByteArray queryDevicePath() const;
 
     EGLDisplay m_eglDisplay = EGL_NO_DISPLAY;
     ::wl_display *m_wlDisplay = nullptr;
     bool m_displayBound = false;
+    bool m_initialized = false;
 
     QHash<EGLint, YuvFormatConversion> m_yuvFormats;
     bool m_supportsDmabufModifiers = false;
     QHash<struct ::wl_resource *, LinuxDmabufWlBuffer *> m_importedBuffers;
     QScopedPointer<LinuxDmabuf> m_linuxDmabuf;
+    QScopedPointer<LinuxDrmSyncobjBackend> m_syncobjBackend;
 };
 
 class LinuxDmabufClientBuffer : public Internal::ClientBuffer
@@ -84,6 +92,7 @@ public:
     QSize size() const override;
     WaylandSurface::Origin origin() const override;
     QOpenGLTexture *toOpenGlTexture(int plane) override;
+    bool dmabufAttributes(Internal::DmabufAttributes *attributes) const override;
 
 protected:
     void setDestroyed() override;
@@ -91,6 +100,7 @@ protected:
 private:
     friend class LinuxDmabufClientBufferIntegration;
     friend class LinuxDmabufClientBufferIntegrationPrivate;
+    friend class tst_LinuxDmabuf;
 
     LinuxDmabufClientBuffer(LinuxDmabufClientBufferIntegration* integration, wl_resource *bufferResource, LinuxDmabufWlBuffer *dmabufBuffer);
 
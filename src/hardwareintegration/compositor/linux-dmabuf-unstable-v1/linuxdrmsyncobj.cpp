@@ -0,0 +1,339 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "linuxdrmsyncobj.h"
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSocketNotifier>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <linux/sync_file.h>
+#include <xf86drm.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+// Merges two sync files into one that is signalled when both are, takes ownership of both
+static int mergeFences(int first, int second)
+{
+    if (first < 0)
+        return second;
+    if (second < 0)
+        return first;
+
+    struct sync_merge_data data = {};
+    qstrncpy(data.name, "aurora", sizeof(data.name));
+    data.fd2 = second;
+    const int ret = ::ioctl(first, SYNC_IOC_MERGE, &data);
+    ::close(first);
+    ::close(second);
+    return ret < 0 ? -1 : data.fence;
+}
+
+// Merges a copy of the fence into another one, which is replaced
+static void mergeFenceCopy(int &fence, int other)
+{
+    if (other < 0)
+        return;
+    const int copy = ::fcntl(other, F_DUPFD_CLOEXEC, 0);
+    if (copy >= 0)
+        fence = mergeFences(fence, copy);
+}
+
+LinuxDrmSyncobjTimeline::LinuxDrmSyncobjTimeline(LinuxDrmSyncobjBackend *backend, uint32_t handle)
+    : m_backend(backend)
+    , m_handle(handle)
+{
+}
+
+LinuxDrmSyncobjTimeline::~LinuxDrmSyncobjTimeline()
+{
+    for (QSocketNotifier *notifier : std::as_const(m_waiters)) {
+        ::close(notifier->socket());
+        delete notifier;
+    }
+    drmSyncobjDestroy(m_backend->drmFd(), m_handle);
+}
+
+bool LinuxDrmSyncobjTimeline::isSignalled(quint64 point) const
+{
+    uint32_t handle = m_handle;
+    uint64_t value = 0;
+    if (drmSyncobjQuery(m_backend->drmFd(), &handle, &value, 1) != 0)
+        return false;
+    return value >= point;
+}
+
+void LinuxDrmSyncobjTimeline::wait(quint64 point, QObject *context, std::function<void()> callback)
+{
+    // The kernel signals the eventfd once the fence for the point is signalled,
+    // even if the client didn't submit it yet
+    const int eventFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0 || drmSyncobjEventfd(m_backend->drmFd(), m_handle, point, eventFd, 0) != 0) {
+        qCWarning(gLcAuroraCompositorHardwareIntegration, "Failed to wait for timeline point %llu",
+                  static_cast<unsigned long long>(point));
+        if (eventFd >= 0)
+            ::close(eventFd);
+        // Better to show the content early than never
+        QMetaObject::invokeMethod(context, std::move(callback), Qt::QueuedConnection);
+        return;
+    }
+
+    auto *notifier = new QSocketNotifier(eventFd, QSocketNotifier::Read);
+    m_waiters.append(notifier);
+    QPointer<QObject> guard(context);
+    QObject::connect(notifier, &QSocketNotifier::activated, notifier, [this, notifier, guard, callback]() {
+        m_waiters.removeOne(notifier);
+        ::close(notifier->socket());
+        notifier->deleteLater();
+        if (guard)
+            callback();
+    });
+}
+
+void LinuxDrmSyncobjTimeline::signal(quint64 point, int fenceFd)
+{
+    const int drmFd = m_backend->drmFd();
+    uint64_t value = point;
+
+    if (fenceFd < 0) {
+        drmSyncobjTimelineSignal(drmFd, &m_handle, &value, 1);
+        return;
+    }
+
+    // The fence is imported into a binary syncobj first, then moved to the point
+    uint32_t fenceHandle = 0;
+    if (drmSyncobjCreate(drmFd, 0, &fenceHandle) == 0) {
+        if (drmSyncobjImportSyncFile(drmFd, fenceHandle, fenceFd) == 0
+                && drmSyncobjTransfer(drmFd, m_handle, point, fenceHandle, 0, 0) == 0) {
+            drmSyncobjDestroy(drmFd, fenceHandle);
+            ::close(fenceFd);
+            return;
+        }
+        drmSyncobjDestroy(drmFd, fenceHandle);
+    }
+    ::close(fenceFd);
+
+    qCWarning(gLcAuroraCompositorHardwareIntegration, "Failed to attach a fence to timeline point %llu",
+              static_cast<unsigned long long>(point));
+    drmSyncobjTimelineSignal(drmFd, &m_handle, &value, 1);
+}
+
+void LinuxDrmSyncobjTimeline::release(quint64 point)
+{
+    m_backend->release(sharedFromThis(), point);
+}
+
+LinuxDrmSyncobjBackend::LinuxDrmSyncobjBackend(int drmFd, EGLDisplay eglDisplay)
+    : m_drmFd(drmFd)
+    , m_eglDisplay(eglDisplay)
+{
+    const char *extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    if (extensions && strstr(extensions, "EGL_ANDROID_native_fence_sync")) {
+        egl_create_sync = reinterpret_cast<PFNEGLCREATESYNCKHRPROC>(eglGetProcAddress("eglCreateSyncKHR"));
+        egl_destroy_sync = reinterpret_cast<PFNEGLDESTROYSYNCKHRPROC>(eglGetProcAddress("eglDestroySyncKHR"));
+        egl_dup_native_fence_fd = reinterpret_cast<PFNEGLDUPNATIVEFENCEFDANDROIDPROC>(eglGetProcAddress("eglDupNativeFenceFDANDROID"));
+    }
+
+    if (!egl_create_sync || !egl_destroy_sync || !egl_dup_native_fence_fd) {
+        qCDebug(gLcAuroraCompositorHardwareIntegration,
+                "EGL_ANDROID_native_fence_sync is not supported, release points are signalled without a fence");
+    }
+}
+
+LinuxDrmSyncobjBackend::~LinuxDrmSyncobjBackend()
+{
+    // Clients must not wait forever for buffers
+    for (PendingRelease &release : m_pendingReleases) {
+        release.timeline->signal(release.point, release.fence);
+        release.timeline.reset();
+    }
+    m_pendingReleases.clear();
+
+    for (const ContextState &state : std::as_const(m_contexts)) {
+        QObject::disconnect(state.destroyedConnection);
+        if (state.fence >= 0)
+            ::close(state.fence);
+    }
+    ::close(m_drmFd);
+}
+
+LinuxDrmSyncobjBackend *LinuxDrmSyncobjBackend::create(const QByteArray &devicePath, EGLDisplay eglDisplay)
+{
+    if (devicePath.isEmpty())
+        return nullptr;
+
+    const int drmFd = ::open(devicePath.constData(), O_RDWR | O_CLOEXEC);
+    if (drmFd < 0)
+        return nullptr;
+
+    uint64_t timelineSupported = 0;
+    if (drmGetCap(drmFd, DRM_CAP_SYNCOBJ_TIMELINE, &timelineSupported) != 0 || !timelineSupported) {
+        ::close(drmFd);
+        return nullptr;
+    }
+
+    // Waiting without blocking needs DRM_IOCTL_SYNCOBJ_EVENTFD, which
+    // fails with an invalid eventfd only when the kernel supports it
+    uint32_t handle = 0;
+    bool eventfdSupported = false;
+    if (drmSyncobjCreate(drmFd, 0, &handle) == 0) {
+        eventfdSupported = drmSyncobjEventfd(drmFd, handle, 0, -1, 0) != 0 && errno == EBADF;
+        drmSyncobjDestroy(drmFd, handle);
+    }
+    if (!eventfdSupported) {
+        qCDebug(gLcAuroraCompositorHardwareIntegration,
+                "The kernel can't wait on synchronization objects with an eventfd");
+        ::close(drmFd);
+        return nullptr;
+    }
+
+    return new LinuxDrmSyncobjBackend(drmFd, eglDisplay);
+}
+
+QSharedPointer<Internal::SyncTimeline> LinuxDrmSyncobjBackend::importTimeline(int fd)
+{
+    uint32_t handle = 0;
+    const int ret = drmSyncobjFDToHandle(m_drmFd, fd, &handle);
+    ::close(fd);
+    if (ret != 0)
+        return {};
+
+    return QSharedPointer<LinuxDrmSyncobjTimeline>::create(this, handle);
+}
+
+LinuxDrmSyncobjBackend::ContextState &LinuxDrmSyncobjBackend::contextState(QOpenGLContext *context)
+{
+    auto it = m_contexts.find(context);
+    if (it != m_contexts.end())
+        return *it;
+
+    it = m_contexts.insert(context, ContextState());
+    it->destroyedConnection = QObject::connect(context, &QOpenGLContext::aboutToBeDestroyed, [this, context]() {
+        int fence = -1;
+        {
+            QMutexLocker locker(&m_fenceMutex);
+            fence = m_contexts.take(context).fence;
+        }
+
+        // Nothing is rendered with the context anymore
+        contextFinished(context, fence);
+        if (fence >= 0)
+            ::close(fence);
+    });
+    return *it;
+}
+
+void LinuxDrmSyncobjBackend::frameStarted()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context)
+        return;
+
+    QMutexLocker locker(&m_fenceMutex);
+    contextState(context).rendering = true;
+}
+
+void LinuxDrmSyncobjBackend::frameRendered()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context)
+        return;
+
+    int fence = -1;
+    if (egl_create_sync) {
+        const EGLint attribs[] = {
+            EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID,
+            EGL_NONE
+        };
+        EGLSyncKHR sync = egl_create_sync(m_eglDisplay, EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+        if (sync != EGL_NO_SYNC_KHR) {
+            // The fence only exists once the commands are flushed
+            context->functions()->glFlush();
+            fence = egl_dup_native_fence_fd(m_eglDisplay, sync);
+            egl_destroy_sync(m_eglDisplay, sync);
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_fenceMutex);
+        ContextState &state = contextState(context);
+        state.rendering = false;
+        if (state.fence >= 0)
+            ::close(state.fence);
+        state.fence = fence;
+    }
+
+    // The fence is only replaced by the next frame of this thread
+    contextFinished(context, fence);
+}
+
+void LinuxDrmSyncobjBackend::contextFinished(QOpenGLContext *context, int fence)
+{
+    QList<PendingRelease> finished;
+    {
+        QMutexLocker locker(&m_fenceMutex);
+        for (auto it = m_pendingReleases.begin(); it != m_pendingReleases.end();) {
+            if (it->contexts.removeOne(context)) {
+                mergeFenceCopy(it->fence, fence);
+                if (it->contexts.isEmpty()) {
+                    finished.append(std::move(*it));
+                    it = m_pendingReleases.erase(it);
+                    continue;
+                }
+            }
+            ++it;
+        }
+    }
+
+    if (finished.isEmpty())
+        return;
+
+    for (const PendingRelease &release : std::as_const(finished))
+        release.timeline->signal(release.point, release.fence);
+
+    // Timelines are destroyed on the main thread, which owns their waiters
+    QMetaObject::invokeMethod(QCoreApplication::instance(), [finished = std::move(finished)]() {}, Qt::QueuedConnection);
+}
+
+void LinuxDrmSyncobjBackend::release(const QSharedPointer<LinuxDrmSyncobjTimeline> &timeline, quint64 point)
+{
+    PendingRelease release;
+    release.timeline = timeline;
+    release.point = point;
+
+    {
+        QMutexLocker locker(&m_fenceMutex);
+
+        // A buffer may have been shown by any window, and a frame being
+        // rendered may still use it, so the release waits for its fence
+        for (auto it = m_contexts.cbegin(); it != m_contexts.cend(); ++it) {
+            if (it->rendering)
+                release.contexts.append(it.key());
+            else
+                mergeFenceCopy(release.fence, it->fence);
+        }
+
+        if (!release.contexts.isEmpty()) {
+            m_pendingReleases.append(release);
+            return;
+        }
+    }
+
+    timeline->signal(point, release.fence);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
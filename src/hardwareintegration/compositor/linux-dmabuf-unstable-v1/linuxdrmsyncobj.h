@@ -0,0 +1,101 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <LiriAuroraCompositor/private/aurorawlsynctimeline_p.h>
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+class QOpenGLContext;
+class QSocketNotifier;
+
+namespace Aurora {
+
+namespace Compositor {
+
+class LinuxDrmSyncobjBackend;
+
+class LinuxDrmSyncobjTimeline : public Internal::SyncTimeline
+                              , public QEnableSharedFromThis<LinuxDrmSyncobjTimeline>
+{
+public:
+    LinuxDrmSyncobjTimeline(LinuxDrmSyncobjBackend *backend, uint32_t handle);
+    ~LinuxDrmSyncobjTimeline() override;
+
+    bool isSignalled(quint64 point) const override;
+    void wait(quint64 point, QObject *context, std::function<void()> callback) override;
+    void signal(quint64 point, int fenceFd = -1) override;
+    void release(quint64 point) override;
+
+private:
+    LinuxDrmSyncobjBackend *m_backend = nullptr;
+    uint32_t m_handle = 0;
+    QList<QSocketNotifier *> m_waiters;
+};
+
+// Timelines of DRM synchronization objects, imported on the render node of
+// the EGL display, with release points signalled by native fences of the
+// frames rendered by the compositor.
+// A buffer released while a frame is being rendered may still be used by
+// that frame, so its release point waits for the fence of that frame.
+class LinuxDrmSyncobjBackend : public Internal::SyncTimelineBackend
+{
+public:
+    ~LinuxDrmSyncobjBackend() override;
+
+    // Returns null unless the device supports waiting on timelines with an eventfd
+    static LinuxDrmSyncobjBackend *create(const QByteArray &devicePath, EGLDisplay eglDisplay);
+
+    int drmFd() const { return m_drmFd; }
+
+    QSharedPointer<Internal::SyncTimeline> importTimeline(int fd) override;
+    void frameStarted() override;
+    void frameRendered() override;
+
+    // Signals the point once the frames that may use the released buffer are done
+    void release(const QSharedPointer<LinuxDrmSyncobjTimeline> &timeline, quint64 point);
+
+private:
+    struct ContextState {
+        int fence = -1;
+        bool rendering = false;
+        QMetaObject::Connection destroyedConnection;
+    };
+
+    struct PendingRelease {
+        QSharedPointer<LinuxDrmSyncobjTimeline> timeline;
+        quint64 point = 0;
+        int fence = -1;
+        QList<QOpenGLContext *> contexts;
+    };
+
+    LinuxDrmSyncobjBackend(int drmFd, EGLDisplay eglDisplay);
+
+    // Must be called with the fence mutex locked
+    ContextState &contextState(QOpenGLContext *context);
+
+    // Signals the releases that only waited for the frame rendered with the context
+    void contextFinished(QOpenGLContext *context, int fence);
+
+    int m_drmFd = -1;
+    EGLDisplay m_eglDisplay = EGL_NO_DISPLAY;
+    PFNEGLCREATESYNCKHRPROC egl_create_sync = nullptr;
+    PFNEGLDESTROYSYNCKHRPROC egl_destroy_sync = nullptr;
+    PFNEGLDUPNATIVEFENCEFDANDROIDPROC egl_dup_native_fence_fd = nullptr;
+
+    // Frames are rendered on the render threads
+    QMutex m_fenceMutex;
+    QHash<QOpenGLContext *, ContextState> m_contexts;
+    QList<PendingRelease> m_pendingReleases;
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
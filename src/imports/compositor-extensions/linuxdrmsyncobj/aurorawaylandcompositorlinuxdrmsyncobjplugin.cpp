@@ -0,0 +1,60 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtQml/qqmlextensionplugin.h>
+#include <QtQml/qqml.h>
+
+#include <LiriAuroraCompositor/aurorawaylandquickextension.h>
+#include <LiriAuroraCompositor/private/aurorawaylandlinuxdrmsyncobjv1_p.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+AURORA_COMPOSITOR_DECLARE_QUICK_EXTENSION_CLASS(WaylandLinuxDrmSyncobjManagerV1)
+
+/*!
+    \qmlmodule Aurora.Compositor.LinuxDrmSyncobj
+    \title Wayland Linux DRM Synchronization Object Extension
+    \ingroup qmlmodules
+    \brief Provides explicit synchronization of client buffers.
+
+    \section2 Summary
+    The LinuxDrmSyncobjManagerV1 extension lets clients attach timeline
+    points to their buffers: the compositor waits for the acquire point
+    before using the buffer, and signals the release point when the GPU
+    is done with it.
+
+    LinuxDrmSyncobjManagerV1 corresponds to the Wayland
+    \c wp_linux_drm_syncobj_manager_v1 interface.
+
+    \section2 Usage
+    To use this module, import it like this:
+    \qml
+    import Aurora.Compositor.LinuxDrmSyncobj
+    \endqml
+*/
+
+class WaylandCompositorLinuxDrmSyncobjPlugin : public QQmlExtensionPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID QQmlExtensionInterface_iid)
+public:
+    void registerTypes(const char *uri) override
+    {
+        Q_ASSERT(QLatin1String(uri) == QLatin1String("Aurora.Compositor.LinuxDrmSyncobj"));
+        defineModule(uri);
+    }
+
+    static void defineModule(const char *uri)
+    {
+        qmlRegisterModule(uri, 1, 0);
+        qmlRegisterType<WaylandLinuxDrmSyncobjManagerV1QuickExtension>(uri, 1, 0, "LinuxDrmSyncobjManagerV1");
+    }
+};
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "aurorawaylandcompositorlinuxdrmsyncobjplugin.moc"
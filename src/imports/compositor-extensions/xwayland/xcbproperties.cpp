@@ -58,6 +58,10 @@ void dump(xcb_atom_t property, xcb_get_property_reply_t *reply)
 
 void dumpProperty(xcb_atom_t property, xcb_get_property_reply_t *reply)
 {
+    // Atom names are looked up with a round trip
+    if (!gLcXwaylandTrace().isDebugEnabled())
+        return;
+
     QString buffer = QStringLiteral("\t%1: ").arg(Xcb::Atom::nameFromAtom(property));
 
     if (!reply) {
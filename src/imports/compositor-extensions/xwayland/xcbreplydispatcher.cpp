@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "xcbreplydispatcher.h"
+#include "xcbwrapper.h"
+
+namespace Xcb {
+
+ReplyDispatcher::~ReplyDispatcher()
+{
+    clear();
+}
+
+void ReplyDispatcher::clear()
+{
+    // Replies that didn't arrive yet are dropped by xcb itself,
+    // unless the connection is already closed
+    if (connection()) {
+        for (const Request &request : m_requests)
+            xcb_discard_reply(connection(), request.sequence);
+    }
+    m_requests.clear();
+}
+
+bool ReplyDispatcher::hasPendingReplies() const
+{
+    return !m_requests.empty();
+}
+
+void ReplyDispatcher::addRequest(unsigned int sequence, QObject *context, std::function<void (void *)> &&callback)
+{
+    Request request;
+    request.sequence = sequence;
+    request.context = context;
+    request.callback = std::move(callback);
+    m_requests.push_back(std::move(request));
+}
+
+void ReplyDispatcher::dispatch()
+{
+    // Replies arrive in the order requests were sent: stop at
+    // the first one that is not here yet
+    while (!m_requests.empty()) {
+        void *reply = nullptr;
+        xcb_generic_error_t *error = nullptr;
+        if (!xcb_poll_for_reply(connection(), m_requests.front().sequence, &reply, &error))
+            break;
+
+        // Continuations may send more requests
+        Request request = std::move(m_requests.front());
+        m_requests.pop_front();
+
+        if (request.context)
+            request.callback(error ? nullptr : reply);
+
+        free(reply);
+        free(error);
+    }
+}
+
+} // namespace Xcb
@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+
+#include <xcb/xcb.h>
+
+#include <deque>
+#include <functional>
+
+namespace Xcb {
+
+/*
+ * Runs a continuation when the reply to a request arrives.
+ *
+ * Waiting for a reply would block the compositor for as long as the
+ * X server or the X client keeps it busy.  Replies are picked up when
+ * the connection is readable instead, and handed to the continuation
+ * of the request in the order they were sent.
+ */
+class ReplyDispatcher
+{
+    Q_DISABLE_COPY(ReplyDispatcher)
+public:
+    ReplyDispatcher() = default;
+    ~ReplyDispatcher();
+
+    // The reply is nullptr on error (usually a window that is already gone)
+    // and freed after the continuation returns, which is not called
+    // when the context is destroyed in the meantime
+    template <typename Reply>
+    void add(unsigned int sequence, QObject *context, std::function<void (Reply *)> callback)
+    {
+        addRequest(sequence, context, [callback](void *reply) {
+            callback(static_cast<Reply *>(reply));
+        });
+    }
+
+    bool hasPendingReplies() const;
+
+    // Forgets about the pending replies, before closing the connection
+    void clear();
+
+    // Runs the continuations of the replies that have arrived
+    void dispatch();
+
+private:
+    struct Request {
+        unsigned int sequence = 0;
+        QPointer<QObject> context;
+        std::function<void (void *)> callback;
+    };
+
+    void addRequest(unsigned int sequence, QObject *context, std::function<void (void *)> &&callback);
+
+    std::deque<Request> m_requests;
+};
+
+} // namespace Xcb
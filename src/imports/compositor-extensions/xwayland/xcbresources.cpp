@@ -27,6 +27,9 @@
 
 #include <xcb/xfixes.h>
 #include <xcb/composite.h>
+#if HAVE_XCB_RES
+#include <xcb/res.h>
+#endif
 
 namespace Xcb {
 
@@ -34,6 +37,9 @@ Resources::Resources()
 {
     xcb_prefetch_extension_data(connection(), &xcb_xfixes_id);
     xcb_prefetch_extension_data(connection(), &xcb_composite_id);
+#if HAVE_XCB_RES
+    xcb_prefetch_extension_data(connection(), &xcb_res_id);
+#endif
 
     xcb_render_query_pict_formats_cookie_t formatsCookie =
             xcb_render_query_pict_formats(connection());
@@ -44,6 +50,15 @@ Resources::Resources()
     if (!xfixes || !xfixes->present)
         qCWarning(gLcXwayland) << "xfixes not available";
 
+    // Tells how many clients are connected
+#if HAVE_XCB_RES
+    res = xcb_get_extension_data(connection(), &xcb_res_id);
+#else
+    res = nullptr;
+#endif
+    if (!res || !res->present)
+        qCDebug(gLcXwayland) << "X-Resource not available";
+
     xcb_xfixes_query_version_cookie_t xfixesCookie =
             xcb_xfixes_query_version(connection(),
                                      XCB_XFIXES_MAJOR_VERSION,
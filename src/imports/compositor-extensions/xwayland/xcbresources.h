@@ -36,6 +36,7 @@ public:
     ~Resources();
 
     const xcb_query_extension_reply_t *xfixes;
+    const xcb_query_extension_reply_t *res;
     Atoms *atoms;
     xcb_render_pictforminfo_t formatRgb;
     xcb_render_pictforminfo_t formatRgba;
@@ -77,8 +77,10 @@ void closeConnection()
 {
     if (s_connection) {
         delete s_resources;
+        s_resources = nullptr;
         xcb_disconnect(s_connection);
         s_connection = nullptr;
+        s_screen = nullptr;
     }
 }
 
@@ -42,10 +42,12 @@ XWayland::XWayland(QObject *parent)
     : QObject(parent)
     , m_compositor(nullptr)
     , m_enabled(false)
+    , m_lazy(false)
     , m_initialized(false)
     , m_server(nullptr)
     , m_manager(nullptr)
 {
+    connect(&m_idleTimer, &QTimer::timeout, this, &XWayland::handleIdleTimeout);
 }
 
 bool XWayland::isEnabled() const
@@ -67,6 +69,43 @@ void XWayland::setEnabled(bool enabled)
     Q_EMIT enabledChanged();
 }
 
+bool XWayland::isLazy() const
+{
+    return m_lazy;
+}
+
+void XWayland::setLazy(bool lazy)
+{
+    if (m_initialized) {
+        qCWarning(gLcXwayland, "Cannot change how XWayland is started after initialization");
+        return;
+    }
+
+    if (m_lazy == lazy)
+        return;
+
+    m_lazy = lazy;
+    Q_EMIT lazyChanged();
+}
+
+int XWayland::idleTimeout() const
+{
+    return m_idleTimer.interval();
+}
+
+void XWayland::setIdleTimeout(int timeout)
+{
+    timeout = qMax(timeout, 0);
+    if (m_idleTimer.interval() == timeout)
+        return;
+
+    m_idleTimer.setInterval(timeout);
+    Q_EMIT idleTimeoutChanged();
+
+    if (m_server)
+        updateIdleTimer();
+}
+
 WaylandCompositor *XWayland::compositor() const
 {
     return m_compositor;
@@ -111,6 +150,17 @@ bool XWayland::startServer()
         return true;
     }
 
+    // Xwayland is started when the first X client connects
+    if (m_lazy) {
+        if (!m_server->listen()) {
+            qCWarning(gLcXwayland) << "Failed to listen for X clients";
+            return false;
+        }
+
+        setDisplayName(m_server->displayName());
+        return true;
+    }
+
     if (!m_server->start()) {
         qCWarning(gLcXwayland) << "Failed to start XWayland";
         return false;
@@ -121,7 +171,10 @@ bool XWayland::startServer()
 
 void XWayland::stopServer()
 {
+    m_idleTimer.stop();
+    m_manager->stop();
     m_server->shutdown();
+    m_server->stopListening();
 }
 
 void XWayland::initialize()
@@ -160,21 +213,77 @@ void XWayland::initialize()
             this, &XWayland::handleServerStarted);
     connect(m_server, &XWaylandServer::failedToStart,
             this, &XWayland::serverFailedToStart);
+    connect(m_server, &XWaylandServer::finished,
+            this, &XWayland::handleServerFinished);
 
     // Window manager
     m_manager->setServer(m_server);
     m_manager->setCompositor(m_compositor);
 }
 
-void XWayland::handleServerStarted(const QString &displayName)
+void XWayland::setDisplayName(const QString &displayName)
 {
+    if (m_displayName == displayName)
+        return;
+
     m_displayName = displayName;
     Q_EMIT displayNameChanged();
+}
+
+void XWayland::handleServerStarted(const QString &displayName)
+{
+    setDisplayName(displayName);
 
     Q_EMIT serverStarted(displayName);
 
     // Start window management
     m_manager->start(m_server->wmFd());
+
+    // Connected clients are checked from now on
+    updateIdleTimer();
+}
+
+void XWayland::handleServerFinished()
+{
+    m_idleTimer.stop();
+    m_manager->stop();
+}
+
+void XWayland::updateIdleTimer()
+{
+    m_idleChecks = 0;
+
+    // Only a server started on demand can be started again
+    if (m_lazy && m_idleTimer.interval() > 0 && m_server->isRunning())
+        m_idleTimer.start();
+    else
+        m_idleTimer.stop();
+}
+
+void XWayland::handleIdleTimeout()
+{
+    if (!m_server->isRunning())
+        return;
+
+    m_manager->countClients(this, [this](int count) {
+        // Without X-Resource clients are only known by their windows
+        const bool idle = count < 0 ? !m_manager->hasClientWindows() : count == 0;
+        if (!idle) {
+            m_idleChecks = 0;
+            return;
+        }
+
+        // Two checks in a row make sure there was no client for a whole interval
+        if (++m_idleChecks < 2 || !m_server->isRunning())
+            return;
+
+        qCInfo(gLcXwayland) << "No X clients for" << m_idleTimer.interval() << "ms, stopping XWayland";
+
+        // Xwayland is started again on the next connection
+        m_idleTimer.stop();
+        m_manager->stop();
+        m_server->shutdown();
+    });
 }
 
 void XWayland::handleSurfaceCreated(WaylandSurface *surface)
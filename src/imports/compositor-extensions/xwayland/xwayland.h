@@ -25,6 +25,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QTimer>
 #include <QtQml/QQmlParserStatus>
 
 #include <LiriAuroraCompositor/aurorawaylandquickchildren.h>
@@ -40,12 +41,15 @@ namespace Compositor {
 class XWaylandManager;
 class XWaylandServer;
 class XWaylandShellSurface;
+class tst_XWayland;
 
 class XWayland : public QObject, public QQmlParserStatus
 {
     Q_OBJECT
     AURORA_COMPOSITOR_DECLARE_QUICK_CHILDREN(XWayland)
     Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(bool lazy READ isLazy WRITE setLazy NOTIFY lazyChanged)
+    Q_PROPERTY(int idleTimeout READ idleTimeout WRITE setIdleTimeout NOTIFY idleTimeoutChanged)
     Q_PROPERTY(Aurora::Compositor::WaylandCompositor *compositor READ compositor WRITE setCompositor NOTIFY compositorChanged)
     Q_PROPERTY(Aurora::Compositor::XWaylandManager *manager READ manager WRITE setManager NOTIFY managerChanged)
     Q_PROPERTY(QString displayName READ displayName NOTIFY displayNameChanged)
@@ -56,6 +60,12 @@ public:
     bool isEnabled() const;
     void setEnabled(bool enabled);
 
+    bool isLazy() const;
+    void setLazy(bool lazy);
+
+    int idleTimeout() const;
+    void setIdleTimeout(int timeout);
+
     WaylandCompositor *compositor() const;
     void setCompositor(WaylandCompositor *compositor);
 
@@ -72,6 +82,8 @@ public:
 
 Q_SIGNALS:
     void enabledChanged();
+    void lazyChanged();
+    void idleTimeoutChanged();
     void compositorChanged();
     void managerChanged();
     void displayNameChanged();
@@ -80,17 +92,26 @@ Q_SIGNALS:
 
 private Q_SLOTS:
     void handleServerStarted(const QString &displayName);
+    void handleServerFinished();
+    void handleIdleTimeout();
     void handleSurfaceCreated(Aurora::Compositor::WaylandSurface *surface);
 
 private:
+    friend class tst_XWayland;
+
     WaylandCompositor *m_compositor;
     bool m_enabled;
+    bool m_lazy;
     bool m_initialized;
+    QTimer m_idleTimer;
+    int m_idleChecks = 0;
     XWaylandServer *m_server;
     XWaylandManager *m_manager;
     QString m_displayName;
 
     void initialize();
+    void setDisplayName(const QString &displayName);
+    void updateIdleTimer();
 };
 
 } // namespace Compositor
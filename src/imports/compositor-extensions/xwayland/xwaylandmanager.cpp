@@ -46,6 +46,7 @@
  * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <QtCore/QAbstractEventDispatcher>
 #include <QtCore/QSocketNotifier>
 #include <QtCore/QtMath>
 
@@ -63,6 +64,9 @@
 
 #include <unistd.h>
 #include <xcb/composite.h>
+#if HAVE_XCB_RES
+#include <xcb/res.h>
+#endif
 #include <wayland-server.h>
 
 namespace Aurora {
@@ -82,9 +86,7 @@ XWaylandManager::XWaylandManager(QObject *parent)
 
 XWaylandManager::~XWaylandManager()
 {
-    Xcb::Cursors::destroyCursors(m_cursors);
-    delete m_wmWindow;
-    Xcb::closeConnection();
+    stop();
 }
 
 XWaylandServer *XWaylandManager::server() const
@@ -119,8 +121,12 @@ void XWaylandManager::start(int fd)
     }
 
     // Listen to WM events
-    QSocketNotifier *notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
-    connect(notifier, SIGNAL(activated(int)), this, SLOT(wmEvents()));
+    m_notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(m_notifier, SIGNAL(activated(int)), this, SLOT(wmEvents()));
+
+    // Replies might have been read along with something else
+    connect(QAbstractEventDispatcher::instance(), &QAbstractEventDispatcher::aboutToBlock,
+            this, &XWaylandManager::dispatchReplies, Qt::UniqueConnection);
 
     // Resources and atoms
     Xcb::resources();
@@ -175,11 +181,67 @@ void XWaylandManager::start(int fd)
     // Xwayland that the setup is done
     createWindowManager();
 
+    // When started on demand, the first client might have created
+    // its windows before we were watching the root window
+    xcb_query_tree_cookie_t cookie = xcb_query_tree(Xcb::connection(), Xcb::rootWindow());
+    m_replies.add<xcb_query_tree_reply_t>(cookie.sequence, this, [this](xcb_query_tree_reply_t *reply) {
+        if (!reply)
+            return;
+
+        const xcb_window_t *children = xcb_query_tree_children(reply);
+        const int count = xcb_query_tree_children_length(reply);
+        for (int i = 0; i < count; ++i)
+            addClientWindow(children[i]);
+    });
+    xcb_flush(Xcb::connection());
+
     qCDebug(gLcXwayland) << "X window manager created, root" << Xcb::rootWindow();
 
     Q_EMIT created();
 }
 
+void XWaylandManager::stop()
+{
+    if (!Xcb::connection())
+        return;
+
+    qCDebug(gLcXwayland) << "Stop X window manager";
+
+    delete m_notifier;
+    m_notifier = nullptr;
+    disconnect(QAbstractEventDispatcher::instance(), &QAbstractEventDispatcher::aboutToBlock,
+               this, &XWaylandManager::dispatchReplies);
+
+    m_replies.clear();
+    m_dirtyWindows.clear();
+
+    // Windows are gone with the server
+    const auto shellSurfaces = m_windowsMap.values();
+    m_windowsMap.clear();
+    for (XWaylandShellSurface *shellSurface : shellSurfaces) {
+        connect(shellSurface, &XWaylandShellSurface::unmapped,
+                shellSurface, &XWaylandShellSurface::deleteLater);
+        shellSurface->setSurface(nullptr);
+    }
+    m_unpairedWindows.clear();
+    m_focusWindow = nullptr;
+
+    m_clientWindows.clear();
+
+    Xcb::Cursors::destroyCursors(m_cursors);
+    m_cursors = nullptr;
+    m_lastCursor = CursorUnset;
+    delete m_wmWindow;
+    m_wmWindow = nullptr;
+
+    Xcb::closeConnection();
+}
+
+bool XWaylandManager::hasClientWindows() const
+{
+    return !m_clientWindows.isEmpty();
+}
+
 void XWaylandManager::addWindow(xcb_window_t id, XWaylandShellSurface *shellSurface)
 {
     if (id != XCB_WINDOW_NONE && shellSurface)
@@ -244,6 +306,54 @@ XWaylandShellSurface *XWaylandManager::shellSurfaceFromSurface(WaylandSurface *s
     return nullptr;
 }
 
+void XWaylandManager::countClients(QObject *context, std::function<void (int count)> callback)
+{
+#if HAVE_XCB_RES
+    const auto *res = Xcb::connection() ? Xcb::resources()->res : nullptr;
+    if (!res || !res->present) {
+        callback(-1);
+        return;
+    }
+
+    xcb_res_query_clients_cookie_t cookie = xcb_res_query_clients(Xcb::connection());
+    m_replies.add<xcb_res_query_clients_reply_t>(cookie.sequence, context, [callback](xcb_res_query_clients_reply_t *reply) {
+        if (!reply) {
+            callback(-1);
+            return;
+        }
+
+        // The server itself has no resource base
+        int count = 0;
+        for (auto it = xcb_res_query_clients_clients_iterator(reply); it.rem; xcb_res_client_next(&it)) {
+            if (it.data->resource_base != 0 && !Xcb::isOurResource(it.data->resource_base))
+                ++count;
+        }
+        callback(count);
+    });
+    xcb_flush(Xcb::connection());
+#else
+    // Built without xcb-res, client windows tell whether X is in use
+    Q_UNUSED(context);
+    callback(-1);
+#endif
+}
+
+void XWaylandManager::addClientWindow(xcb_window_t window)
+{
+    if (!Xcb::isOurResource(window))
+        m_clientWindows.insert(window);
+}
+
+void XWaylandManager::removeClientWindow(xcb_window_t window)
+{
+    m_clientWindows.remove(window);
+}
+
+Xcb::ReplyDispatcher *XWaylandManager::replies()
+{
+    return &m_replies;
+}
+
 void XWaylandManager::setupVisualAndColormap()
 {
     xcb_depth_iterator_t depthIterator =
@@ -383,6 +493,9 @@ void XWaylandManager::handleCreateNotify(xcb_create_notify_event_t *event)
     if (Xcb::isOurResource(event->window))
         return;
 
+    if (event->parent == Xcb::rootWindow())
+        addClientWindow(event->window);
+
     XWaylandShellSurface *parentShellSurface = nullptr;
     if (event->override_redirect != 0)
         parentShellSurface = m_windowsMap[event->parent];
@@ -409,12 +522,15 @@ void XWaylandManager::handleMapRequest(xcb_map_request_event_t *event)
     qCDebug(gLcXwaylandTrace, "XCB_MAP_REQUEST (window %d, %p)",
             event->window, shellSurface);
 
-    shellSurface->readProperties();
-    shellSurface->setWmState(XWaylandShellSurface::NormalState);
-    shellSurface->setNetWmState();
-    shellSurface->setWorkspace(0);
-    xcb_map_window(Xcb::connection(), event->window);
-    xcb_flush(Xcb::connection());
+    // Map the window once its properties are known
+    const xcb_window_t window = event->window;
+    shellSurface->readProperties([shellSurface, window]() {
+        shellSurface->setWmState(XWaylandShellSurface::NormalState);
+        shellSurface->setNetWmState();
+        shellSurface->setWorkspace(0);
+        xcb_map_window(Xcb::connection(), window);
+        xcb_flush(Xcb::connection());
+    });
 }
 
 void XWaylandManager::handleMapNotify(xcb_map_notify_event_t *event)
@@ -545,6 +661,8 @@ void XWaylandManager::handleDestroyNotify(xcb_destroy_notify_event_t *event)
     if (Xcb::isOurResource(event->window))
         return;
 
+    removeClientWindow(event->window);
+
     if (!m_windowsMap.contains(event->window))
         return;
 
@@ -564,23 +682,38 @@ void XWaylandManager::handlePropertyNotify(xcb_property_notify_event_t *event)
 
     shellSurface->dirtyProperties();
 
-    if (event->state == XCB_PROPERTY_DELETE)
+    // Mapped windows are read again once all pending events are handled,
+    // the others when they are mapped
+    if (shellSurface->surface())
+        m_dirtyWindows.insert(event->window);
+
+    if (event->state == XCB_PROPERTY_DELETE) {
         qCDebug(gLcXwaylandTrace, "\tdeleted");
-    else
-        Xcb::Properties::readAndDumpProperty(event->atom, event->window);
+    } else if (gLcXwaylandTrace().isDebugEnabled()) {
+        const xcb_atom_t atom = event->atom;
+        xcb_get_property_cookie_t cookie =
+                xcb_get_property(Xcb::connection(), 0, event->window,
+                                 atom, XCB_ATOM_ANY, 0, 2048);
+        m_replies.add<xcb_get_property_reply_t>(cookie.sequence, this, [atom](xcb_get_property_reply_t *reply) {
+            Xcb::Properties::dumpProperty(atom, reply);
+        });
+    }
 }
 
 void XWaylandManager::handleClientMessage(xcb_client_message_event_t *event)
 {
-    QString name = Xcb::Atom::nameFromAtom(event->type);
-    qCDebug(gLcXwaylandTrace, "XCB_CLIENT_MESSAGE (%s %d %d %d %d %d win %d)",
-            qPrintable(name),
-            event->data.data32[0],
-            event->data.data32[1],
-            event->data.data32[2],
-            event->data.data32[3],
-            event->data.data32[4],
-            event->window);
+    // Looking up the name takes a round trip
+    if (gLcXwaylandTrace().isDebugEnabled()) {
+        QString name = Xcb::Atom::nameFromAtom(event->type);
+        qCDebug(gLcXwaylandTrace, "XCB_CLIENT_MESSAGE (%s %d %d %d %d %d win %d)",
+                qPrintable(name),
+                event->data.data32[0],
+                event->data.data32[1],
+                event->data.data32[2],
+                event->data.data32[3],
+                event->data.data32[4],
+                event->window);
+    }
 
     // Check whether we have the surface because the window may get
     // created and destroyed before we actually handle this message
@@ -854,10 +987,26 @@ void XWaylandManager::wmEvents()
         count++;
     }
 
+    // Several property changes of a window are read in one go
+    const QSet<xcb_window_t> dirtyWindows = std::exchange(m_dirtyWindows, {});
+    for (xcb_window_t window : dirtyWindows) {
+        XWaylandShellSurface *shellSurface = m_windowsMap.value(window);
+        if (shellSurface && shellSurface->surface())
+            shellSurface->readProperties();
+    }
+
+    m_replies.dispatch();
+
     if (count > 0)
         xcb_flush(Xcb::connection());
 }
 
+void XWaylandManager::dispatchReplies()
+{
+    if (m_replies.hasPendingReplies())
+        m_replies.dispatch();
+}
+
 } // namespace Compositor
 
 } // namespace Aurora
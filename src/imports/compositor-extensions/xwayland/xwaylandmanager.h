@@ -25,10 +25,17 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QMap>
+#include <QtCore/QSet>
 #include <LiriAuroraCompositor/WaylandCompositor>
 
 #include <xcb/xcb.h>
 
+#include <functional>
+
+#include "xcbreplydispatcher.h"
+
+class QSocketNotifier;
+
 namespace Xcb {
 class Window;
 class Resources;
@@ -69,6 +76,13 @@ public:
     void setCompositor(WaylandCompositor *compositor);
 
     void start(int fd);
+    void stop();
+
+    bool hasClientWindows() const;
+
+    // Counts the X clients other than the window manager, the
+    // callback gets -1 when the server can't tell
+    void countClients(QObject *context, std::function<void (int count)> callback);
 
     void addWindow(xcb_window_t id, XWaylandShellSurface *shellSurface);
     void removeWindow(xcb_window_t id);
@@ -79,6 +93,8 @@ public:
     XWaylandShellSurface *shellSurfaceFromId(xcb_window_t id);
     XWaylandShellSurface *shellSurfaceFromSurface(WaylandSurface *surface);
 
+    Xcb::ReplyDispatcher *replies();
+
 Q_SIGNALS:
     void created();
     void shellSurfaceRequested(quint32 window, const QRect &geometry,
@@ -104,6 +120,19 @@ private:
     QList<XWaylandShellSurface *> m_unpairedWindows;
     XWaylandShellSurface *m_focusWindow;
 
+    QSocketNotifier *m_notifier = nullptr;
+
+    Xcb::ReplyDispatcher m_replies;
+    QSet<xcb_window_t> m_dirtyWindows;
+
+    // Top level windows of X clients, created either before or after the
+    // window manager was started; they tell whether X clients are still
+    // around when the server doesn't have X-Resource
+    QSet<xcb_window_t> m_clientWindows;
+
+    void addClientWindow(xcb_window_t window);
+    void removeClientWindow(xcb_window_t window);
+
     void setupVisualAndColormap();
     void wmSelection();
     void initializeDragAndDrop();
@@ -144,6 +173,7 @@ private:
 
 private Q_SLOTS:
     void wmEvents();
+    void dispatchReplies();
 };
 
 } // namespace Compositor
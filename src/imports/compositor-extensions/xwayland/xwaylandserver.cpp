@@ -32,8 +32,11 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/un.h>
+#include <fcntl.h>
 #include <signal.h>
+#include <stddef.h>
 #include <unistd.h>
 
 #include <wayland-server.h>
@@ -59,6 +62,79 @@ public:
 };
 
 
+static QByteArray lockFilePath(int display)
+{
+    return QByteArrayLiteral("/tmp/.X") + QByteArray::number(display) + QByteArrayLiteral("-lock");
+}
+
+static QByteArray socketPath(int display)
+{
+    return QByteArrayLiteral("/tmp/.X11-unix/X") + QByteArray::number(display);
+}
+
+static bool createLockFile(int display)
+{
+    const QByteArray path = lockFilePath(display);
+
+    int fd = ::open(path.constData(), O_WRONLY | O_CLOEXEC | O_CREAT | O_EXCL, 0444);
+    if (fd < 0 && errno == EEXIST) {
+        // Take over the lock left behind by a server that is gone
+        QFile file(QFile::decodeName(path));
+        if (!file.open(QFile::ReadOnly))
+            return false;
+        bool ok = false;
+        const pid_t pid = file.read(11).trimmed().toInt(&ok);
+        if (!ok || pid <= 0 || ::kill(pid, 0) == 0 || errno != ESRCH)
+            return false;
+        if (::unlink(path.constData()) < 0)
+            return false;
+        fd = ::open(path.constData(), O_WRONLY | O_CLOEXEC | O_CREAT | O_EXCL, 0444);
+    }
+    if (fd < 0)
+        return false;
+
+    // Same format as the X server
+    const QByteArray pid = QByteArray::number(::getpid()).rightJustified(10, ' ') + '\n';
+    const bool written = ::write(fd, pid.constData(), pid.size()) == pid.size();
+    ::close(fd);
+    if (!written) {
+        ::unlink(path.constData());
+        return false;
+    }
+
+    return true;
+}
+
+static int bindToSocket(int display, bool abstract)
+{
+    const QByteArray path = socketPath(display);
+
+    sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    socklen_t size;
+    if (abstract) {
+        memcpy(addr.sun_path + 1, path.constData(), path.size());
+        size = offsetof(sockaddr_un, sun_path) + 1 + path.size();
+    } else {
+        // Nobody is listening on the abstract socket, the file is stale
+        ::unlink(path.constData());
+        memcpy(addr.sun_path, path.constData(), path.size());
+        size = offsetof(sockaddr_un, sun_path) + path.size() + 1;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+
+    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), size) < 0 || ::listen(fd, 1) < 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
 XWaylandServer::XWaylandServer(WaylandCompositor *compositor, QObject *parent)
     : QObject(parent)
     , m_compositor(compositor)
@@ -73,6 +149,7 @@ XWaylandServer::XWaylandServer(WaylandCompositor *compositor, QObject *parent)
 XWaylandServer::~XWaylandServer()
 {
     shutdown();
+    stopListening();
 }
 
 WaylandCompositor *XWaylandServer::compositor() const
@@ -87,6 +164,9 @@ QString XWaylandServer::displayName() const
 
 bool XWaylandServer::start()
 {
+    if (m_process)
+        return true;
+
     if (::pipe(m_serverPairFd) < 0) {
         qCWarning(gLcXwayland, "Failed to create pipe for XWayland server: %s",
                   strerror(errno));
@@ -136,37 +216,142 @@ bool XWaylandServer::start()
         qCDebug(gLcXwayland) << "Xwayland finished with exit code" << exitCode;
 
         if (m_process) {
-            delete m_process;
+            m_process->deleteLater();
             m_process = nullptr;
         }
+        m_client = nullptr;
+
+        // Wait for the next X client
+        for (QSocketNotifier *notifier : m_listenNotifiers) {
+            if (notifier)
+                notifier->setEnabled(true);
+        }
+
+        Q_EMIT finished();
     });
 
-    QStringList args = QStringList()
-            << QStringLiteral("-displayfd") << QString::number(m_serverPairFd[1])
-            << QStringLiteral("-rootless")
-            << QStringLiteral("-wm") << QString::number(fd);
+    QStringList args;
+
+    // The display is already ours, Xwayland accepts clients on our sockets
+    int listenFds[2] = { -1, -1 };
+    if (isListening()) {
+        args << QStringLiteral(":%1").arg(m_display);
+        for (int i = 0; i < 2; ++i) {
+            // Without close-on-exec, to be inherited
+            listenFds[i] = ::dup(m_listenFds[i]);
+            args << QStringLiteral("-listenfd") << QString::number(listenFds[i]);
+        }
+    }
+
+    args << QStringLiteral("-displayfd") << QString::number(m_serverPairFd[1])
+         << QStringLiteral("-rootless")
+         << QStringLiteral("-wm") << QString::number(fd);
     qCDebug(gLcXwayland) << "Running:" << "Xwayland" << qPrintable(args.join(QStringLiteral(" ")));
     m_process->start(QStringLiteral("Xwayland"), args);
 
     ::close(m_serverPairFd[1]);
+    for (int listenFd : listenFds) {
+        if (listenFd >= 0)
+            ::close(listenFd);
+    }
 
     return true;
 }
 
 void XWaylandServer::shutdown()
 {
-    // Terminate XWayland server
-    if (m_process) {
-        m_process->terminate();
-        m_process->waitForFinished();
+    if (!m_process)
+        return;
 
+    // Terminate XWayland server, the process is deleted when finished
+    ServerProcess *process = m_process;
+    process->terminate();
+    if (!process->waitForFinished()) {
         // Kill the process only if it's still running
-        if (m_process && m_process->state() == QProcess::Running)
-            m_process->kill();
+        if (process->state() == QProcess::Running) {
+            process->kill();
+            process->waitForFinished();
+        }
+    }
+}
 
-        m_process->deleteLater();
-        m_process = nullptr;
+bool XWaylandServer::listen()
+{
+    if (isListening())
+        return true;
+
+    // Usually created at boot
+    ::mkdir("/tmp/.X11-unix", 01777);
+
+    for (int display = 0; display < 32; ++display) {
+        if (!createLockFile(display))
+            continue;
+
+        // The abstract socket first: if somebody else is listening there,
+        // the display is taken even without a lock file
+        m_listenFds[0] = bindToSocket(display, true);
+        m_listenFds[1] = m_listenFds[0] >= 0 ? bindToSocket(display, false) : -1;
+        if (m_listenFds[1] < 0) {
+            if (m_listenFds[0] >= 0)
+                ::close(m_listenFds[0]);
+            m_listenFds[0] = -1;
+            ::unlink(lockFilePath(display).constData());
+            continue;
+        }
+
+        for (int i = 0; i < 2; ++i) {
+            m_listenNotifiers[i] = new QSocketNotifier(m_listenFds[i], QSocketNotifier::Read, this);
+            connect(m_listenNotifiers[i], &QSocketNotifier::activated,
+                    this, &XWaylandServer::handleClientConnecting);
+        }
+
+        setDisplay(display);
+        qCInfo(gLcXwayland) << "Waiting for X clients on display" << m_displayName.toLatin1().constData();
+
+        return true;
+    }
+
+    qCWarning(gLcXwayland, "Failed to find a free display for Xwayland");
+    return false;
+}
+
+void XWaylandServer::stopListening()
+{
+    if (!isListening())
+        return;
+
+    for (int i = 0; i < 2; ++i) {
+        delete m_listenNotifiers[i];
+        m_listenNotifiers[i] = nullptr;
+        ::close(m_listenFds[i]);
+        m_listenFds[i] = -1;
     }
+
+    ::unlink(socketPath(m_display).constData());
+    ::unlink(lockFilePath(m_display).constData());
+}
+
+bool XWaylandServer::isListening() const
+{
+    return m_listenFds[0] >= 0;
+}
+
+bool XWaylandServer::isRunning() const
+{
+    return m_process != nullptr;
+}
+
+void XWaylandServer::setDisplay(int display)
+{
+    const QString displayName = QStringLiteral(":%1").arg(display);
+    m_display = display;
+    if (m_displayName == displayName)
+        return;
+
+    m_displayName = displayName;
+    Q_EMIT displayNameChanged();
+
+    qputenv("DISPLAY", m_displayName.toLatin1());
 }
 
 void XWaylandServer::handleServerStarted()
@@ -181,18 +366,14 @@ void XWaylandServer::handleServerStarted()
     QByteArray displayNumber = readPipe.readLine().trimmed();
 
     bool ok = false;
-    m_display = displayNumber.toInt(&ok);
+    const int display = displayNumber.toInt(&ok);
     if (!ok) {
         qCWarning(gLcXwayland, "Xwayland display read from pipe is not a number: %s",
                   displayNumber.constData());
         return;
     }
 
-    displayNumber.prepend(QByteArray(":"));
-    m_displayName = QString::fromLatin1(displayNumber);
-    Q_EMIT displayNameChanged();
-
-    qputenv("DISPLAY", m_displayName.toLatin1());
+    setDisplay(display);
 
     qCInfo(gLcXwayland) << "Xwayland started on display" << m_displayName.toLatin1().constData();
 
@@ -201,6 +382,19 @@ void XWaylandServer::handleServerStarted()
     Q_EMIT started(m_displayName);
 }
 
+void XWaylandServer::handleClientConnecting()
+{
+    // Xwayland accepts the connection, and the ones that follow
+    for (QSocketNotifier *notifier : m_listenNotifiers)
+        notifier->setEnabled(false);
+
+    qCInfo(gLcXwayland) << "X client connecting to" << m_displayName.toLatin1().constData()
+                        << ", starting Xwayland";
+
+    if (!start())
+        qCWarning(gLcXwayland) << "Failed to start XWayland";
+}
+
 } // namespace Compositor
 
 } // namespace Aurora
@@ -28,6 +28,8 @@
 
 #include <LiriAuroraCompositor/WaylandCompositor>
 
+class QSocketNotifier;
+
 struct wl_client;
 
 namespace Aurora {
@@ -59,10 +61,19 @@ public:
     bool start();
     void shutdown();
 
+    // Lazy mode: the display sockets are created right away,
+    // Xwayland is started when the first X client connects
+    bool listen();
+    void stopListening();
+    bool isListening() const;
+
+    bool isRunning() const;
+
 Q_SIGNALS:
     void displayNameChanged();
     void started(const QString &displayName);
     void failedToStart();
+    void finished();
 
 private:
     WaylandCompositor *m_compositor;
@@ -76,8 +87,14 @@ private:
 
     wl_client *m_client;
 
+    int m_listenFds[2] = { -1, -1 };
+    QSocketNotifier *m_listenNotifiers[2] = { nullptr, nullptr };
+
+    void setDisplay(int display);
+
 private Q_SLOTS:
     void handleServerStarted();
+    void handleClientConnecting();
 };
 
 } // namespace Compositor
@@ -107,22 +107,22 @@ void XWaylandShellSurface::initialize(XWaylandManager *wm, quint32 window,
     m_overrideRedirect = overrideRedirect;
 
     m_properties.deleteWindow = 0;
+    m_sizeHints = {};
+    m_motifHints = {};
 
+    m_hasAlpha = false;
     xcb_get_geometry_cookie_t cookie =
             xcb_get_geometry(Xcb::connection(), m_window);
+    m_wm->replies()->add<xcb_get_geometry_reply_t>(cookie.sequence, this, [this](xcb_get_geometry_reply_t *reply) {
+        if (reply)
+            m_hasAlpha = reply->depth == 32;
+    });
 
     quint32 values[1];
     values[0] = XCB_EVENT_MASK_PROPERTY_CHANGE;
     xcb_change_window_attributes(Xcb::connection(), m_window,
                                  XCB_CW_EVENT_MASK, values);
-
-    xcb_get_geometry_reply_t *reply =
-            xcb_get_geometry_reply(Xcb::connection(), cookie, nullptr);
-    if (reply)
-        m_hasAlpha = reply->depth == 32;
-    else
-        m_hasAlpha = false;
-    free(reply);
+    xcb_flush(Xcb::connection());
 
     Q_EMIT xChanged();
     Q_EMIT yChanged();
@@ -180,14 +180,17 @@ void XWaylandShellSurface::setSurface(WaylandSurface *surface)
 
         qCDebug(gLcXwayland) << "Assign surface" << surface << "to shell surface for" << m_window;
 
-        readProperties();
-        Q_EMIT m_wm->shellSurfaceCreated(this);
-
         handleSeatChanged(m_wm->compositor()->defaultSeat(), nullptr);
         connect(m_wm->compositor(), &WaylandCompositor::defaultSeatChanged,
                 this, &XWaylandShellSurface::handleSeatChanged);
 
-        Q_EMIT mapped();
+        // Announce the window once its properties are known
+        readProperties([this, surface]() {
+            if (m_surface != surface)
+                return;
+            Q_EMIT m_wm->shellSurfaceCreated(this);
+            Q_EMIT mapped();
+        });
     } else {
         qCDebug(gLcXwayland) << "Unassign surface to shell surface for" << m_window;
         Q_EMIT unmapped();
@@ -323,10 +326,17 @@ void XWaylandShellSurface::dirtyProperties()
     m_propsDirty = true;
 }
 
-void XWaylandShellSurface::readProperties()
+void XWaylandShellSurface::readProperties(std::function<void ()> callback)
 {
-    if (!m_propsDirty)
+    if (callback)
+        m_propertiesRead.append(std::move(callback));
+
+    if (!m_propsDirty) {
+        // Callbacks wait for the read in progress, if any
+        if (!m_pendingProperties)
+            runPropertiesRead();
         return;
+    }
     m_propsDirty = false;
 
     QMap<xcb_atom_t, xcb_atom_t> props;
@@ -340,164 +350,207 @@ void XWaylandShellSurface::readProperties()
     props[Xcb::resources()->atoms->net_wm_name] = XCB_ATOM_STRING;
     props[Xcb::resources()->atoms->motif_wm_hints] = TYPE_MOTIF_WM_HINTS;
 
-    QMap<xcb_atom_t, xcb_get_property_cookie_t> cookies;
-    for (xcb_atom_t atom : props.keys()) {
+    qCDebug(gLcXwaylandTrace) << "Properties:";
+
+    // All properties are requested at once, a busy client doesn't hold back
+    // the compositor; they are collected and applied when the last reply
+    // arrives, so that nobody sees a window with half of its properties
+    auto pending = std::make_shared<PendingProperties>();
+    pending->remaining = props.size();
+    m_pendingProperties = pending;
+
+    for (auto it = props.cbegin(); it != props.cend(); ++it) {
+        const xcb_atom_t atom = it.key();
+        const xcb_atom_t type = it.value();
         xcb_get_property_cookie_t cookie = xcb_get_property(
                     Xcb::connection(), 0, m_window, atom, XCB_ATOM_ANY, 0, 2048);
-        cookies[atom] = cookie;
+        m_wm->replies()->add<xcb_get_property_reply_t>(cookie.sequence, this, [this, atom, type, pending](xcb_get_property_reply_t *reply) {
+            // Properties changed again meanwhile, a newer read is in progress
+            if (m_pendingProperties != pending)
+                return;
+
+            handleProperty(atom, type, reply, pending.get());
+            if (--pending->remaining > 0)
+                return;
+
+            m_pendingProperties.reset();
+            applyProperties(*pending);
+            runPropertiesRead();
+        });
     }
+    xcb_flush(Xcb::connection());
+}
 
-    m_sizeHints.flags = 0;
-    m_motifHints.flags = 0;
-    m_properties.deleteWindow = 0;
+void XWaylandShellSurface::runPropertiesRead()
+{
+    const auto callbacks = std::exchange(m_propertiesRead, {});
+    for (const auto &callback : callbacks)
+        callback();
+}
+
+void XWaylandShellSurface::handleProperty(xcb_atom_t atom, xcb_atom_t type, xcb_get_property_reply_t *reply,
+                                          PendingProperties *props)
+{
+    if (!reply)
+        // Bad window, usually
+        return;
+    if (reply->type == XCB_ATOM_NONE)
+        // No such property
+        return;
+
+    Xcb::Properties::dumpProperty(atom, reply);
+
+    const int length = xcb_get_property_value_length(reply);
+
+    switch (type) {
+    case XCB_ATOM_STRING: {
+        // WM_CLASS holds the instance and the class, the first one is used
+        const char *value = reinterpret_cast<const char *>(xcb_get_property_value(reply));
+        const QString string = QString::fromUtf8(value, qstrnlen(value, length));
+        if (atom == XCB_ATOM_WM_CLASS) {
+            props->appId = string;
+            props->hasAppId = true;
+        } else if (atom == XCB_ATOM_WM_NAME || atom == Xcb::resources()->atoms->net_wm_name) {
+            props->title = string;
+            props->hasTitle = true;
+        }
+        break;
+    }
+    case XCB_ATOM_WINDOW:
+        if (reply->value_len > 0)
+            props->transientFor = *reinterpret_cast<xcb_window_t *>(xcb_get_property_value(reply));
+        break;
+    case XCB_ATOM_ATOM:
+        if (atom == Xcb::resources()->atoms->net_wm_window_type) {
+            const xcb_atom_t *atoms = static_cast<xcb_atom_t *>(xcb_get_property_value(reply));
+            props->windowTypes = QVector<xcb_atom_t>(atoms, atoms + reply->value_len);
+        }
+        break;
+    case TYPE_WM_PROTOCOLS: {
+        xcb_atom_t *atoms = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
+        for (quint32 i = 0; i < reply->value_len; ++i)
+            if (atoms[i] == Xcb::resources()->atoms->wm_delete_window)
+                props->deleteWindow = true;
+        break;
+    }
+    case TYPE_WM_NORMAL_HINTS:
+        memcpy(&props->sizeHints, xcb_get_property_value(reply),
+               qMin<size_t>(length, sizeof props->sizeHints));
+        break;
+    case TYPE_NET_WM_STATE: {
+        const xcb_atom_t *atoms = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
+        props->netWmState = QVector<xcb_atom_t>(atoms, atoms + reply->value_len);
+        break;
+    }
+    case TYPE_MOTIF_WM_HINTS:
+        memcpy(&props->motifHints, xcb_get_property_value(reply),
+               qMin<size_t>(length, sizeof props->motifHints));
+        break;
+    default:
+        break;
+    }
+}
+
+void XWaylandShellSurface::applyProperties(const PendingProperties &props)
+{
+    m_sizeHints = props.sizeHints;
+    m_motifHints = props.motifHints;
+    m_properties.deleteWindow = props.deleteWindow ? 1 : 0;
+
+    if (props.hasAppId) {
+        m_properties.appId = props.appId;
+        Q_EMIT appIdChanged();
+    }
+
+    if (props.hasTitle) {
+        m_properties.title = props.title;
+        Q_EMIT titleChanged();
+    }
+
+    if (props.transientFor != XCB_WINDOW_NONE) {
+        XWaylandShellSurface *shellSurface = m_wm->shellSurfaceFromId(props.transientFor);
+        if (shellSurface) {
+            m_transientFor = shellSurface;
+            m_windowType = Qt::SubWindow;
+            Q_EMIT parentSurfaceChanged();
+            Q_EMIT windowTypeChanged();
+        }
+    }
 
     if (m_overrideRedirect) {
         m_decorate = false;
         Q_EMIT decorateChanged();
     }
 
-    qCDebug(gLcXwaylandTrace) << "Properties:";
-
-    for (xcb_atom_t atom : props.keys()) {
-        xcb_get_property_reply_t *reply =
-                xcb_get_property_reply(Xcb::connection(), cookies[atom], nullptr);
-        if (!reply)
-            // Bad window, usually
-            continue;
-        if (reply->type == XCB_ATOM_NONE) {
-            // No such property
-            free(reply);
-            continue;
-        }
+    if (m_motifHints.flags & MWM_HINTS_DECORATIONS) {
+        if (m_motifHints.decorations & MWM_DECOR_ALL)
+            // MWM_DECOR_ALL means all except the other values listed
+            m_decorate = MWM_DECOR_EVERYTHING & (~m_motifHints.decorations);
+        else
+            m_decorate = m_motifHints.decorations > 0;
+        Q_EMIT decorateChanged();
+    }
 
-        Xcb::Properties::dumpProperty(atom, reply);
-
-        switch (props[atom]) {
-        case XCB_ATOM_STRING: {
-            char *p = strndup(reinterpret_cast<char *>(xcb_get_property_value(reply)),
-                              xcb_get_property_value_length(reply));
-            if (atom == XCB_ATOM_WM_CLASS) {
-                m_properties.appId = QString::fromUtf8(p);
-                Q_EMIT appIdChanged();
-            } else if (atom == XCB_ATOM_WM_NAME || Xcb::resources()->atoms->net_wm_name) {
-                m_properties.title = QString::fromUtf8(p);
-                Q_EMIT titleChanged();
-            } else {
-                free(p);
-            }
-            break;
-        }
-        case XCB_ATOM_WINDOW: {
-            xcb_window_t *xid = reinterpret_cast<xcb_window_t *>(xcb_get_property_value(reply));
-            XWaylandShellSurface *shellSurface = m_wm->shellSurfaceFromId(*xid);
-            if (shellSurface) {
-                m_transientFor = shellSurface;
-                m_windowType = Qt::SubWindow;
-                Q_EMIT parentSurfaceChanged();
+    for (xcb_atom_t atom : props.windowTypes) {
+        // Set Popup window type unless we already know this is a SubWindow
+        if (!m_transientFor) {
+            if (atom == Xcb::resources()->atoms->net_wm_window_type_tooltip ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_utility ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_dnd ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_dropdown ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_menu ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_notification ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_popup ||
+                    atom == Xcb::resources()->atoms->net_wm_window_type_combo) {
+                m_windowType = Qt::Popup;
                 Q_EMIT windowTypeChanged();
             }
-            break;
         }
-        case XCB_ATOM_ATOM: {
-            if (atom == Xcb::resources()->atoms->net_wm_window_type) {
-                xcb_atom_t *atoms = static_cast<xcb_atom_t *>(xcb_get_property_value(reply));
-                for (quint32 i = 0; i < reply->value_len; ++i) {
-                    // Set Popup window type unless we already know this is a SubWindow
-                    if (!m_transientFor) {
-                        if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_tooltip ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_utility ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_dnd ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_dropdown ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_menu ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_notification ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_popup ||
-                                atoms[i] == Xcb::resources()->atoms->net_wm_window_type_combo) {
-                            m_windowType = Qt::Popup;
-                            Q_EMIT windowTypeChanged();
-                        }
-                    }
-
-                    // Save XWayland window type
-                    WmWindowType wmWindowType;
-                    if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_tooltip)
-                        wmWindowType = TooltipWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_utility)
-                        wmWindowType = UtilityWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_dnd)
-                        wmWindowType = DndWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_dropdown)
-                        wmWindowType = DropdownWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_menu)
-                        wmWindowType = MenuWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_notification)
-                        wmWindowType = NotificationWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_popup)
-                        wmWindowType = PopupWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_combo)
-                        wmWindowType = ComboWindow;
-                    else if (atoms[i] == Xcb::resources()->atoms->net_wm_window_type_splash)
-                        wmWindowType = SplashWindow;
-                    else
-                        wmWindowType = ToplevelWindow;
-                    if (wmWindowType != m_wmWindowType) {
-                        m_wmWindowType = wmWindowType;
-                        Q_EMIT wmWindowTypeChanged();
-                    }
-
-                    // Make sure only toplevel windows are decorated
-                    if (m_decorate && m_wmWindowType != ToplevelWindow) {
-                        m_decorate = false;
-                        Q_EMIT decorateChanged();
-                    }
-                }
-            }
-            break;
+
+        // Save XWayland window type
+        WmWindowType wmWindowType;
+        if (atom == Xcb::resources()->atoms->net_wm_window_type_tooltip)
+            wmWindowType = TooltipWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_utility)
+            wmWindowType = UtilityWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_dnd)
+            wmWindowType = DndWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_dropdown)
+            wmWindowType = DropdownWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_menu)
+            wmWindowType = MenuWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_notification)
+            wmWindowType = NotificationWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_popup)
+            wmWindowType = PopupWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_combo)
+            wmWindowType = ComboWindow;
+        else if (atom == Xcb::resources()->atoms->net_wm_window_type_splash)
+            wmWindowType = SplashWindow;
+        else
+            wmWindowType = ToplevelWindow;
+        if (wmWindowType != m_wmWindowType) {
+            m_wmWindowType = wmWindowType;
+            Q_EMIT wmWindowTypeChanged();
         }
-        case TYPE_WM_PROTOCOLS: {
-            xcb_atom_t *atoms = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
-            for (quint32 i = 0; i < reply->value_len; ++i)
-                if (atoms[i] == Xcb::resources()->atoms->wm_delete_window)
-                    m_properties.deleteWindow = 1;
-            break;
+
+        // Make sure only toplevel windows are decorated
+        if (m_decorate && m_wmWindowType != ToplevelWindow) {
+            m_decorate = false;
+            Q_EMIT decorateChanged();
         }
-        case TYPE_WM_NORMAL_HINTS:
-            memcpy(&m_sizeHints, xcb_get_property_value(reply), sizeof m_sizeHints);
-            break;
-        case TYPE_NET_WM_STATE: {
-            xcb_atom_t *value = reinterpret_cast<xcb_atom_t *>(xcb_get_property_value(reply));
-            uint32_t i;
-            for (i = 0; i < reply->value_len; i++) {
-                if (value[i] == Xcb::resources()->atoms->net_wm_state_fullscreen && !m_fullscreen) {
-                    m_fullscreen = true;
-                    Q_EMIT fullscreenChanged();
-                }
-            }
-            if (value[i] == Xcb::resources()->atoms->net_wm_state_maximized_horz && !m_maximized) {
-                m_maximized = true;
-                Q_EMIT maximizedChanged();
-            }
-            if (value[i] == Xcb::resources()->atoms->net_wm_state_maximized_vert && !m_maximized) {
-                m_maximized = true;
-                Q_EMIT maximizedChanged();
-            }
-            break;
+    }
+
+    for (xcb_atom_t atom : props.netWmState) {
+        if (atom == Xcb::resources()->atoms->net_wm_state_fullscreen && !m_fullscreen) {
+            m_fullscreen = true;
+            Q_EMIT fullscreenChanged();
         }
-        case TYPE_MOTIF_WM_HINTS:
-            memcpy(&m_motifHints, xcb_get_property_value(reply), sizeof m_motifHints);
-            if (m_motifHints.flags & MWM_HINTS_DECORATIONS) {
-                if (m_motifHints.decorations & MWM_DECOR_ALL)
-                    // MWM_DECOR_ALL means all except the other values listed
-                    m_decorate = MWM_DECOR_EVERYTHING & (~m_motifHints.decorations);
-                else
-                    m_decorate = m_motifHints.decorations > 0;
-                Q_EMIT decorateChanged();
-            }
-            break;
-        default:
-            break;
+        if ((atom == Xcb::resources()->atoms->net_wm_state_maximized_horz ||
+             atom == Xcb::resources()->atoms->net_wm_state_maximized_vert) && !m_maximized) {
+            m_maximized = true;
+            Q_EMIT maximizedChanged();
         }
-
-        free(reply);
     }
 }
 
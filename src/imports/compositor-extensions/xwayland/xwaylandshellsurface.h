@@ -25,6 +25,7 @@
 
 #include <QtCore/QRect>
 #include <QtCore/QPointer>
+#include <QtCore/QVector>
 
 #include <LiriAuroraCompositor/aurorawaylandquickchildren.h>
 #include <LiriAuroraCompositor/WaylandOutput>
@@ -33,6 +34,9 @@
 
 #include <xcb/xcb.h>
 
+#include <functional>
+#include <memory>
+
 #include "xcbwindow.h"
 #include "sizehints.h"
 
@@ -146,7 +150,8 @@ public:
     void setWorkspace(int workspace);
 
     void dirtyProperties();
-    void readProperties();
+    // The callback is called once the properties are read and applied
+    void readProperties(std::function<void ()> callback = {});
     void setProperties();
 
     QSize sizeForResize(const QSizeF &size, const QPointF &delta, ResizeEdge edge);
@@ -232,6 +237,28 @@ private:
     bool m_moving;
     bool m_resizing;
 
+    struct PendingProperties {
+        int remaining = 0;
+        bool hasAppId = false;
+        QString appId;
+        bool hasTitle = false;
+        QString title;
+        xcb_window_t transientFor = XCB_WINDOW_NONE;
+        QVector<xcb_atom_t> windowTypes;
+        QVector<xcb_atom_t> netWmState;
+        bool deleteWindow = false;
+        WmSizeHints sizeHints = {};
+        MotifWmHints motifHints = {};
+    };
+
+    std::shared_ptr<PendingProperties> m_pendingProperties;
+    QList<std::function<void ()>> m_propertiesRead;
+
+    void handleProperty(xcb_atom_t atom, xcb_atom_t type, xcb_get_property_reply_t *reply,
+                        PendingProperties *props);
+    void applyProperties(const PendingProperties &props);
+    void runPropertiesRead();
+
     friend class XWaylandManager;
 
 private Q_SLOTS:
@@ -116,6 +116,72 @@ void EglFSFunctions::disableScreenCast(QScreen *screen)
         func(screen);
 }
 
+QByteArray EglFSFunctions::scanoutBufferIdentifier()
+{
+    return QByteArrayLiteral("LiriEglFSScanoutBuffer");
+}
+
+bool EglFSFunctions::scanoutBuffer(QScreen *screen, const ScanoutBuffer &buffer, QObject *receiver)
+{
+    ScanoutBufferType func = reinterpret_cast<ScanoutBufferType>(QGuiApplication::platformFunction(scanoutBufferIdentifier()));
+    if (func)
+        return func(screen, buffer, receiver);
+    return false;
+}
+
+QByteArray EglFSFunctions::releaseScanoutBufferIdentifier()
+{
+    return QByteArrayLiteral("LiriEglFSReleaseScanoutBuffer");
+}
+
+void EglFSFunctions::releaseScanoutBuffer(QScreen *screen, quint64 cacheKey)
+{
+    ReleaseScanoutBufferType func = reinterpret_cast<ReleaseScanoutBufferType>(QGuiApplication::platformFunction(releaseScanoutBufferIdentifier()));
+    if (func)
+        func(screen, cacheKey);
+}
+
+QByteArray EglFSFunctions::setOverlayLayersIdentifier()
+{
+    return QByteArrayLiteral("LiriEglFSSetOverlayLayers");
+}
+
+bool EglFSFunctions::setOverlayLayers(QScreen *screen, QVector<OverlayLayer> &layers)
+{
+    SetOverlayLayersType func = reinterpret_cast<SetOverlayLayersType>(QGuiApplication::platformFunction(setOverlayLayersIdentifier()));
+    if (func)
+        return func(screen, layers);
+    for (OverlayLayer &layer : layers)
+        layer.assigned = false;
+    return false;
+}
+
+QByteArray EglFSFunctions::scanoutFormatsIdentifier()
+{
+    return QByteArrayLiteral("LiriEglFSScanoutFormats");
+}
+
+ScanoutFormats EglFSFunctions::scanoutFormats(QScreen *screen)
+{
+    ScanoutFormatsType func = reinterpret_cast<ScanoutFormatsType>(QGuiApplication::platformFunction(scanoutFormatsIdentifier()));
+    if (func)
+        return func(screen);
+    return ScanoutFormats();
+}
+
+QByteArray EglFSFunctions::setCursorBufferIdentifier()
+{
+    return QByteArrayLiteral("LiriEglFSSetCursorBuffer");
+}
+
+bool EglFSFunctions::setCursorBuffer(QScreen *screen, const CursorBuffer &buffer, QObject *receiver)
+{
+    SetCursorBufferType func = reinterpret_cast<SetCursorBufferType>(QGuiApplication::platformFunction(setCursorBufferIdentifier()));
+    if (func)
+        return func(screen, buffer, receiver);
+    return false;
+}
+
 /*
  * Screencast
  */
@@ -173,6 +239,54 @@ QEvent::Type ScreenCastReadyEvent::registeredType()
     return eventType;
 }
 
+/*
+ * Presentation
+ */
+
+PresentationEvent::PresentationEvent()
+    : QEvent(registeredType())
+{
+}
+
+QEvent::Type PresentationEvent::registeredType()
+{
+    // Posted from the page flip handler thread, while
+    // receivers might look it up from the main thread
+    static const QEvent::Type eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return eventType;
+}
+
+/*
+ * Cursor presentation
+ */
+
+CursorPresentationEvent::CursorPresentationEvent()
+    : QEvent(registeredType())
+{
+}
+
+QEvent::Type CursorPresentationEvent::registeredType()
+{
+    // Posted from the page flip handler thread too
+    static const QEvent::Type eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return eventType;
+}
+
+/*
+ * Relative motion
+ */
+
+RelativeMotionEvent::RelativeMotionEvent()
+    : QEvent(registeredType())
+{
+}
+
+QEvent::Type RelativeMotionEvent::registeredType()
+{
+    static const QEvent::Type eventType = static_cast<QEvent::Type>(QEvent::registerEventType());
+    return eventType;
+}
+
 } // namespace PlatformSupport
 
 } // namespace Aurora
@@ -24,7 +24,10 @@
 #pragma once
 
 #include <QEvent>
+#include <QHash>
 #include <QGuiApplication>
+#include <QImage>
+#include <QPointF>
 
 #include <LiriAuroraPlatformHeaders/liriauroraplatformheadersglobal.h>
 
@@ -45,6 +48,63 @@ public:
     qreal scale = 1.0f;
 };
 
+class LIRIAURORAPLATFORMHEADERS_EXPORT ScanoutBuffer
+{
+public:
+    explicit ScanoutBuffer() = default;
+
+    QSize size;
+    quint32 drmFormat = 0;
+    quint64 modifier = 0;
+    int planeCount = 0;
+    int fds[4] = { -1, -1, -1, -1 };
+    quint32 offsets[4] = { 0, 0, 0, 0 };
+    quint32 strides[4] = { 0, 0, 0, 0 };
+    // Identifies the buffer across frames when not 0, its framebuffer
+    // is kept until releaseScanoutBuffer() is called with the same key
+    quint64 cacheKey = 0;
+};
+
+class LIRIAURORAPLATFORMHEADERS_EXPORT OverlayLayer
+{
+public:
+    explicit OverlayLayer() = default;
+
+    ScanoutBuffer buffer;
+    // Area of the buffer in buffer pixels and where it goes in screen pixels
+    QRect sourceRect;
+    QRect destinationRect;
+    // Layers with a higher level are stacked on top
+    int stackingLevel = 0;
+    // Set when the layer was placed on a plane
+    bool assigned = false;
+};
+
+class LIRIAURORAPLATFORMHEADERS_EXPORT CursorBuffer
+{
+public:
+    explicit CursorBuffer() = default;
+
+    // Either a shared memory image or a dmabuf, none of them
+    // goes back to the cursor of the window
+    QImage image;
+    ScanoutBuffer buffer;
+    QPoint hotSpot;
+};
+
+class LIRIAURORAPLATFORMHEADERS_EXPORT ScanoutFormats
+{
+public:
+    explicit ScanoutFormats() = default;
+
+    // dev_t of the KMS device, 0 when nothing can be scanned out
+    quint64 device = 0;
+    // Modifiers of each format, a format without modifiers only
+    // supports implicit and linear layouts
+    QHash<quint32, QVector<quint64>> primaryFormats;
+    QHash<quint32, QVector<quint64>> overlayFormats;
+};
+
 class LIRIAURORAPLATFORMHEADERS_EXPORT EglFSFunctions
 {
 public:
@@ -82,6 +142,26 @@ public:
     typedef void (*DisableScreenCastType)(QScreen *screen);
     static QByteArray disableScreenCastIdentifier();
     static void disableScreenCast(QScreen *screen);
+
+    typedef bool (*ScanoutBufferType)(QScreen *screen, const ScanoutBuffer &buffer, QObject *receiver);
+    static QByteArray scanoutBufferIdentifier();
+    static bool scanoutBuffer(QScreen *screen, const ScanoutBuffer &buffer, QObject *receiver = nullptr);
+
+    typedef void (*ReleaseScanoutBufferType)(QScreen *screen, quint64 cacheKey);
+    static QByteArray releaseScanoutBufferIdentifier();
+    static void releaseScanoutBuffer(QScreen *screen, quint64 cacheKey);
+
+    typedef bool (*SetOverlayLayersType)(QScreen *screen, QVector<OverlayLayer> &layers);
+    static QByteArray setOverlayLayersIdentifier();
+    static bool setOverlayLayers(QScreen *screen, QVector<OverlayLayer> &layers);
+
+    typedef ScanoutFormats (*ScanoutFormatsType)(QScreen *screen);
+    static QByteArray scanoutFormatsIdentifier();
+    static ScanoutFormats scanoutFormats(QScreen *screen);
+
+    typedef bool (*SetCursorBufferType)(QScreen *screen, const CursorBuffer &buffer, QObject *receiver);
+    static QByteArray setCursorBufferIdentifier();
+    static bool setCursorBuffer(QScreen *screen, const CursorBuffer &buffer, QObject *receiver = nullptr);
 };
 
 class LIRIAURORAPLATFORMHEADERS_EXPORT ScreenCastFrameEvent : public QEvent
@@ -133,6 +213,58 @@ public:
     static QEvent::Type registeredType();
 };
 
+class LIRIAURORAPLATFORMHEADERS_EXPORT PresentationEvent : public QEvent
+{
+public:
+    // Same meaning as the wp_presentation_feedback kind flags
+    enum Flag {
+        Vsync = 0x1,
+        HwClock = 0x2,
+        HwCompletion = 0x4,
+        ZeroCopy = 0x8
+    };
+    Q_DECLARE_FLAGS(Flags, Flag)
+
+    explicit PresentationEvent();
+
+    QScreen *screen = nullptr;
+    quint64 sequence = 0;
+    quint64 tv_sec = 0;
+    quint32 tv_nsec = 0;
+    quint32 refresh_nsec = 0;
+    Flags flags;
+
+    static QEvent::Type registeredType();
+};
+
+Q_DECLARE_OPERATORS_FOR_FLAGS(PresentationEvent::Flags)
+
+// Posted to the receiver given to setCursorBuffer() when a change of the cursor buffer reached the screen
+class LIRIAURORAPLATFORMHEADERS_EXPORT CursorPresentationEvent : public QEvent
+{
+public:
+    explicit CursorPresentationEvent();
+
+    QScreen *screen = nullptr;
+
+    static QEvent::Type registeredType();
+};
+
+class LIRIAURORAPLATFORMHEADERS_EXPORT RelativeMotionEvent : public QEvent
+{
+public:
+    explicit RelativeMotionEvent();
+
+    // Sum of the motion read from the input devices at once, the
+    // unaccelerated motion is what the devices reported
+    QPointF delta;
+    QPointF deltaUnaccelerated;
+    // Time of the last motion in microseconds
+    quint64 timestamp = 0;
+
+    static QEvent::Type registeredType();
+};
+
 } // namespace PlatformSupport
 
 } // namespace Aurora
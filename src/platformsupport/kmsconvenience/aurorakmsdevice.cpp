@@ -48,6 +48,7 @@
 #include <errno.h>
 
 #include "aurorakmsdevice_p.h"
+#include "aurorastartuptrace_p.h"
 
 #define ARRAY_LENGTH(a) (sizeof (a) / sizeof (a)[0])
 
@@ -661,6 +662,8 @@ static bool orderedScreenLessThan(const OrderedScreen &a, const OrderedScreen &b
 
 void KmsDevice::createScreens()
 {
+    StartupTrace::Span span("kms", "createScreens");
+
     // Headless mode using a render node: cannot do any output related DRM
     // stuff. Skip it all and register a dummy screen.
     if (m_screenConfig->headless()) {
@@ -864,6 +867,8 @@ void KmsDevice::enumerateProperties(drmModeObjectPropertiesPtr objProps, PropCal
 
 void KmsDevice::discoverPlanes()
 {
+    StartupTrace::Span span("kms", "discoverPlanes");
+
     m_planes.clear();
 
     drmModePlaneResPtr planeResources = drmModeGetPlaneResources(m_dri_fd);
@@ -902,7 +907,8 @@ void KmsDevice::discoverPlanes()
             continue;
         }
 
-        enumerateProperties(objProps, [&plane](drmModePropertyPtr prop, quint64 value) {
+        uint32_t inFormatsBlobId = 0;
+        enumerateProperties(objProps, [&plane, &inFormatsBlobId](drmModePropertyPtr prop, quint64 value) {
             if (!strcmp(prop->name, "type")) {
                 plane.type = KmsPlane::Type(value);
             } else if (!strcmp(prop->name, "rotation")) {
@@ -937,9 +943,14 @@ void KmsDevice::discoverPlanes()
                 plane.zposPropertyId = prop->prop_id;
             } else if (!strcasecmp(prop->name, "blend_op")) {
                 plane.blendOpPropertyId = prop->prop_id;
+            } else if (!strcmp(prop->name, "IN_FORMATS")) {
+                inFormatsBlobId = uint32_t(value);
             }
         });
 
+        if (inFormatsBlobId)
+            parseFormatModifiers(inFormatsBlobId, &plane);
+
         m_planes.append(plane);
 
         drmModeFreeObjectProperties(objProps);
@@ -948,6 +959,51 @@ void KmsDevice::discoverPlanes()
     drmModeFreePlaneResources(planeResources);
 }
 
+void KmsDevice::parseFormatModifiers(uint32_t blobId, KmsPlane *plane)
+{
+    drmModePropertyBlobPtr blob = drmModeGetPropertyBlob(m_dri_fd, blobId);
+    if (!blob)
+        return;
+
+    // See struct drm_format_modifier_blob in drm_mode.h
+    const auto *header = static_cast<const drm_format_modifier_blob *>(blob->data);
+    if (blob->length >= sizeof(*header) && header->version == FORMAT_BLOB_CURRENT) {
+        const auto *data = static_cast<const uchar *>(blob->data);
+        const auto *formats = reinterpret_cast<const uint32_t *>(data + header->formats_offset);
+        const auto *modifiers = reinterpret_cast<const drm_format_modifier *>(data + header->modifiers_offset);
+
+        for (uint32_t i = 0; i < header->count_modifiers; ++i) {
+            const drm_format_modifier &modifier = modifiers[i];
+            // Each entry covers 64 formats starting from offset
+            for (int bit = 0; bit < 64; ++bit) {
+                if (!(modifier.formats & (uint64_t(1) << bit)))
+                    continue;
+                const uint32_t index = modifier.offset + bit;
+                if (index < header->count_formats)
+                    plane->supportedModifiers[formats[index]].append(modifier.modifier);
+            }
+        }
+    }
+
+    drmModeFreePropertyBlob(blob);
+}
+
+bool KmsPlane::supportsFormat(uint32_t format, uint64_t modifier) const
+{
+    if (!supportedFormats.contains(format))
+        return false;
+
+    // Without modifiers the driver picks the layout, which is
+    // what planes without IN_FORMATS support as well
+    if (modifier == DRM_FORMAT_MOD_INVALID)
+        return true;
+
+    const auto it = supportedModifiers.constFind(format);
+    if (it == supportedModifiers.cend())
+        return modifier == DRM_FORMAT_MOD_LINEAR;
+    return it->contains(modifier);
+}
+
 int KmsDevice::fd() const
 {
     return m_dri_fd;
@@ -1065,6 +1121,8 @@ KmsScreenConfig::KmsScreenConfig()
     , m_hwCursor(true)
     , m_separateScreens(false)
     , m_pbuffers(false)
+    , m_asyncPageFlip(false)
+    , m_flipQueueDepth(1)
     , m_virtualDesktopLayout(VirtualDesktopLayoutHorizontal)
 {
     loadConfig();
@@ -1111,6 +1169,14 @@ void KmsScreenConfig::loadConfig()
     m_pbuffers = object.value(QLatin1String("pbuffers")).toBool(m_pbuffers);
     m_devicePath = object.value(QLatin1String("device")).toString();
     m_separateScreens = object.value(QLatin1String("separateScreens")).toBool(m_separateScreens);
+    m_asyncPageFlip = object.value(QLatin1String("asyncPageFlip")).toBool(m_asyncPageFlip);
+
+    // Frames that can be in flight or waiting to be flipped before rendering blocks
+    const int flipQueueDepth = object.value(QLatin1String("flipQueueDepth")).toInt(m_flipQueueDepth);
+    if (flipQueueDepth == 1 || flipQueueDepth == 2)
+        m_flipQueueDepth = flipQueueDepth;
+    else
+        qCWarning(qLcKmsDebug) << "Invalid flipQueueDepth value" << flipQueueDepth << "- must be 1 or 2";
 
     const QString vdOriString = object.value(QLatin1String("virtualDesktopLayout")).toString();
     if (!vdOriString.isEmpty()) {
@@ -1142,6 +1208,8 @@ void KmsScreenConfig::loadConfig()
                          << "\thwcursor:" << m_hwCursor << "\n"
                          << "\tpbuffers:" << m_pbuffers << "\n"
                          << "\tseparateScreens:" << m_separateScreens << "\n"
+                         << "\tasyncPageFlip:" << m_asyncPageFlip << "\n"
+                         << "\tflipQueueDepth:" << m_flipQueueDepth << "\n"
                          << "\tvirtualDesktopLayout:" << m_virtualDesktopLayout << "\n"
                          << "\toutputs:" << m_outputSettings;
 }
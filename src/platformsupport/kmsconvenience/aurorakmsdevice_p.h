@@ -54,6 +54,7 @@
 
 #include <QtGui/private/qtguiglobal_p.h>
 #include <qpa/qplatformscreen.h>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QVariant>
 #include <QtCore/QThreadStorage>
@@ -120,6 +121,8 @@ public:
     bool hwCursor() const { return m_hwCursor; }
     bool separateScreens() const { return m_separateScreens; }
     bool supportsPBuffers() const { return m_pbuffers; }
+    bool asyncPageFlip() const { return m_asyncPageFlip; }
+    int flipQueueDepth() const { return m_flipQueueDepth; }
     VirtualDesktopLayout virtualDesktopLayout() const { return m_virtualDesktopLayout; }
 
     QMap<QString, QVariantMap> outputSettings() const { return m_outputSettings; }
@@ -133,6 +136,8 @@ private:
     bool m_hwCursor;
     bool m_separateScreens;
     bool m_pbuffers;
+    bool m_asyncPageFlip;
+    int m_flipQueueDepth;
     VirtualDesktopLayout m_virtualDesktopLayout;
     QMap<QString, QVariantMap> m_outputSettings;
 };
@@ -165,6 +170,10 @@ struct KmsPlane
     int possibleCrtcs = 0;
 
     QVector<uint32_t> supportedFormats;
+    // Modifiers of each format, only known when the plane has IN_FORMATS
+    QHash<uint32_t, QVector<uint64_t>> supportedModifiers;
+
+    bool supportsFormat(uint32_t format, uint64_t modifier) const;
 
     Rotations initialRotation = Rotation0;
     Rotations availableRotations = Rotation0;
@@ -275,6 +284,7 @@ protected:
     typedef std::function<void(drmModePropertyPtr, quint64)> PropCallback;
     void enumerateProperties(drmModeObjectPropertiesPtr objProps, PropCallback callback);
     void discoverPlanes();
+    void parseFormatModifiers(uint32_t blobId, KmsPlane *plane);
     void parseConnectorProperties(uint32_t connectorId, KmsOutput *output);
     void parseCrtcProperties(uint32_t crtcId, KmsOutput *output);
 
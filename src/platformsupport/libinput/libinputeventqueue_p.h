@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QtCore/QtGlobal>
+
+#include <array>
+#include <atomic>
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Liri LibInput API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+namespace Aurora {
+
+namespace PlatformSupport {
+
+/*
+ * Bounded queue for one producer thread and one consumer thread.
+ *
+ * Neither side ever takes a lock, so the input thread can't be held
+ * back by a busy GUI thread and vice versa.  Slots are allocated once,
+ * items are moved in and out of them.
+ */
+template <typename T, int Capacity>
+class LibInputEventQueue
+{
+    static_assert(Capacity > 1 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+public:
+    // Producer side, returns false leaving the item untouched when the queue is full
+    bool push(T &&item)
+    {
+        const quint32 tail = m_tail.load(std::memory_order_relaxed);
+        const quint32 next = (tail + 1) & (Capacity - 1);
+        if (next == m_head.load(std::memory_order_acquire))
+            return false;
+
+        m_items[tail] = std::move(item);
+        m_tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, returns false when the queue is empty
+    bool pop(T &item)
+    {
+        const quint32 head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+
+        item = std::move(m_items[head]);
+        m_items[head] = T();
+        m_head.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    // Keep the indices on separate cache lines, each is written by one thread only
+    alignas(64) std::atomic<quint32> m_head = { 0 };
+    alignas(64) std::atomic<quint32> m_tail = { 0 };
+    std::array<T, Capacity> m_items;
+};
+
+} // namespace PlatformSupport
+
+} // namespace Aurora
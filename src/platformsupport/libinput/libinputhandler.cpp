@@ -31,6 +31,7 @@
 #include <LiriAuroraUdev/private/udev_p.h>
 #include <LiriAuroraLogind/Logind>
 
+#include "aurorastartuptrace_p.h"
 #include "libinputhandler.h"
 #include "libinputhandler_p.h"
 
@@ -85,6 +86,7 @@ LibInputHandlerPrivate::~LibInputHandlerPrivate()
 void LibInputHandlerPrivate::setup()
 {
     Q_Q(LibInputHandler);
+    StartupTrace::Span span("input", "libinput");
 
     // Initialize
     initialize();
@@ -109,6 +111,7 @@ void LibInputHandlerPrivate::setup()
     });
 
     // Pick up the initial events for devices being added
+    StartupTrace::Span devicesSpan("input", "devicesAdded");
     q->handleEvents();
 }
 
@@ -144,6 +147,8 @@ void LibInputHandlerPrivate::initialize()
         qFatal("Cannot determine seat, aborting...");
         return;
     } else {
+        // Devices are enumerated when the seat is assigned
+        StartupTrace::Span span("input", "deviceEnumeration");
         if (Q_UNLIKELY(libinput_udev_assign_seat(li, qPrintable(seat)) != 0)) {
             qFatal("Failed to assign seat \"%s\" to libinput", qPrintable(seat));
             return;
@@ -153,6 +158,8 @@ void LibInputHandlerPrivate::initialize()
 
     keyboard = new LibInputKeyboard(q);
     pointer = new LibInputPointer(q);
+    if (pointerGeometry.isValid())
+        pointer->setGeometry(pointerGeometry);
     touch = new LibInputTouch(q);
     gesture = new LibInputGesture(q);
 
@@ -348,6 +355,15 @@ void LibInputHandler::setPointerPosition(const QPoint &pos)
     d->pointer->setPosition(pos);
 }
 
+void LibInputHandler::setPointerGeometry(const QRect &geometry)
+{
+    Q_D(LibInputHandler);
+
+    d->pointerGeometry = geometry;
+    if (d->pointer)
+        d->pointer->setGeometry(geometry);
+}
+
 void LibInputHandler::suspend()
 {
     Q_D(LibInputHandler);
@@ -520,6 +536,9 @@ void LibInputHandler::handleEvents()
 
         libinput_event_destroy(event);
     }
+
+    // All the motion read now is delivered as a single event
+    d->pointer->flushMotion();
 }
 
 } // namespace PlatformSupport
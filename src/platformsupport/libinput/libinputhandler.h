@@ -49,15 +49,22 @@ struct LIRIAURORALIBINPUT_EXPORT LibInputKeyEvent
     QString text;
     bool autoRepeat;
     ushort repeatCount;
+    // Microseconds, CLOCK_MONOTONIC
+    quint64 timestamp = 0;
 };
 
 struct LIRIAURORALIBINPUT_EXPORT LibInputMouseEvent
 {
-    QPoint pos;
+    QPointF pos;
     Qt::MouseButton button;
     Qt::MouseButtons buttons;
     Qt::KeyboardModifiers modifiers;
     QPoint wheelDelta;
+    // Relative motion since the previous event, before clipping to the screens
+    QPointF delta;
+    QPointF deltaUnaccelerated;
+    // Microseconds, CLOCK_MONOTONIC
+    quint64 timestamp = 0;
 };
 
 struct LIRIAURORALIBINPUT_EXPORT LibInputTouchEvent
@@ -65,6 +72,8 @@ struct LIRIAURORALIBINPUT_EXPORT LibInputTouchEvent
     QTouchDevice *device;
     QList<QWindowSystemInterface::TouchPoint> touchPoints;
     Qt::KeyboardModifiers modifiers;
+    // Microseconds, CLOCK_MONOTONIC
+    quint64 timestamp = 0;
 };
 
 class LIRIAURORALIBINPUT_EXPORT LibInputHandler : public QObject
@@ -94,6 +103,7 @@ public:
     int gestureCount() const;
 
     void setPointerPosition(const QPoint &pos);
+    void setPointerGeometry(const QRect &geometry);
 
     bool isSuspended() const;
 
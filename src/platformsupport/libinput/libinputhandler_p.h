@@ -84,6 +84,7 @@ public:
 
     LibInputPointer *pointer;
     int pointerCount;
+    QRect pointerGeometry;
 
     LibInputTouch *touch;
     int touchCount;
@@ -35,10 +35,13 @@
 #include <QtCore/QTimer>
 #include <QtGui/qpa/qwindowsysteminterface.h>
 
+#include <chrono>
+
 #include <LiriAuroraLogind/Logind>
 
 #include <xkbcommon/xkbcommon.h>
 #include <LiriAuroraXkbCommonSupport/private/auroraxkbcommon_p.h>
+#include <LiriAuroraXkbCommonSupport/private/auroraxkbkeymapcache_p.h>
 
 #include "libinputhandler_p.h"
 #include "libinputkeyboard.h"
@@ -55,53 +58,33 @@ namespace PlatformSupport {
 LibInputKeyboardPrivate::LibInputKeyboardPrivate(LibInputKeyboard *self, LibInputHandler *h)
     : q_ptr(self)
     , handler(h)
-    , context(nullptr)
-    , keymap(nullptr)
-    , state(nullptr)
     , repeatRate(40)
     , repeatDelay(400)
 {
-    context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
-    if (!context) {
-        qCWarning(gLcLibinput) << "Unable to create xkb context";
-        return;
-    }
-
-    keymap = xkb_keymap_new_from_names(context, nullptr,
-                                       XKB_KEYMAP_COMPILE_NO_FLAGS);
+    // Same compiled keymap as the compositor keyboards with default names
+    keymap = XkbKeymapCache::keymap({});
     if (!keymap) {
         qCWarning(gLcLibinput) << "Unable to compile xkb keymap";
-        xkb_context_unref(context);
-        context = nullptr;
         return;
     }
 
-    state = xkb_state_new(keymap);
+    state = keymap->createState();
     if (!state) {
         qCWarning(gLcLibinput) << "Unable to create xkb state";
-        xkb_keymap_unref(keymap);
-        keymap = nullptr;
-        xkb_context_unref(context);
-        context = nullptr;
+        keymap.reset();
         return;
     }
 
-    modifiers[0] = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_CTRL);
-    modifiers[1] = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_ALT);
-    modifiers[2] = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_SHIFT);
-    modifiers[3] = xkb_keymap_mod_get_index(keymap, XKB_MOD_NAME_LOGO);
+    modifiers[0] = xkb_keymap_mod_get_index(keymap->keymap(), XKB_MOD_NAME_CTRL);
+    modifiers[1] = xkb_keymap_mod_get_index(keymap->keymap(), XKB_MOD_NAME_ALT);
+    modifiers[2] = xkb_keymap_mod_get_index(keymap->keymap(), XKB_MOD_NAME_SHIFT);
+    modifiers[3] = xkb_keymap_mod_get_index(keymap->keymap(), XKB_MOD_NAME_LOGO);
 
     repeatTimer.setSingleShot(true);
 }
 
 LibInputKeyboardPrivate::~LibInputKeyboardPrivate()
 {
-    if (state)
-        xkb_state_unref(state);
-    if (keymap)
-        xkb_keymap_unref(keymap);
-    if (context)
-        xkb_context_unref(context);
 }
 
 /*
@@ -124,19 +107,19 @@ void LibInputKeyboard::handleKey(libinput_event_keyboard *event)
 {
     Q_D(LibInputKeyboard);
 
-    if (!d->context || !d->keymap || !d->state)
+    if (!d->keymap || !d->state)
         return;
 
     const quint32 key = libinput_event_keyboard_get_key(event) + 8;
-    const xkb_keysym_t keysym = xkb_state_key_get_one_sym(d->state, key);
+    const xkb_keysym_t keysym = xkb_state_key_get_one_sym(d->state.get(), key);
     const bool isPressed = libinput_event_keyboard_get_key_state(event) == LIBINPUT_KEY_STATE_PRESSED;
 
-    Qt::KeyboardModifiers modifiers = XkbCommon::modifiers(d->state);
+    Qt::KeyboardModifiers modifiers = XkbCommon::modifiers(d->state.get());
 
-    const QString text = XkbCommon::lookupString(d->state, key);
-    const int qtkey = XkbCommon::keysymToQtKey(keysym, modifiers, d->state, key);
+    const QString text = XkbCommon::lookupString(d->state.get(), key);
+    const int qtkey = XkbCommon::keysymToQtKey(keysym, modifiers, d->state.get(), key);
 
-    xkb_state_update_key(d->state, key, isPressed ? XKB_KEY_DOWN : XKB_KEY_UP);
+    xkb_state_update_key(d->state.get(), key, isPressed ? XKB_KEY_DOWN : XKB_KEY_UP);
 
     // Switch to virtual terminal
     if (isPressed && modifiers.testFlag(Qt::ControlModifier) && modifiers.testFlag(Qt::AltModifier)) {
@@ -154,13 +137,14 @@ void LibInputKeyboard::handleKey(libinput_event_keyboard *event)
     keyEvent.text = text;
     keyEvent.autoRepeat = false;
     keyEvent.repeatCount = 1;
+    keyEvent.timestamp = libinput_event_keyboard_get_time_usec(event);
     if (isPressed)
         Q_EMIT d->handler->keyPressed(keyEvent);
     else
         Q_EMIT d->handler->keyReleased(keyEvent);
 
     // Repeat
-    if (isPressed && xkb_keymap_key_repeats(d->keymap, key)) {
+    if (isPressed && xkb_keymap_key_repeats(d->keymap->keymap(), key)) {
         d->repeatData.key = qtkey;
         d->repeatData.modifiers = modifiers;
         d->repeatData.nativeScanCode = key;
@@ -188,6 +172,9 @@ void LibInputKeyboard::handleRepeat()
     keyEvent.text = d->repeatData.text;
     keyEvent.autoRepeat = true;
     keyEvent.repeatCount = d->repeatData.repeatCount;
+    // Same clock as libinput
+    keyEvent.timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
     Q_EMIT d->handler->keyPressed(keyEvent);
 
     ++d->repeatData.repeatCount;
@@ -36,6 +36,8 @@
 #include "libinputhandler.h"
 #include "libinputkeyboard.h"
 
+#include <LiriAuroraXkbCommonSupport/private/auroraxkbkeymapcache_p.h>
+
 #include <libinput.h>
 
 //
@@ -62,9 +64,8 @@ public:
 
     LibInputHandler *handler;
 
-    xkb_context *context;
-    xkb_keymap *keymap;
-    xkb_state *state;
+    std::shared_ptr<XkbKeymap> keymap;
+    XkbKeymap::ScopedState state;
     xkb_mod_index_t modifiers[4];
 
     QTimer repeatTimer;
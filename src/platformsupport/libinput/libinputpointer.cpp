@@ -53,21 +53,31 @@ LibInputPointer::LibInputPointer(LibInputHandler *handler)
 {
     // Center the pointer to the primary screen
     QScreen *const primaryScreen = QGuiApplication::primaryScreen();
-    const QRect geometry = QHighDpi::toNativePixels(primaryScreen->virtualGeometry(), primaryScreen);
-    setPosition(geometry.center());
+    m_geometry = QHighDpi::toNativePixels(primaryScreen->virtualGeometry(), primaryScreen);
+    setPosition(m_geometry.center());
 }
 
-void LibInputPointer::setPosition(const QPoint &pos)
+void LibInputPointer::setPosition(const QPointF &pos)
 {
     // Constrain position to the virtual desktop
-    QScreen *const primaryScreen = QGuiApplication::primaryScreen();
-    const QRect geometry = QHighDpi::toNativePixels(primaryScreen->virtualGeometry(), primaryScreen);
-    m_pt.setX(qBound(geometry.left(), pos.x(), geometry.right()));
-    m_pt.setY(qBound(geometry.top(), pos.y(), geometry.bottom()));
+    m_pt.setX(qBound<qreal>(m_geometry.left(), pos.x(), m_geometry.right()));
+    m_pt.setY(qBound<qreal>(m_geometry.top(), pos.y(), m_geometry.bottom()));
+}
+
+void LibInputPointer::setGeometry(const QRect &geometry)
+{
+    if (m_geometry == geometry)
+        return;
+
+    m_geometry = geometry;
+    setPosition(m_pt);
 }
 
 void LibInputPointer::handleButton(libinput_event_pointer *e)
 {
+    // The button was pressed where the pointer is now
+    flushMotion();
+
     Qt::MouseButton button = Qt::NoButton;
     switch (libinput_event_pointer_get_button(e)) {
     case 0x110: button = Qt::LeftButton; break;
@@ -104,6 +114,7 @@ void LibInputPointer::handleButton(libinput_event_pointer *e)
     event.buttons = m_buttons;
     event.modifiers = QGuiApplicationPrivate::inputDeviceManager()->keyboardModifiers();
     event.wheelDelta = QPoint();
+    event.timestamp = libinput_event_pointer_get_time_usec(e);
     if (libinput_event_pointer_get_button_state(e) == LIBINPUT_BUTTON_STATE_PRESSED)
         Q_EMIT m_handler->mousePressed(event);
     else
@@ -112,27 +123,36 @@ void LibInputPointer::handleButton(libinput_event_pointer *e)
 
 void LibInputPointer::handleMotion(libinput_event_pointer *e)
 {
-    QPoint pos(qRound(m_pt.x() + libinput_event_pointer_get_dx(e)),
-               qRound(m_pt.y() + libinput_event_pointer_get_dy(e)));
-    processMotion(pos);
+    // Sub-pixel motion adds up instead of being rounded away
+    const QPointF delta(libinput_event_pointer_get_dx(e),
+                        libinput_event_pointer_get_dy(e));
+    m_delta += delta;
+    m_deltaUnaccelerated += QPointF(libinput_event_pointer_get_dx_unaccelerated(e),
+                                    libinput_event_pointer_get_dy_unaccelerated(e));
+    m_timestamp = libinput_event_pointer_get_time_usec(e);
+    m_motionPending = true;
+    setPosition(m_pt + delta);
 }
 
 void LibInputPointer::handleAbsoluteMotion(libinput_event_pointer *e)
 {
-    QScreen *const primaryScreen = QGuiApplication::primaryScreen();
-    const QRect geometry = QHighDpi::toNativePixels(primaryScreen->virtualGeometry(), primaryScreen);
-    QPointF abs(libinput_event_pointer_get_absolute_x_transformed(e, geometry.size().width()),
-                  libinput_event_pointer_get_absolute_y_transformed(e, geometry.size().height()));
-    processMotion(abs.toPoint());
+    QPointF abs(libinput_event_pointer_get_absolute_x_transformed(e, m_geometry.size().width()),
+                  libinput_event_pointer_get_absolute_y_transformed(e, m_geometry.size().height()));
+    m_timestamp = libinput_event_pointer_get_time_usec(e);
+    m_motionPending = true;
+    setPosition(abs);
 }
 
 void LibInputPointer::handleAxis(libinput_event_pointer *e)
 {
+    flushMotion();
+
     LibInputMouseEvent event;
     event.pos = m_pt;
     event.button = Qt::NoButton;
     event.buttons = m_buttons;
     event.modifiers = QGuiApplicationPrivate::inputDeviceManager()->keyboardModifiers();
+    event.timestamp = libinput_event_pointer_get_time_usec(e);
 
     // TODO: Make sensitivity configurable instead of fixed 10
     const int sensitivity = 8;
@@ -154,9 +174,10 @@ void LibInputPointer::handleAxis(libinput_event_pointer *e)
     }
 }
 
-void LibInputPointer::processMotion(const QPoint &pos)
+void LibInputPointer::flushMotion()
 {
-    setPosition(pos);
+    if (!m_motionPending)
+        return;
 
     LibInputMouseEvent event;
     event.pos = m_pt;
@@ -164,6 +185,14 @@ void LibInputPointer::processMotion(const QPoint &pos)
     event.buttons = m_buttons;
     event.modifiers = QGuiApplicationPrivate::inputDeviceManager()->keyboardModifiers();
     event.wheelDelta = QPoint();
+    event.delta = m_delta;
+    event.deltaUnaccelerated = m_deltaUnaccelerated;
+    event.timestamp = m_timestamp;
+
+    m_motionPending = false;
+    m_delta = QPointF();
+    m_deltaUnaccelerated = QPointF();
+
     Q_EMIT m_handler->mouseMoved(event);
 }
 
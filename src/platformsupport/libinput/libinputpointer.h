@@ -32,7 +32,8 @@
 
 #pragma once
 
-#include <QtCore/QPoint>
+#include <QtCore/QPointF>
+#include <QtCore/QRect>
 
 #include <LiriAuroraLibInput/liriauroralibinputglobal.h>
 
@@ -49,19 +50,29 @@ class LIRIAURORALIBINPUT_EXPORT LibInputPointer
 public:
     LibInputPointer(LibInputHandler *handler);
 
-    void setPosition(const QPoint &pos);
+    void setPosition(const QPointF &pos);
+    void setGeometry(const QRect &geometry);
 
     void handleButton(libinput_event_pointer *e);
     void handleMotion(libinput_event_pointer *e);
     void handleAbsoluteMotion(libinput_event_pointer *e);
     void handleAxis(libinput_event_pointer *e);
 
+    void flushMotion();
+
 private:
     LibInputHandler *m_handler;
-    QPoint m_pt;
+    // Virtual desktop geometry in native pixels, cached so that events
+    // can be handled outside of the GUI thread
+    QRect m_geometry;
+    QPointF m_pt;
     Qt::MouseButtons m_buttons;
 
-    void processMotion(const QPoint &pos);
+    // Motion events read at once are merged into one
+    bool m_motionPending = false;
+    QPointF m_delta;
+    QPointF m_deltaUnaccelerated;
+    quint64 m_timestamp = 0;
 };
 
 } // namespace PlatformSupport
@@ -208,6 +208,7 @@ void LibInputTouch::handleTouchCancel(libinput_event_touch *event)
         e.device = state->touchDevice;
         e.touchPoints = state->touchPoints;
         e.modifiers = QGuiApplication::keyboardModifiers();
+        e.timestamp = libinput_event_touch_get_time_usec(event);
         Q_EMIT d->handler->touchCancel(e);
     } else {
         qCWarning(gLcLibinput) << "Received a touch canceled without a device";
@@ -231,6 +232,7 @@ void LibInputTouch::handleTouchFrame(libinput_event_touch *event)
     e.device = state->touchDevice;
     e.touchPoints = state->touchPoints;
     e.modifiers = QGuiApplication::keyboardModifiers();
+    e.timestamp = libinput_event_touch_get_time_usec(event);
     Q_EMIT d->handler->touchEvent(e);
 
     for (int i = 0; i < state->touchPoints.size(); i++) {
@@ -28,6 +28,7 @@
 #include <QDBusPendingReply>
 #include <QDBusUnixFileDescriptor>
 
+#include "aurorastartuptrace_p.h"
 #include "defaultlogind_p_p.h"
 #include "logind.h"
 #include "logind_p.h"
@@ -75,85 +76,32 @@ LogindPrivate::LogindPrivate(Logind *qq)
 
 void LogindPrivate::_q_serviceRegistered()
 {
-    Q_Q(Logind);
-
-    // Skip if we're already connected
-    if (isConnected)
+    // Skip if we're already connected or looking for the session
+    if (isConnected || discovery.running)
         return;
 
-    // Find the active session otherwise try with XDG_SESSION_ID or the PID,
-    // when spawned by systemd --user only the first method is expected to work
-    DBusUserSession session;
-    if (getUserSession(session)) {
-        sessionPath = session.objectPath.path();
-        qCInfo(gLcLogind, "Using session %s", qPrintable(session.id));
-    } else {
-        QDBusObjectPath sessionObjectPath;
-
-        if (qEnvironmentVariableIsSet("XDG_SESSION_ID")) {
-            if (getSessionById(QString::fromLocal8Bit(qgetenv("XDG_SESSION_ID")), sessionObjectPath))
-                sessionPath = sessionObjectPath.path();
-        }
-
-        if (sessionObjectPath.path().isEmpty()) {
-            if (getSessionByPid(sessionObjectPath))
-                sessionPath = sessionObjectPath.path();
-        }
-
-        if (!sessionPath.isEmpty()) {
-            QString sessionId = getSessionId(sessionPath);
-            qCInfo(gLcLogind, "Using session %s", qPrintable(sessionId));
-        }
-    }
-    if (sessionPath.isEmpty()) {
-        qCWarning(gLcLogind) << "Unable to find session!";
-        return;
-    }
-    qCDebug(gLcLogind) << "Session path:" << sessionPath;
+    const quint32 generation = discovery.generation + 1;
+    discovery = Discovery();
+    discovery.running = true;
+    discovery.generation = generation;
+    discovery.timer.start();
 
-    // We are connected now
-    isConnected = true;
-
-    // Listen for lock and unlock signals
-    bus.connect(LOGIN1_SERVICE, sessionPath, LOGIN1_SESSION_INTERFACE,
-                QLatin1String("Lock"),
-                q, SIGNAL(lockSessionRequested()));
-    bus.connect(LOGIN1_SERVICE, sessionPath, LOGIN1_SESSION_INTERFACE,
-                QLatin1String("Unlock"),
-                q, SIGNAL(unlockSessionRequested()));
-
-    // Listen for properties changed
-    bus.connect(LOGIN1_SERVICE, sessionPath, DBUS_PROPERTIES_INTERFACE,
-                QLatin1String("PropertiesChanged"),
-                q, SLOT(_q_sessionPropertiesChanged()));
-
-    // Listen for prepare signals
-    bus.connect(LOGIN1_SERVICE, LOGIN1_OBJECT, LOGIN1_MANAGER_INTERFACE,
-                QLatin1String("PrepareForSleep"),
-                q, SIGNAL(prepareForSleep(bool)));
-    bus.connect(LOGIN1_SERVICE, LOGIN1_OBJECT, LOGIN1_MANAGER_INTERFACE,
-                QLatin1String("PrepareForShutdown"),
-                q, SIGNAL(prepareForShutdown(bool)));
-
-    // Activate the session in case we are on another vt, the
-    // call blocks on purpose because we need to get properties
-    QDBusMessage message =
-            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           sessionPath,
-                                           LOGIN1_MANAGER_INTERFACE,
-                                           QLatin1String("Activate"));
-    bus.call(message);
-
-    // Get properties
-    _q_sessionPropertiesChanged();
-
-    Q_EMIT q->connectedChanged(isConnected);
+    // Find the active session otherwise try with XDG_SESSION_ID or the PID,
+    // when spawned by systemd --user only the first method is expected to work.
+    // Ask for all of them at once, instead of waiting for each one to fail
+    getUserSessions();
+    if (qEnvironmentVariableIsSet("XDG_SESSION_ID"))
+        getSessionById(QString::fromLocal8Bit(qgetenv("XDG_SESSION_ID")));
+    getSessionByPid();
 }
 
 void LogindPrivate::_q_serviceUnregistered()
 {
     Q_Q(Logind);
 
+    // Replies to the session discovery are now meaningless
+    stopDiscovery();
+
     // Disconnect prepare signals
     bus.disconnect(LOGIN1_SERVICE, LOGIN1_OBJECT, LOGIN1_MANAGER_INTERFACE,
                    QLatin1String("PrepareForSleep"),
@@ -186,9 +134,7 @@ void LogindPrivate::_q_sessionPropertiesChanged()
     if (!isConnected || sessionPath.isEmpty())
         return;
 
-    getSessionActive();
-    getVirtualTerminal();
-    getSeat();
+    getSessionProperties();
 }
 
 void LogindPrivate::checkServiceRegistration()
@@ -217,292 +163,311 @@ void LogindPrivate::checkServiceRegistration()
     });
 }
 
-bool LogindPrivate::getSessionById(const QString &sessionId, QDBusObjectPath &path) const
+void LogindPrivate::asyncCall(const QDBusMessage &message,
+                              const std::function<void(const QDBusMessage &)> &callback)
 {
-    QDBusMessage message =
-            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           LOGIN1_OBJECT,
-                                           LOGIN1_MANAGER_INTERFACE,
-                                           QStringLiteral("GetSession"));
-    message.setArguments(QVariantList() << sessionId);
-
-    QDBusReply<QDBusObjectPath> reply = bus.call(message);
-    if (!reply.isValid()) {
-        qCWarning(gLcLogind, "Failed to get session path for session %s: %s",
-                  qPrintable(sessionId),
-                  qPrintable(reply.error().message()));
-        return false;
-    }
+    Q_Q(Logind);
 
-    path = reply.value();
-    return true;
+    QDBusPendingCall result = bus.asyncCall(message);
+    QDBusPendingCallWatcher *callWatcher = new QDBusPendingCallWatcher(result, q);
+    q->connect(callWatcher, &QDBusPendingCallWatcher::finished, q,
+               [callback](QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        callback(w->reply());
+    });
 }
 
-bool LogindPrivate::getSessionByPid(QDBusObjectPath &path) const
+// Calls made while looking for the session: replies are dropped when the
+// service goes away in the meantime, and the discovery finishes when the
+// last one is received
+void LogindPrivate::discoveryCall(const QDBusMessage &message,
+                                  const std::function<void(const QDBusMessage &)> &callback)
 {
-    QVariantList args;
-    args << static_cast<quint32>(QCoreApplication::applicationPid());
+    const quint32 generation = discovery.generation;
+    discovery.pendingCalls++;
 
-    QDBusMessage message =
-            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           LOGIN1_OBJECT,
-                                           LOGIN1_MANAGER_INTERFACE,
-                                           QStringLiteral("GetSessionByPID"));
-    message.setArguments(args);
+    asyncCall(message, [this, generation, callback](const QDBusMessage &reply) {
+        if (!discovery.running || discovery.generation != generation)
+            return;
 
-    QDBusReply<QDBusObjectPath> reply = bus.call(message);
-    if (!reply.isValid()) {
-        qCWarning(gLcLogind, "Failed to get session path by PID: %s",
-                  qPrintable(reply.error().message()));
-        return false;
-    }
+        callback(reply);
 
-    path = reply.value();
-    return true;
+        if (--discovery.pendingCalls == 0)
+            finishDiscovery();
+    });
 }
 
-bool LogindPrivate::getUserSession(DBusUserSession &session) const
+void LogindPrivate::stopDiscovery()
 {
-    QDBusObjectPath userPath;
-
-    {
-        QVariantList args;
-        args << ::getuid();
+    discovery.running = false;
+    discovery.generation++;
+    discovery.pendingCalls = 0;
+}
 
-        QDBusMessage message =
-                QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                               LOGIN1_OBJECT,
-                                               LOGIN1_MANAGER_INTERFACE,
-                                               QStringLiteral("GetUser"));
-        message.setArguments(args);
+void LogindPrivate::getUserSessions()
+{
+    QDBusMessage message =
+            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
+                                           LOGIN1_OBJECT,
+                                           LOGIN1_MANAGER_INTERFACE,
+                                           QStringLiteral("GetUser"));
+    message.setArguments(QVariantList() << ::getuid());
 
-        QDBusReply<QDBusObjectPath> reply = bus.call(message);
-        if (!reply.isValid()) {
+    discoveryCall(message, [this](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
             qCWarning(gLcLogind, "Failed to get user path: %s",
-                      qPrintable(reply.error().message()));
-            return false;
+                      qPrintable(reply.errorMessage()));
+            return;
         }
 
-        userPath = reply.value();
-    }
-
-    {
-        QVariantList args;
-        args << QStringLiteral("org.freedesktop.login1.User")
-             << QStringLiteral("Sessions");
+        const QString userPath = qdbus_cast<QDBusObjectPath>(reply.arguments().value(0)).path();
 
         QDBusMessage message =
                 QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                               userPath.path(),
+                                               userPath,
                                                DBUS_PROPERTIES_INTERFACE,
                                                QStringLiteral("Get"));
-        message.setArguments(args);
-
-        QDBusReply<QVariant> reply = bus.call(message);
-        if (!reply.isValid()) {
-            qCWarning(gLcLogind, "Failed to list user sessions: %s",
-                      qPrintable(reply.error().message()));
-            return false;
-        }
-
-        // Find which session meets our critera
-        QStringList validTypes = {
-            QStringLiteral("tty"),
-            QStringLiteral("wayland"),
-            QStringLiteral("x11")
-        };
-
-        // We expect to have only one session for each user, and the session for the current
-        // user is supposed to be active because the user logged in with a login manager (either
-        // text based such as getty, or graphical like SDDM).
-        // Graphical login managers usually don't spawn a second session, but activate an already
-        // existing session for the user.
-        bool found = false;
-        DBusUserSessionVector sessions = qdbus_cast<DBusUserSessionVector>(reply.value().value<QDBusArgument>());
-        for (const auto &curSession : qAsConst(sessions)) {
-            const QString type = getSessionType(curSession.id, curSession.objectPath.path());
-            const QString state = getSessionState(curSession.id, curSession.objectPath.path());
-
-            if (!validTypes.contains(type))
-                continue;
-            if (state != QStringLiteral("active"))
-                continue;
-
-            // We get the sessions from newest to oldest, pick the last
-            // one that meets the criteria
-            session = curSession;
-            found = true;
-        }
-
-        return found;
-    }
-
-    return false;
+        message.setArguments(QVariantList() << QStringLiteral("org.freedesktop.login1.User")
+                                            << QStringLiteral("Sessions"));
+
+        discoveryCall(message, [this](const QDBusMessage &reply) {
+            if (reply.type() == QDBusMessage::ErrorMessage) {
+                qCWarning(gLcLogind, "Failed to list user sessions: %s",
+                          qPrintable(reply.errorMessage()));
+                return;
+            }
+
+            const QDBusVariant variant = qdbus_cast<QDBusVariant>(reply.arguments().value(0));
+            const DBusUserSessionVector sessions =
+                    qdbus_cast<DBusUserSessionVector>(variant.variant().value<QDBusArgument>());
+
+            // Type and state of all the sessions, one call for each session
+            // and all of them in parallel
+            discovery.userSessions.resize(sessions.size());
+            for (int i = 0; i < sessions.size(); ++i) {
+                discovery.userSessions[i].path = sessions.at(i).objectPath.path();
+
+                QDBusMessage message =
+                        QDBusMessage::createMethodCall(LOGIN1_SERVICE,
+                                                       sessions.at(i).objectPath.path(),
+                                                       DBUS_PROPERTIES_INTERFACE,
+                                                       QStringLiteral("GetAll"));
+                message.setArguments(QVariantList() << LOGIN1_SESSION_INTERFACE);
+
+                discoveryCall(message, [this, i](const QDBusMessage &reply) {
+                    SessionCandidate &candidate = discovery.userSessions[i];
+
+                    if (reply.type() == QDBusMessage::ErrorMessage) {
+                        qCWarning(gLcLogind, "Failed to get properties of session %s: %s",
+                                  qPrintable(candidate.path), qPrintable(reply.errorMessage()));
+                        return;
+                    }
+
+                    const QVariantMap properties =
+                            qdbus_cast<QVariantMap>(reply.arguments().value(0));
+                    candidate.type = properties.value(QStringLiteral("Type")).toString();
+                    candidate.state = properties.value(QStringLiteral("State")).toString();
+                });
+            }
+        });
+    });
 }
 
-QString LogindPrivate::getSessionId(const QString &sessionPath) const
+void LogindPrivate::getSessionById(const QString &sessionId)
 {
-    QVariantList args;
-    args << LOGIN1_SESSION_INTERFACE
-         << QStringLiteral("Id");
-
     QDBusMessage message =
             QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           sessionPath,
-                                           DBUS_PROPERTIES_INTERFACE,
-                                           QStringLiteral("Get"));
-    message.setArguments(args);
-
-    QDBusReply<QVariant> reply = bus.call(message);
-    if (!reply.isValid()) {
-        qCWarning(gLcLogind, "Failed to get session id: %s",
-                  qPrintable(reply.error().message()));
-        return QString();
-    }
+                                           LOGIN1_OBJECT,
+                                           LOGIN1_MANAGER_INTERFACE,
+                                           QStringLiteral("GetSession"));
+    message.setArguments(QVariantList() << sessionId);
+
+    discoveryCall(message, [this, sessionId](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qCWarning(gLcLogind, "Failed to get session path for session %s: %s",
+                      qPrintable(sessionId), qPrintable(reply.errorMessage()));
+            return;
+        }
 
-    return reply.value().toString();
+        discovery.sessionPathById = qdbus_cast<QDBusObjectPath>(reply.arguments().value(0)).path();
+    });
 }
 
-QString LogindPrivate::getSessionType(const QString &sessionId, const QString &sessionPath) const
+void LogindPrivate::getSessionByPid()
 {
-    QVariantList args;
-    args << LOGIN1_SESSION_INTERFACE
-         << QStringLiteral("Type");
-
     QDBusMessage message =
             QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           sessionPath,
-                                           DBUS_PROPERTIES_INTERFACE,
-                                           QStringLiteral("Get"));
-    message.setArguments(args);
-
-    QDBusReply<QVariant> reply = bus.call(message);
-    if (!reply.isValid()) {
-        qCWarning(gLcLogind, "Failed to get type for session %s: %s",
-                  qPrintable(sessionId), qPrintable(reply.error().message()));
-        return QString();
-    }
+                                           LOGIN1_OBJECT,
+                                           LOGIN1_MANAGER_INTERFACE,
+                                           QStringLiteral("GetSessionByPID"));
+    message.setArguments(QVariantList() << static_cast<quint32>(QCoreApplication::applicationPid()));
 
-    return reply.value().toString();
+    discoveryCall(message, [this](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage) {
+            qCWarning(gLcLogind, "Failed to get session path by PID: %s",
+                      qPrintable(reply.errorMessage()));
+            return;
+        }
+
+        discovery.sessionPathByPid = qdbus_cast<QDBusObjectPath>(reply.arguments().value(0)).path();
+    });
 }
 
-QString LogindPrivate::getSessionState(const QString &sessionId, const QString &sessionPath) const
-{
-    QVariantList args;
-    args << LOGIN1_SESSION_INTERFACE
-         << QStringLiteral("State");
+void LogindPrivate::finishDiscovery()
+{
+    discovery.running = false;
+    discovery.discoveryTime = discovery.timer.elapsed();
+
+    // Find which session meets our critera
+    const QStringList validTypes = {
+        QStringLiteral("tty"),
+        QStringLiteral("wayland"),
+        QStringLiteral("x11")
+    };
+
+    // We expect to have only one session for each user, and the session for the current
+    // user is supposed to be active because the user logged in with a login manager (either
+    // text based such as getty, or graphical like SDDM).
+    // Graphical login managers usually don't spawn a second session, but activate an already
+    // existing session for the user.
+    // We get the sessions from newest to oldest, pick the last one that meets the criteria.
+    QString path;
+    for (const auto &candidate : qAsConst(discovery.userSessions)) {
+        if (!validTypes.contains(candidate.type))
+            continue;
+        if (candidate.state != QStringLiteral("active"))
+            continue;
+
+        path = candidate.path;
+    }
 
-    QDBusMessage message =
-            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           sessionPath,
-                                           DBUS_PROPERTIES_INTERFACE,
-                                           QStringLiteral("Get"));
-    message.setArguments(args);
-
-    QDBusReply<QVariant> reply = bus.call(message);
-    if (!reply.isValid()) {
-        qCWarning(gLcLogind, "Failed to get state for session %s: %s",
-                  qPrintable(sessionId), qPrintable(reply.error().message()));
-        return QString();
+    if (path.isEmpty())
+        path = discovery.sessionPathById;
+    if (path.isEmpty())
+        path = discovery.sessionPathByPid;
+
+    if (path.isEmpty()) {
+        qCWarning(gLcLogind) << "Unable to find session!";
+        return;
     }
 
-    return reply.value().toString();
+    connectToSession(path);
 }
 
-void LogindPrivate::getSessionActive()
+void LogindPrivate::connectToSession(const QString &path)
 {
     Q_Q(Logind);
 
+    sessionPath = path;
+    qCDebug(gLcLogind) << "Session path:" << sessionPath;
+
+    // Listen for lock and unlock signals
+    bus.connect(LOGIN1_SERVICE, sessionPath, LOGIN1_SESSION_INTERFACE,
+                QLatin1String("Lock"),
+                q, SIGNAL(lockSessionRequested()));
+    bus.connect(LOGIN1_SERVICE, sessionPath, LOGIN1_SESSION_INTERFACE,
+                QLatin1String("Unlock"),
+                q, SIGNAL(unlockSessionRequested()));
+
+    // Listen for properties changed
+    bus.connect(LOGIN1_SERVICE, sessionPath, DBUS_PROPERTIES_INTERFACE,
+                QLatin1String("PropertiesChanged"),
+                q, SLOT(_q_sessionPropertiesChanged()));
+
+    // Listen for prepare signals
+    bus.connect(LOGIN1_SERVICE, LOGIN1_OBJECT, LOGIN1_MANAGER_INTERFACE,
+                QLatin1String("PrepareForSleep"),
+                q, SIGNAL(prepareForSleep(bool)));
+    bus.connect(LOGIN1_SERVICE, LOGIN1_OBJECT, LOGIN1_MANAGER_INTERFACE,
+                QLatin1String("PrepareForShutdown"),
+                q, SIGNAL(prepareForShutdown(bool)));
+
+    // Activate the session in case we are on another vt: logind handles
+    // messages in order, so properties requested right after reflect the
+    // activation without waiting for the reply
     QDBusMessage message =
             QDBusMessage::createMethodCall(LOGIN1_SERVICE,
                                            sessionPath,
-                                           DBUS_PROPERTIES_INTERFACE,
-                                           QLatin1String("Get"));
-    message.setArguments(QVariantList() << LOGIN1_SESSION_INTERFACE << QStringLiteral("Active"));
-
-    QDBusPendingReply<QVariant> result = bus.asyncCall(message);
-    QDBusPendingCallWatcher *callWatcher = new QDBusPendingCallWatcher(result, q);
-    q->connect(callWatcher, &QDBusPendingCallWatcher::finished, q,
-               [q, this](QDBusPendingCallWatcher *w) {
-        QDBusPendingReply<QVariant> reply = *w;
-        w->deleteLater();
+                                           LOGIN1_SESSION_INTERFACE,
+                                           QLatin1String("Activate"));
+    bus.asyncCall(message);
 
-        if (!reply.isValid()) {
-            qCWarning(gLcLogind, "Failed to get \"Active\" property from session: %s",
-                      qPrintable(reply.error().message()));
+    // We are connected when the properties are known
+    const quint32 generation = discovery.generation;
+    getSessionProperties([this, q, generation]() {
+        if (discovery.generation != generation || isConnected)
             return;
-        }
 
-        const bool active = reply.value().toBool();
-        if (sessionActive != active) {
-            sessionActive = active;
-            Q_EMIT q->sessionActiveChanged(active);
+        isConnected = true;
+
+        qCInfo(gLcLogind, "Connected to logind in %lld ms (session discovery %lld ms)",
+               static_cast<long long>(discovery.timer.elapsed()),
+               static_cast<long long>(discovery.discoveryTime));
+
+        if (StartupTrace::isActive()) {
+            const qint64 end = StartupTrace::now();
+            const qint64 begin = end - discovery.timer.nsecsElapsed();
+            StartupTrace::addSpan("logind", "sessionDiscovery",
+                                  begin, begin + discovery.discoveryTime * 1000000);
+            StartupTrace::addSpan("logind", "connect", begin, end);
         }
+
+        Q_EMIT q->connectedChanged(isConnected);
     });
 }
 
-void LogindPrivate::getVirtualTerminal()
+void LogindPrivate::getSessionProperties(const std::function<void()> &callback)
 {
-    Q_Q(Logind);
-
     QDBusMessage message =
             QDBusMessage::createMethodCall(LOGIN1_SERVICE,
                                            sessionPath,
                                            DBUS_PROPERTIES_INTERFACE,
-                                           QLatin1String("Get"));
-    message.setArguments(QVariantList() << LOGIN1_SESSION_INTERFACE << QStringLiteral("VTNr"));
-
-    QDBusPendingReply<QVariant> result = bus.asyncCall(message);
-    QDBusPendingCallWatcher *callWatcher = new QDBusPendingCallWatcher(result, q);
-    q->connect(callWatcher, &QDBusPendingCallWatcher::finished, q,
-               [q, this](QDBusPendingCallWatcher *w) {
-        QDBusPendingReply<QVariant> reply = *w;
-        w->deleteLater();
-
-        if (!reply.isValid()) {
-            qCWarning(gLcLogind, "Failed to get \"VTNr\" property from session: %s",
-                      qPrintable(reply.error().message()));
-            return;
-        }
-
-        const uint vtnr = reply.value().toUInt();
-        if (vt != static_cast<int>(vtnr)) {
-            vt = static_cast<int>(vtnr);
-            Q_EMIT q->vtNumberChanged(vt);
-        }
+                                           QLatin1String("GetAll"));
+    message.setArguments(QVariantList() << LOGIN1_SESSION_INTERFACE);
+
+    asyncCall(message, [this, callback](const QDBusMessage &reply) {
+        if (reply.type() == QDBusMessage::ErrorMessage)
+            qCWarning(gLcLogind, "Failed to get session properties: %s",
+                      qPrintable(reply.errorMessage()));
+        else
+            applySessionProperties(qdbus_cast<QVariantMap>(reply.arguments().value(0)));
+
+        if (callback)
+            callback();
     });
 }
 
-void LogindPrivate::getSeat()
+void LogindPrivate::applySessionProperties(const QVariantMap &properties)
 {
     Q_Q(Logind);
 
-    QDBusMessage message =
-            QDBusMessage::createMethodCall(LOGIN1_SERVICE,
-                                           sessionPath,
-                                           DBUS_PROPERTIES_INTERFACE,
-                                           QLatin1String("Get"));
-    message.setArguments(QVariantList() << LOGIN1_SESSION_INTERFACE << QStringLiteral("Seat"));
+    if (properties.contains(QStringLiteral("Id")) && !isConnected)
+        qCInfo(gLcLogind, "Using session %s",
+               qPrintable(properties.value(QStringLiteral("Id")).toString()));
 
-    QDBusPendingReply<QVariant> result = bus.asyncCall(message);
-    QDBusPendingCallWatcher *callWatcher = new QDBusPendingCallWatcher(result, q);
-    q->connect(callWatcher, &QDBusPendingCallWatcher::finished, q,
-               [q, this](QDBusPendingCallWatcher *w) {
-        QDBusPendingReply<QVariant> reply = *w;
-        w->deleteLater();
+    if (properties.contains(QStringLiteral("Active"))) {
+        const bool active = properties.value(QStringLiteral("Active")).toBool();
+        if (sessionActive != active) {
+            sessionActive = active;
+            Q_EMIT q->sessionActiveChanged(active);
+        }
+    }
 
-        if (!reply.isValid()) {
-            qCWarning(gLcLogind, "Failed to get \"Seat\" property from session: %s",
-                      qPrintable(reply.error().message()));
-            return;
+    if (properties.contains(QStringLiteral("VTNr"))) {
+        const int vtnr = static_cast<int>(properties.value(QStringLiteral("VTNr")).toUInt());
+        if (vt != vtnr) {
+            vt = vtnr;
+            Q_EMIT q->vtNumberChanged(vt);
         }
+    }
 
-        const DBusSeat dbusSeat = qdbus_cast<DBusSeat>(reply.value().value<QDBusArgument>());
+    if (properties.contains(QStringLiteral("Seat"))) {
+        const DBusSeat dbusSeat = qdbus_cast<DBusSeat>(properties.value(QStringLiteral("Seat")).value<QDBusArgument>());
         if (seat != dbusSeat.id) {
             seat = dbusSeat.id;
             Q_EMIT q->seatChanged(seat);
         }
-    });
+    }
 }
 
 /*
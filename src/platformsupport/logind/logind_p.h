@@ -37,9 +37,12 @@
 #include <QDBusConnection>
 #include <QDBusObjectPath>
 #include <QDBusServiceWatcher>
+#include <QElapsedTimer>
 #include <QLoggingCategory>
 #include <QVector>
 
+#include <functional>
+
 #include "logindtypes_p.h"
 
 Q_DECLARE_LOGGING_CATEGORY(gLcLogind)
@@ -76,16 +79,38 @@ protected:
     Logind *q_ptr;
 
 private:
-    bool getSessionById(const QString &sessionId, QDBusObjectPath &path) const;
-    bool getSessionByPid(QDBusObjectPath &path) const;
-    bool getUserSession(DBusUserSession &session) const;
-    QString getSessionId(const QString &sessionPath) const;
-    QString getSessionType(const QString &sessionId, const QString &sessionPath) const;
-    QString getSessionState(const QString &sessionId, const QString &sessionPath) const;
-
-    void getSessionActive();
-    void getVirtualTerminal();
-    void getSeat();
+    struct SessionCandidate {
+        QString path;
+        QString type;
+        QString state;
+    };
+
+    // Session discovery state, all the lookups run in parallel
+    struct Discovery {
+        bool running = false;
+        quint32 generation = 0;
+        int pendingCalls = 0;
+        QVector<SessionCandidate> userSessions;
+        QString sessionPathById;
+        QString sessionPathByPid;
+        QElapsedTimer timer;
+        qint64 discoveryTime = 0;
+    } discovery;
+
+    void asyncCall(const QDBusMessage &message,
+                   const std::function<void(const QDBusMessage &)> &callback);
+    void discoveryCall(const QDBusMessage &message,
+                       const std::function<void(const QDBusMessage &)> &callback);
+    void stopDiscovery();
+
+    void getUserSessions();
+    void getSessionById(const QString &sessionId);
+    void getSessionByPid();
+    void finishDiscovery();
+
+    void connectToSession(const QString &path);
+    void getSessionProperties(const std::function<void()> &callback = nullptr);
+    void applySessionProperties(const QVariantMap &properties);
 };
 
 } // namespace PlatformSupport
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
 
 #include "auroraxkbcommon_p.h"
+#include "auroraxkbkeymapcache_p.h"
 
 #include <private/qmakearray_p.h>
 
@@ -630,7 +631,7 @@ QList<QKeyCombination> XkbCommon::possibleKeyCombinations(xkb_state *state, cons
     Qt::KeyboardModifiers notNeeded = Qt::KeypadModifier | Qt::GroupSwitchModifier;
     modifiers &= ~notNeeded;
     // create a fresh kb state and test against the relevant modifier combinations
-    ScopedXKBState scopedXkbQueryState(xkb_state_new(keymap));
+    XkbKeymap::ScopedState scopedXkbQueryState(XkbKeymap::createState(keymap));
     xkb_state *queryState = scopedXkbQueryState.get();
     if (!queryState) {
         qCWarning(gLcXkbcommon) << Q_FUNC_INFO << "failed to compile xkb keymap";
@@ -790,7 +791,7 @@ xkb_keysym_t XkbCommon::lookupLatinKeysym(xkb_state *state, xkb_keycode_t keycod
     // generate the same shortcut event in this case.
     const xkb_keycode_t minKeycode = xkb_keymap_min_keycode(keymap);
     const xkb_keycode_t maxKeycode = xkb_keymap_max_keycode(keymap);
-    ScopedXKBState queryState(xkb_state_new(keymap));
+    XkbKeymap::ScopedState queryState(XkbKeymap::createState(keymap));
     for (xkb_layout_index_t prevLayout = 0; prevLayout < layout; ++prevLayout) {
         xkb_state_update_mask(queryState.get(), 0, latchedMods, lockedMods, 0, 0, prevLayout);
         for (xkb_keycode_t code = minKeycode; code < maxKeycode; ++code) {
@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QStandardPaths>
+
+#include "auroraxkbcommon_p.h"
+#include "auroraxkbkeymapcache_p.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace PlatformSupport {
+
+// Recently used keymaps stay compiled even when no keyboard uses
+// them, switching back and forth between layouts is common
+static const int maxRecentKeymaps = 8;
+
+struct XkbKeymapCacheData
+{
+    QMutex mutex;
+    XkbCommon::ScopedXKBContext context;
+    QHash<QByteArray, std::weak_ptr<XkbKeymap>> keymaps;
+    QList<std::shared_ptr<XkbKeymap>> recent;
+};
+
+Q_GLOBAL_STATIC(XkbKeymapCacheData, cacheData)
+
+static QByteArray cacheKey(const XkbKeymapCache::RuleNames &names)
+{
+    const char separator = '\0';
+    return names.rules + separator + names.model + separator + names.layout
+            + separator + names.variant + separator + names.options;
+}
+
+// Older kernels lack memfd, the keymap is written to an unlinked file instead
+static int createFallbackFile()
+{
+    const QString path = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (path.isEmpty())
+        return -1;
+
+    QByteArray name = QFile::encodeName(path + QStringLiteral("/aurora-keymap-XXXXXX"));
+    const int fd = mkostemp(name.data(), O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    unlink(name.constData());
+    return fd;
+}
+
+static int createKeymapFile(const char *string, size_t size)
+{
+    bool sealed = true;
+    int fd = memfd_create("aurora-keymap", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        sealed = false;
+        fd = createFallbackFile();
+        if (fd < 0)
+            return -1;
+    }
+
+    if (ftruncate(fd, size) < 0 || pwrite(fd, string, size, 0) != ssize_t(size)) {
+        qCWarning(gLcXkbcommon, "Failed to write the keymap: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Clients of every seat get the same file, none of them can change it
+    if (sealed && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) < 0)
+        qCWarning(gLcXkbcommon, "Failed to seal the keymap: %s", strerror(errno));
+
+    return fd;
+}
+
+/*
+ * XkbKeymap
+ */
+
+// The cache is gone when the last keymaps are destroyed at exit
+static QMutex *cacheMutex()
+{
+    XkbKeymapCacheData *d = cacheData();
+    return d ? &d->mutex : nullptr;
+}
+
+XkbKeymap::~XkbKeymap()
+{
+    QMutexLocker locker(cacheMutex());
+
+    if (m_keymap)
+        xkb_keymap_unref(m_keymap);
+    if (m_fd >= 0)
+        close(m_fd);
+
+    // Forget about this keymap, unless it was compiled again in the meantime
+    if (XkbKeymapCacheData *d = cacheData()) {
+        auto it = d->keymaps.find(m_key);
+        if (it != d->keymaps.end() && it->expired())
+            d->keymaps.erase(it);
+    }
+}
+
+XkbKeymap::ScopedState XkbKeymap::createState() const
+{
+    return createState(m_keymap);
+}
+
+XkbKeymap::ScopedState XkbKeymap::createState(xkb_keymap *keymap)
+{
+    QMutexLocker locker(cacheMutex());
+    return ScopedState(xkb_state_new(keymap));
+}
+
+void XkbKeymap::StateDeleter::operator()(struct xkb_state *state) const
+{
+    QMutexLocker locker(cacheMutex());
+    xkb_state_unref(state);
+}
+
+/*
+ * XkbKeymapCache
+ */
+
+std::shared_ptr<XkbKeymap> XkbKeymapCache::keymap(const RuleNames &names)
+{
+    XkbKeymapCacheData *d = cacheData();
+    const QByteArray key = cacheKey(names);
+
+    // Declared before the lock: the last reference to an evicted
+    // keymap has to be dropped after unlocking
+    std::shared_ptr<XkbKeymap> evicted;
+
+    QMutexLocker locker(&d->mutex);
+
+    std::shared_ptr<XkbKeymap> keymap = d->keymaps.value(key).lock();
+    if (keymap) {
+        d->recent.removeOne(keymap);
+        d->recent.prepend(keymap);
+        return keymap;
+    }
+
+    if (!d->context) {
+        d->context.reset(xkb_context_new(XKB_CONTEXT_NO_FLAGS));
+        if (!d->context) {
+            qCWarning(gLcXkbcommon, "Failed to create xkb context");
+            return nullptr;
+        }
+    }
+
+    const struct xkb_rule_names ruleNames = {
+        names.rules.isEmpty() ? nullptr : names.rules.constData(),
+        names.model.isEmpty() ? nullptr : names.model.constData(),
+        names.layout.isEmpty() ? nullptr : names.layout.constData(),
+        names.variant.isEmpty() ? nullptr : names.variant.constData(),
+        names.options.isEmpty() ? nullptr : names.options.constData()
+    };
+
+    xkb_keymap *xkbKeymap = xkb_keymap_new_from_names(d->context.get(), &ruleNames,
+                                                      XKB_KEYMAP_COMPILE_NO_FLAGS);
+    if (!xkbKeymap) {
+        qCWarning(gLcXkbcommon, "Failed to compile the '%s' keymap", names.layout.constData());
+        return nullptr;
+    }
+
+    keymap.reset(new XkbKeymap);
+    keymap->m_key = key;
+    keymap->m_keymap = xkbKeymap;
+
+    if (char *string = xkb_keymap_get_as_string(xkbKeymap, XKB_KEYMAP_FORMAT_TEXT_V1)) {
+        keymap->m_size = strlen(string) + 1;
+        keymap->m_fd = createKeymapFile(string, keymap->m_size);
+        free(string);
+    }
+    if (keymap->m_fd < 0)
+        qCWarning(gLcXkbcommon, "Failed to share the '%s' keymap with clients", names.layout.constData());
+
+    d->keymaps.insert(key, keymap);
+    d->recent.prepend(keymap);
+    if (d->recent.size() > maxRecentKeymaps)
+        evicted = d->recent.takeLast();
+
+    return keymap;
+}
+
+} // namespace PlatformSupport
+
+} // namespace Aurora
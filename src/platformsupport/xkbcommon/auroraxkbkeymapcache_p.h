@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QByteArray>
+
+#include <xkbcommon/xkbcommon.h>
+
+#include <LiriAuroraXkbCommonSupport/liriauroraxkbcommonsupportglobal.h>
+
+#include <memory>
+
+namespace Aurora {
+
+namespace PlatformSupport {
+
+class XkbKeymapCache;
+
+/*
+ * A compiled keymap shared by every keyboard using the same names.
+ *
+ * The text form lives in a read-only sealed memfd that is sent to
+ * all clients of all seats as is.
+ */
+class LIRIAURORAXKBCOMMONSUPPORT_EXPORT XkbKeymap
+{
+public:
+    ~XkbKeymap();
+
+    xkb_keymap *keymap() const { return m_keymap; }
+
+    // Read-only, -1 when the keymap couldn't be serialized
+    int fd() const { return m_fd; }
+    // Including the terminating NUL
+    size_t size() const { return m_size; }
+
+    // libxkbcommon reference counting is not atomic, states are
+    // created and destroyed with the cache lock held
+    struct StateDeleter {
+        void operator()(struct xkb_state *state) const;
+    };
+    using ScopedState = std::unique_ptr<struct xkb_state, StateDeleter>;
+
+    ScopedState createState() const;
+    // For keymaps that may be cached, without holding a reference to them
+    static ScopedState createState(xkb_keymap *keymap);
+
+private:
+    Q_DISABLE_COPY(XkbKeymap)
+
+    XkbKeymap() = default;
+
+    QByteArray m_key;
+    xkb_keymap *m_keymap = nullptr;
+    int m_fd = -1;
+    size_t m_size = 0;
+
+    friend class XkbKeymapCache;
+};
+
+class LIRIAURORAXKBCOMMONSUPPORT_EXPORT XkbKeymapCache
+{
+public:
+    // Empty names pick the libxkbcommon defaults
+    struct RuleNames {
+        QByteArray rules;
+        QByteArray model;
+        QByteArray layout;
+        QByteArray variant;
+        QByteArray options;
+    };
+
+    // Thread-safe, compiles the keymap only the first time it's needed
+    static std::shared_ptr<XkbKeymap> keymap(const RuleNames &names);
+};
+
+} // namespace PlatformSupport
+
+} // namespace Aurora
@@ -0,0 +1,31 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <LiriAuroraCompositor/private/aurorawlhardwarelayerintegrationfactory_p.h>
+#include <LiriAuroraCompositor/private/aurorawlhardwarelayerintegrationplugin_p.h>
+#include "kmslayerintegration.h"
+
+namespace Aurora {
+
+namespace Compositor {
+
+class KmsLayerIntegrationPlugin : public Internal::HardwareLayerIntegrationPlugin
+{
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID AuroraHardwareLayerIntegrationFactoryInterface_iid FILE "kms-layers.json")
+public:
+    Internal::HardwareLayerIntegration *create(const QString &key, const QStringList &paramList) override;
+};
+
+Internal::HardwareLayerIntegration *KmsLayerIntegrationPlugin::create(const QString &key, const QStringList &paramList)
+{
+    Q_UNUSED(paramList);
+    Q_UNUSED(key);
+    return new KmsLayerIntegration();
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include "main.moc"
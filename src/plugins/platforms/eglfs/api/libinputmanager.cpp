@@ -21,12 +21,25 @@
  * $END_LICENSE$
  ***************************************************************************/
 
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QThread>
+#include <QtGui/QScreen>
 #include <QtGui/private/qguiapplication_p.h>
+#include <QtGui/private/qhighdpiscaling_p.h>
 #include <QtGui/private/qinputdevicemanager_p_p.h>
 
 #include <LiriAuroraLibInput/libinputhandler.h>
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
 
 #include "libinputmanager_p.h"
+#include "qeglfsscreen_p.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace Aurora {
 
@@ -34,8 +47,41 @@ namespace PlatformSupport {
 
 LibInputManager::LibInputManager(QObject *parent)
     : QObject(parent)
-    , m_handler(new LibInputHandler(this))
 {
+    // Input can be read on a dedicated thread, so that the cursor keeps
+    // moving and events keep their timestamps when the GUI thread is busy
+    if (qEnvironmentVariableIntValue("QT_QPA_EGLFS_INPUT_THREAD")) {
+        m_wakeupFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (m_wakeupFd < 0)
+            qWarning("Failed to create eventfd, reading input on the GUI thread");
+    }
+
+    if (m_wakeupFd >= 0) {
+        m_wakeupNotifier = new QSocketNotifier(m_wakeupFd, QSocketNotifier::Read, this);
+        connect(m_wakeupNotifier, &QSocketNotifier::activated, this, &LibInputManager::processQueue);
+
+        m_thread = new QThread(this);
+        m_thread->setObjectName(QStringLiteral("libinput"));
+        connect(m_thread, &QThread::started, m_thread, []() {
+            // Real-time scheduling needs RLIMIT_RTPRIO or CAP_SYS_NICE
+            sched_param param = {};
+            param.sched_priority = qMax(1, sched_get_priority_min(SCHED_FIFO));
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+                QThread::currentThread()->setPriority(QThread::TimeCriticalPriority);
+        }, Qt::DirectConnection);
+        m_thread->start();
+
+        m_threadContext = new QObject();
+        m_threadContext->moveToThread(m_thread);
+
+        // Device counts are read right below
+        QMetaObject::invokeMethod(m_threadContext, [this]() {
+            createHandler();
+        }, Qt::BlockingQueuedConnection);
+    } else {
+        createHandler();
+    }
+
     QInputDeviceManager *inputManager =
             QGuiApplicationPrivate::inputDeviceManager();
     QInputDeviceManagerPrivate *inputManagerPriv
@@ -72,80 +118,311 @@ LibInputManager::LibInputManager(QObject *parent)
         inputManagerPriv->setDeviceCount(QInputDeviceManager::DeviceTypeTablet,
                                          count);
     });
+    // Registration is thread-safe and must happen before the first touch event is queued
     connect(m_handler, &LibInputHandler::touchDeviceRegistered, this,
             [](QTouchDevice *td) {
         QWindowSystemInterface::registerTouchDevice(td);
-    });
+    }, Qt::DirectConnection);
 
     // Events
-    connect(m_handler, &LibInputHandler::keyPressed, this,
-            [](const LibInputKeyEvent &e) {
-        QWindowSystemInterface::handleExtendedKeyEvent(
-                    nullptr, QKeyEvent::KeyPress, e.key,
-                    e.modifiers, e.nativeScanCode,
-                    e.nativeVirtualKey, e.nativeModifiers,
-                    e.text, e.autoRepeat, e.repeatCount);
-    });
-    connect(m_handler, &LibInputHandler::keyReleased, this,
-            [](const LibInputKeyEvent &e) {
-        QWindowSystemInterface::handleExtendedKeyEvent(
-                    nullptr, QKeyEvent::KeyRelease, e.key,
-                    e.modifiers, e.nativeScanCode,
-                    e.nativeVirtualKey, e.nativeModifiers,
-                    e.text, e.autoRepeat, e.repeatCount);
-    });
-    connect(m_handler, &LibInputHandler::mousePressed, this,
-            [](const LibInputMouseEvent &e) {
-        QWindowSystemInterface::handleMouseEvent(
-                    nullptr, e.pos, e.pos, e.buttons,
-                    e.button, QEvent::MouseButtonPress,
-                    e.modifiers);
-    });
-    connect(m_handler, &LibInputHandler::mouseReleased, this,
-            [](const LibInputMouseEvent &e) {
-        QWindowSystemInterface::handleMouseEvent(
-                    nullptr, e.pos, e.pos, e.buttons,
-                    e.button, QEvent::MouseButtonRelease,
-                    e.modifiers);
-    });
-    connect(m_handler, &LibInputHandler::mouseMoved, this,
-            [](const LibInputMouseEvent &e) {
-        QWindowSystemInterface::handleMouseEvent(
-                    nullptr, e.pos, e.pos, e.buttons,
-                    Qt::NoButton, QEvent::MouseMove,
-                    e.modifiers);
-    });
-    connect(m_handler, &LibInputHandler::mouseWheel, this,
-            [](const LibInputMouseEvent &e) {
-        QWindowSystemInterface::handleWheelEvent(
-                    nullptr, e.pos, e.pos,
-                    QPoint(), e.wheelDelta,
-                    e.modifiers);
-    });
-    connect(m_handler, &LibInputHandler::touchEvent, this,
-            [](const LibInputTouchEvent &e) {
-        QWindowSystemInterface::handleTouchEvent(
-                    nullptr, e.device, e.touchPoints,
-                    e.modifiers);
-    });
-    connect(m_handler, &LibInputHandler::touchCancel, this,
-            [](const LibInputTouchEvent &e) {
-        QWindowSystemInterface::handleTouchCancelEvent(
-                    nullptr, e.device, e.modifiers);
+    if (m_thread) {
+        // Handlers run on the input thread and only queue the events
+        connect(m_handler, &LibInputHandler::keyPressed, this,
+                [this](const LibInputKeyEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::KeyPress;
+            event.key = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::keyReleased, this,
+                [this](const LibInputKeyEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::KeyRelease;
+            event.key = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::mousePressed, this,
+                [this](const LibInputMouseEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::MousePress;
+            event.mouse = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::mouseReleased, this,
+                [this](const LibInputMouseEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::MouseRelease;
+            event.mouse = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::mouseMoved, this,
+                [this](const LibInputMouseEvent &e) {
+            // Move the hardware cursor right away
+            {
+                QMutexLocker locker(&m_cursorScreenMutex);
+                if (m_cursorScreen)
+                    m_cursorScreen->moveHardwareCursor(e.pos.toPoint());
+            }
+
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::MouseMove;
+            event.mouse = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::mouseWheel, this,
+                [this](const LibInputMouseEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::MouseWheel;
+            event.mouse = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::touchEvent, this,
+                [this](const LibInputTouchEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::Touch;
+            event.touch = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+        connect(m_handler, &LibInputHandler::touchCancel, this,
+                [this](const LibInputTouchEvent &e) {
+            LibInputQueuedEvent event;
+            event.type = LibInputQueuedEvent::TouchCancel;
+            event.touch = e;
+            enqueue(std::move(event));
+        }, Qt::DirectConnection);
+
+        // The cursor is moved by the input thread
+        updateCursorScreen();
+        connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this, [this]() {
+            updateCursorScreen();
+        });
+        connect(qGuiApp, &QGuiApplication::screenRemoved, this, [this](QScreen *screen) {
+            updateCursorScreen(screen);
+        });
+    } else {
+        connect(m_handler, &LibInputHandler::keyPressed, this,
+                [this](const LibInputKeyEvent &e) {
+            handleKeyEvent(QEvent::KeyPress, e);
+        });
+        connect(m_handler, &LibInputHandler::keyReleased, this,
+                [this](const LibInputKeyEvent &e) {
+            handleKeyEvent(QEvent::KeyRelease, e);
+        });
+        connect(m_handler, &LibInputHandler::mousePressed, this,
+                [this](const LibInputMouseEvent &e) {
+            handleMouseEvent(QEvent::MouseButtonPress, e);
+        });
+        connect(m_handler, &LibInputHandler::mouseReleased, this,
+                [this](const LibInputMouseEvent &e) {
+            handleMouseEvent(QEvent::MouseButtonRelease, e);
+        });
+        connect(m_handler, &LibInputHandler::mouseMoved, this,
+                [this](const LibInputMouseEvent &e) {
+            handleMouseEvent(QEvent::MouseMove, e);
+        });
+        connect(m_handler, &LibInputHandler::mouseWheel, this,
+                [this](const LibInputMouseEvent &e) {
+            handleWheelEvent(e);
+        });
+        connect(m_handler, &LibInputHandler::touchEvent, this,
+                [this](const LibInputTouchEvent &e) {
+            handleTouchEvent(e);
+        });
+        connect(m_handler, &LibInputHandler::touchCancel, this,
+                [this](const LibInputTouchEvent &e) {
+            handleTouchCancel(e);
+        });
+    }
+
+    // The pointer is constrained to the virtual desktop
+    const auto screens = QGuiApplication::screens();
+    for (QScreen *screen : screens)
+        connect(screen, &QScreen::virtualGeometryChanged, this, &LibInputManager::updatePointerGeometry);
+    connect(qGuiApp, &QGuiApplication::screenAdded, this, [this](QScreen *screen) {
+        connect(screen, &QScreen::virtualGeometryChanged, this, &LibInputManager::updatePointerGeometry);
+        updatePointerGeometry();
     });
+    connect(qGuiApp, &QGuiApplication::primaryScreenChanged, this, &LibInputManager::updatePointerGeometry);
 
     // Change pointer coordinates when requested by QPA
     connect(inputManager, &QInputDeviceManager::cursorPositionChangeRequested, this,
             [this](const QPoint &pos) {
-        m_handler->setPointerPosition(pos);
+        QMetaObject::invokeMethod(m_handler, [this, pos]() {
+            m_handler->setPointerPosition(pos);
+        });
     });
 }
 
+LibInputManager::~LibInputManager()
+{
+    if (m_thread) {
+        {
+            QMutexLocker locker(&m_cursorScreenMutex);
+            m_cursorScreen = nullptr;
+        }
+
+        // The handler has to go away on the thread it lives in
+        QMetaObject::invokeMethod(m_threadContext, [this]() {
+            delete m_handler;
+            m_handler = nullptr;
+            m_threadContext->deleteLater();
+        }, Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+
+        ::close(m_wakeupFd);
+    }
+}
+
 LibInputHandler *LibInputManager::handler() const
 {
     return m_handler;
 }
 
+void LibInputManager::createHandler()
+{
+    m_handler = new LibInputHandler(m_thread ? nullptr : this);
+}
+
+void LibInputManager::updatePointerGeometry()
+{
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (!screen)
+        return;
+
+    const QRect geometry = QHighDpi::toNativePixels(screen->virtualGeometry(), screen);
+    QMetaObject::invokeMethod(m_handler, [this, geometry]() {
+        m_handler->setPointerGeometry(geometry);
+    });
+}
+
+// GUI thread, \a removedScreen is about to be deleted
+void LibInputManager::updateCursorScreen(QScreen *removedScreen)
+{
+    // The primary screen changes after the old one is removed
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen == removedScreen) {
+        screen = nullptr;
+        const auto screens = QGuiApplication::screens();
+        for (QScreen *candidate : screens) {
+            if (candidate != removedScreen) {
+                screen = candidate;
+                break;
+            }
+        }
+    }
+
+    // Waits for the input thread to be done with the previous screen
+    QMutexLocker locker(&m_cursorScreenMutex);
+    m_cursorScreen = screen ? static_cast<QEglFSScreen *>(screen->handle()) : nullptr;
+}
+
+// Input thread
+void LibInputManager::enqueue(LibInputQueuedEvent &&event)
+{
+    while (!m_queue.push(std::move(event))) {
+        // Motion is superseded by the next one anyway
+        if (event.type == LibInputQueuedEvent::MouseMove)
+            return;
+        QThread::yieldCurrentThread();
+    }
+
+    // One wakeup for all the events queued before the GUI thread runs
+    if (m_wakeupPending.fetchAndStoreOrdered(1) == 0) {
+        const quint64 value = 1;
+        if (::write(m_wakeupFd, &value, sizeof(value)) < 0)
+            qWarning("Failed to wake up the GUI thread: %s", strerror(errno));
+    }
+}
+
+// GUI thread
+void LibInputManager::processQueue()
+{
+    quint64 value;
+    while (::read(m_wakeupFd, &value, sizeof(value)) > 0)
+        ;
+    // A full barrier, or the queue could be read before the flag is reset
+    m_wakeupPending.fetchAndStoreOrdered(0);
+
+    LibInputQueuedEvent event;
+    while (m_queue.pop(event)) {
+        switch (event.type) {
+        case LibInputQueuedEvent::KeyPress:
+            handleKeyEvent(QEvent::KeyPress, event.key);
+            break;
+        case LibInputQueuedEvent::KeyRelease:
+            handleKeyEvent(QEvent::KeyRelease, event.key);
+            break;
+        case LibInputQueuedEvent::MousePress:
+            handleMouseEvent(QEvent::MouseButtonPress, event.mouse);
+            break;
+        case LibInputQueuedEvent::MouseRelease:
+            handleMouseEvent(QEvent::MouseButtonRelease, event.mouse);
+            break;
+        case LibInputQueuedEvent::MouseMove:
+            handleMouseEvent(QEvent::MouseMove, event.mouse);
+            break;
+        case LibInputQueuedEvent::MouseWheel:
+            handleWheelEvent(event.mouse);
+            break;
+        case LibInputQueuedEvent::Touch:
+            handleTouchEvent(event.touch);
+            break;
+        case LibInputQueuedEvent::TouchCancel:
+            handleTouchCancel(event.touch);
+            break;
+        }
+    }
+}
+
+void LibInputManager::handleKeyEvent(QEvent::Type type, const LibInputKeyEvent &e)
+{
+    QWindowSystemInterface::handleExtendedKeyEvent(
+                nullptr, ulong(e.timestamp / 1000), type, e.key,
+                e.modifiers, e.nativeScanCode,
+                e.nativeVirtualKey, e.nativeModifiers,
+                e.text, e.autoRepeat, e.repeatCount);
+}
+
+void LibInputManager::handleMouseEvent(QEvent::Type type, const LibInputMouseEvent &e)
+{
+    QWindowSystemInterface::handleMouseEvent(
+                nullptr, ulong(e.timestamp / 1000), e.pos, e.pos, e.buttons,
+                type == QEvent::MouseMove ? Qt::NoButton : e.button, type,
+                e.modifiers);
+
+    // Mouse events don't carry the deltas, the compositor
+    // gets them for the relative pointer protocol this way
+    if (type == QEvent::MouseMove && (!e.delta.isNull() || !e.deltaUnaccelerated.isNull())) {
+        auto *event = new RelativeMotionEvent();
+        event->delta = e.delta;
+        event->deltaUnaccelerated = e.deltaUnaccelerated;
+        event->timestamp = e.timestamp;
+        QCoreApplication::postEvent(QCoreApplication::instance(), event);
+    }
+}
+
+void LibInputManager::handleWheelEvent(const LibInputMouseEvent &e)
+{
+    QWindowSystemInterface::handleWheelEvent(
+                nullptr, ulong(e.timestamp / 1000), e.pos, e.pos,
+                QPoint(), e.wheelDelta,
+                e.modifiers);
+}
+
+void LibInputManager::handleTouchEvent(const LibInputTouchEvent &e)
+{
+    QWindowSystemInterface::handleTouchEvent(
+                nullptr, ulong(e.timestamp / 1000), e.device, e.touchPoints,
+                e.modifiers);
+}
+
+void LibInputManager::handleTouchCancel(const LibInputTouchEvent &e)
+{
+    QWindowSystemInterface::handleTouchCancelEvent(
+                nullptr, ulong(e.timestamp / 1000), e.device, e.modifiers);
+}
+
 } // namespace PlatformSupport
 
 } // namespace Aurora
@@ -24,6 +24,11 @@
 #pragma once
 
 #include <QObject>
+#include <QAtomicInt>
+#include <QMutex>
+
+#include <LiriAuroraLibInput/libinputhandler.h>
+#include <LiriAuroraLibInput/private/libinputeventqueue_p.h>
 
 //
 //  W A R N I N G
@@ -36,22 +41,72 @@
 // We mean it.
 //
 
+QT_BEGIN_NAMESPACE
+class QEglFSScreen;
+class QScreen;
+class QSocketNotifier;
+class QThread;
+QT_END_NAMESPACE
+
 namespace Aurora {
 
 namespace PlatformSupport {
 
-class LibInputHandler;
+struct LibInputQueuedEvent
+{
+    enum Type {
+        KeyPress,
+        KeyRelease,
+        MousePress,
+        MouseRelease,
+        MouseMove,
+        MouseWheel,
+        Touch,
+        TouchCancel
+    };
+
+    Type type = MouseMove;
+    LibInputKeyEvent key;
+    LibInputMouseEvent mouse;
+    LibInputTouchEvent touch;
+};
 
 class LibInputManager : public QObject
 {
     Q_OBJECT
 public:
     explicit LibInputManager(QObject *parent = nullptr);
+    ~LibInputManager();
 
     LibInputHandler *handler() const;
 
 private:
-    LibInputHandler *m_handler;
+    void createHandler();
+    void updatePointerGeometry();
+    void updateCursorScreen(QScreen *removedScreen = nullptr);
+
+    void enqueue(LibInputQueuedEvent &&event);
+    void processQueue();
+
+    void handleKeyEvent(QEvent::Type type, const LibInputKeyEvent &e);
+    void handleMouseEvent(QEvent::Type type, const LibInputMouseEvent &e);
+    void handleWheelEvent(const LibInputMouseEvent &e);
+    void handleTouchEvent(const LibInputTouchEvent &e);
+    void handleTouchCancel(const LibInputTouchEvent &e);
+
+    LibInputHandler *m_handler = nullptr;
+
+    // Only when libinput runs on its own thread
+    QThread *m_thread = nullptr;
+    QObject *m_threadContext = nullptr;
+    LibInputEventQueue<LibInputQueuedEvent, 1024> m_queue;
+    QAtomicInt m_wakeupPending;
+    int m_wakeupFd = -1;
+    QSocketNotifier *m_wakeupNotifier = nullptr;
+    // Held by the input thread while it moves the cursor, so that
+    // the GUI thread doesn't delete the screen meanwhile
+    QMutex m_cursorScreenMutex;
+    QEglFSScreen *m_cursorScreen = nullptr;
 };
 
 } // namespace PlatformSupport
@@ -63,6 +63,7 @@
 #include "qeglfslogindhandler_p.h"
 #include "vthandler.h"
 #include "libinputmanager_p.h"
+#include "aurorastartuptrace_p.h"
 
 #include <QtEglSupport/private/qeglconvenience_p.h>
 #ifndef QT_NO_OPENGL
@@ -111,28 +112,40 @@ void QEglFSIntegration::initialize()
 {
     m_logindHandler = new QEglFSLogindHandler();
     connect(m_logindHandler, &QEglFSLogindHandler::initializationRequested, this, [&] {
-        qt_egl_device_integration()->platformInit();
+        {
+            Aurora::StartupTrace::Span span("platform", "platformInit");
+            qt_egl_device_integration()->platformInit();
+        }
 
-        m_display = qt_egl_device_integration()->createDisplay(nativeDisplay());
-        if (Q_UNLIKELY(m_display == EGL_NO_DISPLAY))
-            qFatal("Could not open egl display");
+        {
+            Aurora::StartupTrace::Span span("egl", "initialize");
 
-        EGLint major, minor;
-        if (Q_UNLIKELY(!eglInitialize(m_display, &major, &minor)))
-            qFatal("Could not initialize egl display");
+            m_display = qt_egl_device_integration()->createDisplay(nativeDisplay());
+            if (Q_UNLIKELY(m_display == EGL_NO_DISPLAY))
+                qFatal("Could not open egl display");
+
+            EGLint major, minor;
+            if (Q_UNLIKELY(!eglInitialize(m_display, &major, &minor)))
+                qFatal("Could not initialize egl display");
+        }
 
         m_inputContext = QPlatformInputContextFactory::create();
 
         m_vtHandler.reset(new VtHandler);
 
-        if (qt_egl_device_integration()->usesDefaultScreen())
-            QWindowSystemInterface::handleScreenAdded(new QEglFSScreen(display()));
-        else
-            qt_egl_device_integration()->screenInit();
+        {
+            Aurora::StartupTrace::Span span("platform", "screenInit");
+            if (qt_egl_device_integration()->usesDefaultScreen())
+                QWindowSystemInterface::handleScreenAdded(new QEglFSScreen(display()));
+            else
+                qt_egl_device_integration()->screenInit();
+        }
 
         // Input code may rely on the screens, so do it only after the screen init.
-        if (!m_disableInputHandlers)
+        if (!m_disableInputHandlers) {
+            Aurora::StartupTrace::Span span("input", "inputHandlers");
             createInputHandlers();
+        }
 
         // Exit initialization
         m_logindHandler->stop();
@@ -142,6 +155,9 @@ void QEglFSIntegration::initialize()
 
 void QEglFSIntegration::destroy()
 {
+    // Input may be handled on another thread that moves the cursor
+    m_liHandler.reset();
+
     foreach (QWindow *w, qGuiApp->topLevelWindows())
         w->destroy();
 
@@ -37,6 +37,8 @@
 **
 ****************************************************************************/
 
+#include <QtCore/QElapsedTimer>
+
 #include "qeglfshooks_p.h"
 #include "qeglfslogindhandler_p.h"
 
@@ -52,6 +54,9 @@ QEglFSLogindHandler::QEglFSLogindHandler()
 
 void QEglFSLogindHandler::initialize()
 {
+    QElapsedTimer timer;
+    timer.start();
+
     // Connect to logind and take control
     Logind *logind = Logind::instance();
     if (logind->isConnected()) {
@@ -66,6 +71,9 @@ void QEglFSLogindHandler::initialize()
 
     // Wait for logind setup
     m_loop->exec();
+
+    qCInfo(qLcEglDevDebug, "Session set up via logind in %lld ms",
+           static_cast<long long>(timer.elapsed()));
 }
 
 void QEglFSLogindHandler::stop()
@@ -212,6 +212,13 @@ void QEglFSScreen::setCursorTheme(const QString &name, int size)
         cursor->setCursorTheme(name, size);
 }
 
+bool QEglFSScreen::moveHardwareCursor(const QPoint &pos)
+{
+    // The software cursor is drawn by the compositor
+    Q_UNUSED(pos);
+    return false;
+}
+
 QPixmap QEglFSScreen::grabWindow(WId wid, int x, int y, int width, int height) const
 {
 #ifndef QT_NO_OPENGL
@@ -94,6 +94,10 @@ public:
 
     virtual void setCursorTheme(const QString &name, int size);
 
+    // Called from the input thread, returns false when the cursor
+    // can only be moved by pointer events on the GUI thread
+    virtual bool moveHardwareCursor(const QPoint &pos);
+
     virtual bool modeChangeRequested() const { return m_modeChangeRequested; }
     virtual void setModeChangeRequested(bool enabled) { m_modeChangeRequested = enabled; }
 
@@ -47,9 +47,13 @@
 #include <QtCore/QJsonObject>
 #include <QtCore/QJsonArray>
 #include <QtCore/QLoggingCategory>
-#include <QtGui/QPainter>
+#include <QtCore/QMutexLocker>
 #include <QtGui/private/qguiapplication_p.h>
 
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+
+#include <drm_fourcc.h>
+#include <string.h>
 #include <xf86drm.h>
 #include <xf86drmMode.h>
 
@@ -65,11 +69,12 @@ QT_BEGIN_NAMESPACE
 
 Q_DECLARE_LOGGING_CATEGORY(qLcEglfsKmsDebug)
 
+// Shapes kept uploaded, applications rarely use more than a handful
+static const int maxCachedCursors = 16;
+
 QEglFSKmsGbmCursor::QEglFSKmsGbmCursor(QEglFSKmsGbmScreen *screen)
     : m_screen(screen)
     , m_cursorSize(64, 64) // 64x64 is the old standard size, we now try to query the real size below
-    , m_bo(nullptr)
-    , m_cursorImage(nullptr, nullptr, 0, 0, 0, 0)
     , m_state(CursorPendingVisible)
     , m_deviceListener(nullptr)
 {
@@ -86,11 +91,13 @@ QEglFSKmsGbmCursor::QEglFSKmsGbmCursor(QEglFSKmsGbmScreen *screen)
         m_cursorSize.setHeight(height);
     }
 
-    m_bo = gbm_bo_create(static_cast<QEglFSKmsGbmDevice *>(m_screen->device())->gbmDevice(), m_cursorSize.width(), m_cursorSize.height(),
-                         GBM_FORMAT_ARGB8888, GBM_BO_USE_CURSOR_64X64 | GBM_BO_USE_WRITE);
-    if (!m_bo) {
+    gbm_bo *bo = createBufferObject();
+    if (!bo) {
         qWarning("Could not create buffer for cursor!");
     } else {
+        gbm_bo_destroy(bo);
+        m_hasBuffers = true;
+
         // Load the default cursor
         m_cursorTheme.loadTheme(QString(), 32);
 
@@ -116,15 +123,24 @@ QEglFSKmsGbmCursor::~QEglFSKmsGbmCursor()
     delete m_deviceListener;
 
     Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
-        QEglFSKmsScreen *kmsScreen = static_cast<QEglFSKmsScreen *>(screen);
-        drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0, 0);
-        drmModeMoveCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0);
+        QEglFSKmsGbmScreen *kmsScreen = static_cast<QEglFSKmsGbmScreen *>(screen);
+        if (kmsScreen->hasCursorPlane()) {
+            kmsScreen->setCursorPlane(0, QSize(), QPoint());
+        } else {
+            drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0, 0);
+            drmModeMoveCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0);
+        }
     }
 
-    if (m_bo) {
-        gbm_bo_destroy(m_bo);
-        m_bo = nullptr;
+    for (HardwareBuffer *buffer : qAsConst(m_cache)) {
+        destroyBuffer(buffer);
+        delete buffer;
     }
+    for (HardwareBuffer &buffer : m_clientBuffers)
+        destroyBuffer(&buffer);
+    destroyBuffer(&m_clientDmabuf);
+    if (m_previousDmabufFb)
+        drmModeRmFB(m_screen->device()->fd(), m_previousDmabufFb);
 }
 
 void QEglFSKmsGbmCursor::updateMouseStatus()
@@ -144,6 +160,9 @@ void QEglFSKmsGbmCursor::updateMouseStatus()
 void QEglFSKmsGbmCursor::setCursorTheme(const QString &name, int size)
 {
     m_cursorTheme.loadTheme(name, size);
+
+    // Shapes of the previous theme age out of the cache
+    ++m_themeSerial;
 }
 
 bool QEglFSKmsGbmCursorDeviceListener::hasMouse() const
@@ -159,7 +178,17 @@ void QEglFSKmsGbmCursorDeviceListener::onDeviceListChanged(QInputDeviceManager::
 
 void QEglFSKmsGbmCursor::pointerEvent(const QMouseEvent &event)
 {
-    setPos(event.screenPos().toPoint());
+    const QPoint pos = event.screenPos().toPoint();
+
+    // The input thread is ahead of the events we get here, moving the
+    // cursor again would make it jump back
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_movedByInputThread)
+            updateHardwareCursor(pos);
+    }
+
+    notifyCursorMove(pos);
 }
 
 #ifndef QT_NO_CURSOR
@@ -167,106 +196,350 @@ void QEglFSKmsGbmCursor::changeCursor(QCursor *windowCursor, QWindow *window)
 {
     Q_UNUSED(window);
 
-    if (!m_bo)
+    if (!m_hasBuffers)
         return;
 
+    QMutexLocker locker(&m_mutex);
+
     if (m_state == CursorPendingHidden) {
         m_state = CursorHidden;
-        Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
-            QEglFSKmsScreen *kmsScreen = static_cast<QEglFSKmsScreen *>(screen);
-            drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0, 0);
-        }
+        showBuffer(m_current);
     }
 
     if (m_state == CursorHidden || m_state == CursorDisabled)
         return;
 
+    if (m_state == CursorPendingVisible)
+        m_state = CursorVisible;
+
     const Qt::CursorShape newShape = windowCursor ? windowCursor->shape() : Qt::ArrowCursor;
-    if (newShape == Qt::BitmapCursor) {
-        m_cursorImage.set(windowCursor->pixmap().toImage(),
-                          windowCursor->hotSpot().x(),
-                          windowCursor->hotSpot().y());
+    if (newShape == Qt::BlankCursor) {
+        m_shape = nullptr;
+        if (!m_clientCursor)
+            showBuffer(nullptr);
+        return;
+    }
+
+    // Bitmaps are told apart by their pixmap, shapes by the theme they come from
+    const CursorKey key = newShape == Qt::BitmapCursor
+            ? CursorKey(newShape, windowCursor->pixmap().cacheKey())
+            : CursorKey(newShape, m_cursorTheme.isLoaded() ? m_themeSerial : -1);
+
+    HardwareBuffer *buffer = m_cache.value(key);
+    if (buffer) {
+        m_recent.removeOne(key);
     } else {
-        if (m_cursorTheme.isLoaded()) {
-            auto cursor = m_cursorTheme.cursorForShape(newShape);
-            if (cursor.isValid)
-                m_cursorImage.set(cursor.image, cursor.hotSpot.x(), cursor.hotSpot.y());
-        } else {
-            // Standard cursor, look up in atlas
-            const int width = m_cursorAtlas.cursorWidth;
-            const int height = m_cursorAtlas.cursorHeight;
-            const qreal ws = (qreal)m_cursorAtlas.cursorWidth / m_cursorAtlas.width;
-            const qreal hs = (qreal)m_cursorAtlas.cursorHeight / m_cursorAtlas.height;
-
-            QRect textureRect(ws * (newShape % m_cursorAtlas.cursorsPerRow) * m_cursorAtlas.width,
-                              hs * (newShape / m_cursorAtlas.cursorsPerRow) * m_cursorAtlas.height,
-                              width,
-                              height);
-            QPoint hotSpot = m_cursorAtlas.hotSpots[newShape];
-            m_cursorImage.set(m_cursorAtlas.image.copy(textureRect),
-                              hotSpot.x(),
-                              hotSpot.y());
+        QPoint hotSpot;
+        const QImage image = shapeImage(windowCursor, newShape, &hotSpot);
+        if (image.isNull())
+            return;
+
+        // Least recently used first, the buffer on screen stays
+        for (int i = m_recent.size() - 1; i >= 0 && m_cache.size() >= maxCachedCursors; --i) {
+            HardwareBuffer *evicted = m_cache.value(m_recent.at(i));
+            if (evicted == m_shape || evicted == m_current)
+                continue;
+            m_cache.remove(m_recent.takeAt(i));
+            destroyBuffer(evicted);
+            delete evicted;
+        }
+
+        buffer = new HardwareBuffer;
+        buffer->hotSpot = hotSpot;
+        if (!uploadImage(buffer, image)) {
+            destroyBuffer(buffer);
+            delete buffer;
+            return;
         }
+        m_cache.insert(key, buffer);
     }
+    m_recent.prepend(key);
+    m_shape = buffer;
+
+    // Client cursors win over the window cursor until they are reset
+    if (m_clientCursor)
+        showBuffer(m_current);
+    else
+        showBuffer(buffer);
+}
+#endif // QT_NO_CURSOR
 
-    if (m_cursorImage.image()->width() > m_cursorSize.width() || m_cursorImage.image()->height() > m_cursorSize.height())
-        qWarning("Cursor larger than %dx%d, cursor will be clipped.", m_cursorSize.width(), m_cursorSize.height());
+/*
+    Shows the cursor surface of a client: shared memory images are copied
+    to a cursor buffer, dmabufs go straight on the cursor plane. Returns
+    false when the compositor has to draw the cursor itself.
+*/
+bool QEglFSKmsGbmCursor::setCursorBuffer(const Aurora::PlatformSupport::CursorBuffer &buffer)
+{
+    if (!m_hasBuffers || m_state == CursorDisabled)
+        return false;
 
-    QImage cursorImage(m_cursorSize, QImage::Format_ARGB32);
-    cursorImage.fill(Qt::transparent);
+    QMutexLocker locker(&m_mutex);
 
-    QPainter painter;
-    painter.begin(&cursorImage);
-    painter.drawImage(0, 0, *m_cursorImage.image());
-    painter.end();
+    // Back to the cursor of the window
+    if (buffer.image.isNull() && buffer.buffer.planeCount == 0) {
+        if (m_clientCursor) {
+            m_clientCursor = false;
+            showBuffer(m_shape);
+        }
+        return true;
+    }
 
-    gbm_bo_write(m_bo, cursorImage.constBits(), cursorImage.sizeInBytes());
+    if (!buffer.image.isNull()) {
+        // Clipped cursors are better drawn by the compositor
+        if (buffer.image.width() > m_cursorSize.width() || buffer.image.height() > m_cursorSize.height())
+            return false;
+
+        HardwareBuffer *client = &m_clientBuffers[m_nextClientBuffer];
+        if (!uploadImage(client, buffer.image))
+            return false;
+        m_nextClientBuffer = (m_nextClientBuffer + 1) % 2;
+
+        client->hotSpot = buffer.hotSpot;
+        m_clientCursor = true;
+        showBuffer(client);
+
+        // Legacy cursors are updated right away, planes with their next commit
+        for (QPlatformScreen *screen : m_screen->virtualSiblings()) {
+            auto *kmsScreen = static_cast<QEglFSKmsGbmScreen *>(screen);
+            if (!kmsScreen->hasCursorPlane()) {
+                QMutexLocker flipLocker(&kmsScreen->m_flipMutex);
+                kmsScreen->sendCursorPresentation();
+            }
+        }
+        return true;
+    }
 
-    uint32_t handle = gbm_bo_get_handle(m_bo).u32;
+    // Only cursor planes take client buffers, on every screen the cursor goes
+    const QSize size = buffer.buffer.size;
+    if (size.width() > m_cursorSize.width() || size.height() > m_cursorSize.height())
+        return false;
+    const QList<QPlatformScreen *> screens = m_screen->virtualSiblings();
+    for (QPlatformScreen *screen : screens) {
+        if (!static_cast<QEglFSKmsGbmScreen *>(screen)->hasCursorPlane())
+            return false;
+    }
 
-    if (m_state == CursorPendingVisible)
-        m_state = CursorVisible;
+    const uint32_t fb = m_screen->importScanoutBuffer(buffer.buffer);
+    if (!fb)
+        return false;
 
-    Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
-        QEglFSKmsScreen *kmsScreen = static_cast<QEglFSKmsScreen *>(screen);
-        if (kmsScreen->isCursorOutOfRange())
-            continue;
-        int status = drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, handle,
-                                      m_cursorSize.width(), m_cursorSize.height());
-        if (status != 0)
-            qWarning("Could not set cursor on screen %s: %d", kmsScreen->name().toLatin1().constData(), status);
+    // Many cursor planes only take buffers of the cursor size
+    for (QPlatformScreen *screen : screens) {
+        if (!static_cast<QEglFSKmsGbmScreen *>(screen)->testCursorPlane(fb, size)) {
+            drmModeRmFB(m_screen->device()->fd(), fb);
+            return false;
+        }
     }
+
+    // The previous framebuffer might still be on screen until the next commit
+    if (m_previousDmabufFb)
+        drmModeRmFB(m_screen->device()->fd(), m_previousDmabufFb);
+    m_previousDmabufFb = m_clientDmabuf.fb;
+    m_clientDmabuf.fb = fb;
+    m_clientDmabuf.size = size;
+    m_clientDmabuf.hotSpot = buffer.hotSpot;
+
+    m_clientCursor = true;
+    showBuffer(&m_clientDmabuf);
+    return true;
 }
-#endif // QT_NO_CURSOR
 
 QPoint QEglFSKmsGbmCursor::pos() const
 {
+    QMutexLocker locker(&m_mutex);
     return m_pos;
 }
 
 void QEglFSKmsGbmCursor::setPos(const QPoint &pos)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        updateHardwareCursor(pos);
+    }
+
+    notifyCursorMove(pos);
+}
+
+void QEglFSKmsGbmCursor::moveHardwareCursor(const QPoint &pos)
+{
+    QMutexLocker locker(&m_mutex);
+    m_movedByInputThread = true;
+    updateHardwareCursor(pos);
+}
+
+bool QEglFSKmsGbmCursor::usesCursorPlanes() const
 {
     Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
-        QEglFSKmsScreen *kmsScreen = static_cast<QEglFSKmsScreen *>(screen);
+        if (static_cast<QEglFSKmsGbmScreen *>(screen)->hasCursorPlane())
+            return true;
+    }
+    return false;
+}
+
+gbm_bo *QEglFSKmsGbmCursor::createBufferObject() const
+{
+    return gbm_bo_create(static_cast<QEglFSKmsGbmDevice *>(m_screen->device())->gbmDevice(),
+                         m_cursorSize.width(), m_cursorSize.height(),
+                         GBM_FORMAT_ARGB8888, GBM_BO_USE_CURSOR_64X64 | GBM_BO_USE_WRITE);
+}
+
+QImage QEglFSKmsGbmCursor::shapeImage(QCursor *windowCursor, Qt::CursorShape shape, QPoint *hotSpot)
+{
+    if (shape == Qt::BitmapCursor) {
+        *hotSpot = windowCursor->hotSpot();
+        return windowCursor->pixmap().toImage();
+    }
+
+    if (m_cursorTheme.isLoaded()) {
+        auto cursor = m_cursorTheme.cursorForShape(shape);
+        if (!cursor.isValid)
+            return QImage();
+        *hotSpot = cursor.hotSpot;
+        return cursor.image;
+    }
+
+    // Standard cursor, look up in atlas
+    const int width = m_cursorAtlas.cursorWidth;
+    const int height = m_cursorAtlas.cursorHeight;
+    const qreal ws = (qreal)m_cursorAtlas.cursorWidth / m_cursorAtlas.width;
+    const qreal hs = (qreal)m_cursorAtlas.cursorHeight / m_cursorAtlas.height;
+
+    QRect textureRect(ws * (shape % m_cursorAtlas.cursorsPerRow) * m_cursorAtlas.width,
+                      hs * (shape / m_cursorAtlas.cursorsPerRow) * m_cursorAtlas.height,
+                      width,
+                      height);
+    *hotSpot = m_cursorAtlas.hotSpots[shape];
+    return m_cursorAtlas.image.copy(textureRect);
+}
+
+bool QEglFSKmsGbmCursor::uploadImage(HardwareBuffer *buffer, const QImage &image)
+{
+    if (!buffer->bo) {
+        buffer->bo = createBufferObject();
+        if (!buffer->bo)
+            return false;
+        buffer->size = m_cursorSize;
+    }
+
+    if (image.width() > m_cursorSize.width() || image.height() > m_cursorSize.height())
+        qWarning("Cursor larger than %dx%d, cursor will be clipped.", m_cursorSize.width(), m_cursorSize.height());
+
+    // Rows are copied as they are, the rest of the buffer is transparent
+    const QImage source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage cursorImage(m_cursorSize, QImage::Format_ARGB32_Premultiplied);
+    cursorImage.fill(Qt::transparent);
+    const int width = qMin(source.width(), m_cursorSize.width());
+    const int height = qMin(source.height(), m_cursorSize.height());
+    for (int y = 0; y < height; ++y)
+        memcpy(cursorImage.scanLine(y), source.constScanLine(y), width * 4);
+
+    if (gbm_bo_write(buffer->bo, cursorImage.constBits(), cursorImage.sizeInBytes()) != 0) {
+        qWarning("Could not write cursor buffer!");
+        return false;
+    }
+
+    // Planes take framebuffers, the same one is used for every upload
+    if (!buffer->fb && usesCursorPlanes()) {
+        uint32_t handles[4] = { gbm_bo_get_handle(buffer->bo).u32 };
+        uint32_t strides[4] = { gbm_bo_get_stride(buffer->bo) };
+        uint32_t offsets[4] = { 0 };
+        if (drmModeAddFB2(m_screen->device()->fd(), m_cursorSize.width(), m_cursorSize.height(),
+                          DRM_FORMAT_ARGB8888, handles, strides, offsets, &buffer->fb, 0) != 0) {
+            qWarning("Could not create framebuffer for cursor!");
+            buffer->fb = 0;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void QEglFSKmsGbmCursor::destroyBuffer(HardwareBuffer *buffer)
+{
+    if (buffer->fb)
+        drmModeRmFB(m_screen->device()->fd(), buffer->fb);
+    if (buffer->bo)
+        gbm_bo_destroy(buffer->bo);
+    *buffer = HardwareBuffer();
+}
+
+// Called with the mutex locked
+void QEglFSKmsGbmCursor::showBuffer(HardwareBuffer *buffer)
+{
+    m_current = buffer;
+
+    Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
+        QEglFSKmsGbmScreen *kmsScreen = static_cast<QEglFSKmsGbmScreen *>(screen);
+        if (!kmsScreen->isCursorOutOfRange())
+            showOnScreen(kmsScreen, m_pos - kmsScreen->geometry().topLeft());
+    }
+}
+
+// Puts the current buffer on a screen the cursor is on, called with the mutex locked
+bool QEglFSKmsGbmCursor::showOnScreen(QEglFSKmsGbmScreen *screen, const QPoint &localPos)
+{
+    const bool visible = m_state == CursorVisible && m_current;
+    const QPoint position = localPos - (m_current ? m_current->hotSpot : QPoint());
+
+    // The position goes with the buffer, in the next commit of the screen
+    if (screen->hasCursorPlane()) {
+        if (visible)
+            screen->setCursorPlane(m_current->fb, m_current->size, position);
+        else
+            screen->setCursorPlane(0, QSize(), QPoint());
+        return true;
+    }
+
+    const int fd = screen->device()->fd();
+    const uint32_t crtcId = screen->output().crtc_id;
+    int ret;
+    if (visible && m_current->bo) {
+        ret = drmModeSetCursor(fd, crtcId, gbm_bo_get_handle(m_current->bo).u32,
+                               m_cursorSize.width(), m_cursorSize.height());
+        if (ret == 0)
+            ret = drmModeMoveCursor(fd, crtcId, position.x(), position.y());
+    } else {
+        ret = drmModeSetCursor(fd, crtcId, 0, 0, 0);
+    }
+    if (ret != 0)
+        qWarning("Could not set cursor on screen %s: %d", screen->name().toLatin1().constData(), ret);
+
+    return ret == 0;
+}
+
+// Called with the mutex locked, from either the GUI or the input thread
+void QEglFSKmsGbmCursor::updateHardwareCursor(const QPoint &pos)
+{
+    Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
+        QEglFSKmsGbmScreen *kmsScreen = static_cast<QEglFSKmsGbmScreen *>(screen);
         const QRect screenGeom = kmsScreen->geometry();
         const QPoint origin = screenGeom.topLeft();
         const QPoint localPos = pos - origin;
-        const QPoint adjustedLocalPos = localPos - m_cursorImage.hotspot();
+        const QPoint adjustedLocalPos = localPos - (m_current ? m_current->hotSpot : QPoint());
 
         if (localPos.x() < 0 || localPos.y() < 0
             || localPos.x() >= screenGeom.width() || localPos.y() >= screenGeom.height())
         {
             if (!kmsScreen->isCursorOutOfRange()) {
                 kmsScreen->setCursorOutOfRange(true);
-                drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0, 0);
+                if (kmsScreen->hasCursorPlane())
+                    kmsScreen->setCursorPlane(0, QSize(), QPoint());
+                else
+                    drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id, 0, 0, 0);
             }
+        } else if (kmsScreen->hasCursorPlane()) {
+            // No ioctl, moves are folded into the commits of the screen
+            kmsScreen->setCursorOutOfRange(false);
+            if (m_state == CursorVisible && m_current)
+                kmsScreen->setCursorPlane(m_current->fb, m_current->size, adjustedLocalPos);
+            m_pos = pos;
         } else {
             int ret;
-            if (kmsScreen->isCursorOutOfRange() && m_bo) {
+            if (kmsScreen->isCursorOutOfRange()) {
                 kmsScreen->setCursorOutOfRange(false);
-                uint32_t handle = gbm_bo_get_handle(m_bo).u32;
-                ret = drmModeSetCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id,
-                                       handle, m_cursorSize.width(), m_cursorSize.height());
+                m_pos = pos;
+                ret = showOnScreen(kmsScreen, localPos) ? 0 : -1;
             } else {
                 ret = drmModeMoveCursor(kmsScreen->device()->fd(), kmsScreen->output().crtc_id,
                                         adjustedLocalPos.x(), adjustedLocalPos.y());
@@ -275,9 +548,17 @@ void QEglFSKmsGbmCursor::setPos(const QPoint &pos)
                 m_pos = pos;
             else
                 qWarning("Failed to move cursor on screen %s: %d", kmsScreen->name().toLatin1().constData(), ret);
+        }
+    }
+}
 
+// Enter and leave events for the windows, GUI thread only
+void QEglFSKmsGbmCursor::notifyCursorMove(const QPoint &pos)
+{
+    Q_FOREACH (QPlatformScreen *screen, m_screen->virtualSiblings()) {
+        QEglFSKmsScreen *kmsScreen = static_cast<QEglFSKmsScreen *>(screen);
+        if (kmsScreen->geometry().contains(pos))
             kmsScreen->handleCursorMove(pos);
-        }
     }
 }
 
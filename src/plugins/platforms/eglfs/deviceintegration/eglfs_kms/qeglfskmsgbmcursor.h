@@ -40,6 +40,9 @@
 #pragma once
 
 #include <qpa/qplatformcursor.h>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
 #include <QtCore/QVector>
 #include <QtGui/QImage>
 #include <QtGui/private/qinputdevicemanager_p.h>
@@ -48,6 +51,12 @@
 
 #include <gbm.h>
 
+namespace Aurora {
+namespace PlatformSupport {
+class CursorBuffer;
+}
+}
+
 QT_BEGIN_NAMESPACE
 
 class QEglFSKmsGbmScreen;
@@ -84,13 +93,36 @@ public:
     QPoint pos() const override;
     void setPos(const QPoint &pos) override;
 
+    void moveHardwareCursor(const QPoint &pos);
+
     void updateMouseStatus();
 
     void setCursorTheme(const QString &name, int size);
     void reevaluateVisibilityForScreens() { setPos(pos()); }
 
+    // Cursor surface of a client, or the cursor shape again when empty
+    bool setCursorBuffer(const Aurora::PlatformSupport::CursorBuffer &buffer);
+
 private:
+    // Cursor image uploaded to a buffer object that can be scanned out
+    struct HardwareBuffer {
+        gbm_bo *bo = nullptr;
+        uint32_t fb = 0;
+        QSize size;
+        QPoint hotSpot;
+    };
+    typedef QPair<int, qint64> CursorKey;
+
     void initCursorAtlas();
+    bool usesCursorPlanes() const;
+    gbm_bo *createBufferObject() const;
+    QImage shapeImage(QCursor *windowCursor, Qt::CursorShape shape, QPoint *hotSpot);
+    bool uploadImage(HardwareBuffer *buffer, const QImage &image);
+    void destroyBuffer(HardwareBuffer *buffer);
+    void showBuffer(HardwareBuffer *buffer);
+    bool showOnScreen(QEglFSKmsGbmScreen *screen, const QPoint &localPos);
+    void updateHardwareCursor(const QPoint &pos);
+    void notifyCursorMove(const QPoint &pos);
 
     enum CursorState {
         CursorDisabled,
@@ -102,13 +134,34 @@ private:
 
     QEglFSKmsGbmScreen *m_screen;
     QSize m_cursorSize;
-    gbm_bo *m_bo;
     QPoint m_pos;
-    QPlatformCursorImage m_cursorImage;
     CursorState m_state;
     QEglFSKmsGbmCursorDeviceListener *m_deviceListener;
     Liri::Platform::XcursorTheme m_cursorTheme;
 
+    // Serializes cursor plane updates between the GUI and the input thread
+    mutable QMutex m_mutex;
+    // Once the input thread moves the cursor, pointer events don't
+    bool m_movedByInputThread = false;
+
+    // Shapes are uploaded once and reused, the buffer on screen
+    // is either one of them or a client buffer
+    QHash<CursorKey, HardwareBuffer *> m_cache;
+    QList<CursorKey> m_recent;
+    HardwareBuffer *m_shape = nullptr;
+    HardwareBuffer *m_current = nullptr;
+    qint64 m_themeSerial = 0;
+    bool m_hasBuffers = false;
+
+    // Client cursors are uploaded alternately to two buffers, not to
+    // overwrite the one on screen; dmabufs are imported as framebuffers
+    // and the previous one is kept until the next replaces it on screen
+    HardwareBuffer m_clientBuffers[2];
+    int m_nextClientBuffer = 0;
+    HardwareBuffer m_clientDmabuf;
+    uint32_t m_previousDmabufFb = 0;
+    bool m_clientCursor = false;
+
     // cursor atlas information
     struct CursorAtlas {
         CursorAtlas() : cursorsPerRow(0), cursorWidth(0), cursorHeight(0) { }
@@ -148,6 +148,26 @@ void QEglFSKmsGbmDevice::destroyGlobalCursor()
     }
 }
 
+bool QEglFSKmsGbmDevice::claimPlane(uint32_t planeId, QEglFSKmsGbmScreen *screen)
+{
+    QMutexLocker locker(&m_planeMutex);
+
+    QEglFSKmsGbmScreen *&owner = m_planeOwners[planeId];
+    if (owner && owner != screen)
+        return false;
+    owner = screen;
+    return true;
+}
+
+void QEglFSKmsGbmDevice::releasePlane(uint32_t planeId, QEglFSKmsGbmScreen *screen)
+{
+    QMutexLocker locker(&m_planeMutex);
+
+    auto it = m_planeOwners.find(planeId);
+    if (it != m_planeOwners.end() && it.value() == screen)
+        m_planeOwners.erase(it);
+}
+
 QPlatformScreen *QEglFSKmsGbmDevice::createScreen(const KmsOutput &output)
 {
     QEglFSKmsGbmScreen *screen = new QEglFSKmsGbmScreen(this, output, false);
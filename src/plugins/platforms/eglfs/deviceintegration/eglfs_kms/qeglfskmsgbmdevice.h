@@ -41,6 +41,9 @@
 
 #pragma once
 
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+
 #include <LiriEglFSKmsSupport/qeglfskmsdevice.h>
 
 #include "qeglfskmsgbmcursor.h"
@@ -50,6 +53,7 @@
 QT_BEGIN_NAMESPACE
 
 class QEglFSKmsScreen;
+class QEglFSKmsGbmScreen;
 
 class QEglFSKmsGbmDevice: public QEglFSKmsDevice
 {
@@ -65,6 +69,9 @@ public:
     QPlatformCursor *globalCursor() const;
     void destroyGlobalCursor();
 
+    bool claimPlane(uint32_t planeId, QEglFSKmsGbmScreen *screen);
+    void releasePlane(uint32_t planeId, QEglFSKmsGbmScreen *screen);
+
     QPlatformScreen *createScreen(const KmsOutput &output) override;
     QPlatformScreen *createHeadlessScreen() override;
     void registerScreenCloning(QPlatformScreen *screen,
@@ -81,6 +88,10 @@ private:
     gbm_device *m_gbm_device;
 
     QEglFSKmsGbmCursor *m_globalCursor;
+
+    // Overlay planes can often be used by more than one CRTC
+    QMutex m_planeMutex;
+    QHash<uint32_t, QEglFSKmsGbmScreen *> m_planeOwners;
 };
 
 QT_END_NAMESPACE
@@ -178,6 +178,16 @@ QFunctionPointer QEglFSKmsGbmIntegration::platformFunction(const QByteArray &fun
         return QFunctionPointer(testScreenChangesStatic);
     else if (function == Aurora::PlatformSupport::EglFSFunctions::applyScreenChangesIdentifier())
         return QFunctionPointer(applyScreenChangesStatic);
+    else if (function == Aurora::PlatformSupport::EglFSFunctions::scanoutBufferIdentifier())
+        return QFunctionPointer(scanoutBufferStatic);
+    else if (function == Aurora::PlatformSupport::EglFSFunctions::releaseScanoutBufferIdentifier())
+        return QFunctionPointer(releaseScanoutBufferStatic);
+    else if (function == Aurora::PlatformSupport::EglFSFunctions::setOverlayLayersIdentifier())
+        return QFunctionPointer(setOverlayLayersStatic);
+    else if (function == Aurora::PlatformSupport::EglFSFunctions::scanoutFormatsIdentifier())
+        return QFunctionPointer(scanoutFormatsStatic);
+    else if (function == Aurora::PlatformSupport::EglFSFunctions::setCursorBufferIdentifier())
+        return QFunctionPointer(setCursorBufferStatic);
 
     return nullptr;
 }
@@ -250,4 +260,50 @@ bool QEglFSKmsGbmIntegration::applyScreenChangesStatic(const QVector<Aurora::Pla
     return true;
 }
 
+bool QEglFSKmsGbmIntegration::scanoutBufferStatic(QScreen *screen, const Aurora::PlatformSupport::ScanoutBuffer &buffer, QObject *receiver)
+{
+    auto *gbmScreen = screen ? static_cast<QEglFSKmsGbmScreen *>(screen->handle()) : nullptr;
+    if (!gbmScreen)
+        return false;
+
+    return gbmScreen->scanoutBuffer(buffer, receiver);
+}
+
+void QEglFSKmsGbmIntegration::releaseScanoutBufferStatic(QScreen *screen, quint64 cacheKey)
+{
+    auto *gbmScreen = screen ? static_cast<QEglFSKmsGbmScreen *>(screen->handle()) : nullptr;
+    if (gbmScreen)
+        gbmScreen->releaseScanoutBuffer(cacheKey);
+}
+
+bool QEglFSKmsGbmIntegration::setOverlayLayersStatic(QScreen *screen, QVector<Aurora::PlatformSupport::OverlayLayer> &layers)
+{
+    auto *gbmScreen = screen ? static_cast<QEglFSKmsGbmScreen *>(screen->handle()) : nullptr;
+    if (!gbmScreen) {
+        for (auto &layer : layers)
+            layer.assigned = false;
+        return false;
+    }
+
+    return gbmScreen->setOverlayLayers(layers);
+}
+
+Aurora::PlatformSupport::ScanoutFormats QEglFSKmsGbmIntegration::scanoutFormatsStatic(QScreen *screen)
+{
+    auto *gbmScreen = screen ? static_cast<QEglFSKmsGbmScreen *>(screen->handle()) : nullptr;
+    if (!gbmScreen)
+        return Aurora::PlatformSupport::ScanoutFormats();
+
+    return gbmScreen->scanoutFormats();
+}
+
+bool QEglFSKmsGbmIntegration::setCursorBufferStatic(QScreen *screen, const Aurora::PlatformSupport::CursorBuffer &buffer, QObject *receiver)
+{
+    auto *gbmScreen = screen ? static_cast<QEglFSKmsGbmScreen *>(screen->handle()) : nullptr;
+    if (!gbmScreen)
+        return false;
+
+    return gbmScreen->setCursorBuffer(buffer, receiver);
+}
+
 QT_END_NAMESPACE
@@ -50,6 +50,9 @@ namespace Aurora {
 namespace PlatformSupport {
 class Udev;
 class ScreenChange;
+class OverlayLayer;
+class ScanoutBuffer;
+class CursorBuffer;
 }
 }
 
@@ -84,6 +87,11 @@ private:
 
     static bool testScreenChangesStatic(const QVector<Aurora::PlatformSupport::ScreenChange> &changes);
     static bool applyScreenChangesStatic(const QVector<Aurora::PlatformSupport::ScreenChange> &changes);
+    static bool scanoutBufferStatic(QScreen *screen, const Aurora::PlatformSupport::ScanoutBuffer &buffer, QObject *receiver);
+    static void releaseScanoutBufferStatic(QScreen *screen, quint64 cacheKey);
+    static bool setOverlayLayersStatic(QScreen *screen, QVector<Aurora::PlatformSupport::OverlayLayer> &layers);
+    static Aurora::PlatformSupport::ScanoutFormats scanoutFormatsStatic(QScreen *screen);
+    static bool setCursorBufferStatic(QScreen *screen, const Aurora::PlatformSupport::CursorBuffer &buffer, QObject *receiver);
 };
 
 QT_END_NAMESPACE
@@ -43,16 +43,25 @@
 #include "qeglfskmsgbmdevice.h"
 #include "qeglfskmsgbmcursor.h"
 #include "qeglfsintegration_p.h"
+#include "auroraframetrace_p.h"
 
 #include <QtCore/QLoggingCategory>
+#include <QtCore/QSet>
 
 #include <QtGui/private/qguiapplication_p.h>
 #include <QtGui/private/qtguiglobal_p.h>
 #include <QtFbSupport/private/qfbvthandler_p.h>
 
 #include <LiriAuroraLogind/Logind>
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
 
 #include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <algorithm>
+#include <utility>
 
 QT_BEGIN_NAMESPACE
 
@@ -118,13 +127,62 @@ QEglFSKmsGbmScreen::QEglFSKmsGbmScreen(QEglFSKmsDevice *device, const KmsOutput
     , m_gbm_bo_current(nullptr)
     , m_gbm_bo_next(nullptr)
     , m_flipPending(false)
+    , m_scanoutFbStaged(0)
+    , m_scanoutFbCurrent(0)
+    , m_scanoutFbNext(0)
+    , m_scanoutActive(false)
+    , m_scanoutReceiver(nullptr)
+    , m_overlaysPendingChanged(false)
+    , m_overlaysNextChanged(false)
+    , m_asyncFlip(device->screenConfig()->asyncPageFlip())
+    , m_flipListenersRegistered(false)
+    , m_flipQueueDepth(device->screenConfig()->flipQueueDepth())
+    , m_flipWaiting(false)
+    , m_monotonicTimestamps(false)
     , m_cursor(nullptr)
+    , m_cursorPlane(nullptr)
+    , m_cursorPlaneChanged(false)
+    , m_cursorPlaneCommitted(false)
+    , m_cursorFlipPending(false)
+    , m_cursorReceiver(nullptr)
     , m_cloneSource(nullptr)
 {
+    uint64_t cap = 0;
+    if (drmGetCap(device->fd(), DRM_CAP_TIMESTAMP_MONOTONIC, &cap) == 0)
+        m_monotonicTimestamps = cap != 0;
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    // Cursor planes are only exposed with universal planes, which atomic enables
+    if (!headless && device->hasAtomicSupport()) {
+        for (const KmsPlane &plane : qAsConst(m_output.available_planes)) {
+            if (plane.type == KmsPlane::CursorPlane) {
+                m_cursorPlane = &plane;
+                break;
+            }
+        }
+    }
+#endif
 }
 
 QEglFSKmsGbmScreen::~QEglFSKmsGbmScreen()
 {
+    if (m_flipListenersRegistered) {
+        device()->eventReader()->unregisterFlipListener(this);
+        for (const CloneDestination &d : qAsConst(m_cloneDests))
+            device()->eventReader()->unregisterFlipListener(d.screen);
+    }
+
+    // Cached framebuffers may also be staged or on screen
+    QSet<uint32_t> scanoutFbs(m_scanoutFbCache.cbegin(), m_scanoutFbCache.cend());
+    scanoutFbs << m_scanoutFbStaged << m_scanoutFbCurrent << m_scanoutFbNext;
+    for (uint32_t fb : qAsConst(scanoutFbs)) {
+        if (fb)
+            drmModeRmFB(device()->fd(), fb);
+    }
+    releaseOverlays(m_overlaysPending);
+    releaseOverlays(m_overlaysNext);
+    releaseOverlays(m_overlaysCurrent);
+
     const int remainingScreenCount = qGuiApp->screens().count();
     qCDebug(qLcEglfsKmsDebug, "Screen dtor. Remaining screens: %d", remainingScreenCount);
     if (!remainingScreenCount && !device()->screenConfig()->separateScreens())
@@ -195,6 +253,9 @@ void QEglFSKmsGbmScreen::resetSurface()
 
 void QEglFSKmsGbmScreen::setSurface(gbm_surface *surface)
 {
+    QMutexLocker locker(&m_flipMutex);
+
+    releaseRetiredBuffers();
     if (m_gbm_bo_current) {
         gbm_surface_release_buffer(m_gbm_surface,
                                    m_gbm_bo_current);
@@ -283,6 +344,20 @@ void QEglFSKmsGbmScreen::waitForFlip()
     if (!Aurora::PlatformSupport::Logind::instance()->isSessionActive())
         return;
 
+    Aurora::FrameTrace::Scope trace(Aurora::FrameTrace::WaitForFlip);
+
+    if (m_asyncFlip) {
+        // With a queue the next frame is rendered while the previous one
+        // is in flight, flip() waits for it before submitting
+        QMutexLocker locker(&m_flipMutex);
+        if (m_flipQueueDepth < 2) {
+            while (isFlipInFlight())
+                m_flipCond.wait(&m_flipMutex);
+        }
+        releaseRetiredBuffers();
+        return;
+    }
+
     // Don't lock the mutex unless we actually need to
     if (!m_gbm_bo_next)
         return;
@@ -294,7 +369,18 @@ void QEglFSKmsGbmScreen::waitForFlip()
 
     flipFinished();
 
-#if EGLFS_ENABLE_DRM_ATOMIC
+    {
+        QMutexLocker locker(&m_flipMutex);
+        releaseRetiredBuffers();
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+        // A client buffer waited for the frame to be done
+        if (m_scanoutFbStaged && !isFlipInFlight())
+            submitStagedScanout();
+#endif
+    }
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
     device()->threadLocalAtomicReset();
 #endif
 }
@@ -319,12 +405,99 @@ void QEglFSKmsGbmScreen::flip()
         return;
     }
 
-    m_gbm_bo_next = gbm_surface_lock_front_buffer(m_gbm_surface);
-    if (!m_gbm_bo_next) {
+    ensureFlipListeners();
+
+    // The page flip event updates the state from the event reader thread
+    QMutexLocker locker(&m_flipMutex);
+
+    // Only one flip can be pending on a CRTC. Frames are submitted from
+    // this thread, the atomic request it staged goes with them
+    if (m_asyncFlip) {
+        m_flipWaiting = true;
+        while (isFlipInFlight())
+            m_flipCond.wait(&m_flipMutex);
+        m_flipWaiting = false;
+    } else {
+        // Nobody waits for client buffers scanned out directly
+        while (m_scanoutFbNext || m_cursorFlipPending)
+            m_flipCond.wait(&m_flipMutex);
+    }
+    releaseRetiredBuffers();
+
+    gbm_bo *bo = gbm_surface_lock_front_buffer(m_gbm_surface);
+    if (!bo) {
         qWarning("Could not lock GBM surface front buffer!");
         return;
     }
 
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    // A client buffer is on screen in place of the scene, which was only
+    // rendered for changes that don't show, the frame is dropped
+    if (m_scanoutActive) {
+        gbm_surface_release_buffer(m_gbm_surface, bo);
+        if (m_scanoutFbStaged && !isFlipInFlight())
+            submitStagedScanout();
+        return;
+    }
+#endif
+
+    submitFlip(bo);
+}
+
+bool QEglFSKmsGbmScreen::pageFlipped(unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec)
+{
+    // Called on the event reader thread
+
+    // Clone destinations share the state of their source
+    QEglFSKmsGbmScreen *source = m_cloneSource ? m_cloneSource : this;
+    QMutexLocker locker(&source->m_flipMutex);
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (source->m_cursorPlaneCommitted) {
+        source->m_cursorPlaneCommitted = false;
+        source->sendCursorPresentation();
+    }
+
+    // Only the cursor was updated, this is not a frame
+    if (source->m_cursorFlipPending) {
+        source->m_cursorFlipPending = false;
+        source->m_flipPending = false;
+
+        // A frame waiting in flip() takes the cursor with it
+        if (source->m_scanoutFbStaged)
+            source->submitStagedScanout();
+        else if (source->m_cursorPlaneChanged && !source->m_flipWaiting)
+            source->commitCursorPlane();
+
+        source->m_flipCond.wakeAll();
+        return true;
+    }
+#endif
+
+    // Client buffers scanned out directly are never cloned
+    const bool scanout = source->m_scanoutFbNext != 0;
+    sendPresentation(sequence, tv_sec, tv_usec, scanout, scanout ? source->m_scanoutReceiver : nullptr);
+
+    if (!source->m_asyncFlip && !scanout)
+        return false;
+
+    flipFinished();
+    if (!m_cloneSource)
+        recordFrame(tv_sec, tv_usec);
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (source->m_scanoutFbStaged && !source->isFlipInFlight())
+        source->submitStagedScanout();
+#endif
+
+    source->m_flipCond.wakeAll();
+    return true;
+}
+
+bool QEglFSKmsGbmScreen::submitFlip(gbm_bo *bo)
+{
+    m_gbm_bo_next = bo;
+
     FrameBuffer *fb = framebufferForBufferObject(m_gbm_bo_next);
     ensureModeSet(fb->fb);
 
@@ -336,27 +509,9 @@ void QEglFSKmsGbmScreen::flip()
 #ifdef EGLFS_ENABLE_DRM_ATOMIC
         drmModeAtomicReq *request = device()->threadLocalAtomicRequest();
         if (request) {
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->framebufferPropertyId, fb->fb);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcPropertyId, op.crtc_id);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcwidthPropertyId,
-                                     op.size.width() << 16);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcXPropertyId, 0);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcYPropertyId, 0);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcheightPropertyId,
-                                     op.size.height() << 16);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcXPropertyId, 0);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcYPropertyId, 0);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcwidthPropertyId,
-                                     m_output.modes[m_output.mode].hdisplay);
-            drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcheightPropertyId,
-                                     m_output.modes[m_output.mode].vdisplay);
-
-            static int zpos = qEnvironmentVariableIntValue("QT_QPA_EGLFS_KMS_ZPOS");
-            if (zpos)
-                drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->zposPropertyId, zpos);
-            static uint blendOp = uint(qEnvironmentVariableIntValue("QT_QPA_EGLFS_KMS_BLEND_OP"));
-            if (blendOp)
-                drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->blendOpPropertyId, blendOp);
+            addPlaneProperties(request, fb->fb);
+            addOverlayProperties(request);
+            addCursorPlaneProperties(request);
         }
 #endif
     } else {
@@ -370,7 +525,7 @@ void QEglFSKmsGbmScreen::flip()
             m_flipPending = false;
             gbm_surface_release_buffer(m_gbm_surface, m_gbm_bo_next);
             m_gbm_bo_next = nullptr;
-            return;
+            return false;
         }
     }
 
@@ -404,16 +559,688 @@ void QEglFSKmsGbmScreen::flip()
     }
 
 #ifdef EGLFS_ENABLE_DRM_ATOMIC
-    device()->threadLocalAtomicCommit(this);
+    if (device()->hasAtomicSupport()) {
+        if (!device()->threadLocalAtomicCommit(this)) {
+            // No page flip event will ever come
+            m_flipPending = false;
+            for (CloneDestination &d : m_cloneDests)
+                d.cloneFlipPending = false;
+            gbm_surface_release_buffer(m_gbm_surface, m_gbm_bo_next);
+            m_gbm_bo_next = nullptr;
+
+            // Layers are tested again with the next frame
+            if (m_overlaysPendingChanged) {
+                releaseOverlays(m_overlaysPending);
+                m_overlaysPendingChanged = false;
+            }
+            return false;
+        }
+
+        m_cursorPlaneCommitted |= m_cursorPlaneChanged;
+        m_cursorPlaneChanged = false;
+
+        if (m_overlaysPendingChanged) {
+            m_overlaysNext = std::move(m_overlaysPending);
+            m_overlaysPending.clear();
+            m_overlaysPendingChanged = false;
+            m_overlaysNextChanged = true;
+        }
+
+        // The kernel made its own copy of the request, which
+        // waitForFlip() doesn't reset with asynchronous flips
+        if (m_asyncFlip)
+            device()->threadLocalAtomicReset();
+    }
+#endif
+
+    return true;
+}
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+void QEglFSKmsGbmScreen::addPlaneProperties(drmModeAtomicReq *request, uint32_t fb)
+{
+    KmsOutput &op(output());
+
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->framebufferPropertyId, fb);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcPropertyId, op.crtc_id);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcwidthPropertyId,
+                             op.size.width() << 16);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcXPropertyId, 0);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcYPropertyId, 0);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->srcheightPropertyId,
+                             op.size.height() << 16);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcXPropertyId, 0);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcYPropertyId, 0);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcwidthPropertyId,
+                             m_output.modes[m_output.mode].hdisplay);
+    drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->crtcheightPropertyId,
+                             m_output.modes[m_output.mode].vdisplay);
+
+    static int zpos = qEnvironmentVariableIntValue("QT_QPA_EGLFS_KMS_ZPOS");
+    if (zpos)
+        drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->zposPropertyId, zpos);
+    static uint blendOp = uint(qEnvironmentVariableIntValue("QT_QPA_EGLFS_KMS_BLEND_OP"));
+    if (blendOp)
+        drmModeAtomicAddProperty(request, op.eglfs_plane->id, op.eglfs_plane->blendOpPropertyId, blendOp);
+}
+
+void QEglFSKmsGbmScreen::addOverlayPlaneProperties(drmModeAtomicReq *request, const KmsPlane *plane, uint32_t fb,
+                                                   const QRect &source, const QRect &destination)
+{
+    // Source coordinates are 16.16 fixed point
+    drmModeAtomicAddProperty(request, plane->id, plane->framebufferPropertyId, fb);
+    drmModeAtomicAddProperty(request, plane->id, plane->crtcPropertyId, fb ? output().crtc_id : 0);
+    if (!fb)
+        return;
+    drmModeAtomicAddProperty(request, plane->id, plane->srcXPropertyId, uint64_t(source.x()) << 16);
+    drmModeAtomicAddProperty(request, plane->id, plane->srcYPropertyId, uint64_t(source.y()) << 16);
+    drmModeAtomicAddProperty(request, plane->id, plane->srcwidthPropertyId, uint64_t(source.width()) << 16);
+    drmModeAtomicAddProperty(request, plane->id, plane->srcheightPropertyId, uint64_t(source.height()) << 16);
+    drmModeAtomicAddProperty(request, plane->id, plane->crtcXPropertyId, destination.x());
+    drmModeAtomicAddProperty(request, plane->id, plane->crtcYPropertyId, destination.y());
+    drmModeAtomicAddProperty(request, plane->id, plane->crtcwidthPropertyId, destination.width());
+    drmModeAtomicAddProperty(request, plane->id, plane->crtcheightPropertyId, destination.height());
+}
+
+void QEglFSKmsGbmScreen::addOverlayProperties(drmModeAtomicReq *request)
+{
+    if (!m_overlaysPendingChanged)
+        return;
+
+    // Turn off the planes that are not used anymore
+    for (const OverlayPlane &overlay : qAsConst(m_overlaysCurrent)) {
+        auto it = std::find_if(m_overlaysPending.cbegin(), m_overlaysPending.cend(), [&overlay](const OverlayPlane &o) {
+            return o.plane->id == overlay.plane->id;
+        });
+        if (it == m_overlaysPending.cend())
+            addOverlayPlaneProperties(request, overlay.plane, 0, QRect(), QRect());
+    }
+
+    for (const OverlayPlane &overlay : qAsConst(m_overlaysPending))
+        addOverlayPlaneProperties(request, overlay.plane, overlay.fb, overlay.source, overlay.destination);
+}
+
+// Called with the flip mutex locked
+void QEglFSKmsGbmScreen::addCursorPlaneProperties(drmModeAtomicReq *request)
+{
+    if (!m_cursorPlane || !m_cursorPlaneChanged)
+        return;
+
+    const CursorPlaneState &cursor = m_cursorPlanePending;
+    addOverlayPlaneProperties(request, m_cursorPlane, cursor.fb,
+                              QRect(QPoint(0, 0), cursor.size),
+                              QRect(cursor.position, cursor.size));
+}
+
+// Updates the cursor plane alone, called with the flip mutex locked
+// when neither a frame nor another commit is in flight
+bool QEglFSKmsGbmScreen::commitCursorPlane()
+{
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    addCursorPlaneProperties(request);
+
+    // The page flip event tells when the next commit can be made
+    int ret = drmModeAtomicCommit(device()->fd(), request,
+                                  DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, this);
+    drmModeAtomicFree(request);
+
+    if (ret) {
+        qCDebug(qLcEglfsKmsDebug, "Failed to update cursor plane on screen %s (code=%d)", qPrintable(name()), ret);
+        return false;
+    }
+
+    m_flipPending = true;
+    m_cursorFlipPending = true;
+    m_cursorPlaneCommitted = true;
+    m_cursorPlaneCommitted |= m_cursorPlaneChanged;
+    m_cursorPlaneChanged = false;
+    return true;
+}
+#endif
+
+bool QEglFSKmsGbmScreen::hasCursorPlane() const
+{
+    // Clones would need the cursor on each CRTC of the commit
+    return m_cursorPlane && !m_cloneSource && m_cloneDests.isEmpty();
+}
+
+/*
+    Shows \a fb on the cursor plane at \a position, or hides the cursor when
+    \a fb is 0. The change is committed with the next frame, or right away
+    when nothing is being rendered.
+*/
+void QEglFSKmsGbmScreen::setCursorPlane(uint32_t fb, const QSize &size, const QPoint &position)
+{
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (!hasCursorPlane())
+        return;
+
+    QMutexLocker locker(&m_flipMutex);
+
+    CursorPlaneState &cursor = m_cursorPlanePending;
+    if (cursor.fb == fb && cursor.size == size && cursor.position == position)
+        return;
+
+    cursor.fb = fb;
+    cursor.size = size;
+    cursor.position = position;
+    m_cursorPlaneChanged = true;
+
+    if (m_headless || modeChangeRequested() || !m_output.mode_set)
+        return;
+    if (!Aurora::PlatformSupport::Logind::instance()->isSessionActive())
+        return;
+
+    // Folded into the commit of the frame being rendered, or committed
+    // once the one in flight is done; the first frame registers the
+    // listener of the page flip events
+    if (isFlipInFlight() || m_flipWaiting || !m_flipListenersRegistered)
+        return;
+
+    commitCursorPlane();
+#else
+    Q_UNUSED(fb);
+    Q_UNUSED(size);
+    Q_UNUSED(position);
 #endif
 }
 
+/*
+    Returns whether the cursor plane takes \a fb, without changing what
+    is on screen.
+*/
+bool QEglFSKmsGbmScreen::testCursorPlane(uint32_t fb, const QSize &size)
+{
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (!hasCursorPlane() || !m_output.mode_set)
+        return false;
+
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    addOverlayPlaneProperties(request, m_cursorPlane, fb,
+                              QRect(QPoint(0, 0), size), QRect(QPoint(0, 0), size));
+    const int ret = drmModeAtomicCommit(device()->fd(), request, DRM_MODE_ATOMIC_TEST_ONLY, nullptr);
+    drmModeAtomicFree(request);
+
+    return ret == 0;
+#else
+    Q_UNUSED(fb);
+    Q_UNUSED(size);
+    return false;
+#endif
+}
+
+/*
+    Tests whether a client buffer can go on the primary plane, bypassing
+    composition, and if so commits it right away or, when a flip is in
+    flight, as soon as it's done. Returns false when the buffer cannot be
+    scanned out, in which case the scene has to be rendered.
+
+    Frames rendered while a buffer is scanned out are dropped, an empty
+    buffer goes back to showing them. \a receiver gets a PresentationEvent
+    for each buffer that reached the screen, one without the ZeroCopy flag
+    when a buffer could not be committed after all.
+*/
+bool QEglFSKmsGbmScreen::scanoutBuffer(const Aurora::PlatformSupport::ScanoutBuffer &buffer, QObject *receiver)
+{
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    QMutexLocker locker(&m_flipMutex);
+
+    // Replace what was not committed yet
+    releaseScanoutFb(std::exchange(m_scanoutFbStaged, 0));
+    m_scanoutActive = false;
+    m_scanoutReceiver = nullptr;
+
+    // Only atomic modesetting can test the configuration before committing it
+    if (m_headless || m_cloneSource || !m_cloneDests.isEmpty() || modeChangeRequested())
+        return false;
+    if (!device()->hasAtomicSupport())
+        return false;
+    if (!Aurora::PlatformSupport::Logind::instance()->isSessionActive())
+        return false;
+
+    KmsOutput &op(output());
+    if (!op.mode_set || !op.eglfs_plane || buffer.size != op.size)
+        return false;
+    if (buffer.planeCount < 1 || buffer.planeCount > 4)
+        return false;
+    if (!op.eglfs_plane->supportsFormat(buffer.drmFormat, buffer.modifier))
+        return false;
+
+    // Clients cycle through a few buffers, each is imported once
+    uint32_t fb = buffer.cacheKey ? m_scanoutFbCache.value(buffer.cacheKey) : 0;
+    if (!fb) {
+        fb = importScanoutBuffer(buffer);
+        if (!fb)
+            return false;
+        if (buffer.cacheKey)
+            m_scanoutFbCache.insert(buffer.cacheKey, fb);
+    }
+
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    addPlaneProperties(request, fb);
+    addCursorPlaneProperties(request);
+    const int ret = drmModeAtomicCommit(device()->fd(), request, DRM_MODE_ATOMIC_TEST_ONLY, nullptr);
+    drmModeAtomicFree(request);
+
+    if (ret) {
+        qCDebug(qLcEglfsKmsDebug, "Cannot scan out client buffer on screen %s (code=%d)", qPrintable(name()), ret);
+        releaseScanoutFb(fb);
+        return false;
+    }
+
+    m_scanoutFbStaged = fb;
+    m_scanoutActive = true;
+    m_scanoutReceiver = receiver;
+
+    // The first frame registers the listener of the page flip events
+    if (!isFlipInFlight() && m_flipListenersRegistered)
+        submitStagedScanout();
+    return true;
+#else
+    Q_UNUSED(buffer);
+    Q_UNUSED(receiver);
+    return false;
+#endif
+}
+
+/*
+    Forgets the framebuffer of the client buffer with \a cacheKey, which
+    is removed once it's not on screen anymore.
+*/
+void QEglFSKmsGbmScreen::releaseScanoutBuffer(quint64 cacheKey)
+{
+    QMutexLocker locker(&m_flipMutex);
+    releaseScanoutFb(m_scanoutFbCache.take(cacheKey));
+}
+
+// Removes the framebuffer of a client buffer unless it's cached or
+// still in use, called with the flip mutex locked
+void QEglFSKmsGbmScreen::releaseScanoutFb(uint32_t fb)
+{
+    if (!fb || fb == m_scanoutFbStaged || fb == m_scanoutFbNext || fb == m_scanoutFbCurrent)
+        return;
+
+    for (uint32_t cachedFb : qAsConst(m_scanoutFbCache)) {
+        if (cachedFb == fb)
+            return;
+    }
+
+    drmModeRmFB(device()->fd(), fb);
+}
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+/*
+    Commits the client buffer \a fb tested by scanoutBuffer() in place
+    of the frame. Called with the flip mutex locked.
+*/
+bool QEglFSKmsGbmScreen::submitScanout(uint32_t fb)
+{
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    addPlaneProperties(request, fb);
+    addCursorPlaneProperties(request);
+
+    m_flipPending = true;
+    m_scanoutFbNext = fb;
+    const int ret = drmModeAtomicCommit(device()->fd(), request,
+                                        DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, this);
+    drmModeAtomicFree(request);
+
+    if (ret) {
+        qCDebug(qLcEglfsKmsDebug, "Cannot scan out client buffer on screen %s (code=%d)", qPrintable(name()), ret);
+        m_flipPending = false;
+        m_scanoutFbNext = 0;
+        return false;
+    }
+
+    m_cursorPlaneCommitted |= m_cursorPlaneChanged;
+    m_cursorPlaneChanged = false;
+    return true;
+}
+
+// Commits the staged client buffer, or goes back to the scene when it
+// can't be committed. Called with the flip mutex locked.
+void QEglFSKmsGbmScreen::submitStagedScanout()
+{
+    const uint32_t fb = std::exchange(m_scanoutFbStaged, 0);
+    if (submitScanout(fb))
+        return;
+
+    releaseScanoutFb(fb);
+    m_scanoutActive = false;
+    if (m_scanoutReceiver) {
+        auto *event = new Aurora::PlatformSupport::PresentationEvent();
+        event->screen = screen();
+        QCoreApplication::postEvent(std::exchange(m_scanoutReceiver, nullptr), event);
+    }
+}
+#endif
+
+/*
+    Tests which of \a layers can be put on overlay planes on top of the
+    composited frame and marks them as assigned. The configuration is
+    committed together with the next frame, unassigned layers are
+    supposed to be composited.
+*/
+bool QEglFSKmsGbmScreen::setOverlayLayers(QVector<Aurora::PlatformSupport::OverlayLayer> &layers)
+{
+    using Aurora::PlatformSupport::OverlayLayer;
+
+    for (OverlayLayer &layer : layers)
+        layer.assigned = false;
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (m_headless || m_cloneSource || !m_cloneDests.isEmpty() || modeChangeRequested())
+        return false;
+    if (!device()->hasAtomicSupport())
+        return false;
+    if (!Aurora::PlatformSupport::Logind::instance()->isSessionActive())
+        return false;
+
+    KmsOutput &op(output());
+    if (!op.mode_set || !op.eglfs_plane || op.mode < 0)
+        return false;
+
+    QMutexLocker locker(&m_flipMutex);
+
+    // Replace what was tested for a frame that was never submitted
+    releaseOverlays(m_overlaysPending);
+
+    // Planes are tested against the frame on screen, the next one has the same format
+    uint32_t primaryFb = m_scanoutFbCurrent;
+    if (m_gbm_bo_current) {
+        FrameBuffer *fb = framebufferForBufferObject(m_gbm_bo_current);
+        primaryFb = fb ? fb->fb : 0;
+    }
+    if (!primaryFb) {
+        m_overlaysPendingChanged = !m_overlaysCurrent.isEmpty();
+        return false;
+    }
+
+    QVector<const KmsPlane *> planes;
+    for (const KmsPlane &plane : qAsConst(op.available_planes)) {
+        if (plane.type == KmsPlane::OverlayPlane)
+            planes.append(&plane);
+    }
+
+    // Bottom to top, overlay planes are usually stacked in the order they
+    // are listed so each layer goes on a plane after the one of the layer below
+    QVector<int> order;
+    order.reserve(layers.size());
+    for (int i = 0; i < layers.size(); ++i) {
+        // Planes below the primary plane would need holes in the frame
+        if (layers.at(i).stackingLevel >= 0)
+            order.append(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&layers](int a, int b) {
+        return layers.at(a).stackingLevel < layers.at(b).stackingLevel;
+    });
+
+    const QRect screenRect(0, 0, op.modes[op.mode].hdisplay, op.modes[op.mode].vdisplay);
+    const int fd = device()->fd();
+    auto *gbmDevice = static_cast<QEglFSKmsGbmDevice *>(device());
+
+    drmModeAtomicReq *request = drmModeAtomicAlloc();
+    addPlaneProperties(request, primaryFb);
+
+    int firstPlane = 0;
+    for (int index : qAsConst(order)) {
+        OverlayLayer &layer = layers[index];
+        const Aurora::PlatformSupport::ScanoutBuffer &buffer = layer.buffer;
+
+        if (buffer.planeCount < 1 || buffer.planeCount > 4)
+            continue;
+        if (layer.sourceRect.isEmpty() || !QRect(QPoint(0, 0), buffer.size).contains(layer.sourceRect))
+            continue;
+        if (layer.destinationRect.isEmpty() || !screenRect.contains(layer.destinationRect))
+            continue;
+
+        uint32_t fb = 0;
+        for (int i = firstPlane; i < planes.size(); ++i) {
+            const KmsPlane *plane = planes.at(i);
+            if (!plane->supportsFormat(buffer.drmFormat, buffer.modifier))
+                continue;
+            if (!gbmDevice->claimPlane(plane->id, this))
+                continue;
+
+            if (!fb)
+                fb = importScanoutBuffer(buffer);
+            if (!fb) {
+                if (!isPlaneInUse(plane->id))
+                    gbmDevice->releasePlane(plane->id, this);
+                break;
+            }
+
+            const int cursor = drmModeAtomicGetCursor(request);
+            addOverlayPlaneProperties(request, plane, fb, layer.sourceRect, layer.destinationRect);
+            if (drmModeAtomicCommit(fd, request, DRM_MODE_ATOMIC_TEST_ONLY, nullptr) == 0) {
+                OverlayPlane overlay;
+                overlay.plane = plane;
+                overlay.fb = fb;
+                overlay.source = layer.sourceRect;
+                overlay.destination = layer.destinationRect;
+                m_overlaysPending.append(overlay);
+                layer.assigned = true;
+                firstPlane = i + 1;
+                break;
+            }
+
+            drmModeAtomicSetCursor(request, cursor);
+            if (!isPlaneInUse(plane->id))
+                gbmDevice->releasePlane(plane->id, this);
+        }
+
+        if (fb && !layer.assigned) {
+            qCDebug(qLcEglfsKmsDebug, "No overlay plane can show layer %d on screen %s", index, qPrintable(name()));
+            drmModeRmFB(fd, fb);
+        }
+    }
+
+    drmModeAtomicFree(request);
+
+    m_overlaysPendingChanged = !m_overlaysPending.isEmpty() || !m_overlaysCurrent.isEmpty();
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void addPlaneFormats(const KmsPlane &plane, QHash<quint32, QVector<quint64>> &formats)
+{
+    for (uint32_t format : plane.supportedFormats) {
+        QVector<quint64> &modifiers = formats[format];
+        const auto planeModifiers = plane.supportedModifiers.value(format);
+        for (uint64_t modifier : planeModifiers) {
+            if (!modifiers.contains(modifier))
+                modifiers.append(modifier);
+        }
+    }
+}
+
+/*
+    Returns the formats that scanoutBuffer() and setOverlayLayers() might
+    accept, so that clients can allocate buffers that skip composition.
+*/
+Aurora::PlatformSupport::ScanoutFormats QEglFSKmsGbmScreen::scanoutFormats()
+{
+    Aurora::PlatformSupport::ScanoutFormats formats;
+
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    if (m_headless || !device()->hasAtomicSupport())
+        return formats;
+
+    struct stat st;
+    if (fstat(device()->fd(), &st) != 0)
+        return formats;
+    formats.device = st.st_rdev;
+
+    const KmsOutput &op = output();
+    if (op.eglfs_plane)
+        addPlaneFormats(*op.eglfs_plane, formats.primaryFormats);
+    for (const KmsPlane &plane : op.available_planes) {
+        if (plane.type == KmsPlane::OverlayPlane)
+            addPlaneFormats(plane, formats.overlayFormats);
+    }
+#endif
+
+    return formats;
+}
+
+bool QEglFSKmsGbmScreen::isPlaneInUse(uint32_t planeId) const
+{
+    for (const QVector<OverlayPlane> *overlays : { &m_overlaysPending, &m_overlaysNext, &m_overlaysCurrent }) {
+        for (const OverlayPlane &overlay : *overlays) {
+            if (overlay.plane->id == planeId)
+                return true;
+        }
+    }
+    return false;
+}
+
+void QEglFSKmsGbmScreen::releaseOverlays(QVector<OverlayPlane> &overlays)
+{
+    const QVector<OverlayPlane> released = std::exchange(overlays, {});
+    for (const OverlayPlane &overlay : released) {
+        drmModeRmFB(device()->fd(), overlay.fb);
+        if (!isPlaneInUse(overlay.plane->id))
+            static_cast<QEglFSKmsGbmDevice *>(device())->releasePlane(overlay.plane->id, this);
+    }
+}
+
+uint32_t QEglFSKmsGbmScreen::importScanoutBuffer(const Aurora::PlatformSupport::ScanoutBuffer &buffer)
+{
+    const int fd = device()->fd();
+    uint32_t handles[4] = { 0, 0, 0, 0 };
+    uint32_t strides[4] = { 0, 0, 0, 0 };
+    uint32_t offsets[4] = { 0, 0, 0, 0 };
+    uint64_t modifiers[4] = { 0, 0, 0, 0 };
+    uint32_t fb = 0;
+    int ret = 0;
+
+    for (int i = 0; i < buffer.planeCount && ret == 0; ++i) {
+        ret = drmPrimeFDToHandle(fd, buffer.fds[i], &handles[i]);
+        strides[i] = buffer.strides[i];
+        offsets[i] = buffer.offsets[i];
+        modifiers[i] = buffer.modifier;
+    }
+
+    if (ret == 0) {
+        if (buffer.modifier != DRM_FORMAT_MOD_INVALID)
+            ret = drmModeAddFB2WithModifiers(fd, buffer.size.width(), buffer.size.height(), buffer.drmFormat,
+                                             handles, strides, offsets, modifiers, &fb, DRM_MODE_FB_MODIFIERS);
+        else
+            ret = drmModeAddFB2(fd, buffer.size.width(), buffer.size.height(), buffer.drmFormat,
+                                handles, strides, offsets, &fb, 0);
+        if (ret) {
+            qCDebug(qLcEglfsKmsDebug, "Failed to add framebuffer for client buffer (code=%d)", ret);
+            fb = 0;
+        }
+    }
+
+    // The framebuffer holds a reference to the memory, planes often share the same handle
+    for (int i = 0; i < buffer.planeCount; ++i) {
+        if (!handles[i])
+            continue;
+        bool closed = false;
+        for (int j = 0; j < i; ++j)
+            closed |= handles[j] == handles[i];
+        if (!closed) {
+            drm_gem_close args;
+            memset(&args, 0, sizeof(args));
+            args.handle = handles[i];
+            drmIoctl(fd, DRM_IOCTL_GEM_CLOSE, &args);
+        }
+    }
+
+    return fb;
+}
+
+void QEglFSKmsGbmScreen::ensureFlipListeners()
+{
+    if (m_flipListenersRegistered)
+        return;
+
+    // Clone destinations receive page flip events for the frames of this screen
+    QEglFSKmsEventReader *eventReader = device()->eventReader();
+    m_flipListenersRegistered = eventReader->registerFlipListener(this, this);
+    for (const CloneDestination &d : qAsConst(m_cloneDests))
+        m_flipListenersRegistered &= eventReader->registerFlipListener(d.screen, d.screen);
+
+    if (!m_flipListenersRegistered && m_asyncFlip) {
+        qWarning("Cannot flip asynchronously on screen %s, falling back to blocking flips", qPrintable(name()));
+        eventReader->unregisterFlipListener(this);
+        for (const CloneDestination &d : qAsConst(m_cloneDests))
+            eventReader->unregisterFlipListener(d.screen);
+        m_asyncFlip = false;
+    }
+
+    // Don't try again for every frame
+    m_flipListenersRegistered = true;
+}
+
+bool QEglFSKmsGbmScreen::isFlipInFlight() const
+{
+    if (m_flipPending)
+        return true;
+
+    for (const CloneDestination &d : qAsConst(m_cloneDests)) {
+        if (d.cloneFlipPending)
+            return true;
+    }
+
+    return false;
+}
+
+// Gives the buffers that left the screen back to the surface, called on
+// the render thread with the flip mutex locked
+void QEglFSKmsGbmScreen::releaseRetiredBuffers()
+{
+    for (gbm_bo *bo : qAsConst(m_retiredBos))
+        gbm_surface_release_buffer(m_gbm_surface, bo);
+    m_retiredBos.clear();
+}
+
 void QEglFSKmsGbmScreen::setCursorTheme(const QString &name, int size)
 {
     if (!m_cursor.isNull())
         m_cursor->setCursorTheme(name, size);
 }
 
+bool QEglFSKmsGbmScreen::moveHardwareCursor(const QPoint &pos)
+{
+    // Unlike cursor() this never creates the cursor, it's called from another thread
+    KmsScreenConfig *config = device()->screenConfig();
+    if (config->headless() || !config->hwCursor())
+        return false;
+
+    QEglFSKmsGbmCursor *cursor = config->separateScreens()
+            ? m_cursor.data()
+            : static_cast<QEglFSKmsGbmCursor *>(static_cast<QEglFSKmsGbmDevice *>(device())->globalCursor());
+    if (!cursor)
+        return false;
+
+    cursor->moveHardwareCursor(pos);
+    return true;
+}
+
+bool QEglFSKmsGbmScreen::setCursorBuffer(const Aurora::PlatformSupport::CursorBuffer &buffer, QObject *receiver)
+{
+    KmsScreenConfig *config = device()->screenConfig();
+    if (config->headless() || !config->hwCursor())
+        return false;
+
+    QEglFSKmsGbmCursor *cursor = static_cast<QEglFSKmsGbmCursor *>(this->cursor());
+    if (!cursor)
+        return false;
+
+    // Page flip events may be posted from the event reader thread
+    {
+        QMutexLocker locker(&m_flipMutex);
+        m_cursorReceiver = receiver;
+    }
+
+    return cursor->setCursorBuffer(buffer);
+}
+
 void QEglFSKmsGbmScreen::setModeChangeRequested(bool enabled)
 {
     m_modeChangeRequested = enabled;
@@ -453,9 +1280,32 @@ void QEglFSKmsGbmScreen::updateFlipStatus()
             return;
     }
 
+    // A client buffer replaced the composited frame
+    if (m_scanoutFbNext) {
+        if (m_gbm_bo_current) {
+            m_retiredBos.append(m_gbm_bo_current);
+            m_gbm_bo_current = nullptr;
+        }
+        const uint32_t previous = std::exchange(m_scanoutFbCurrent, m_scanoutFbNext);
+        m_scanoutFbNext = 0;
+        releaseScanoutFb(previous);
+        return;
+    }
+
+    // Nothing was flipped, keep scanning out the current buffer
+    if (!m_gbm_bo_next)
+        return;
+
+    // Overlay planes changed together with the frame
+    if (m_overlaysNextChanged) {
+        std::swap(m_overlaysCurrent, m_overlaysNext);
+        releaseOverlays(m_overlaysNext);
+        m_overlaysNextChanged = false;
+    }
+
     if (m_gbm_bo_current)
-        gbm_surface_release_buffer(m_gbm_surface,
-                                   m_gbm_bo_current);
+        m_retiredBos.append(m_gbm_bo_current);
+    releaseScanoutFb(std::exchange(m_scanoutFbCurrent, 0));
 
     m_gbm_bo_current = m_gbm_bo_next;
     m_gbm_bo_next = nullptr;
@@ -463,7 +1313,8 @@ void QEglFSKmsGbmScreen::updateFlipStatus()
 
 void QEglFSKmsGbmScreen::recordFrame(unsigned int tv_sec, unsigned int tv_usec)
 {
-    if (!isRecordingEnabled())
+    // Client buffers scanned out directly are not recorded
+    if (!isRecordingEnabled() || !m_gbm_bo_current)
         return;
 
     // We don't want to be called every flip
@@ -496,4 +1347,76 @@ void QEglFSKmsGbmScreen::recordFrame(unsigned int tv_sec, unsigned int tv_usec)
     QCoreApplication::postEvent(QCoreApplication::instance(), readyEvent);
 }
 
+// Called with the flip mutex locked
+void QEglFSKmsGbmScreen::sendCursorPresentation()
+{
+    if (!m_cursorReceiver)
+        return;
+
+    auto *event = new Aurora::PlatformSupport::CursorPresentationEvent();
+    event->screen = screen();
+    QCoreApplication::postEvent(m_cursorReceiver, event);
+}
+
+void QEglFSKmsGbmScreen::sendPresentation(unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, bool zeroCopy,
+                                          QObject *receiver)
+{
+    using Aurora::PlatformSupport::PresentationEvent;
+
+    auto *event = new PresentationEvent();
+    event->screen = screen();
+    event->sequence = sequence;
+    // The page flip event is sent by the hardware once scanout started from
+    // the new buffer, and flips are never asynchronous so they don't tear
+    event->flags = PresentationEvent::Vsync | PresentationEvent::HwCompletion;
+    if (zeroCopy)
+        event->flags |= PresentationEvent::ZeroCopy;
+
+    if (m_monotonicTimestamps) {
+        event->tv_sec = tv_sec;
+        event->tv_nsec = tv_usec * 1000;
+        event->flags |= PresentationEvent::HwClock;
+    } else {
+        // Old kernels use CLOCK_REALTIME, move the timestamp to the
+        // CLOCK_MONOTONIC domain expected by wp_presentation
+        timespec realtime, monotonic;
+        clock_gettime(CLOCK_REALTIME, &realtime);
+        clock_gettime(CLOCK_MONOTONIC, &monotonic);
+        const qint64 elapsed = (qint64(realtime.tv_sec) * 1000000000 + realtime.tv_nsec)
+                - (qint64(tv_sec) * 1000000000 + qint64(tv_usec) * 1000);
+        const qint64 presented = qint64(monotonic.tv_sec) * 1000000000 + monotonic.tv_nsec - elapsed;
+        event->tv_sec = quint64(presented / 1000000000);
+        event->tv_nsec = quint32(presented % 1000000000);
+    }
+
+    // Exact refresh duration from the mode timings, the refresh rate is rounded
+    const KmsOutput &op(output());
+    if (op.mode >= 0 && op.mode < op.modes.size()) {
+        const drmModeModeInfo &mode = op.modes[op.mode];
+        quint64 pixels = quint64(mode.htotal) * mode.vtotal;
+        if (mode.flags & DRM_MODE_FLAG_INTERLACE)
+            pixels /= 2;
+        if (mode.flags & DRM_MODE_FLAG_DBLSCAN)
+            pixels *= 2;
+        if (mode.vscan > 1)
+            pixels *= mode.vscan;
+        if (mode.clock > 0)
+            event->refresh_nsec = quint32(pixels * 1000000 / mode.clock);
+    }
+
+    // The receiver of a client buffer that is scanned out gets its own copy
+    if (receiver) {
+        auto *copy = new PresentationEvent();
+        copy->screen = event->screen;
+        copy->sequence = event->sequence;
+        copy->tv_sec = event->tv_sec;
+        copy->tv_nsec = event->tv_nsec;
+        copy->refresh_nsec = event->refresh_nsec;
+        copy->flags = event->flags;
+        QCoreApplication::postEvent(receiver, copy);
+    }
+
+    QCoreApplication::postEvent(QCoreApplication::instance(), event);
+}
+
 QT_END_NAMESPACE
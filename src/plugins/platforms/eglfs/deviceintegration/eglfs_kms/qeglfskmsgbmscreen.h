@@ -41,18 +41,28 @@
 
 #pragma once
 
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
 #include <QtCore/QWaitCondition>
 
+#include <LiriEglFSKmsSupport/qeglfskmsdevice.h>
 #include <LiriEglFSKmsSupport/qeglfskmsscreen.h>
 
 #include <gbm.h>
 
+namespace Aurora {
+namespace PlatformSupport {
+class OverlayLayer;
+class ScanoutBuffer;
+class CursorBuffer;
+}
+}
+
 QT_BEGIN_NAMESPACE
 
 class QEglFSKmsGbmCursor;
 
-class QEglFSKmsGbmScreen : public QEglFSKmsScreen
+class QEglFSKmsGbmScreen : public QEglFSKmsScreen, public QEglFSKmsPageFlipListener
 {
 public:
     QEglFSKmsGbmScreen(QEglFSKmsDevice *device, const KmsOutput &output, bool headless);
@@ -71,17 +81,57 @@ public:
     void waitForFlip() override;
 
     void flip();
+    bool scanoutBuffer(const Aurora::PlatformSupport::ScanoutBuffer &buffer, QObject *receiver);
+    void releaseScanoutBuffer(quint64 cacheKey);
+    bool setOverlayLayers(QVector<Aurora::PlatformSupport::OverlayLayer> &layers);
+    Aurora::PlatformSupport::ScanoutFormats scanoutFormats();
 
     void setCursorTheme(const QString &name, int size) override;
+    bool moveHardwareCursor(const QPoint &pos) override;
+
+    bool hasCursorPlane() const;
+    void setCursorPlane(uint32_t fb, const QSize &size, const QPoint &position);
+    bool testCursorPlane(uint32_t fb, const QSize &size);
+    bool setCursorBuffer(const Aurora::PlatformSupport::CursorBuffer &buffer, QObject *receiver = nullptr);
 
     void setModeChangeRequested(bool enabled) override;
 
+    bool pageFlipped(unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec) override;
+
 private:
+    bool submitFlip(gbm_bo *bo);
+#ifdef EGLFS_ENABLE_DRM_ATOMIC
+    void addPlaneProperties(drmModeAtomicReq *request, uint32_t fb);
+    void addOverlayPlaneProperties(drmModeAtomicReq *request, const KmsPlane *plane, uint32_t fb,
+                                   const QRect &source, const QRect &destination);
+    void addOverlayProperties(drmModeAtomicReq *request);
+    void addCursorPlaneProperties(drmModeAtomicReq *request);
+    bool commitCursorPlane();
+    bool submitScanout(uint32_t fb);
+    void submitStagedScanout();
+#endif
+    void releaseScanoutFb(uint32_t fb);
+    uint32_t importScanoutBuffer(const Aurora::PlatformSupport::ScanoutBuffer &buffer);
+    struct OverlayPlane {
+        const KmsPlane *plane = nullptr;
+        uint32_t fb = 0;
+        QRect source;
+        QRect destination;
+    };
+    bool isPlaneInUse(uint32_t planeId) const;
+    void releaseOverlays(QVector<OverlayPlane> &overlays);
+
+    void ensureFlipListeners();
+    bool isFlipInFlight() const;
+    void releaseRetiredBuffers();
     void flipFinished();
     void ensureModeSet(uint32_t fb);
     void cloneDestFlipFinished(QEglFSKmsGbmScreen *cloneDestScreen);
     void updateFlipStatus();
     void recordFrame(unsigned int tv_sec, unsigned int tv_usec);
+    void sendPresentation(unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, bool zeroCopy,
+                          QObject *receiver = nullptr);
+    void sendCursorPresentation();
 
     gbm_surface *m_gbm_surface;
 
@@ -89,11 +139,69 @@ private:
     gbm_bo *m_gbm_bo_next;
     bool m_flipPending;
 
+    // Buffers that left the screen, given back to the surface by the
+    // render thread because eglSwapBuffers() uses the surface too
+    QVector<gbm_bo *> m_retiredBos;
+
+    // Framebuffers of client buffers that are scanned out without
+    // composition, instead of the buffers of the GBM surface: the one
+    // tested by scanoutBuffer() and committed as soon as no flip is in
+    // flight, the one committed with the flip in flight and the one on screen
+    uint32_t m_scanoutFbStaged;
+    uint32_t m_scanoutFbCurrent;
+    uint32_t m_scanoutFbNext;
+
+    // Whether frames rendered meanwhile are dropped, because a client
+    // buffer is on screen, and who gets the presentation events for it
+    bool m_scanoutActive;
+    QObject *m_scanoutReceiver;
+
+    // Framebuffers of client buffers by cache key, kept until released
+    QHash<quint64, uint32_t> m_scanoutFbCache;
+
+    // Overlay planes tested by setOverlayLayers() and committed with the next
+    // frame, the ones committed with the flip in flight and the ones on screen
+    QVector<OverlayPlane> m_overlaysPending;
+    QVector<OverlayPlane> m_overlaysNext;
+    QVector<OverlayPlane> m_overlaysCurrent;
+    bool m_overlaysPendingChanged;
+    bool m_overlaysNextChanged;
+
+    // With asynchronous page flips, the page flip event only updates the
+    // state on the event reader thread: the render thread waits for the
+    // flip in flight in flip() rather than in waitForFlip() when frames
+    // are queued, and submits its frame itself
+    bool m_asyncFlip;
+    bool m_flipListenersRegistered;
+    int m_flipQueueDepth;
+    bool m_flipWaiting;
+
+    // Whether page flip timestamps come from CLOCK_MONOTONIC
+    bool m_monotonicTimestamps;
+
     QMutex m_flipMutex;
     QWaitCondition m_flipCond;
 
     QScopedPointer<QEglFSKmsGbmCursor> m_cursor;
 
+    // The cursor plane is updated with the next frame, or on its own
+    // with a commit that is not a frame when nothing is being rendered
+    struct CursorPlaneState {
+        uint32_t fb = 0;
+        QSize size;
+        QPoint position;
+    };
+    const KmsPlane *m_cursorPlane;
+    CursorPlaneState m_cursorPlanePending;
+    bool m_cursorPlaneChanged;
+    bool m_cursorPlaneCommitted;
+    bool m_cursorFlipPending;
+
+    // Gets the presentation events of the cursor buffers of clients
+    QObject *m_cursorReceiver;
+
+    friend class QEglFSKmsGbmCursor;
+
     struct FrameBuffer {
         uint32_t fb = 0;
     };
@@ -50,12 +50,10 @@ Q_DECLARE_LOGGING_CATEGORY(qLcEglfsKmsDebug)
 static void pageFlipHandler(int fd, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, void *user_data)
 {
     Q_UNUSED(fd);
-    Q_UNUSED(sequence);
-    Q_UNUSED(tv_sec);
-    Q_UNUSED(tv_usec);
 
     QEglFSKmsEventReaderThread *t = static_cast<QEglFSKmsEventReaderThread *>(QThread::currentThread());
-    t->eventHost()->handlePageFlipCompleted(user_data);
+    if (!t->eventHost()->notifyFlipListener(user_data, sequence, tv_sec, tv_usec))
+        t->eventHost()->handlePageFlipCompleted(user_data);
 }
 
 class RegisterWaitFlipEvent : public QEvent
@@ -144,6 +142,19 @@ void QEglFSKmsEventHost::handlePageFlipCompleted(void *key)
     qWarning("Cannot store page flip status (more than %d screens?)", MAX_FLIPS);
 }
 
+bool QEglFSKmsEventHost::notifyFlipListener(void *key, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec)
+{
+    // The lock is held during the callback, so that unregistering waits for it to return
+    QMutexLocker locker(&flipListenersMutex);
+
+    for (int i = 0; i < MAX_FLIPS; ++i) {
+        if (flipListeners[i].key == key)
+            return flipListeners[i].listener->pageFlipped(sequence, tv_sec, tv_usec);
+    }
+
+    return false;
+}
+
 void QEglFSKmsEventReaderThread::run()
 {
     qCDebug(qLcEglfsKmsDebug, "Event reader thread: entering event loop");
@@ -215,4 +226,51 @@ void QEglFSKmsEventReader::startWaitFlip(void *key, QMutex *mutex, QWaitConditio
     }
 }
 
+bool QEglFSKmsEventReader::registerFlipListener(void *key, QEglFSKmsPageFlipListener *listener)
+{
+    if (!m_thread)
+        return false;
+
+    QEglFSKmsEventHost *host = m_thread->eventHost();
+    QMutexLocker locker(&host->flipListenersMutex);
+
+    QEglFSKmsEventHost::FlipListener *freeSlot = nullptr;
+    for (int i = 0; i < QEglFSKmsEventHost::MAX_FLIPS; ++i) {
+        QEglFSKmsEventHost::FlipListener *l = &host->flipListeners[i];
+        if (l->key == key) {
+            l->listener = listener;
+            return true;
+        }
+        if (!l->key && !freeSlot)
+            freeSlot = l;
+    }
+
+    if (!freeSlot) {
+        qWarning("Cannot register page flip listener (more than %d screens?)", QEglFSKmsEventHost::MAX_FLIPS);
+        return false;
+    }
+
+    freeSlot->key = key;
+    freeSlot->listener = listener;
+    return true;
+}
+
+void QEglFSKmsEventReader::unregisterFlipListener(void *key)
+{
+    if (!m_thread)
+        return;
+
+    QEglFSKmsEventHost *host = m_thread->eventHost();
+    QMutexLocker locker(&host->flipListenersMutex);
+
+    for (int i = 0; i < QEglFSKmsEventHost::MAX_FLIPS; ++i) {
+        QEglFSKmsEventHost::FlipListener *l = &host->flipListeners[i];
+        if (l->key == key) {
+            l->key = nullptr;
+            l->listener = nullptr;
+            return;
+        }
+    }
+}
+
 QT_END_NAMESPACE
@@ -49,6 +49,15 @@ QT_BEGIN_NAMESPACE
 
 class QEglFSKmsDevice;
 
+// Receives page flip events directly on the event reader thread,
+// return false to also wake up the thread blocked on startWaitFlip()
+class Q_EGLFS_EXPORT QEglFSKmsPageFlipListener
+{
+public:
+    virtual ~QEglFSKmsPageFlipListener() = default;
+    virtual bool pageFlipped(unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec) = 0;
+};
+
 struct QEglFSKmsEventHost : public QObject
 {
     struct PendingFlipWait {
@@ -57,13 +66,24 @@ struct QEglFSKmsEventHost : public QObject
         QWaitCondition *cond;
     };
 
+    struct FlipListener {
+        void *key;
+        QEglFSKmsPageFlipListener *listener;
+    };
+
     static const int MAX_FLIPS = 32;
     void *completedFlips[MAX_FLIPS] = {};
     QEglFSKmsEventHost::PendingFlipWait pendingFlipWaits[MAX_FLIPS] = {};
 
+    // Listeners are registered from other threads and must be gone
+    // for good once unregistered, so they are not managed with events
+    QMutex flipListenersMutex;
+    QEglFSKmsEventHost::FlipListener flipListeners[MAX_FLIPS] = {};
+
     bool event(QEvent *event) override;
     void updateStatus();
     void handlePageFlipCompleted(void *key);
+    bool notifyFlipListener(void *key, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec);
 };
 
 class QEglFSKmsEventReaderThread : public QThread
@@ -88,6 +108,9 @@ public:
 
     void startWaitFlip(void *key, QMutex *mutex, QWaitCondition *cond);
 
+    bool registerFlipListener(void *key, QEglFSKmsPageFlipListener *listener);
+    void unregisterFlipListener(void *key);
+
 private:
     QEglFSKmsDevice *m_device = nullptr;
     QEglFSKmsEventReaderThread *m_thread = nullptr;
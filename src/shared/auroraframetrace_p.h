@@ -0,0 +1,93 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include "aurorastartuptrace_p.h"
+
+namespace Aurora {
+
+namespace FrameTrace {
+
+/*
+ * Records frame stages for the frame tracer of the compositor library,
+ * from the modules that don't link to it, such as the EGLFS platform.
+ *
+ * Keep the stages in sync with Compositor::Internal::FrameTracer::Stage.
+ */
+
+enum Stage : quint8 {
+    SurfaceCommit = 0,
+    ShmTextureUpload,
+    DmabufTextureImport,
+    PaintNodeUpdate,
+    WaitForFlip,
+    FrameCallbacks,
+};
+
+typedef bool (*IsActiveFunction)();
+typedef void (*RecordFunction)(quint8 stage, qint64 beginNs, qint64 endNs, quint32 surfaceId, quint32 clientId);
+
+struct Functions
+{
+    IsActiveFunction isActive = nullptr;
+    RecordFunction record = nullptr;
+};
+
+// Looked up like the startup tracer, until the compositor library is loaded
+inline Functions functions()
+{
+    static const StartupTrace::Symbol isActive("aurora_frame_trace_is_active");
+    static const StartupTrace::Symbol record("aurora_frame_trace_record");
+
+    Functions f;
+    f.isActive = reinterpret_cast<IsActiveFunction>(isActive.address());
+    f.record = reinterpret_cast<RecordFunction>(record.address());
+    if (!f.isActive || !f.record)
+        f = Functions();
+    return f;
+}
+
+inline bool isActive()
+{
+    const Functions f = functions();
+    return f.isActive && f.isActive();
+}
+
+// Records the lifetime of the object as the given stage
+class Scope
+{
+public:
+    explicit Scope(Stage stage)
+        : m_stage(stage)
+        , m_begin(isActive() ? StartupTrace::now() : 0)
+    {
+    }
+
+    ~Scope()
+    {
+        if (m_begin > 0)
+            functions().record(m_stage, m_begin, StartupTrace::now(), 0, 0);
+    }
+
+private:
+    Q_DISABLE_COPY(Scope)
+
+    const Stage m_stage;
+    const qint64 m_begin;
+};
+
+} // namespace FrameTrace
+
+} // namespace Aurora
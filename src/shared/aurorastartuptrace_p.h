@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Aurora API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QtGlobal>
+
+#include <dlfcn.h>
+#include <time.h>
+
+namespace Aurora {
+
+namespace StartupTrace {
+
+/*
+ * Records startup phases for the tracer of the compositor library,
+ * enabled by setting AURORA_STARTUP_TRACE to the trace file name.
+ *
+ * Modules that don't link to the compositor, like logind, libinput
+ * and the KMS support, find the tracer at runtime. When the tracer
+ * is not recording a span only costs a function call, or a symbol
+ * lookup until the compositor library is loaded.
+ */
+
+// Address of a function exported by the compositor library, which may
+// be loaded after the first lookup: it's looked up until it's found
+class Symbol
+{
+public:
+    explicit Symbol(const char *name)
+        : m_name(name)
+    {
+    }
+
+    void *address() const
+    {
+        void *address = m_address.loadAcquire();
+        if (!address) {
+            address = dlsym(RTLD_DEFAULT, m_name);
+            if (address)
+                m_address.storeRelease(address);
+        }
+        return address;
+    }
+
+private:
+    Q_DISABLE_COPY(Symbol)
+
+    const char *m_name;
+    mutable QAtomicPointer<void> m_address;
+};
+
+typedef bool (*IsActiveFunction)();
+typedef void (*AddSpanFunction)(const char *category, const char *name, qint64 beginNs, qint64 endNs);
+
+struct Functions
+{
+    IsActiveFunction isActive = nullptr;
+    AddSpanFunction addSpan = nullptr;
+};
+
+inline Functions functions()
+{
+    static const Symbol isActive("aurora_startup_trace_is_active");
+    static const Symbol addSpan("aurora_startup_trace_add_span");
+
+    Functions f;
+    f.isActive = reinterpret_cast<IsActiveFunction>(isActive.address());
+    f.addSpan = reinterpret_cast<AddSpanFunction>(addSpan.address());
+    if (!f.isActive || !f.addSpan)
+        f = Functions();
+    return f;
+}
+
+// Same clock as QElapsedTimer, timestamps of all the modules can be compared
+inline qint64 now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline bool isActive()
+{
+    const Functions f = functions();
+    return f.isActive && f.isActive();
+}
+
+inline void addSpan(const char *category, const char *name, qint64 beginNs, qint64 endNs)
+{
+    const Functions f = functions();
+    if (f.addSpan)
+        f.addSpan(category, name, beginNs, endNs);
+}
+
+// Records the lifetime of the object, category and name must be literals
+class Span
+{
+public:
+    Span(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_begin(isActive() ? now() : 0)
+    {
+    }
+
+    ~Span()
+    {
+        if (m_begin > 0)
+            addSpan(m_category, m_name, m_begin, now());
+    }
+
+private:
+    Q_DISABLE_COPY(Span)
+
+    const char *m_category;
+    const char *m_name;
+    const qint64 m_begin;
+};
+
+} // namespace StartupTrace
+
+} // namespace Aurora
@@ -94,9 +94,9 @@ void MockClient::outputModeEvent(void *data, wl_output *, uint32_t flags,
     resolve(data)->modes.append(mode);
 }
 
-void MockClient::outputDone(void *, wl_output *)
+void MockClient::outputDone(void *data, wl_output *)
 {
-
+    resolve(data)->outputDoneCount++;
 }
 
 void MockClient::outputScale(void *, wl_output *, int)
@@ -158,6 +158,8 @@ void MockClient::handleGlobal(uint32_t id, const QByteArray &interface)
 {
     if (interface == "wl_compositor") {
         compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 4));
+    } else if (interface == "wl_subcompositor") {
+        subcompositor = static_cast<wl_subcompositor *>(wl_registry_bind(registry, id, &wl_subcompositor_interface, 1));
     } else if (interface == "wl_output") {
         auto output = static_cast<wl_output *>(wl_registry_bind(registry, id, &wl_output_interface, 2));
         m_outputs.insert(id, output);
@@ -177,8 +179,13 @@ void MockClient::handleGlobal(uint32_t id, const QByteArray &interface)
         m_seats << new MockSeat(s);
     } else if (interface == "zwp_idle_inhibit_manager_v1") {
         idleInhibitManager = static_cast<zwp_idle_inhibit_manager_v1 *>(wl_registry_bind(registry, id, &zwp_idle_inhibit_manager_v1_interface, 1));
+    } else if (interface == "wp_linux_drm_syncobj_manager_v1") {
+        syncobjManager = static_cast<wp_linux_drm_syncobj_manager_v1 *>(wl_registry_bind(registry, id, &wp_linux_drm_syncobj_manager_v1_interface, 1));
+    } else if (interface == "zwp_relative_pointer_manager_v1") {
+        relativePointerManager = static_cast<zwp_relative_pointer_manager_v1 *>(wl_registry_bind(registry, id, &zwp_relative_pointer_manager_v1_interface, 1));
     } else if (interface == "zxdg_output_manager_v1") {
         xdgOutputManager = new Aurora::Client::PrivateClient::zxdg_output_manager_v1(registry, id, 2);
+        xdgOutputManagerId = id;
     }
 }
 
@@ -197,6 +204,12 @@ wl_surface *MockClient::createSurface()
     return wl_compositor_create_surface(compositor);
 }
 
+wl_subsurface *MockClient::createSubsurface(wl_surface *surface, wl_surface *parent)
+{
+    flushDisplay();
+    return wl_subcompositor_get_subsurface(subcompositor, surface, parent);
+}
+
 wl_shell_surface *MockClient::createShellSurface(wl_surface *surface)
 {
     flushDisplay();
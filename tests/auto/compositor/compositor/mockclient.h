@@ -8,6 +8,8 @@
 #include <wayland-ivi-application-client-protocol.h>
 #include "wayland-viewporter-client-protocol.h"
 #include "wayland-idle-inhibit-unstable-v1-client-protocol.h"
+#include "wayland-linux-drm-syncobj-v1-client-protocol.h"
+#include "wayland-relative-pointer-unstable-v1-client-protocol.h"
 
 #include <QObject>
 #include <QImage>
@@ -44,6 +46,7 @@ public:
     ~MockClient() override;
 
     wl_surface *createSurface();
+    wl_subsurface *createSubsurface(wl_surface *surface, wl_surface *parent);
     wl_shell_surface *createShellSurface(wl_surface *surface);
     xdg_surface *createXdgSurface(wl_surface *surface);
     xdg_toplevel *createXdgToplevel(xdg_surface *xdgSurface);
@@ -53,6 +56,7 @@ public:
 
     wl_display *display = nullptr;
     wl_compositor *compositor = nullptr;
+    wl_subcompositor *subcompositor = nullptr;
     QMap<uint, wl_output *> m_outputs;
     QMap<wl_output *, MockXdgOutputV1 *> m_xdgOutputs;
     wl_shm *shm = nullptr;
@@ -62,7 +66,10 @@ public:
     wp_viewporter *viewporter = nullptr;
     ivi_application *iviApplication = nullptr;
     zwp_idle_inhibit_manager_v1 *idleInhibitManager = nullptr;
+    wp_linux_drm_syncobj_manager_v1 *syncobjManager = nullptr;
+    zwp_relative_pointer_manager_v1 *relativePointerManager = nullptr;
     Aurora::Client::PrivateClient::zxdg_output_manager_v1 *xdgOutputManager = nullptr;
+    uint xdgOutputManagerId = 0;
 
     QList<MockSeat *> m_seats;
 
@@ -72,6 +79,7 @@ public:
     WaylandOutputMode currentMode;
     WaylandOutputMode preferredMode;
     QList<WaylandOutputMode> modes;
+    int outputDoneCount = 0;
 
     int fd;
     int error = 0 /* means no error according to spec */;
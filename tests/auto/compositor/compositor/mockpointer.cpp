@@ -36,10 +36,9 @@ static void pointerEnter(void *pointer, struct wl_pointer *wlPointer, uint seria
 {
     Q_UNUSED(wlPointer);
     Q_UNUSED(serial);
-    Q_UNUSED(x);
-    Q_UNUSED(y);
 
     static_cast<MockPointer *>(pointer)->m_enteredSurface = surface;
+    static_cast<MockPointer *>(pointer)->m_position = QPointF(wl_fixed_to_double(x), wl_fixed_to_double(y));
 }
 
 static void pointerLeave(void *pointer, struct wl_pointer *wlPointer, uint32_t serial, struct wl_surface *surface)
@@ -55,11 +54,11 @@ static void pointerLeave(void *pointer, struct wl_pointer *wlPointer, uint32_t s
 
 static void pointerMotion(void *pointer, struct wl_pointer *wlPointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
 {
-    Q_UNUSED(pointer);
     Q_UNUSED(wlPointer);
     Q_UNUSED(time);
-    Q_UNUSED(x);
-    Q_UNUSED(y);
+
+    static_cast<MockPointer *>(pointer)->m_position = QPointF(wl_fixed_to_double(x), wl_fixed_to_double(y));
+    static_cast<MockPointer *>(pointer)->m_motionCount++;
 }
 
 static void pointerButton(void *pointer, struct wl_pointer *wlPointer, uint32_t serial, uint32_t time, uint32_t button, uint32_t state)
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <QObject>
+#include <QPointF>
 #include "wayland-wayland-client-protocol.h"
 
 namespace Aurora {
@@ -20,6 +21,8 @@ public:
 
     wl_pointer *m_pointer = nullptr;
     wl_surface *m_enteredSurface = nullptr;
+    QPointF m_position;
+    int m_motionCount = 0;
 };
 
 } // namespace Compositor
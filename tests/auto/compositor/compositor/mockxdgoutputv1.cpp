@@ -34,6 +34,7 @@ void MockXdgOutputV1::zxdg_output_v1_done()
     description = pending.description;
     logicalPosition = pending.logicalPosition;
     logicalSize = pending.logicalSize;
+    ++doneCount;
 }
 
 void MockXdgOutputV1::zxdg_output_v1_name(const QString &name)
@@ -23,6 +23,7 @@ public:
     QString description;
     QPoint logicalPosition;
     QSize logicalSize;
+    int doneCount = 0;
 
     struct {
         QString name;
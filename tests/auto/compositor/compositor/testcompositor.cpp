@@ -5,6 +5,8 @@
 #include "testseat.h"
 #include "testkeyboardgrabber.h"
 
+#include <LiriAuroraCompositor/private/aurorawaylandcompositor_p.h>
+
 #include <wayland-server-core.h>
 
 namespace Aurora {
@@ -31,6 +33,7 @@ void TestCompositor::create()
 
 void TestCompositor::flushClients()
 {
+    WaylandCompositorPrivate::get(this)->flushPendingDone();
     wl_display_flush_clients(display());
 }
 
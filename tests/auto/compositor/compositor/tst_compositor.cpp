@@ -9,6 +9,9 @@
 #include "testkeyboardgrabber.h"
 #include "testseat.h"
 
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
 #include <QtGui/QScreen>
 #include <LiriAuroraCompositor/WaylandBufferRef>
 #include <LiriAuroraCompositor/WaylandXdgShell>
@@ -22,14 +25,24 @@
 #include <LiriAuroraCompositor/WaylandView>
 #include <LiriAuroraCompositor/WaylandViewporter>
 #include <LiriAuroraCompositor/WaylandIdleInhibitManagerV1>
+#include <LiriAuroraCompositor/WaylandRelativePointerManagerV1>
 #include <LiriAuroraCompositor/WaylandXdgOutputManagerV1>
 #include <aurora-client-xdg-shell.h>
 #include <aurora-client-ivi-application.h>
 #include <LiriAuroraCompositor/private/aurorawaylandoutput_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandpointer_p.h>
 #include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandxdgshell_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandlinuxdrmsyncobjv1_p.h>
+#include <LiriAuroraCompositor/private/aurorawlsynctimeline_p.h>
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
+#include <LiriAuroraCompositor/private/aurorastartuptracer_p.h>
 
 #include <QtTest/QtTest>
 
+#include <sys/eventfd.h>
+#include <unistd.h>
+
 using namespace Qt::StringLiterals;
 
 namespace Aurora {
@@ -52,6 +65,7 @@ private slots:
     void seatCreation();
     void seatKeyboardFocus();
     void seatMouseFocus();
+    void pointerMotionCoalescing();
     void inputRegion();
     void defaultInputRegionHiDpi();
     void singleClient();
@@ -65,14 +79,24 @@ private slots:
     void mapSurfaceHiDpi();
     void frameCallback();
     void pixelFormats();
+    void bufferDamageHistory();
+    void bufferDamageTransformed();
+    void subsurfaceSynchronized();
+    void subsurfaceDesynchronized();
+    void subsurfaceNestedDesynchronized();
     void outputs();
     void customSurface();
+    void startupTrace();
+    void frameTrace();
+    void frameTraceRingBuffer();
+    void frameTraceActivation();
 
     void advertisesXdgShellSupport();
     void createsXdgSurfaces();
     void reportsXdgSurfaceWindowGeometry();
     void setsXdgAppId();
     void sendsXdgConfigure();
+    void pacesXdgResize();
 
     void advertisesIviApplicationSupport();
     void createsIviSurfaces();
@@ -96,7 +120,15 @@ private slots:
 
     void idleInhibit();
 
+    void relativePointer();
+
     void xdgOutput();
+    void xdgOutputDoneBatching();
+
+    void linuxDrmSyncobj();
+    void linuxDrmSyncobjSupersededBuffer();
+    void linuxDrmSyncobjSynchronizedSubsurface();
+    void linuxDrmSyncobjNoAcquirePointError();
 
 private:
     QTemporaryDir m_tmpRuntimeDir;
@@ -663,6 +695,245 @@ void tst_WaylandCompositor::pixelFormats()
     wl_surface_destroy(surface);
 }
 
+void tst_WaylandCompositor::bufferDamageHistory()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    WaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    WaylandSurfacePrivate *surfacePrivate = WaylandSurfacePrivate::get(waylandSurface);
+    QSignalSpy damagedSpy(waylandSurface, SIGNAL(damaged(const QRegion &)));
+
+    QSize size(64, 64);
+    ShmBuffer front(size, client.shm);
+    ShmBuffer back(size, client.shm);
+
+    wl_surface_attach(surface, front.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, size.width(), size.height());
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 1);
+    const quint32 frontSerial = surfacePrivate->commitSerial;
+
+    wl_surface_attach(surface, back.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, 8, 8);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 2);
+
+    wl_surface_attach(surface, front.handle, 0, 0);
+    wl_surface_damage(surface, 16, 16, 8, 8);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 3);
+
+    // The front buffer has to catch up with what was drawn into the back buffer
+    QCOMPARE(surfacePrivate->bufferDamageSince(frontSerial), QRegion(0, 0, 8, 8) | QRegion(16, 16, 8, 8));
+    QCOMPARE(surfacePrivate->bufferDamageSince(surfacePrivate->commitSerial - 1), QRegion(16, 16, 8, 8));
+
+    // Too old to be known
+    QCOMPARE(surfacePrivate->bufferDamageSince(frontSerial - 10), QRegion(QRect(QPoint(), size)));
+
+    wl_surface_destroy(surface);
+}
+
+// Surface damage is mapped to the texture of the buffer
+void tst_WaylandCompositor::bufferDamageTransformed()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    WaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    WaylandSurfacePrivate *surfacePrivate = WaylandSurfacePrivate::get(waylandSurface);
+    QSignalSpy damagedSpy(waylandSurface, SIGNAL(damaged(const QRegion &)));
+
+    // The surface is 64x32, the top left corner is at the bottom left of the buffer
+    QSize size(32, 64);
+    ShmBuffer rotated(size, client.shm);
+    wl_surface_set_buffer_transform(surface, WL_OUTPUT_TRANSFORM_90);
+    wl_surface_attach(surface, rotated.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, 8, 8);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 1);
+    QCOMPARE(surfacePrivate->bufferDamageSince(surfacePrivate->commitSerial - 1), QRegion(0, 56, 8, 8));
+
+    // The surface is 32x32, the top left corner is at the bottom right of the buffer
+    size = QSize(64, 64);
+    ShmBuffer scaled(size, client.shm);
+    wl_surface_set_buffer_transform(surface, WL_OUTPUT_TRANSFORM_180);
+    wl_surface_set_buffer_scale(surface, 2);
+    wl_surface_attach(surface, scaled.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, 8, 8);
+    wl_surface_commit(surface);
+    QTRY_COMPARE(damagedSpy.count(), 2);
+    QCOMPARE(surfacePrivate->bufferDamageSince(surfacePrivate->commitSerial - 1), QRegion(48, 48, 16, 16));
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::subsurfaceSynchronized()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    QVERIFY(client.subcompositor);
+
+    wl_surface *parent = client.createSurface();
+    wl_surface *child = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    WaylandSurface *waylandParent = compositor.surfaces.at(0);
+    WaylandSurface *waylandChild = compositor.surfaces.at(1);
+
+    wl_subsurface *subsurface = client.createSubsurface(child, parent);
+    QTRY_VERIFY(WaylandSurfacePrivate::get(waylandChild)->isSubsurface());
+    QVERIFY(WaylandSurfacePrivate::get(waylandChild)->isSynchronized());
+
+    QSignalSpy parentRedrawSpy(waylandParent, SIGNAL(redraw()));
+    QSignalSpy childRedrawSpy(waylandChild, SIGNAL(redraw()));
+    QSignalSpy childSizeSpy(waylandChild, SIGNAL(bufferSizeChanged()));
+
+    QSize size(32, 32);
+    ShmBuffer parentBuffer(size, client.shm);
+    ShmBuffer childBuffer(size, client.shm);
+
+    // The child state is cached until the parent commits
+    wl_surface_attach(child, childBuffer.handle, 0, 0);
+    wl_surface_damage(child, 0, 0, size.width(), size.height());
+    wl_surface_commit(child);
+    QTRY_VERIFY(WaylandSurfacePrivate::get(waylandChild)->hasCachedState);
+    QCOMPARE(childRedrawSpy.count(), 0);
+    QVERIFY(!waylandChild->hasContent());
+
+    // A second child commit replaces the cached state
+    wl_surface_attach(child, childBuffer.handle, 0, 0);
+    wl_surface_damage(child, 0, 0, 8, 8);
+    wl_surface_commit(child);
+
+    wl_surface_attach(parent, parentBuffer.handle, 0, 0);
+    wl_surface_damage(parent, 0, 0, size.width(), size.height());
+    wl_surface_commit(parent);
+
+    // Both states are applied at once, with signals emitted once per surface
+    QTRY_COMPARE(parentRedrawSpy.count(), 1);
+    QCOMPARE(childRedrawSpy.count(), 1);
+    QCOMPARE(childSizeSpy.count(), 1);
+    QVERIFY(waylandParent->hasContent());
+    QVERIFY(waylandChild->hasContent());
+    QVERIFY(!WaylandSurfacePrivate::get(waylandChild)->hasCachedState);
+
+    // Only surfaces with a cached state are notified
+    wl_surface_commit(parent);
+    QTRY_COMPARE(parentRedrawSpy.count(), 2);
+    QCOMPARE(childRedrawSpy.count(), 1);
+
+    wl_subsurface_destroy(subsurface);
+    wl_surface_destroy(child);
+    wl_surface_destroy(parent);
+}
+
+void tst_WaylandCompositor::subsurfaceDesynchronized()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *parent = client.createSurface();
+    wl_surface *child = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    WaylandSurface *waylandChild = compositor.surfaces.at(1);
+
+    wl_subsurface *subsurface = client.createSubsurface(child, parent);
+    QTRY_VERIFY(WaylandSurfacePrivate::get(waylandChild)->isSubsurface());
+
+    QSignalSpy childRedrawSpy(waylandChild, SIGNAL(redraw()));
+
+    QSize size(32, 32);
+    ShmBuffer childBuffer(size, client.shm);
+
+    wl_surface_attach(child, childBuffer.handle, 0, 0);
+    wl_surface_damage(child, 0, 0, size.width(), size.height());
+    wl_surface_commit(child);
+    QTRY_VERIFY(WaylandSurfacePrivate::get(waylandChild)->hasCachedState);
+
+    // Switching to desynchronized mode applies the cached state
+    wl_subsurface_set_desync(subsurface);
+    QTRY_COMPARE(childRedrawSpy.count(), 1);
+    QVERIFY(waylandChild->hasContent());
+
+    // From now on commits are applied immediately
+    wl_surface_damage(child, 0, 0, 8, 8);
+    wl_surface_commit(child);
+    QTRY_COMPARE(childRedrawSpy.count(), 2);
+    QVERIFY(!WaylandSurfacePrivate::get(waylandChild)->isSynchronized());
+
+    wl_subsurface_destroy(subsurface);
+    wl_surface_destroy(child);
+    wl_surface_destroy(parent);
+}
+
+void tst_WaylandCompositor::subsurfaceNestedDesynchronized()
+{
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+
+    wl_surface *root = client.createSurface();
+    wl_surface *middle = client.createSurface();
+    wl_surface *leaf = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 3);
+    WaylandSurface *waylandLeaf = compositor.surfaces.at(2);
+    auto *leafPrivate = WaylandSurfacePrivate::get(waylandLeaf);
+
+    wl_subsurface *middleSubsurface = client.createSubsurface(middle, root);
+    wl_subsurface *leafSubsurface = client.createSubsurface(leaf, middle);
+    wl_subsurface_set_desync(leafSubsurface);
+    QTRY_VERIFY(leafPrivate->isSubsurface() && !leafPrivate->subsurface->synchronized);
+
+    // Desynchronized, but synchronized through its parent
+    QVERIFY(leafPrivate->isSynchronized());
+
+    QSignalSpy leafRedrawSpy(waylandLeaf, SIGNAL(redraw()));
+
+    QSize size(32, 32);
+    ShmBuffer leafBuffer(size, client.shm);
+
+    wl_surface_attach(leaf, leafBuffer.handle, 0, 0);
+    wl_surface_damage(leaf, 0, 0, size.width(), size.height());
+    wl_surface_commit(leaf);
+    QTRY_VERIFY(leafPrivate->hasCachedState);
+    QCOMPARE(leafRedrawSpy.count(), 0);
+
+    // The leaf is applied along with the middle surface, which is applied along with the root
+    wl_surface_commit(middle);
+    wl_surface_commit(root);
+    QTRY_COMPARE(leafRedrawSpy.count(), 1);
+    QVERIFY(waylandLeaf->hasContent());
+    QVERIFY(!leafPrivate->hasCachedState);
+
+    // The state held because of the middle surface is applied when it's desynchronized
+    wl_surface_damage(leaf, 0, 0, 8, 8);
+    wl_surface_commit(leaf);
+    QTRY_VERIFY(leafPrivate->hasCachedState);
+    wl_subsurface_set_desync(middleSubsurface);
+    QTRY_COMPARE(leafRedrawSpy.count(), 2);
+    QVERIFY(!leafPrivate->hasCachedState);
+    QVERIFY(!leafPrivate->isSynchronized());
+
+    wl_subsurface_destroy(leafSubsurface);
+    wl_subsurface_destroy(middleSubsurface);
+    wl_surface_destroy(leaf);
+    wl_surface_destroy(middle);
+    wl_surface_destroy(root);
+}
+
 void tst_WaylandCompositor::outputs()
 {
     TestCompositor compositor;
@@ -722,6 +993,219 @@ void tst_WaylandCompositor::customSurface()
     QTRY_COMPARE(compositor.surfaces.size(), 0);
 }
 
+void tst_WaylandCompositor::startupTrace()
+{
+    QTemporaryDir tmpDir;
+    QVERIFY(tmpDir.isValid());
+    const QString fileName = tmpDir.filePath(u"startup.json"_s);
+
+    auto *tracer = Internal::StartupTracer::instance();
+    tracer->start(fileName);
+    QVERIFY(tracer->isActive());
+
+    TestCompositor compositor;
+    compositor.create();
+    QVERIFY(tracer->isActive());
+
+    // The trace is saved with the first frame
+    compositor.defaultOutput()->frameStarted();
+    compositor.defaultOutput()->sendFrameCallbacks();
+    QVERIFY(!tracer->isActive());
+
+    QFile file(fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+
+    QHash<QString, QJsonObject> events;
+    const QJsonArray traceEvents = document.object().value(u"traceEvents"_s).toArray();
+    for (const QJsonValue &value : traceEvents) {
+        const QJsonObject event = value.toObject();
+        events.insert(event.value(u"name"_s).toString(), event);
+    }
+
+    const QStringList phases = {
+        u"create"_s, u"init"_s, u"hardwareIntegration"_s,
+        u"seats"_s, u"extensions"_s, u"createdChanged"_s,
+    };
+    for (const QString &phase : phases) {
+        QVERIFY2(events.contains(phase), qPrintable(phase));
+        const QJsonObject event = events.value(phase);
+        QCOMPARE(event.value(u"ph"_s).toString(), u"X"_s);
+        QCOMPARE(event.value(u"cat"_s).toString(), u"compositor"_s);
+        QVERIFY(event.value(u"dur"_s).toDouble() >= 0);
+    }
+
+    // Phases are nested in the one that started them
+    const QJsonObject create = events.value(u"create"_s);
+    const QJsonObject init = events.value(u"init"_s);
+    QVERIFY(init.value(u"ts"_s).toDouble() >= create.value(u"ts"_s).toDouble());
+    QVERIFY(init.value(u"ts"_s).toDouble() + init.value(u"dur"_s).toDouble()
+            <= create.value(u"ts"_s).toDouble() + create.value(u"dur"_s).toDouble());
+
+    QVERIFY(events.contains(u"firstFrame"_s));
+    QVERIFY(events.value(u"firstFrame"_s).value(u"ts"_s).toDouble()
+            >= create.value(u"ts"_s).toDouble() + create.value(u"dur"_s).toDouble());
+}
+
+void tst_WaylandCompositor::frameTrace()
+{
+    auto *tracer = Internal::FrameTracer::instance();
+    tracer->acquire();
+
+    TestCompositor compositor;
+    compositor.create();
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    WaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    BufferView view;
+    view.setSurface(waylandSurface);
+    view.setOutput(compositor.defaultOutput());
+
+    const quint64 frame = tracer->frame();
+
+    ShmBuffer buffer(QSize(32, 32), client.shm);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, 32, 32);
+    wl_surface_commit(surface);
+    QTRY_VERIFY(waylandSurface->hasContent());
+
+    compositor.defaultOutput()->frameStarted();
+    compositor.defaultOutput()->sendFrameCallbacks();
+    QCOMPARE(tracer->frame(), frame + 1);
+
+    tracer->release();
+
+    // Ignored while not recording
+    const qsizetype count = tracer->events().size();
+    compositor.defaultOutput()->sendFrameCallbacks();
+    QCOMPARE(tracer->events().size(), count);
+    QCOMPARE(tracer->frame(), frame + 1);
+
+    const quint32 surfaceId = wl_proxy_get_id(reinterpret_cast<wl_proxy *>(surface));
+    const quint32 clientId = quint32(::getpid());
+    bool hasCommit = false;
+    bool hasFrameCallbacks = false;
+    const auto events = tracer->events();
+    for (const auto &event : events) {
+        QVERIFY(event.end >= event.begin);
+        if (event.stage == Internal::FrameTracer::SurfaceCommit && event.surfaceId == surfaceId) {
+            QCOMPARE(event.clientId, clientId);
+            QCOMPARE(event.frame, frame);
+            hasCommit = true;
+        } else if (event.stage == Internal::FrameTracer::FrameCallbacks && event.frame == frame) {
+            hasFrameCallbacks = true;
+        }
+    }
+    QVERIFY(hasCommit);
+    QVERIFY(hasFrameCallbacks);
+
+    QTemporaryDir tmpDir;
+    QVERIFY(tmpDir.isValid());
+
+    // Chrome trace
+    const QString jsonFileName = tmpDir.filePath(u"frames.json"_s);
+    QVERIFY(tracer->save(jsonFileName, Internal::FrameTracer::ChromeTrace));
+    QFile jsonFile(jsonFileName);
+    QVERIFY(jsonFile.open(QIODevice::ReadOnly));
+    const QJsonArray traceEvents = QJsonDocument::fromJson(jsonFile.readAll())
+            .object().value(u"traceEvents"_s).toArray();
+    hasCommit = false;
+    for (const QJsonValue &value : traceEvents) {
+        const QJsonObject event = value.toObject();
+        const QJsonObject args = event.value(u"args"_s).toObject();
+        if (event.value(u"name"_s).toString() == u"surfaceCommit"_s
+                && args.value(u"surface"_s).toInteger() == surfaceId) {
+            QCOMPARE(event.value(u"ph"_s).toString(), u"X"_s);
+            QCOMPARE(args.value(u"client"_s).toInteger(), qint64(clientId));
+            hasCommit = true;
+        }
+    }
+    QVERIFY(hasCommit);
+
+    // Binary stream
+    const QString binaryFileName = tmpDir.filePath(u"frames.bin"_s);
+    QVERIFY(tracer->save(binaryFileName, Internal::FrameTracer::Binary));
+    QFile binaryFile(binaryFileName);
+    QVERIFY(binaryFile.open(QIODevice::ReadOnly));
+    QDataStream stream(&binaryFile);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    char magic[4];
+    QCOMPARE(stream.readRawData(magic, 4), 4);
+    QCOMPARE(QByteArray(magic, 4), "AFTR"_ba);
+    quint16 version = 0, stageCount = 0;
+    stream >> version >> stageCount;
+    QCOMPARE(version, quint16(1));
+    QCOMPARE(stageCount, quint16(Internal::FrameTracer::StageCount));
+    for (int i = 0; i < stageCount; ++i) {
+        QByteArray name;
+        stream >> name;
+        QCOMPARE(name, QByteArray(Internal::FrameTracer::stageName(Internal::FrameTracer::Stage(i))));
+    }
+    quint32 eventCount = 0;
+    stream >> eventCount;
+    QCOMPARE(qsizetype(eventCount), events.size());
+    // Begin, duration, frame, surface, client, thread and stage
+    QCOMPARE(binaryFile.size() - binaryFile.pos(), qint64(eventCount) * 29);
+
+    wl_surface_destroy(surface);
+}
+
+void tst_WaylandCompositor::frameTraceRingBuffer()
+{
+    using Internal::FrameTracer;
+
+    auto *tracer = FrameTracer::instance();
+    tracer->acquire();
+
+    // The oldest events are overwritten
+    const int count = int(FrameTracer::Capacity) + 10;
+    for (int i = 0; i < count; ++i)
+        tracer->record(FrameTracer::PaintNodeUpdate, i + 1, i + 2, 1, 2);
+    tracer->release();
+
+    const auto events = tracer->events();
+    QCOMPARE(events.size(), qsizetype(FrameTracer::Capacity));
+    QCOMPARE(events.first().begin, qint64(11));
+    QCOMPARE(events.last().begin, qint64(count));
+    for (const auto &event : events) {
+        QCOMPARE(event.stage, FrameTracer::PaintNodeUpdate);
+        QCOMPARE(event.end - event.begin, qint64(1));
+        QCOMPARE(event.surfaceId, 1u);
+        QCOMPARE(event.clientId, 2u);
+    }
+}
+
+void tst_WaylandCompositor::frameTraceActivation()
+{
+    using Internal::FrameTracer;
+
+    if (qEnvironmentVariableIsSet("AURORA_FRAME_TRACE"))
+        QSKIP("Recording is held on by AURORA_FRAME_TRACE");
+
+    auto *tracer = FrameTracer::instance();
+    QVERIFY(!tracer->isActive());
+
+    // Recording goes on until every user is done with it
+    tracer->acquire();
+    tracer->acquire();
+    QVERIFY(tracer->isActive());
+    tracer->release();
+    QVERIFY(tracer->isActive());
+    tracer->release();
+    QVERIFY(!tracer->isActive());
+
+    // Clients are only looked up while recording
+    const qsizetype count = tracer->events().size();
+    {
+        FrameTracer::Scope trace(FrameTracer::SurfaceCommit, 1, nullptr);
+    }
+    QCOMPARE(tracer->events().size(), count);
+}
+
 void tst_WaylandCompositor::seatCapabilities()
 {
     TestCompositor compositor;
@@ -852,6 +1336,49 @@ void tst_WaylandCompositor::seatMouseFocus()
     delete view;
 }
 
+void tst_WaylandCompositor::pointerMotionCoalescing()
+{
+    TestCompositor compositor(true);
+    compositor.create();
+
+    WaylandOutputMode mode(QSize(1024, 768), 60000);
+    compositor.defaultOutput()->addMode(mode, true);
+    compositor.defaultOutput()->setCurrentMode(mode);
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+
+    WaylandView view;
+    view.setSurface(compositor.surfaces.at(0));
+    view.setOutput(compositor.defaultOutput());
+
+    QTRY_COMPARE(client.m_seats.size(), 1);
+    MockPointer *mockPointer = client.m_seats.first()->pointer();
+    QVERIFY(mockPointer);
+
+    // The enter event carries the position
+    WaylandSeat *seat = compositor.defaultSeat();
+    seat->sendMouseMoveEvent(&view, QPointF(10, 10), QPointF(10, 10));
+    compositor.flushClients();
+    QTRY_COMPARE(mockPointer->m_enteredSurface, surface);
+    QCOMPARE(mockPointer->m_position, QPointF(10, 10));
+    QCOMPARE(mockPointer->m_motionCount, 0);
+
+    // Sub-pixel motion between two frames is sent once, at the last position
+    for (int i = 0; i < 10; ++i) {
+        const QPointF pos(10.25 + i, 20.5);
+        seat->sendMouseMoveEvent(&view, pos, pos);
+    }
+    compositor.defaultOutput()->sendFrameCallbacks();
+
+    QTRY_COMPARE(mockPointer->m_motionCount, 1);
+    QCOMPARE(mockPointer->m_position, QPointF(19.25, 20.5));
+
+    QTest::qWait(50);
+    QCOMPARE(mockPointer->m_motionCount, 1);
+}
+
 void tst_WaylandCompositor::inputRegion()
 {
     TestCompositor compositor(true);
@@ -1164,6 +1691,109 @@ void tst_WaylandCompositor::sendsXdgConfigure()
     QTRY_VERIFY(!toplevel->resizing());
 }
 
+void tst_WaylandCompositor::pacesXdgResize()
+{
+    class MockXdgSurface : public Aurora::Client::PrivateClient::xdg_surface
+    {
+    public:
+        explicit MockXdgSurface(::xdg_surface *xdgSurface) : Aurora::Client::PrivateClient::xdg_surface(xdgSurface) {}
+        void xdg_surface_configure(uint32_t serial) override { configureSerial = serial; }
+        uint configureSerial = 0;
+    };
+
+    class MockXdgToplevel : public Aurora::Client::PrivateClient::xdg_toplevel
+    {
+    public:
+        explicit MockXdgToplevel(::xdg_toplevel *toplevel) : Aurora::Client::PrivateClient::xdg_toplevel(toplevel) {}
+        void xdg_toplevel_configure(int32_t width, int32_t height, wl_array *rawStates) override
+        {
+            Q_UNUSED(rawStates);
+            configureSize = QSize(width, height);
+            ++configureCount;
+        }
+        QSize configureSize;
+        int configureCount = 0;
+    };
+
+    XdgTestCompositor compositor;
+    compositor.create();
+
+    WaylandXdgToplevel *toplevel = nullptr;
+    QObject::connect(&compositor.xdgShell, &WaylandXdgShell::toplevelCreated, [&](WaylandXdgToplevel *t) {
+        toplevel = t;
+    });
+
+    MockClient client;
+    wl_surface *surface = client.createSurface();
+    xdg_surface *clientXdgSurface = client.createXdgSurface(surface);
+    MockXdgSurface mockXdgSurface(clientXdgSurface);
+    xdg_toplevel *clientToplevel = client.createXdgToplevel(clientXdgSurface);
+    MockXdgToplevel mockToplevel(clientToplevel);
+
+    QTRY_VERIFY(toplevel);
+    auto *d = WaylandXdgToplevelPrivate::get(toplevel);
+
+    // Done with the initial configure
+    QTRY_COMPARE(mockToplevel.configureCount, 1);
+    xdg_surface_ack_configure(clientXdgSurface, mockXdgSurface.configureSerial);
+    wl_surface_commit(surface);
+    wl_display_flush(client.display);
+    QTRY_VERIFY(d->m_pendingConfigures.isEmpty());
+
+    // A 1 kHz mouse dragged for a second, the client redraws at 60 Hz
+    const int moves = 1000;
+    const int frameInterval = 16;
+    int maxUnacked = 0;
+    QSize lastSize;
+    for (int ms = 1; ms <= moves; ++ms) {
+        lastSize = QSize(400 + ms / 2, 300 + ms / 4);
+        d->requestResize(lastSize);
+        maxUnacked = qMax(maxUnacked, int(d->m_pendingConfigures.size()));
+
+        if (ms % frameInterval != 0)
+            continue;
+
+        // The client acks and commits the configure it got,
+        // then the newest size is sent
+        compositor.flushClients();
+        const uint serial = d->m_resizeSerial;
+        QVERIFY(serial != 0);
+        QTRY_COMPARE(mockXdgSurface.configureSerial, serial);
+        xdg_surface_ack_configure(clientXdgSurface, serial);
+        wl_surface_commit(surface);
+        wl_display_flush(client.display);
+        QTRY_VERIFY(d->m_resizeSerial != serial);
+        QVERIFY(!d->m_resizePendingSize.isValid());
+    }
+
+    QCOMPARE(maxUnacked, 1);
+    const int resizeConfigures = mockToplevel.configureCount - 1;
+    QVERIFY2(resizeConfigures <= moves / frameInterval + 2,
+             qPrintable(QStringLiteral("%1 configures for %2 moves").arg(resizeConfigures).arg(moves)));
+
+    // The client acks the last configure without committing
+    compositor.flushClients();
+    const uint serial = d->m_resizeSerial;
+    QVERIFY(serial != 0);
+    QTRY_COMPARE(mockXdgSurface.configureSerial, serial);
+    xdg_surface_ack_configure(clientXdgSurface, serial);
+    wl_display_flush(client.display);
+    QTRY_VERIFY(d->m_resizeAcked);
+
+    // Sizes in between are dropped, the newest one waits for the next frame
+    const QSize finalSize = lastSize + QSize(10, 10);
+    d->requestResize(finalSize);
+    QCOMPARE(d->m_resizeSerial, serial);
+    d->flushResize();
+    QCOMPARE(d->m_resizeSerial, serial);
+    d->flushResize(true);
+    QVERIFY(d->m_resizeSerial != serial);
+    QVERIFY(!d->m_resizePendingSize.isValid());
+
+    compositor.flushClients();
+    QTRY_COMPARE(mockToplevel.configureSize, finalSize);
+}
+
 class IviTestCompositor: public TestCompositor {
     Q_OBJECT
 public:
@@ -1744,6 +2374,88 @@ void tst_WaylandCompositor::idleInhibit()
     QTRY_COMPARE(changedSpy.count(), 1);
 }
 
+class RelativePointerCompositor : public TestCompositor
+{
+    Q_OBJECT
+public:
+    RelativePointerCompositor() : TestCompositor(true), relativePointerManager(this) {}
+    WaylandRelativePointerManagerV1 relativePointerManager;
+};
+
+struct RelativeMotion
+{
+    int count = 0;
+    quint64 timestamp = 0;
+    QPointF delta;
+    QPointF deltaUnaccelerated;
+};
+
+static void relativePointerMotion(void *data, zwp_relative_pointer_v1 *relativePointer,
+                                  uint32_t utime_hi, uint32_t utime_lo,
+                                  wl_fixed_t dx, wl_fixed_t dy,
+                                  wl_fixed_t dx_unaccel, wl_fixed_t dy_unaccel)
+{
+    Q_UNUSED(relativePointer);
+
+    auto *motion = static_cast<RelativeMotion *>(data);
+    motion->count++;
+    motion->timestamp = (quint64(utime_hi) << 32) | utime_lo;
+    motion->delta = QPointF(wl_fixed_to_double(dx), wl_fixed_to_double(dy));
+    motion->deltaUnaccelerated = QPointF(wl_fixed_to_double(dx_unaccel), wl_fixed_to_double(dy_unaccel));
+}
+
+static const struct zwp_relative_pointer_v1_listener relativePointerListener = {
+    relativePointerMotion,
+};
+
+void tst_WaylandCompositor::relativePointer()
+{
+    RelativePointerCompositor compositor;
+    compositor.create();
+
+    WaylandOutputMode mode(QSize(1024, 768), 60000);
+    compositor.defaultOutput()->addMode(mode, true);
+    compositor.defaultOutput()->setCurrentMode(mode);
+
+    MockClient client;
+    QTRY_VERIFY(client.relativePointerManager);
+    QTRY_COMPARE(client.m_seats.size(), 1);
+    MockPointer *mockPointer = client.m_seats.first()->pointer();
+    QVERIFY(mockPointer);
+
+    RelativeMotion motion;
+    auto *relativePointer = zwp_relative_pointer_manager_v1_get_relative_pointer(
+                client.relativePointerManager, mockPointer->m_pointer);
+    zwp_relative_pointer_v1_add_listener(relativePointer, &relativePointerListener, &motion);
+
+    WaylandSeat *seat = compositor.defaultSeat();
+    auto *pointerPrivate = WaylandPointerPrivate::get(seat->pointer());
+    QTRY_COMPARE(pointerPrivate->relativePointers.size(), 1);
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+
+    WaylandView view;
+    view.setSurface(compositor.surfaces.at(0));
+    view.setOutput(compositor.defaultOutput());
+    seat->sendMouseMoveEvent(&view, QPointF(10, 10), QPointF(10, 10));
+    compositor.flushClients();
+    QTRY_COMPARE(mockPointer->m_enteredSurface, surface);
+
+    // Deltas between two frames are added up
+    seat->pointer()->sendRelativeMotionEvent(QPointF(0.5, 0.25), QPointF(0.25, 0.125), 0x100000001ull);
+    seat->pointer()->sendRelativeMotionEvent(QPointF(1.5, -0.25), QPointF(0.75, -0.125), 0x100000002ull);
+    compositor.defaultOutput()->sendFrameCallbacks();
+
+    QTRY_COMPARE(motion.count, 1);
+    QCOMPARE(motion.timestamp, quint64(0x100000002ull));
+    QCOMPARE(motion.delta, QPointF(2, 0));
+    QCOMPARE(motion.deltaUnaccelerated, QPointF(1, 0));
+
+    zwp_relative_pointer_v1_destroy(relativePointer);
+    QTRY_VERIFY(pointerPrivate->relativePointers.isEmpty());
+}
+
 class XdgOutputCompositor : public TestCompositor
 {
     Q_OBJECT
@@ -1807,6 +2519,265 @@ void tst_WaylandCompositor::xdgOutput()
     QTRY_COMPARE(xdgOutput->logicalSize, QSize(1000, 1000));
 }
 
+void tst_WaylandCompositor::xdgOutputDoneBatching()
+{
+    XdgOutputCompositor compositor;
+    compositor.create();
+
+    auto *xdgOutputServer = new WaylandXdgOutputV1(compositor.defaultOutput(), &compositor.xdgOutputManager);
+    xdgOutputServer->setLogicalSize(QSize(1024, 768));
+
+    MockClient client;
+    QTRY_VERIFY(client.xdgOutputManagerId);
+    QTRY_COMPARE(client.m_outputs.size(), 1);
+    auto *wlOutput = client.m_outputs.first();
+
+    // Since version 3 the changes are completed by wl_output.done
+    Aurora::Client::PrivateClient::zxdg_output_manager_v1 manager(client.registry, client.xdgOutputManagerId, 3);
+    MockXdgOutputV1 xdgOutput(manager.get_xdg_output(wlOutput));
+    QTRY_COMPARE(xdgOutput.pending.logicalSize, QSize(1024, 768));
+
+    const int outputDoneCount = client.outputDoneCount;
+    const int xdgOutputDoneCount = xdgOutput.doneCount;
+
+    // The logical size changes with the scale, both are completed by one done
+    xdgOutputServer->setLogicalSize(QSize(512, 384));
+    compositor.defaultOutput()->setScaleFactor(2);
+    compositor.flushClients();
+    QTRY_COMPARE(xdgOutput.pending.logicalSize, QSize(512, 384));
+    QTRY_COMPARE(client.outputDoneCount, outputDoneCount + 1);
+    QCOMPARE(xdgOutput.doneCount, xdgOutputDoneCount);
+
+    // Changes on their own are completed by the next flush
+    xdgOutputServer->setLogicalPosition(QPoint(10, 10));
+    xdgOutputServer->setLogicalSize(QSize(500, 400));
+    compositor.flushClients();
+    QTRY_COMPARE(xdgOutput.pending.logicalSize, QSize(500, 400));
+    QCOMPARE(xdgOutput.pending.logicalPosition, QPoint(10, 10));
+    QTRY_COMPARE(client.outputDoneCount, outputDoneCount + 2);
+    QCOMPARE(xdgOutput.doneCount, xdgOutputDoneCount);
+
+    manager.destroy();
+}
+
+class SyncobjCompositor : public TestCompositor
+{
+    Q_OBJECT
+public:
+    SyncobjCompositor() : syncobjManager(this) { syncobjManager.setBackend(&backend); }
+    Internal::SoftwareSyncTimelineBackend backend;
+    WaylandLinuxDrmSyncobjManagerV1 syncobjManager;
+};
+
+static wp_linux_drm_syncobj_timeline_v1 *importTimeline(MockClient *client)
+{
+    // Any file descriptor is a timeline for the software backend
+    const int fd = eventfd(0, EFD_CLOEXEC);
+    auto *timeline = wp_linux_drm_syncobj_manager_v1_import_timeline(client->syncobjManager, fd);
+    close(fd);
+    return timeline;
+}
+
+void tst_WaylandCompositor::linuxDrmSyncobj()
+{
+    SyncobjCompositor compositor;
+    compositor.create();
+    MockClient client;
+    QTRY_VERIFY(client.syncobjManager);
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    WaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    auto *waylandSurfacePrivate = WaylandSurfacePrivate::get(waylandSurface);
+
+    auto *syncobjSurface = wp_linux_drm_syncobj_manager_v1_get_surface(client.syncobjManager, surface);
+    auto *acquireTimeline = importTimeline(&client);
+    auto *releaseTimeline = importTimeline(&client);
+    QTRY_COMPARE(compositor.backend.timelines().size(), 2);
+    auto acquire = compositor.backend.timelines().at(0);
+    auto release = compositor.backend.timelines().at(1);
+
+    const QSize bufferSize(64, 64);
+    ShmBuffer firstBuffer(bufferSize, client.shm);
+    wl_surface_attach(surface, firstBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, bufferSize.width(), bufferSize.height());
+    wp_linux_drm_syncobj_surface_v1_set_acquire_point(syncobjSurface, acquireTimeline, 0, 1);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 1);
+    wl_surface_commit(surface);
+
+    // The commit is held until the client is done rendering
+    QTRY_VERIFY(waylandSurfacePrivate->hasCachedState);
+    QCOMPARE(waylandSurface->bufferSize(), QSize());
+
+    acquire->signal(1);
+    QTRY_COMPARE(waylandSurface->bufferSize(), bufferSize);
+    QVERIFY(!waylandSurfacePrivate->hasCachedState);
+    QCOMPARE(release->value(), quint64(0));
+
+    // The first buffer is released once the second one is applied
+    const QSize secondBufferSize(32, 32);
+    ShmBuffer secondBuffer(secondBufferSize, client.shm);
+    wl_surface_attach(surface, secondBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, secondBufferSize.width(), secondBufferSize.height());
+    wp_linux_drm_syncobj_surface_v1_set_acquire_point(syncobjSurface, acquireTimeline, 0, 2);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 2);
+    wl_surface_commit(surface);
+
+    QTRY_VERIFY(waylandSurfacePrivate->hasCachedState);
+    QCOMPARE(release->value(), quint64(0));
+
+    acquire->signal(2);
+    QTRY_COMPARE(waylandSurface->bufferSize(), secondBufferSize);
+    QTRY_COMPARE(release->value(), quint64(1));
+
+    wp_linux_drm_syncobj_surface_v1_destroy(syncobjSurface);
+    wp_linux_drm_syncobj_timeline_v1_destroy(acquireTimeline);
+    wp_linux_drm_syncobj_timeline_v1_destroy(releaseTimeline);
+    wl_surface_destroy(surface);
+    QCOMPARE(client.error, 0);
+}
+
+void tst_WaylandCompositor::linuxDrmSyncobjSupersededBuffer()
+{
+    SyncobjCompositor compositor;
+    compositor.create();
+    MockClient client;
+    QTRY_VERIFY(client.syncobjManager);
+
+    wl_surface *surface = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 1);
+    WaylandSurface *waylandSurface = compositor.surfaces.at(0);
+    auto *waylandSurfacePrivate = WaylandSurfacePrivate::get(waylandSurface);
+
+    auto *syncobjSurface = wp_linux_drm_syncobj_manager_v1_get_surface(client.syncobjManager, surface);
+    auto *acquireTimeline = importTimeline(&client);
+    auto *releaseTimeline = importTimeline(&client);
+    QTRY_COMPARE(compositor.backend.timelines().size(), 2);
+    auto acquire = compositor.backend.timelines().at(0);
+    auto release = compositor.backend.timelines().at(1);
+
+    const QSize firstBufferSize(64, 64);
+    ShmBuffer firstBuffer(firstBufferSize, client.shm);
+    wl_surface_attach(surface, firstBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, firstBufferSize.width(), firstBufferSize.height());
+    wp_linux_drm_syncobj_surface_v1_set_acquire_point(syncobjSurface, acquireTimeline, 0, 1);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 1);
+    wl_surface_commit(surface);
+
+    QTRY_VERIFY(waylandSurfacePrivate->hasCachedState);
+    QCOMPARE(release->value(), quint64(0));
+
+    // The first buffer is replaced while its acquire point is not signalled:
+    // it is never used, and goes back to the client right away
+    const QSize secondBufferSize(32, 32);
+    ShmBuffer secondBuffer(secondBufferSize, client.shm);
+    wl_surface_attach(surface, secondBuffer.handle, 0, 0);
+    wl_surface_damage(surface, 0, 0, secondBufferSize.width(), secondBufferSize.height());
+    wp_linux_drm_syncobj_surface_v1_set_acquire_point(syncobjSurface, acquireTimeline, 0, 2);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 2);
+    wl_surface_commit(surface);
+
+    QTRY_COMPARE(release->value(), quint64(1));
+    QVERIFY(waylandSurfacePrivate->hasCachedState);
+    QCOMPARE(waylandSurface->bufferSize(), QSize());
+
+    // Only the point of the second buffer applies the state
+    acquire->signal(1);
+    QTest::qWait(50);
+    QCOMPARE(waylandSurface->bufferSize(), QSize());
+
+    acquire->signal(2);
+    QTRY_COMPARE(waylandSurface->bufferSize(), secondBufferSize);
+    QCOMPARE(release->value(), quint64(1));
+
+    wp_linux_drm_syncobj_surface_v1_destroy(syncobjSurface);
+    wp_linux_drm_syncobj_timeline_v1_destroy(acquireTimeline);
+    wp_linux_drm_syncobj_timeline_v1_destroy(releaseTimeline);
+    wl_surface_destroy(surface);
+    QCOMPARE(client.error, 0);
+}
+
+void tst_WaylandCompositor::linuxDrmSyncobjSynchronizedSubsurface()
+{
+    SyncobjCompositor compositor;
+    compositor.create();
+    MockClient client;
+    QTRY_VERIFY(client.syncobjManager);
+    QVERIFY(client.subcompositor);
+
+    wl_surface *parent = client.createSurface();
+    wl_surface *child = client.createSurface();
+    QTRY_COMPARE(compositor.surfaces.size(), 2);
+    WaylandSurface *waylandParent = compositor.surfaces.at(0);
+    WaylandSurface *waylandChild = compositor.surfaces.at(1);
+    auto *childPrivate = WaylandSurfacePrivate::get(waylandChild);
+
+    wl_subsurface *subsurface = client.createSubsurface(child, parent);
+    QTRY_VERIFY(childPrivate->isSubsurface());
+
+    auto *syncobjSurface = wp_linux_drm_syncobj_manager_v1_get_surface(client.syncobjManager, child);
+    auto *acquireTimeline = importTimeline(&client);
+    auto *releaseTimeline = importTimeline(&client);
+    QTRY_COMPARE(compositor.backend.timelines().size(), 2);
+    auto acquire = compositor.backend.timelines().at(0);
+
+    const QSize size(32, 32);
+    ShmBuffer parentBuffer(size, client.shm);
+    ShmBuffer childBuffer(size, client.shm);
+
+    wl_surface_attach(child, childBuffer.handle, 0, 0);
+    wl_surface_damage(child, 0, 0, size.width(), size.height());
+    wp_linux_drm_syncobj_surface_v1_set_acquire_point(syncobjSurface, acquireTimeline, 0, 1);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 1);
+    wl_surface_commit(child);
+    QTRY_VERIFY(childPrivate->hasCachedState);
+
+    // The parent waits for the buffer of the child, the tree is updated at once
+    wl_surface_attach(parent, parentBuffer.handle, 0, 0);
+    wl_surface_damage(parent, 0, 0, size.width(), size.height());
+    wl_surface_commit(parent);
+    QTRY_VERIFY(WaylandSurfacePrivate::get(waylandParent)->hasCachedState);
+    QTest::qWait(50);
+    QVERIFY(!waylandParent->hasContent());
+    QVERIFY(!waylandChild->hasContent());
+
+    acquire->signal(1);
+    QTRY_VERIFY(waylandParent->hasContent());
+    QVERIFY(waylandChild->hasContent());
+    QVERIFY(!childPrivate->hasCachedState);
+
+    wp_linux_drm_syncobj_surface_v1_destroy(syncobjSurface);
+    wp_linux_drm_syncobj_timeline_v1_destroy(acquireTimeline);
+    wp_linux_drm_syncobj_timeline_v1_destroy(releaseTimeline);
+    wl_subsurface_destroy(subsurface);
+    wl_surface_destroy(child);
+    wl_surface_destroy(parent);
+    QCOMPARE(client.error, 0);
+}
+
+void tst_WaylandCompositor::linuxDrmSyncobjNoAcquirePointError()
+{
+    SyncobjCompositor compositor;
+    compositor.create();
+    MockClient client;
+    QTRY_VERIFY(client.syncobjManager);
+
+    wl_surface *surface = client.createSurface();
+    auto *syncobjSurface = wp_linux_drm_syncobj_manager_v1_get_surface(client.syncobjManager, surface);
+    auto *releaseTimeline = importTimeline(&client);
+
+    const QSize bufferSize(64, 64);
+    ShmBuffer buffer(bufferSize, client.shm);
+    wl_surface_attach(surface, buffer.handle, 0, 0);
+    wp_linux_drm_syncobj_surface_v1_set_release_point(syncobjSurface, releaseTimeline, 0, 1);
+    wl_surface_commit(surface);
+
+    QTRY_COMPARE(client.error, EPROTO);
+    QCOMPARE(client.protocolError.interface, &wp_linux_drm_syncobj_surface_v1_interface);
+    QCOMPARE(static_cast<wp_linux_drm_syncobj_surface_v1_error>(client.protocolError.code),
+             WP_LINUX_DRM_SYNCOBJ_SURFACE_V1_ERROR_NO_ACQUIRE_POINT);
+}
+
 } // namespace Compositor
 
 } // namespace Aurora
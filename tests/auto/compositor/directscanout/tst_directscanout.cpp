@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/aurorawaylandquickdirectscanout_p.h>
+
+Q_DECLARE_METATYPE(Aurora::Compositor::Internal::DirectScanout::Candidate)
+
+namespace Aurora {
+
+namespace Compositor {
+
+using Internal::DirectScanout;
+using Internal::ScanoutHint;
+
+// DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888 and DRM_FORMAT_NV12 from drm_fourcc.h
+static const quint32 DrmFormatXrgb8888 = 0x34325258;
+static const quint32 DrmFormatArgb8888 = 0x34325241;
+static const quint32 DrmFormatNv12 = 0x3231564e;
+
+// DRM_FORMAT_MOD_INVALID, DRM_FORMAT_MOD_LINEAR and I915_FORMAT_MOD_X_TILED
+static const quint64 DrmFormatModInvalid = 0x00ffffffffffffffULL;
+static const quint64 DrmFormatModLinear = 0;
+static const quint64 DrmFormatModXTiled = 0x0100000000000001ULL;
+
+static const QSize OutputSize(1920, 1080);
+
+class tst_DirectScanout : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void isEligible_data();
+    void isEligible();
+};
+
+void tst_DirectScanout::isEligible_data()
+{
+    QTest::addColumn<DirectScanout::Candidate>("candidate");
+    QTest::addColumn<bool>("eligible");
+
+    // An opaque buffer filling the output as is, in a format of the plane
+    DirectScanout::Candidate fullscreen;
+    fullscreen.bufferSize = OutputSize;
+    fullscreen.opaque = true;
+    fullscreen.drmFormat = DrmFormatXrgb8888;
+    fullscreen.modifier = DrmFormatModXTiled;
+    fullscreen.rect = QRectF(QPointF(0, 0), QSizeF(OutputSize));
+    QTest::newRow("fullscreen") << fullscreen << true;
+
+    DirectScanout::Candidate c = fullscreen;
+    c.rect = QRectF(0, 0, 1280, 720);
+    c.bufferSize = QSize(1280, 720);
+    QTest::newRow("smaller than the output") << c << false;
+
+    c = fullscreen;
+    c.rect = QRectF(0, 0, 960, 540);
+    c.transform = QTransform::fromScale(2, 2);
+    c.bufferSize = QSize(960, 540);
+    QTest::newRow("scaled to the output") << c << false;
+
+    // Device pixel ratio of 2 with a buffer of the output size
+    c = fullscreen;
+    c.rect = QRectF(0, 0, 960, 540);
+    c.transform = QTransform::fromScale(2, 2);
+    c.bufferSize = OutputSize;
+    QTest::newRow("high dpi") << c << true;
+
+    c = fullscreen;
+    c.transform = QTransform::fromTranslate(10, 0);
+    QTest::newRow("moved") << c << false;
+
+    c = fullscreen;
+    c.opaque = false;
+    QTest::newRow("translucent") << c << false;
+
+    c = fullscreen;
+    c.origin = WaylandSurface::OriginBottomLeft;
+    QTest::newRow("upside down") << c << false;
+
+    c = fullscreen;
+    c.contentOrientation = Qt::InvertedLandscapeOrientation;
+    QTest::newRow("buffer transform") << c << false;
+
+    c = fullscreen;
+    c.transform = QTransform::fromScale(-1, 1).translate(-OutputSize.width(), 0);
+    QTest::newRow("mirrored") << c << false;
+
+    c = fullscreen;
+    c.transform.rotate(90);
+    QTest::newRow("rotated") << c << false;
+
+    c = fullscreen;
+    c.drmFormat = DrmFormatNv12;
+    QTest::newRow("format not on the plane") << c << false;
+
+    c = fullscreen;
+    c.modifier = DrmFormatModLinear;
+    QTest::newRow("modifier not on the plane") << c << false;
+
+    // ARGB8888 has no modifiers, only implicit and linear layouts
+    c = fullscreen;
+    c.drmFormat = DrmFormatArgb8888;
+    c.modifier = DrmFormatModInvalid;
+    QTest::newRow("implicit layout") << c << true;
+    c.modifier = DrmFormatModLinear;
+    QTest::newRow("linear layout") << c << true;
+    c.modifier = DrmFormatModXTiled;
+    QTest::newRow("tiled without modifiers") << c << false;
+}
+
+void tst_DirectScanout::isEligible()
+{
+    QFETCH(DirectScanout::Candidate, candidate);
+    QFETCH(bool, eligible);
+
+    ScanoutHint hint;
+    hint.device = 1;
+    hint.formats.insert(DrmFormatXrgb8888, { DrmFormatModInvalid, DrmFormatModXTiled });
+    hint.formats.insert(DrmFormatArgb8888, {});
+
+    QCOMPARE(DirectScanout::isEligible(candidate, OutputSize, hint), eligible);
+
+    // Nothing can be scanned out without the formats of the plane
+    QVERIFY(!DirectScanout::isEligible(candidate, OutputSize, ScanoutHint()));
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_directscanout.moc>
+QTEST_MAIN(Aurora::Compositor::tst_DirectScanout);
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtQuick/QQuickWindow>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandQuickOutput>
+#include <LiriAuroraCompositor/private/aurorawaylandquickhardwarecursor_p.h>
+#include <LiriAuroraPlatformHeaders/lirieglfsfunctions.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+using Aurora::PlatformSupport::CursorPresentationEvent;
+using Internal::HardwareCursor;
+
+class tst_HardwareCursor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void presentation();
+
+private:
+    static QList<int> flips(const HardwareCursor &cursor);
+
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_HardwareCursor::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+QList<int> tst_HardwareCursor::flips(const HardwareCursor &cursor)
+{
+    QList<int> result;
+    for (const HardwareCursor::SubmittedBuffer &submitted : cursor.m_buffers)
+        result.append(submitted.flips);
+    return result;
+}
+
+// Cursor flips are delivered to the cursor of the output, buffers are
+// released once a newer one was presented
+void tst_HardwareCursor::presentation()
+{
+    WaylandCompositor compositor;
+    compositor.create();
+
+    QQuickWindow window;
+    WaylandQuickOutput output(&compositor, &window);
+    HardwareCursor cursor(&output);
+
+    cursor.m_buffers.append(HardwareCursor::SubmittedBuffer());
+    cursor.m_buffers.append(HardwareCursor::SubmittedBuffer());
+
+    CursorPresentationEvent event;
+    event.screen = window.screen();
+    QVERIFY(QCoreApplication::sendEvent(&cursor, &event));
+    QCOMPARE(flips(cursor), QList<int>({ 1, 1 }));
+
+    // Events are not filtered from the whole application
+    CursorPresentationEvent appEvent;
+    appEvent.screen = window.screen();
+    QCoreApplication::sendEvent(QCoreApplication::instance(), &appEvent);
+    QCOMPARE(flips(cursor), QList<int>({ 1, 1 }));
+
+    // Flips of other screens don't count
+    CursorPresentationEvent otherEvent;
+    QCoreApplication::sendEvent(&cursor, &otherEvent);
+    QCOMPARE(flips(cursor), QList<int>({ 1, 1 }));
+
+    // The newer buffer was presented twice, the older one is not on screen
+    QCoreApplication::sendEvent(&cursor, &event);
+    QCOMPARE(flips(cursor), QList<int>({ 2 }));
+
+    // The buffer on screen is kept
+    auto *postedEvent = new CursorPresentationEvent();
+    postedEvent->screen = window.screen();
+    QCoreApplication::postEvent(&cursor, postedEvent);
+    QCoreApplication::sendPostedEvents(&cursor);
+    QCOMPARE(flips(cursor), QList<int>({ 3 }));
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_hardwarecursor.moc>
+QTEST_MAIN(Aurora::Compositor::tst_HardwareCursor);
@@ -0,0 +1,188 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtQuick/QQuickWindow>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandClient>
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandQuickItem>
+#include <LiriAuroraCompositor/WaylandSurface>
+#include <LiriAuroraCompositor/private/aurorawaylandquickhardwarelayer_p.h>
+
+#include "kmslayerintegration.h"
+
+#include <wayland-server-core.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class tst_KmsLayerIntegration : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void isCandidate();
+    void assignPlanes();
+
+private:
+    WaylandClient *createClient(WaylandCompositor *compositor);
+
+    QTemporaryDir m_tmpRuntimeDir;
+    int m_clientFd = -1;
+};
+
+void tst_KmsLayerIntegration::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_KmsLayerIntegration::cleanup()
+{
+    if (m_clientFd >= 0)
+        ::close(m_clientFd);
+    m_clientFd = -1;
+}
+
+// Surfaces only need a client on the server side, nothing is committed to them
+WaylandClient *tst_KmsLayerIntegration::createClient(WaylandCompositor *compositor)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return nullptr;
+
+    // The server end is closed with the client
+    m_clientFd = fds[1];
+    wl_client *client = wl_client_create(compositor->display(), fds[0]);
+    return client ? WaylandClient::fromWlClient(compositor, client) : nullptr;
+}
+
+void tst_KmsLayerIntegration::isCandidate()
+{
+    WaylandCompositor compositor;
+    compositor.create();
+
+    QQuickItem root;
+    WaylandQuickItem item;
+    item.setParentItem(&root);
+    item.setSize(QSizeF(64, 64));
+
+    WaylandQuickHardwareLayer layer(&item);
+    layer.classBegin();
+
+    KmsLayerIntegration integration;
+    integration.add(&layer);
+    QCOMPARE(integration.m_layers.size(), 1);
+    auto *entry = integration.m_layers.first();
+
+    // Nothing to put on a plane
+    QVERIFY(!integration.isCandidate(entry));
+
+    WaylandClient *client = createClient(&compositor);
+    QVERIFY(client);
+    item.setSurface(new WaylandSurface(&compositor, client, 0, 4));
+    QVERIFY(integration.isCandidate(entry));
+
+    // Layers below the scene are composited
+    layer.setStackingLevel(-1);
+    QVERIFY(!integration.isCandidate(entry));
+    layer.setStackingLevel(1);
+    QVERIFY(integration.isCandidate(entry));
+
+    // Planes can't blend or hide the content
+    root.setOpacity(0.5);
+    QVERIFY(!integration.isCandidate(entry));
+    root.setOpacity(1);
+    root.setVisible(false);
+    QVERIFY(!integration.isCandidate(entry));
+    root.setVisible(true);
+
+    // Translation and scaling map to a plane, rotation and mirroring don't
+    root.setPosition(QPointF(10, 20));
+    item.setScale(2);
+    QVERIFY(integration.isCandidate(entry));
+    item.setScale(-1);
+    QVERIFY(!integration.isCandidate(entry));
+    item.setScale(1);
+    item.setRotation(90);
+    QVERIFY(!integration.isCandidate(entry));
+
+    integration.remove(&layer);
+    QVERIFY(integration.m_layers.isEmpty());
+}
+
+void tst_KmsLayerIntegration::assignPlanes()
+{
+    WaylandCompositor compositor;
+    compositor.create();
+
+    WaylandClient *client = createClient(&compositor);
+    QVERIFY(client);
+
+    QQuickWindow window;
+    QQuickWindow otherWindow;
+    if (!window.screen())
+        QSKIP("No screen available");
+
+    WaylandQuickItem item;
+    item.setParentItem(window.contentItem());
+    item.setSize(QSizeF(64, 64));
+    item.setSurface(new WaylandSurface(&compositor, client, 0, 4));
+
+    WaylandQuickItem otherItem;
+    otherItem.setParentItem(otherWindow.contentItem());
+    otherItem.setSize(QSizeF(64, 64));
+    otherItem.setSurface(new WaylandSurface(&compositor, client, 0, 4));
+
+    WaylandQuickHardwareLayer layer(&item);
+    layer.classBegin();
+    WaylandQuickHardwareLayer otherLayer(&otherItem);
+    otherLayer.classBegin();
+
+    KmsLayerIntegration integration;
+    integration.add(&layer);
+    integration.add(&otherLayer);
+    integration.watchWindow(&window);
+    integration.watchWindow(&window);
+    QCOMPARE(integration.m_windows.size(), 1);
+
+    auto *entry = integration.m_layers.at(0);
+    auto *otherEntry = integration.m_layers.at(1);
+    QVERIFY(integration.isCandidate(entry));
+
+    // Without a buffer the layer stays composited and the buffers
+    // of the previous frames are let go, one per frame
+    for (int frame = 1; frame <= KmsLayerIntegration::HeldBuffers + 1; ++frame) {
+        integration.assignPlanes(&window);
+        QVERIFY(!entry->onPlane);
+        QVERIFY(item.isPaintEnabled());
+        QCOMPARE(entry->nextBuffer, frame % KmsLayerIntegration::HeldBuffers);
+        QVERIFY(!integration.m_windows.first().hasPlanes);
+    }
+
+    // Layers of other windows are left alone
+    QCOMPARE(otherEntry->nextBuffer, 0);
+    QVERIFY(otherItem.isPaintEnabled());
+
+    // Windows that are not watched are ignored
+    integration.assignPlanes(&otherWindow);
+    QCOMPARE(otherEntry->nextBuffer, 0);
+
+    integration.remove(&otherLayer);
+    integration.remove(&layer);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_kmslayers.moc>
+QTEST_MAIN(Aurora::Compositor::tst_KmsLayerIntegration);
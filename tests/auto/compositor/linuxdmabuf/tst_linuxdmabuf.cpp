@@ -0,0 +1,536 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandSurface>
+#include <LiriAuroraCompositor/private/aurorawaylandsurface_p.h>
+#include <LiriAuroraCompositor/private/aurorawltextureorphanage_p.h>
+
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtOpenGL/QOpenGLTexture>
+
+#include "linuxdmabuf.h"
+#include "linuxdmabufclientbufferintegration.h"
+
+#include "wayland-wayland-client-protocol.h"
+
+#include <wayland-client-core.h>
+#include <wayland-server-core.h>
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+// Only the server side of linux-dmabuf is generated for the test, because
+// the client side would define the same interfaces: the client sends
+// requests and listens to events with the opcodes from the protocol
+enum {
+    GetDefaultFeedbackRequest = 2,
+    GetSurfaceFeedbackRequest = 3
+};
+
+enum {
+    FeedbackDestroyRequest = 0
+};
+
+struct FeedbackListener
+{
+    void (*done)(void *data, wl_proxy *feedback);
+    void (*formatTable)(void *data, wl_proxy *feedback, int32_t fd, uint32_t size);
+    void (*mainDevice)(void *data, wl_proxy *feedback, wl_array *device);
+    void (*trancheDone)(void *data, wl_proxy *feedback);
+    void (*trancheTargetDevice)(void *data, wl_proxy *feedback, wl_array *device);
+    void (*trancheFormats)(void *data, wl_proxy *feedback, wl_array *indices);
+    void (*trancheFlags)(void *data, wl_proxy *feedback, uint32_t flags);
+};
+
+struct Tranche
+{
+    dev_t device = 0;
+    QList<uint16_t> indices;
+    uint32_t flags = 0;
+};
+
+struct ClientFeedback
+{
+    ~ClientFeedback()
+    {
+        reset();
+        if (proxy)
+            wl_proxy_marshal_flags(proxy, FeedbackDestroyRequest, nullptr,
+                                   wl_proxy_get_version(proxy), WL_MARSHAL_FLAG_DESTROY);
+    }
+
+    void reset()
+    {
+        if (tableFd != -1)
+            ::close(tableFd);
+        tableFd = -1;
+        tableSize = 0;
+        mainDevice = 0;
+        tranches.clear();
+        pending = Tranche();
+    }
+
+    wl_proxy *proxy = nullptr;
+    int tableFd = -1;
+    uint32_t tableSize = 0;
+    dev_t mainDevice = 0;
+    QList<Tranche> tranches;
+    Tranche pending;
+    int doneCount = 0;
+};
+
+struct TableEntry
+{
+    uint32_t format;
+    uint32_t padding;
+    uint64_t modifier;
+};
+
+using FormatModifier = QPair<uint32_t, uint64_t>;
+
+class tst_LinuxDmabuf : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void defaultFeedback();
+    void surfaceFeedback();
+    void textureCache();
+
+private:
+    void setupGlobal(LinuxDmabuf *linuxDmabuf);
+    bool connectClient(WaylandCompositor *compositor);
+    void roundtrip(WaylandCompositor *compositor);
+    void getFeedback(ClientFeedback *feedback, wl_surface *surface = nullptr);
+    QList<TableEntry> readFormatTable(const ClientFeedback &feedback);
+
+    static dev_t deviceFromArray(wl_array *array);
+    static void bindNoImage(GLenum target, GLeglImageOES image);
+
+    static void handleGlobal(void *data, wl_registry *registry, uint32_t id,
+                             const char *interface, uint32_t version);
+    static void handleGlobalRemove(void *data, wl_registry *registry, uint32_t id);
+    static void handleSyncDone(void *data, wl_callback *callback, uint32_t serial);
+    static void handleDone(void *data, wl_proxy *feedback);
+    static void handleFormatTable(void *data, wl_proxy *feedback, int32_t fd, uint32_t size);
+    static void handleMainDevice(void *data, wl_proxy *feedback, wl_array *device);
+    static void handleTrancheDone(void *data, wl_proxy *feedback);
+    static void handleTrancheTargetDevice(void *data, wl_proxy *feedback, wl_array *device);
+    static void handleTrancheFormats(void *data, wl_proxy *feedback, wl_array *indices);
+    static void handleTrancheFlags(void *data, wl_proxy *feedback, uint32_t flags);
+
+    static const wl_registry_listener s_registryListener;
+    static const wl_callback_listener s_syncListener;
+    static const FeedbackListener s_feedbackListener;
+
+    QTemporaryDir m_tmpRuntimeDir;
+    wl_display *m_display = nullptr;
+    wl_registry *m_registry = nullptr;
+    wl_compositor *m_compositor = nullptr;
+    wl_proxy *m_dmabuf = nullptr;
+};
+
+const wl_registry_listener tst_LinuxDmabuf::s_registryListener = {
+    tst_LinuxDmabuf::handleGlobal,
+    tst_LinuxDmabuf::handleGlobalRemove
+};
+
+const wl_callback_listener tst_LinuxDmabuf::s_syncListener = {
+    tst_LinuxDmabuf::handleSyncDone
+};
+
+const FeedbackListener tst_LinuxDmabuf::s_feedbackListener = {
+    tst_LinuxDmabuf::handleDone,
+    tst_LinuxDmabuf::handleFormatTable,
+    tst_LinuxDmabuf::handleMainDevice,
+    tst_LinuxDmabuf::handleTrancheDone,
+    tst_LinuxDmabuf::handleTrancheTargetDevice,
+    tst_LinuxDmabuf::handleTrancheFormats,
+    tst_LinuxDmabuf::handleTrancheFlags
+};
+
+static const dev_t s_mainDevice = makedev(226, 128);
+static const dev_t s_scanoutDevice = makedev(226, 0);
+
+void tst_LinuxDmabuf::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_LinuxDmabuf::cleanup()
+{
+    if (m_dmabuf)
+        wl_proxy_destroy(m_dmabuf);
+    if (m_compositor)
+        wl_compositor_destroy(m_compositor);
+    if (m_registry)
+        wl_registry_destroy(m_registry);
+    if (m_display)
+        wl_display_disconnect(m_display);
+    m_dmabuf = nullptr;
+    m_compositor = nullptr;
+    m_registry = nullptr;
+    m_display = nullptr;
+}
+
+void tst_LinuxDmabuf::handleGlobal(void *data, wl_registry *registry, uint32_t id,
+                                   const char *interface, uint32_t version)
+{
+    auto *self = static_cast<tst_LinuxDmabuf *>(data);
+
+    if (strcmp(interface, wl_compositor_interface.name) == 0)
+        self->m_compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+    else if (strcmp(interface, zwp_linux_dmabuf_v1_interface.name) == 0 && version >= 4)
+        self->m_dmabuf = static_cast<wl_proxy *>(wl_registry_bind(registry, id, &zwp_linux_dmabuf_v1_interface, 4));
+}
+
+void tst_LinuxDmabuf::handleGlobalRemove(void *data, wl_registry *registry, uint32_t id)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(registry);
+    Q_UNUSED(id);
+}
+
+void tst_LinuxDmabuf::handleSyncDone(void *data, wl_callback *callback, uint32_t serial)
+{
+    Q_UNUSED(serial);
+
+    *static_cast<bool *>(data) = true;
+    wl_callback_destroy(callback);
+}
+
+void tst_LinuxDmabuf::handleDone(void *data, wl_proxy *feedback)
+{
+    Q_UNUSED(feedback);
+
+    static_cast<ClientFeedback *>(data)->doneCount++;
+}
+
+void tst_LinuxDmabuf::handleFormatTable(void *data, wl_proxy *feedback, int32_t fd, uint32_t size)
+{
+    Q_UNUSED(feedback);
+
+    auto *clientFeedback = static_cast<ClientFeedback *>(data);
+    if (clientFeedback->tableFd != -1)
+        ::close(clientFeedback->tableFd);
+    clientFeedback->tableFd = fd;
+    clientFeedback->tableSize = size;
+}
+
+void tst_LinuxDmabuf::handleMainDevice(void *data, wl_proxy *feedback, wl_array *device)
+{
+    Q_UNUSED(feedback);
+
+    static_cast<ClientFeedback *>(data)->mainDevice = deviceFromArray(device);
+}
+
+void tst_LinuxDmabuf::handleTrancheDone(void *data, wl_proxy *feedback)
+{
+    Q_UNUSED(feedback);
+
+    auto *clientFeedback = static_cast<ClientFeedback *>(data);
+    clientFeedback->tranches.append(clientFeedback->pending);
+    clientFeedback->pending = Tranche();
+}
+
+void tst_LinuxDmabuf::handleTrancheTargetDevice(void *data, wl_proxy *feedback, wl_array *device)
+{
+    Q_UNUSED(feedback);
+
+    static_cast<ClientFeedback *>(data)->pending.device = deviceFromArray(device);
+}
+
+void tst_LinuxDmabuf::handleTrancheFormats(void *data, wl_proxy *feedback, wl_array *indices)
+{
+    Q_UNUSED(feedback);
+
+    auto *clientFeedback = static_cast<ClientFeedback *>(data);
+    const auto *index = static_cast<const uint16_t *>(indices->data);
+    for (size_t i = 0; i < indices->size / sizeof(uint16_t); ++i)
+        clientFeedback->pending.indices.append(index[i]);
+}
+
+void tst_LinuxDmabuf::handleTrancheFlags(void *data, wl_proxy *feedback, uint32_t flags)
+{
+    Q_UNUSED(feedback);
+
+    static_cast<ClientFeedback *>(data)->pending.flags = flags;
+}
+
+dev_t tst_LinuxDmabuf::deviceFromArray(wl_array *array)
+{
+    dev_t device = 0;
+    if (array->size == sizeof(device))
+        memcpy(&device, array->data, sizeof(device));
+    return device;
+}
+
+void tst_LinuxDmabuf::bindNoImage(GLenum target, GLeglImageOES image)
+{
+    Q_UNUSED(target);
+    Q_UNUSED(image);
+}
+
+// Formats without modifiers are sent with DRM_FORMAT_MOD_INVALID
+void tst_LinuxDmabuf::setupGlobal(LinuxDmabuf *linuxDmabuf)
+{
+    linuxDmabuf->setMainDevice(s_mainDevice);
+    linuxDmabuf->setSupportedModifiers({
+        { DRM_FORMAT_XRGB8888, { DRM_FORMAT_MOD_LINEAR, I915_FORMAT_MOD_X_TILED } },
+        { DRM_FORMAT_ARGB8888, {} },
+    });
+}
+
+// The client lives in the same thread, its end of the socket is read by hand
+bool tst_LinuxDmabuf::connectClient(WaylandCompositor *compositor)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return false;
+
+    if (!wl_client_create(compositor->display(), fds[0])) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+
+    m_display = wl_display_connect_to_fd(fds[1]);
+    if (!m_display)
+        return false;
+
+    m_registry = wl_display_get_registry(m_display);
+    wl_registry_add_listener(m_registry, &s_registryListener, this);
+    roundtrip(compositor);
+    return m_compositor && m_dmabuf;
+}
+
+void tst_LinuxDmabuf::roundtrip(WaylandCompositor *compositor)
+{
+    bool done = false;
+    wl_callback *callback = wl_display_sync(m_display);
+    wl_callback_add_listener(callback, &s_syncListener, &done);
+
+    for (int i = 0; i < 100 && !done; ++i) {
+        wl_display_flush(m_display);
+        compositor->processWaylandEvents();
+
+        if (wl_display_prepare_read(m_display) == 0) {
+            pollfd pfd = { wl_display_get_fd(m_display), POLLIN, 0 };
+            if (::poll(&pfd, 1, 10) > 0)
+                wl_display_read_events(m_display);
+            else
+                wl_display_cancel_read(m_display);
+        }
+        wl_display_dispatch_pending(m_display);
+    }
+
+    QVERIFY(done);
+}
+
+void tst_LinuxDmabuf::getFeedback(ClientFeedback *feedback, wl_surface *surface)
+{
+    const uint32_t version = wl_proxy_get_version(m_dmabuf);
+    if (surface) {
+        feedback->proxy = wl_proxy_marshal_flags(m_dmabuf, GetSurfaceFeedbackRequest,
+                                                 &zwp_linux_dmabuf_feedback_v1_interface, version, 0,
+                                                 nullptr, surface);
+    } else {
+        feedback->proxy = wl_proxy_marshal_flags(m_dmabuf, GetDefaultFeedbackRequest,
+                                                 &zwp_linux_dmabuf_feedback_v1_interface, version, 0,
+                                                 nullptr);
+    }
+    wl_proxy_add_listener(feedback->proxy, reinterpret_cast<void (**)(void)>(const_cast<FeedbackListener *>(&s_feedbackListener)),
+                          feedback);
+}
+
+QList<TableEntry> tst_LinuxDmabuf::readFormatTable(const ClientFeedback &feedback)
+{
+    QList<TableEntry> entries;
+    if (feedback.tableFd == -1 || feedback.tableSize % sizeof(TableEntry) != 0)
+        return entries;
+
+    void *data = ::mmap(nullptr, feedback.tableSize, PROT_READ, MAP_PRIVATE, feedback.tableFd, 0);
+    if (data == MAP_FAILED)
+        return entries;
+
+    const auto *entry = static_cast<const TableEntry *>(data);
+    for (size_t i = 0; i < feedback.tableSize / sizeof(TableEntry); ++i)
+        entries.append(entry[i]);
+
+    ::munmap(data, feedback.tableSize);
+    return entries;
+}
+
+void tst_LinuxDmabuf::defaultFeedback()
+{
+    WaylandCompositor compositor;
+    compositor.create();
+
+    LinuxDmabuf linuxDmabuf(compositor.display(), 4, nullptr);
+    setupGlobal(&linuxDmabuf);
+    QVERIFY(connectClient(&compositor));
+
+    ClientFeedback feedback;
+    getFeedback(&feedback);
+    roundtrip(&compositor);
+    QCOMPARE(feedback.doneCount, 1);
+    QCOMPARE(feedback.mainDevice, s_mainDevice);
+
+    // Clients can map the table but nobody can change it
+    QVERIFY(feedback.tableFd != -1);
+    const int seals = ::fcntl(feedback.tableFd, F_GET_SEALS);
+    QCOMPARE(seals, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+    QCOMPARE(::mmap(nullptr, feedback.tableSize, PROT_READ | PROT_WRITE, MAP_SHARED, feedback.tableFd, 0),
+             MAP_FAILED);
+
+    const QList<TableEntry> table = readFormatTable(feedback);
+    QCOMPARE(table.size(), 3);
+    QSet<FormatModifier> pairs;
+    for (const TableEntry &entry : table)
+        pairs.insert(FormatModifier(entry.format, entry.modifier));
+    const QSet<FormatModifier> expectedPairs = {
+        FormatModifier(DRM_FORMAT_XRGB8888, DRM_FORMAT_MOD_LINEAR),
+        FormatModifier(DRM_FORMAT_XRGB8888, I915_FORMAT_MOD_X_TILED),
+        FormatModifier(DRM_FORMAT_ARGB8888, DRM_FORMAT_MOD_INVALID),
+    };
+    QCOMPARE(pairs, expectedPairs);
+
+    // A single tranche for the main device with the whole table
+    QCOMPARE(feedback.tranches.size(), 1);
+    const Tranche &tranche = feedback.tranches.at(0);
+    QCOMPARE(tranche.device, s_mainDevice);
+    QCOMPARE(tranche.flags, 0u);
+    QCOMPARE(tranche.indices, QList<uint16_t>({ 0, 1, 2 }));
+}
+
+void tst_LinuxDmabuf::surfaceFeedback()
+{
+    WaylandCompositor compositor;
+    compositor.create();
+
+    LinuxDmabuf linuxDmabuf(compositor.display(), 4, nullptr);
+    setupGlobal(&linuxDmabuf);
+
+    WaylandSurface *waylandSurface = nullptr;
+    connect(&compositor, &WaylandCompositor::surfaceCreated, this, [&waylandSurface](WaylandSurface *surface) {
+        waylandSurface = surface;
+    });
+
+    QVERIFY(connectClient(&compositor));
+    wl_surface *surface = wl_compositor_create_surface(m_compositor);
+    roundtrip(&compositor);
+    QVERIFY(waylandSurface);
+
+    // An overlay plane scans out linear XRGB8888 buffers
+    Internal::ScanoutHint hint;
+    hint.device = s_scanoutDevice;
+    hint.formats.insert(DRM_FORMAT_XRGB8888, {});
+    WaylandSurfacePrivate::get(waylandSurface)->setScanoutHint(Internal::ScanoutHint::OverlayPlane, hint);
+
+    ClientFeedback feedback;
+    getFeedback(&feedback, surface);
+    roundtrip(&compositor);
+    QCOMPARE(feedback.doneCount, 1);
+    QCOMPARE(feedback.mainDevice, s_mainDevice);
+
+    const QList<TableEntry> table = readFormatTable(feedback);
+    QCOMPARE(table.size(), 3);
+
+    // The scanout tranche comes first, with the entries the plane supports
+    QCOMPARE(feedback.tranches.size(), 2);
+    const Tranche &scanoutTranche = feedback.tranches.at(0);
+    QCOMPARE(scanoutTranche.device, s_scanoutDevice);
+    QCOMPARE(scanoutTranche.flags, uint32_t(ZWP_LINUX_DMABUF_FEEDBACK_V1_TRANCHE_FLAGS_SCANOUT));
+    QCOMPARE(scanoutTranche.indices.size(), 1);
+    const TableEntry &entry = table.at(scanoutTranche.indices.at(0));
+    QCOMPARE(entry.format, uint32_t(DRM_FORMAT_XRGB8888));
+    QCOMPARE(entry.modifier, uint64_t(DRM_FORMAT_MOD_LINEAR));
+
+    const Tranche &defaultTranche = feedback.tranches.at(1);
+    QCOMPARE(defaultTranche.device, s_mainDevice);
+    QCOMPARE(defaultTranche.flags, 0u);
+    QCOMPARE(defaultTranche.indices, QList<uint16_t>({ 0, 1, 2 }));
+
+    // Feedback is sent again without the scanout tranche when the hint goes away
+    feedback.reset();
+    WaylandSurfacePrivate::get(waylandSurface)->setScanoutHint(Internal::ScanoutHint::OverlayPlane, Internal::ScanoutHint());
+    linuxDmabuf.sendSurfaceFeedback(waylandSurface);
+    roundtrip(&compositor);
+    QCOMPARE(feedback.doneCount, 2);
+    QCOMPARE(feedback.tranches.size(), 1);
+    QCOMPARE(feedback.tranches.at(0).device, s_mainDevice);
+
+    wl_surface_destroy(surface);
+}
+
+// Textures of an imported buffer are created on the first commit and
+// reused as long as the buffer lives
+void tst_LinuxDmabuf::textureCache()
+{
+    QOffscreenSurface surface;
+    surface.create();
+    QOpenGLContext context;
+    if (!context.create() || !context.makeCurrent(&surface))
+        QSKIP("OpenGL is not available");
+
+    WaylandCompositor compositor;
+    compositor.create();
+
+    int fds[2];
+    QCOMPARE(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds), 0);
+    wl_client *client = wl_client_create(compositor.display(), fds[0]);
+    QVERIFY(client);
+
+    // No EGLImage is bound, only the cache is under test
+    LinuxDmabufClientBufferIntegration integration;
+    integration.gl_egl_image_target_texture_2d = bindNoImage;
+
+    auto *dmabufBuffer = new LinuxDmabufWlBuffer(client, &integration);
+    wl_resource *resource = dmabufBuffer->resource()->handle;
+    integration.m_importedBuffers.insert(resource, dmabufBuffer);
+
+    QScopedPointer<Internal::ClientBuffer> buffer(integration.createBufferFor(resource));
+    QVERIFY(buffer);
+    buffer->setCommitSerial(QSharedPointer<Internal::BufferUploadStatistics>::create(), 1);
+
+    QOpenGLTexture *texture = buffer->toOpenGlTexture(0);
+    QVERIFY(texture);
+    QCOMPARE(buffer->uploadStatistics()->importMisses.loadRelaxed(), quint64(1));
+    QCOMPARE(buffer->uploadStatistics()->importHits.loadRelaxed(), quint64(0));
+
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(buffer->toOpenGlTexture(0), texture);
+    QCOMPARE(buffer->uploadStatistics()->importMisses.loadRelaxed(), quint64(1));
+    QCOMPARE(buffer->uploadStatistics()->importHits.loadRelaxed(), quint64(3));
+
+    // Destroying the client destroys the buffer and orphans its texture
+    buffer.reset();
+    wl_client_destroy(client);
+    ::close(fds[1]);
+    QVERIFY(!integration.m_importedBuffers.contains(resource));
+    Internal::WaylandTextureOrphanage::instance()->deleteTextures();
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_linuxdmabuf.moc>
+QTEST_MAIN(Aurora::Compositor::tst_LinuxDmabuf);
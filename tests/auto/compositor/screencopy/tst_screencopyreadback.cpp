@@ -0,0 +1,551 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/private/qquickitem_p.h>
+#include <QtQuick/private/qquickwindow_p.h>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandOutput>
+#include <LiriAuroraCompositor/WaylandOutputMode>
+#include <LiriAuroraCompositor/WaylandWlrScreencopyManagerV1>
+#include <LiriAuroraCompositor/private/aurorawaylandwlrscreencopyreadback_p.h>
+#include <LiriAuroraCompositor/private/aurorawaylandwlrscreencopyv1_p.h>
+
+#include "wayland-wayland-client-protocol.h"
+#include "wayland-wlr-screencopy-unstable-v1-client-protocol.h"
+
+#include <wayland-server-core.h>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+using Internal::ScreencopyReadback;
+
+// Damages the window where it is
+class ContentItem : public QQuickItem
+{
+public:
+    explicit ContentItem(QQuickItem *parent = nullptr)
+        : QQuickItem(parent)
+    {
+        setFlag(ItemHasContents);
+    }
+};
+
+struct ClientFrame
+{
+    zwlr_screencopy_frame_v1 *frame = nullptr;
+    QSize size;
+    uint32_t stride = 0;
+    QRect damage;
+    bool ready = false;
+    bool failed = false;
+};
+
+class tst_ScreencopyReadback : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void damageSince();
+    void itemDamage();
+    void shmCopy();
+
+private:
+    bool connectClient(WaylandCompositor *compositor);
+    void roundtrip(WaylandCompositor *compositor);
+    wl_buffer *createShmBuffer(const QSize &size, uint32_t stride);
+    void captureOutput(WaylandCompositor *compositor, ClientFrame *frame);
+    void finishRecording(ScreencopyReadback *readback, char value);
+
+    static void clearDirtyItems(QQuickWindow *window);
+
+    static void handleGlobal(void *data, wl_registry *registry, uint32_t id,
+                             const char *interface, uint32_t version);
+    static void handleGlobalRemove(void *data, wl_registry *registry, uint32_t id);
+    static void handleSyncDone(void *data, wl_callback *callback, uint32_t serial);
+    static void handleFrameBuffer(void *data, zwlr_screencopy_frame_v1 *frame, uint32_t format,
+                                  uint32_t width, uint32_t height, uint32_t stride);
+    static void handleFrameFlags(void *data, zwlr_screencopy_frame_v1 *frame, uint32_t flags);
+    static void handleFrameReady(void *data, zwlr_screencopy_frame_v1 *frame,
+                                 uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec);
+    static void handleFrameFailed(void *data, zwlr_screencopy_frame_v1 *frame);
+    static void handleFrameDamage(void *data, zwlr_screencopy_frame_v1 *frame,
+                                  uint32_t x, uint32_t y, uint32_t width, uint32_t height);
+    static void handleFrameLinuxDmabuf(void *data, zwlr_screencopy_frame_v1 *frame,
+                                       uint32_t format, uint32_t width, uint32_t height);
+    static void handleFrameBufferDone(void *data, zwlr_screencopy_frame_v1 *frame);
+
+    static const wl_registry_listener s_registryListener;
+    static const wl_callback_listener s_syncListener;
+    static const zwlr_screencopy_frame_v1_listener s_frameListener;
+
+    QTemporaryDir m_tmpRuntimeDir;
+    wl_display *m_display = nullptr;
+    wl_registry *m_registry = nullptr;
+    wl_shm *m_shm = nullptr;
+    wl_output *m_output = nullptr;
+    zwlr_screencopy_manager_v1 *m_manager = nullptr;
+    uchar *m_shmData = nullptr;
+    size_t m_shmSize = 0;
+};
+
+const wl_registry_listener tst_ScreencopyReadback::s_registryListener = {
+    tst_ScreencopyReadback::handleGlobal,
+    tst_ScreencopyReadback::handleGlobalRemove
+};
+
+const wl_callback_listener tst_ScreencopyReadback::s_syncListener = {
+    tst_ScreencopyReadback::handleSyncDone
+};
+
+const zwlr_screencopy_frame_v1_listener tst_ScreencopyReadback::s_frameListener = {
+    tst_ScreencopyReadback::handleFrameBuffer,
+    tst_ScreencopyReadback::handleFrameFlags,
+    tst_ScreencopyReadback::handleFrameReady,
+    tst_ScreencopyReadback::handleFrameFailed,
+    tst_ScreencopyReadback::handleFrameDamage,
+    tst_ScreencopyReadback::handleFrameLinuxDmabuf,
+    tst_ScreencopyReadback::handleFrameBufferDone
+};
+
+void tst_ScreencopyReadback::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+void tst_ScreencopyReadback::cleanup()
+{
+    if (m_shmData)
+        ::munmap(m_shmData, m_shmSize);
+    m_shmData = nullptr;
+    m_shmSize = 0;
+
+    if (m_manager)
+        zwlr_screencopy_manager_v1_destroy(m_manager);
+    if (m_output)
+        wl_output_destroy(m_output);
+    if (m_shm)
+        wl_shm_destroy(m_shm);
+    if (m_registry)
+        wl_registry_destroy(m_registry);
+    if (m_display)
+        wl_display_disconnect(m_display);
+    m_manager = nullptr;
+    m_output = nullptr;
+    m_shm = nullptr;
+    m_registry = nullptr;
+    m_display = nullptr;
+}
+
+void tst_ScreencopyReadback::handleGlobal(void *data, wl_registry *registry, uint32_t id,
+                                          const char *interface, uint32_t version)
+{
+    auto *self = static_cast<tst_ScreencopyReadback *>(data);
+
+    if (strcmp(interface, wl_shm_interface.name) == 0)
+        self->m_shm = static_cast<wl_shm *>(wl_registry_bind(registry, id, &wl_shm_interface, 1));
+    else if (strcmp(interface, wl_output_interface.name) == 0 && !self->m_output)
+        self->m_output = static_cast<wl_output *>(wl_registry_bind(registry, id, &wl_output_interface, 1));
+    else if (strcmp(interface, zwlr_screencopy_manager_v1_interface.name) == 0)
+        self->m_manager = static_cast<zwlr_screencopy_manager_v1 *>(
+                    wl_registry_bind(registry, id, &zwlr_screencopy_manager_v1_interface, qMin(version, 3u)));
+}
+
+void tst_ScreencopyReadback::handleGlobalRemove(void *data, wl_registry *registry, uint32_t id)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(registry);
+    Q_UNUSED(id);
+}
+
+void tst_ScreencopyReadback::handleSyncDone(void *data, wl_callback *callback, uint32_t serial)
+{
+    Q_UNUSED(serial);
+
+    *static_cast<bool *>(data) = true;
+    wl_callback_destroy(callback);
+}
+
+void tst_ScreencopyReadback::handleFrameBuffer(void *data, zwlr_screencopy_frame_v1 *frame, uint32_t format,
+                                               uint32_t width, uint32_t height, uint32_t stride)
+{
+    Q_UNUSED(frame);
+    Q_UNUSED(format);
+
+    auto *clientFrame = static_cast<ClientFrame *>(data);
+    clientFrame->size = QSize(int(width), int(height));
+    clientFrame->stride = stride;
+}
+
+void tst_ScreencopyReadback::handleFrameFlags(void *data, zwlr_screencopy_frame_v1 *frame, uint32_t flags)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(frame);
+    Q_UNUSED(flags);
+}
+
+void tst_ScreencopyReadback::handleFrameReady(void *data, zwlr_screencopy_frame_v1 *frame,
+                                              uint32_t tv_sec_hi, uint32_t tv_sec_lo, uint32_t tv_nsec)
+{
+    Q_UNUSED(frame);
+    Q_UNUSED(tv_sec_hi);
+    Q_UNUSED(tv_sec_lo);
+    Q_UNUSED(tv_nsec);
+
+    static_cast<ClientFrame *>(data)->ready = true;
+}
+
+void tst_ScreencopyReadback::handleFrameFailed(void *data, zwlr_screencopy_frame_v1 *frame)
+{
+    Q_UNUSED(frame);
+
+    static_cast<ClientFrame *>(data)->failed = true;
+}
+
+void tst_ScreencopyReadback::handleFrameDamage(void *data, zwlr_screencopy_frame_v1 *frame,
+                                               uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+    Q_UNUSED(frame);
+
+    static_cast<ClientFrame *>(data)->damage = QRect(int(x), int(y), int(width), int(height));
+}
+
+void tst_ScreencopyReadback::handleFrameLinuxDmabuf(void *data, zwlr_screencopy_frame_v1 *frame,
+                                                    uint32_t format, uint32_t width, uint32_t height)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(frame);
+    Q_UNUSED(format);
+    Q_UNUSED(width);
+    Q_UNUSED(height);
+}
+
+void tst_ScreencopyReadback::handleFrameBufferDone(void *data, zwlr_screencopy_frame_v1 *frame)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(frame);
+}
+
+// The client lives in the same thread, its end of the socket is read by hand
+bool tst_ScreencopyReadback::connectClient(WaylandCompositor *compositor)
+{
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0)
+        return false;
+
+    if (!wl_client_create(compositor->display(), fds[0])) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+
+    m_display = wl_display_connect_to_fd(fds[1]);
+    if (!m_display)
+        return false;
+
+    m_registry = wl_display_get_registry(m_display);
+    wl_registry_add_listener(m_registry, &s_registryListener, this);
+    roundtrip(compositor);
+    return m_shm && m_output && m_manager;
+}
+
+void tst_ScreencopyReadback::roundtrip(WaylandCompositor *compositor)
+{
+    bool done = false;
+    wl_callback *callback = wl_display_sync(m_display);
+    wl_callback_add_listener(callback, &s_syncListener, &done);
+
+    for (int i = 0; i < 100 && !done; ++i) {
+        wl_display_flush(m_display);
+        compositor->processWaylandEvents();
+
+        if (wl_display_prepare_read(m_display) == 0) {
+            pollfd pfd = { wl_display_get_fd(m_display), POLLIN, 0 };
+            if (::poll(&pfd, 1, 10) > 0)
+                wl_display_read_events(m_display);
+            else
+                wl_display_cancel_read(m_display);
+        }
+        wl_display_dispatch_pending(m_display);
+    }
+
+    QVERIFY(done);
+}
+
+wl_buffer *tst_ScreencopyReadback::createShmBuffer(const QSize &size, uint32_t stride)
+{
+    m_shmSize = size_t(stride) * size_t(size.height());
+
+    int fd = ::memfd_create("tst_screencopyreadback", MFD_CLOEXEC);
+    if (fd < 0)
+        return nullptr;
+    if (::ftruncate(fd, off_t(m_shmSize)) != 0) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    void *data = ::mmap(nullptr, m_shmSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        ::close(fd);
+        return nullptr;
+    }
+    m_shmData = static_cast<uchar *>(data);
+    memset(m_shmData, 0, m_shmSize);
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd, int32_t(m_shmSize));
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, size.width(), size.height(),
+                                                  int32_t(stride), WL_SHM_FORMAT_ABGR8888);
+    wl_shm_pool_destroy(pool);
+    ::close(fd);
+    return buffer;
+}
+
+void tst_ScreencopyReadback::captureOutput(WaylandCompositor *compositor, ClientFrame *frame)
+{
+    frame->frame = zwlr_screencopy_manager_v1_capture_output(m_manager, 0, m_output);
+    zwlr_screencopy_frame_v1_add_listener(frame->frame, &s_frameListener, frame);
+    roundtrip(compositor);
+}
+
+// Stands in for the render thread, which reads back what was rendered
+void tst_ScreencopyReadback::finishRecording(ScreencopyReadback *readback, char value)
+{
+    for (auto *job : std::as_const(readback->m_recording))
+        job->pixels.fill(value, qsizetype(job->readRect.width()) * job->readRect.height() * 4);
+
+    readback->handleFrameSwapped();
+    readback->collectAll();
+    QCoreApplication::processEvents();
+}
+
+// What synchronizing the scene graph would do
+void tst_ScreencopyReadback::clearDirtyItems(QQuickWindow *window)
+{
+    QQuickWindowPrivate *wd = QQuickWindowPrivate::get(window);
+    while (QQuickItem *item = wd->dirtyItemList) {
+        QQuickItemPrivate *d = QQuickItemPrivate::get(item);
+        d->removeFromDirtyList();
+        d->dirtyAttributes = 0;
+    }
+}
+
+void tst_ScreencopyReadback::damageSince()
+{
+    QQuickWindow window;
+    auto *readback = ScreencopyReadback::get(&window);
+    const QRect rect(0, 0, 100, 100);
+
+    // Clients that never copied get everything
+    QCOMPARE(readback->damageSince(0, rect), rect);
+
+    const QRect damage[] = { QRect(0, 0, 10, 10), QRect(20, 20, 10, 10), QRect(90, 90, 20, 20) };
+    for (const QRect &frameDamage : damage) {
+        ++readback->m_sequence;
+        readback->m_damage[readback->m_sequence % ScreencopyReadback::DamageHistorySize] = frameDamage;
+    }
+
+    // Damage of the frames since, clipped to the area
+    QCOMPARE(readback->damageSince(3, rect), QRect());
+    QCOMPARE(readback->damageSince(2, rect), QRect(90, 90, 10, 10));
+    QCOMPARE(readback->damageSince(1, rect), QRect(20, 20, 80, 80));
+    QCOMPARE(readback->damageSince(1, QRect(0, 0, 50, 50)), QRect(20, 20, 10, 10));
+
+    // Frames older than the history are copied entirely
+    readback->m_sequence += ScreencopyReadback::DamageHistorySize;
+    QCOMPARE(readback->damageSince(1, rect), rect);
+}
+
+void tst_ScreencopyReadback::itemDamage()
+{
+    QQuickWindow window;
+    if (!window.screen())
+        QSKIP("No screen available");
+    window.resize(64, 64);
+
+    const qreal dpr = window.effectiveDevicePixelRatio();
+    const QRect windowRect(0, 0, qRound(64 * dpr), qRound(64 * dpr));
+    auto toPixels = [dpr, windowRect](const QRectF &rect) {
+        return QRectF(rect.topLeft() * dpr, rect.size() * dpr).toAlignedRect() & windowRect;
+    };
+
+    ContentItem item(window.contentItem());
+    item.setPosition(QPointF(8, 8));
+    item.setSize(QSizeF(16, 16));
+
+    auto *readback = ScreencopyReadback::get(&window);
+    auto lastDamage = [readback]() {
+        return readback->m_damage[readback->m_sequence % ScreencopyReadback::DamageHistorySize];
+    };
+
+    // The first frame is damaged entirely
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), windowRect);
+    clearDirtyItems(&window);
+
+    // New content damages the item
+    item.update();
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), toPixels(QRectF(8, 8, 16, 16)));
+    clearDirtyItems(&window);
+
+    // Moving damages where it was as well
+    item.setPosition(QPointF(32, 32));
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), toPixels(QRectF(8, 8, 40, 40)));
+    clearDirtyItems(&window);
+
+    // Hidden items damage where they were
+    item.setOpacity(0);
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), toPixels(QRectF(32, 32, 16, 16)));
+    clearDirtyItems(&window);
+    item.setOpacity(1);
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), toPixels(QRectF(32, 32, 16, 16)));
+    clearDirtyItems(&window);
+
+    // Changes that are not tracked damage the whole window
+    item.setRotation(45);
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), windowRect);
+    clearDirtyItems(&window);
+
+    // So does resizing the window
+    window.resize(48, 48);
+    item.update();
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(lastDamage(), QRect(0, 0, qRound(48 * dpr), qRound(48 * dpr)));
+}
+
+void tst_ScreencopyReadback::shmCopy()
+{
+    WaylandCompositor compositor;
+    compositor.setAdditionalShmFormats({ WaylandCompositor::ShmFormat_ABGR8888 });
+
+    QQuickWindow window;
+    if (!window.screen())
+        QSKIP("No screen available");
+    if (window.devicePixelRatio() != 1)
+        QSKIP("Buffers are expected to have the size of the output");
+    window.resize(64, 64);
+
+    WaylandOutput output(&compositor, &window);
+    const WaylandOutputMode mode(QSize(64, 64), 60000);
+    output.addMode(mode, true);
+    output.setCurrentMode(mode);
+
+    WaylandWlrScreencopyManagerV1 manager(&compositor);
+    compositor.create();
+
+    // Frames are handed to the readback without waiting for a rendered frame
+    auto *readback = ScreencopyReadback::get(&window);
+    connect(&manager, &WaylandWlrScreencopyManagerV1::captureOutputRequested,
+            this, [readback](WaylandWlrScreencopyFrameV1 *frame) {
+        connect(frame, &WaylandWlrScreencopyFrameV1::ready, frame, [readback, frame]() {
+            auto *d = WaylandWlrScreencopyFrameV1Private::get(frame);
+            d->ready = false;
+            readback->queue(frame, d->buffer);
+        });
+    });
+
+    QVERIFY(connectClient(&compositor));
+
+    ContentItem item(window.contentItem());
+    item.setPosition(QPointF(8, 8));
+    item.setSize(QSizeF(16, 16));
+
+    ClientFrame first;
+    captureOutput(&compositor, &first);
+    QCOMPARE(first.size, QSize(64, 64));
+    QCOMPARE(first.stride, 64u * 4);
+
+    wl_buffer *buffer = createShmBuffer(first.size, first.stride);
+    QVERIFY(buffer);
+
+    // The first copy is complete
+    zwlr_screencopy_frame_v1_copy_with_damage(first.frame, buffer);
+    roundtrip(&compositor);
+    QCOMPARE(readback->m_queued.size(), 1);
+
+    readback->handleBeforeSynchronizing();
+    QVERIFY(readback->m_queued.isEmpty());
+    QCOMPARE(readback->m_recording.size(), 1);
+    QCOMPARE(readback->m_recording.first()->readRect, QRect(0, 0, 64, 64));
+    clearDirtyItems(&window);
+
+    finishRecording(readback, char(0xff));
+    roundtrip(&compositor);
+    QVERIFY(first.ready);
+    QVERIFY(!first.failed);
+    QCOMPARE(first.damage, QRect(0, 0, 64, 64));
+    for (size_t i = 0; i < m_shmSize; ++i)
+        QCOMPARE(m_shmData[i], uchar(0xff));
+    zwlr_screencopy_frame_v1_destroy(first.frame);
+
+    ClientFrame second;
+    captureOutput(&compositor, &second);
+
+    // Nothing changed since, the copy waits for damage
+    zwlr_screencopy_frame_v1_copy_with_damage(second.frame, buffer);
+    roundtrip(&compositor);
+    QCOMPARE(readback->m_queued.size(), 1);
+    QVERIFY(!second.ready);
+
+    // Only what changed is read and written to the buffer
+    item.update();
+    readback->handleBeforeSynchronizing();
+    QCOMPARE(readback->m_recording.size(), 1);
+    QCOMPARE(readback->m_recording.first()->readRect, QRect(8, 8, 16, 16));
+    clearDirtyItems(&window);
+
+    finishRecording(readback, char(0x80));
+    roundtrip(&compositor);
+    QVERIFY(second.ready);
+    QVERIFY(!second.failed);
+    QCOMPARE(second.damage, QRect(8, 8, 16, 16));
+    for (int y = 0; y < 64; ++y) {
+        for (int x = 0; x < 64; ++x) {
+            const bool damaged = x >= 8 && x < 24 && y >= 8 && y < 24;
+            QCOMPARE(m_shmData[y * second.stride + x * 4], damaged ? uchar(0x80) : uchar(0xff));
+        }
+    }
+    zwlr_screencopy_frame_v1_destroy(second.frame);
+
+    // Buffers destroyed before the frame is read fail it
+    ClientFrame third;
+    captureOutput(&compositor, &third);
+    zwlr_screencopy_frame_v1_copy(third.frame, buffer);
+    roundtrip(&compositor);
+    QCOMPARE(readback->m_queued.size(), 1);
+    wl_buffer_destroy(buffer);
+    roundtrip(&compositor);
+
+    readback->handleBeforeSynchronizing();
+    QCoreApplication::processEvents();
+    roundtrip(&compositor);
+    QVERIFY(third.failed);
+    QVERIFY(!third.ready);
+    zwlr_screencopy_frame_v1_destroy(third.frame);
+    roundtrip(&compositor);
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_screencopyreadback.moc>
+QTEST_MAIN(Aurora::Compositor::tst_ScreencopyReadback);
@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QRandomGenerator>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/aurorawlshmtextureuploader_p.h>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class tst_ShmUpload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void convertRgb32_data();
+    void convertRgb32();
+};
+
+void tst_ShmUpload::convertRgb32_data()
+{
+    QTest::addColumn<int>("width");
+    QTest::addColumn<bool>("swapRedBlue");
+    QTest::addColumn<bool>("forceOpaque");
+
+    // Vectorized loops convert 4 pixels at a time, the rest are left over
+    const QList<int> widths = { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 63, 1921 };
+
+    for (int width : widths) {
+        for (bool swapRedBlue : { false, true }) {
+            for (bool forceOpaque : { false, true }) {
+                QTest::addRow("%d%s%s", width, swapRedBlue ? " swap" : "", forceOpaque ? " opaque" : "")
+                        << width << swapRedBlue << forceOpaque;
+            }
+        }
+    }
+}
+
+// The conversion doesn't depend on the instruction set
+void tst_ShmUpload::convertRgb32()
+{
+    QFETCH(int, width);
+    QFETCH(bool, swapRedBlue);
+    QFETCH(bool, forceOpaque);
+
+    const int height = 3;
+
+    // Rows are padded, as in client buffers and the staging buffer, with
+    // a source stride that doesn't match the destination
+    const qsizetype srcBytesPerLine = qsizetype(width) * 4 + 12;
+    const qsizetype dstBytesPerLine = qsizetype(width) * 4 + 4;
+
+    QByteArray src(srcBytesPerLine * height, Qt::Uninitialized);
+    QRandomGenerator generator(width);
+    for (qsizetype i = 0; i < src.size(); ++i)
+        src[i] = char(generator.bounded(256));
+
+    const char padding = char(0xa5);
+    QByteArray converted(dstBytesPerLine * height, padding);
+    QByteArray expected(dstBytesPerLine * height, padding);
+
+    const auto *bits = reinterpret_cast<const uchar *>(src.constData());
+    Internal::convertRgb32Pixels(bits, srcBytesPerLine,
+                                 reinterpret_cast<uchar *>(converted.data()), dstBytesPerLine,
+                                 width, height, swapRedBlue, forceOpaque);
+    Internal::convertRgb32PixelsScalar(bits, srcBytesPerLine,
+                                       reinterpret_cast<uchar *>(expected.data()), dstBytesPerLine,
+                                       width, height, swapRedBlue, forceOpaque);
+
+    // Padding is left alone as well
+    QCOMPARE(converted, expected);
+    for (int y = 0; y < height; ++y)
+        QCOMPARE(converted.mid(y * dstBytesPerLine + width * 4, 4), QByteArray(4, padding));
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_shmupload.moc>
+QTEST_MAIN(Aurora::Compositor::tst_ShmUpload);
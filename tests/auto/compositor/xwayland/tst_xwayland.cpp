@@ -0,0 +1,136 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QDeadlineTimer>
+#include <QtCore/QStandardPaths>
+#include <QtCore/QThread>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandOutput>
+
+#include "xwayland.h"
+#include "xwaylandmanager.h"
+#include "xwaylandserver.h"
+
+#include <xcb/xcb.h>
+
+#include <memory>
+
+namespace Aurora {
+
+namespace Compositor {
+
+class tst_XWayland : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void lazyStartAndIdle();
+
+private:
+    xcb_connection_t *connectClient(const QString &displayName);
+
+    QTemporaryDir m_tmpRuntimeDir;
+};
+
+void tst_XWayland::init()
+{
+    // We need to set a test specific runtime dir so we don't conflict with other tests'
+    // compositors by accident.
+    qputenv("XDG_RUNTIME_DIR", m_tmpRuntimeDir.path().toLocal8Bit());
+}
+
+// Connecting blocks until Xwayland answers, which it does only after the
+// compositor has seen the connection, so the client connects from a thread
+xcb_connection_t *tst_XWayland::connectClient(const QString &displayName)
+{
+    const QByteArray name = displayName.toLocal8Bit();
+    auto connection = std::make_shared<xcb_connection_t *>(nullptr);
+
+    QThread *thread = QThread::create([name, connection]() {
+        *connection = xcb_connect(name.constData(), nullptr);
+    });
+    thread->start();
+
+    QDeadlineTimer deadline(10000);
+    while (!thread->isFinished() && !deadline.hasExpired())
+        QTest::qWait(10);
+    if (!thread->isFinished()) {
+        // Still blocked, the thread is leaked along with the connection
+        return nullptr;
+    }
+    delete thread;
+
+    if (*connection && xcb_connection_has_error(*connection)) {
+        xcb_disconnect(*connection);
+        return nullptr;
+    }
+    return *connection;
+}
+
+void tst_XWayland::lazyStartAndIdle()
+{
+    if (QStandardPaths::findExecutable(QStringLiteral("Xwayland")).isEmpty())
+        QSKIP("Xwayland is not installed");
+
+    WaylandCompositor compositor;
+    WaylandOutput output(&compositor, nullptr);
+    compositor.setDefaultOutput(&output);
+    compositor.create();
+
+    XWaylandManager manager;
+    XWayland xwayland;
+    xwayland.setCompositor(&compositor);
+    xwayland.setManager(&manager);
+    xwayland.setEnabled(true);
+    xwayland.setLazy(true);
+    xwayland.setIdleTimeout(200);
+    xwayland.componentComplete();
+
+    QSignalSpy startedSpy(&xwayland, &XWayland::serverStarted);
+
+    // The display is taken right away, Xwayland waits for a client
+    QVERIFY(xwayland.startServer());
+    const QString displayName = xwayland.displayName();
+    QVERIFY(!displayName.isEmpty());
+    QVERIFY(xwayland.m_server->isListening());
+    QVERIFY(!xwayland.m_server->isRunning());
+
+    // The first client starts it
+    xcb_connection_t *client = connectClient(displayName);
+    QVERIFY(client);
+    QTRY_COMPARE(startedSpy.size(), 1);
+    QVERIFY(xwayland.m_server->isRunning());
+
+    // Clients without windows keep it running, without X-Resource
+    // only clients with windows are seen
+#if HAVE_XCB_RES
+    QTest::qWait(xwayland.idleTimeout() * 4);
+    QVERIFY(xwayland.m_server->isRunning());
+#endif
+
+    // It's stopped once the last client is gone, and listens again
+    xcb_disconnect(client);
+    QTRY_VERIFY_WITH_TIMEOUT(!xwayland.m_server->isRunning(), 10000);
+    QVERIFY(xwayland.m_server->isListening());
+    QCOMPARE(xwayland.displayName(), displayName);
+
+    // The next client starts it again
+    client = connectClient(displayName);
+    QVERIFY(client);
+    QTRY_COMPARE(startedSpy.size(), 2);
+    QVERIFY(xwayland.m_server->isRunning());
+    xcb_disconnect(client);
+
+    xwayland.stopServer();
+    QVERIFY(!xwayland.m_server->isListening());
+}
+
+} // namespace Compositor
+
+} // namespace Aurora
+
+#include <tst_xwayland.moc>
+QTEST_MAIN(Aurora::Compositor::tst_XWayland);
@@ -22,16 +22,41 @@
  ***************************************************************************/
 
 #include <QDBusConnection>
+#include <QDBusMetaType>
 
 #include "fakelogind.h"
 
+#include <unistd.h>
+
+QDBusArgument &operator<<(QDBusArgument &argument, const FakeUserSession &session)
+{
+    argument.beginStructure();
+    argument << session.id << session.path;
+    argument.endStructure();
+    return argument;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, FakeUserSession &session)
+{
+    argument.beginStructure();
+    argument >> session.id >> session.path;
+    argument.endStructure();
+    return argument;
+}
+
 /*
  * FakeLogindSession
  */
 
-FakeLogindSession::FakeLogindSession(const QString &path, QObject *parent)
+FakeLogindSession::FakeLogindSession(const QString &id, const QString &type,
+                                     const QString &state, quint32 vt,
+                                     QObject *parent)
     : QObject(parent)
-    , m_path(path)
+    , m_id(id)
+    , m_path(QStringLiteral("/org/freedesktop/login1/session/_") + id)
+    , m_type(type)
+    , m_state(state)
+    , m_vt(vt)
 {
     QDBusConnection::sessionBus().registerObject(
                 m_path, this, QDBusConnection::ExportScriptableContents);
@@ -47,14 +72,38 @@ const QString &FakeLogindSession::path()
     return m_path;
 }
 
+QString FakeLogindSession::id() const
+{
+    return m_id;
+}
+
+QString FakeLogindSession::type() const
+{
+    return m_type;
+}
+
+QString FakeLogindSession::state() const
+{
+    return m_state;
+}
+
+void FakeLogindSession::setState(const QString &state)
+{
+    m_state = state;
+}
+
 bool FakeLogindSession::isActive() const
 {
-    return true;
+    return m_state == QStringLiteral("active");
 }
 
 quint32 FakeLogindSession::vtNumber() const
 {
-    return 1;
+    return m_vt;
+}
+
+void FakeLogindSession::Activate()
+{
 }
 
 void FakeLogindSession::TakeControl(bool force)
@@ -66,14 +115,54 @@ void FakeLogindSession::ReleaseControl()
 {
 }
 
+/*
+ * FakeLogindUser
+ */
+
+FakeLogindUser::FakeLogindUser(const QString &path, QObject *parent)
+    : QObject(parent)
+    , m_path(path)
+{
+    qDBusRegisterMetaType<FakeUserSession>();
+    qDBusRegisterMetaType<FakeUserSessionList>();
+
+    QDBusConnection::sessionBus().registerObject(
+                m_path, this, QDBusConnection::ExportScriptableContents);
+}
+
+FakeLogindUser::~FakeLogindUser()
+{
+    QDBusConnection::sessionBus().unregisterObject(m_path);
+}
+
+const QString &FakeLogindUser::path()
+{
+    return m_path;
+}
+
+FakeUserSessionList FakeLogindUser::sessions() const
+{
+    return m_sessions;
+}
+
+void FakeLogindUser::addSession(FakeLogindSession *session)
+{
+    m_sessions.prepend(FakeUserSession{ session->id(), QDBusObjectPath(session->path()) });
+}
+
 /*
  * FakeLogind
  */
 
 FakeLogind::FakeLogind(QObject *parent)
     : QObject(parent)
-    , m_session(new FakeLogindSession(QStringLiteral("/org/freedesktop/login1/session/_1"), this))
+    , m_session(new FakeLogindSession(QStringLiteral("1"), QStringLiteral("tty"),
+                                      QStringLiteral("active"), 1, this))
+    , m_user(new FakeLogindUser(QStringLiteral("/org/freedesktop/login1/user/_") +
+                                QString::number(::getuid()), this))
 {
+    m_user->addSession(m_session);
+
     QDBusConnection::sessionBus().registerObject(
                 QStringLiteral("/org/freedesktop/login1"), this,
                 QDBusConnection::ExportScriptableContents);
@@ -89,6 +178,20 @@ FakeLogind::~FakeLogind()
                 QStringLiteral("org.freedesktop.login1"));
 }
 
+FakeLogindSession *FakeLogind::session() const
+{
+    return m_session;
+}
+
+FakeLogindSession *FakeLogind::addUserSession(const QString &id, const QString &type,
+                                              const QString &state, quint32 vt)
+{
+    auto *session = new FakeLogindSession(id, type, state, vt, this);
+    m_userSessions.append(session);
+    m_user->addSession(session);
+    return session;
+}
+
 void FakeLogind::doLock()
 {
     Q_EMIT m_session->Lock();
@@ -109,6 +212,21 @@ void FakeLogind::doPrepareForShutdown(bool before)
     Q_EMIT PrepareForShutdown(before);
 }
 
+QDBusObjectPath FakeLogind::GetUser(quint32 uid)
+{
+    Q_UNUSED(uid);
+    return QDBusObjectPath(m_user->path());
+}
+
+QDBusObjectPath FakeLogind::GetSession(const QString &id)
+{
+    for (auto *session : std::as_const(m_userSessions)) {
+        if (session->id() == id)
+            return QDBusObjectPath(session->path());
+    }
+    return QDBusObjectPath(m_session->path());
+}
+
 QDBusObjectPath FakeLogind::GetSessionByPID(quint32 pid)
 {
     Q_UNUSED(pid);
@@ -24,24 +24,49 @@
 #pragma once
 
 #include <QObject>
+#include <QDBusArgument>
 #include <QDBusObjectPath>
+#include <QVector>
+
+struct FakeUserSession
+{
+    QString id;
+    QDBusObjectPath path;
+};
+Q_DECLARE_METATYPE(FakeUserSession)
+
+typedef QVector<FakeUserSession> FakeUserSessionList;
+Q_DECLARE_METATYPE(FakeUserSessionList)
+
+QDBusArgument &operator<<(QDBusArgument &argument, const FakeUserSession &session);
+const QDBusArgument &operator>>(const QDBusArgument &argument, FakeUserSession &session);
 
 class FakeLogindSession : public QObject
 {
     Q_OBJECT
+    Q_PROPERTY(QString Id READ id CONSTANT)
+    Q_PROPERTY(QString Type READ type CONSTANT)
+    Q_PROPERTY(QString State READ state CONSTANT)
     Q_PROPERTY(bool Active READ isActive CONSTANT)
     Q_PROPERTY(uint VTNr READ vtNumber CONSTANT)
     Q_CLASSINFO("D-Bus Interface", "org.freedesktop.login1.Session")
 public:
-    explicit FakeLogindSession(const QString &path, QObject *parent = nullptr);
+    explicit FakeLogindSession(const QString &id, const QString &type,
+                               const QString &state, quint32 vt,
+                               QObject *parent = nullptr);
     virtual ~FakeLogindSession();
 
     const QString &path();
 
+    QString id() const;
+    QString type() const;
+    QString state() const;
+    void setState(const QString &state);
     bool isActive() const;
     quint32 vtNumber() const;
 
 public Q_SLOTS:
+    Q_SCRIPTABLE void Activate();
     Q_SCRIPTABLE void TakeControl(bool force);
     Q_SCRIPTABLE void ReleaseControl();
 
@@ -49,8 +74,31 @@ Q_SIGNALS:
     Q_SCRIPTABLE void Lock();
     Q_SCRIPTABLE void Unlock();
 
+private:
+    QString m_id;
+    QString m_path;
+    QString m_type;
+    QString m_state;
+    quint32 m_vt = 0;
+};
+
+class FakeLogindUser : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(FakeUserSessionList Sessions READ sessions CONSTANT)
+    Q_CLASSINFO("D-Bus Interface", "org.freedesktop.login1.User")
+public:
+    explicit FakeLogindUser(const QString &path, QObject *parent = nullptr);
+    virtual ~FakeLogindUser();
+
+    const QString &path();
+
+    FakeUserSessionList sessions() const;
+    void addSession(FakeLogindSession *session);
+
 private:
     QString m_path;
+    FakeUserSessionList m_sessions;
 };
 
 class FakeLogind : public QObject
@@ -61,6 +109,14 @@ public:
     explicit FakeLogind(QObject *parent = nullptr);
     virtual ~FakeLogind();
 
+    // Session of the process, also the oldest session of the user
+    FakeLogindSession *session() const;
+
+    // Adds another session for the current user, sessions are
+    // listed from the newest to the oldest like logind does
+    FakeLogindSession *addUserSession(const QString &id, const QString &type,
+                                      const QString &state, quint32 vt);
+
     // Methods to trigger signals
     void doLock();
     void doUnlock();
@@ -68,6 +124,8 @@ public:
     void doPrepareForShutdown(bool before);
 
 public Q_SLOTS:
+    Q_SCRIPTABLE QDBusObjectPath GetUser(quint32 uid);
+    Q_SCRIPTABLE QDBusObjectPath GetSession(const QString &id);
     Q_SCRIPTABLE QDBusObjectPath GetSessionByPID(quint32 pid);
     Q_SCRIPTABLE int TakeDevice(int maj, int min);
     Q_SCRIPTABLE void ReleaseDevice(int maj, int min);
@@ -78,4 +136,6 @@ Q_SIGNALS:
 
 private:
     FakeLogindSession *m_session;
+    FakeLogindUser *m_user;
+    QVector<FakeLogindSession *> m_userSessions;
 };
@@ -106,6 +106,91 @@ private Q_SLOTS:
         logind->deleteLater();
     }
 
+    void testPropertiesKnownWhenConnected()
+    {
+        CustomLogind *logind = new CustomLogind;
+
+        // Session properties are read before telling we are connected
+        bool active = false;
+        int vtNumber = -1;
+        connect(logind, &Logind::connectedChanged, this, [&](bool connected) {
+            if (connected) {
+                active = logind->isSessionActive();
+                vtNumber = logind->vtNumber();
+            }
+        });
+
+        QSignalSpy spyConnected(logind, SIGNAL(connectedChanged(bool)));
+        FakeLogind *fakeLogind = new FakeLogind;
+        QVERIFY(spyConnected.wait());
+        QVERIFY(active);
+        QCOMPARE(vtNumber, 1);
+
+        fakeLogind->deleteLater();
+        logind->deleteLater();
+
+        QTest::qWait(1000);
+    }
+
+    void testUserSession()
+    {
+        CustomLogind *logind = new CustomLogind;
+
+        // The active graphical session of the user is preferred
+        // to the session of the process, that is not active here
+        QSignalSpy spyConnected(logind, SIGNAL(connectedChanged(bool)));
+        FakeLogind *fakeLogind = new FakeLogind;
+        fakeLogind->session()->setState(QStringLiteral("online"));
+        fakeLogind->addUserSession(QStringLiteral("c2"), QStringLiteral("wayland"),
+                                   QStringLiteral("active"), 2);
+        fakeLogind->addUserSession(QStringLiteral("c3"), QStringLiteral("unspecified"),
+                                   QStringLiteral("active"), 3);
+        QVERIFY(spyConnected.wait());
+        QCOMPARE(logind->vtNumber(), 2);
+        QVERIFY(logind->isSessionActive());
+
+        fakeLogind->deleteLater();
+        logind->deleteLater();
+
+        QTest::qWait(1000);
+    }
+
+    void testOldestUserSession()
+    {
+        CustomLogind *logind = new CustomLogind;
+
+        // Sessions are listed from the newest, the oldest valid one is used
+        QSignalSpy spyConnected(logind, SIGNAL(connectedChanged(bool)));
+        FakeLogind *fakeLogind = new FakeLogind;
+        fakeLogind->addUserSession(QStringLiteral("c2"), QStringLiteral("x11"),
+                                   QStringLiteral("active"), 2);
+        QVERIFY(spyConnected.wait());
+        QCOMPARE(logind->vtNumber(), 1);
+
+        fakeLogind->deleteLater();
+        logind->deleteLater();
+
+        QTest::qWait(1000);
+    }
+
+    void testInactiveUserSession()
+    {
+        CustomLogind *logind = new CustomLogind;
+
+        // The newest session is going away, the older one is used
+        QSignalSpy spyConnected(logind, SIGNAL(connectedChanged(bool)));
+        FakeLogind *fakeLogind = new FakeLogind;
+        fakeLogind->addUserSession(QStringLiteral("c2"), QStringLiteral("wayland"),
+                                   QStringLiteral("closing"), 2);
+        QVERIFY(spyConnected.wait());
+        QCOMPARE(logind->vtNumber(), 1);
+
+        fakeLogind->deleteLater();
+        logind->deleteLater();
+
+        QTest::qWait(1000);
+    }
+
     void testPropertySessionActive()
     {
         CustomLogind *logind = new CustomLogind;
@@ -151,10 +236,11 @@ private Q_SLOTS:
         // Take control as soon as we are connected to logind and
         // then release control, we should have received two signals
         logind->takeControl();
-        spyTakeControl.wait();
+        QVERIFY(spyTakeControl.wait());
+        QVERIFY(logind->hasSessionControl());
         logind->releaseControl();
-        spyTakeControl.wait();
         QCOMPARE(spyTakeControl.count(), 2);
+        QVERIFY(!logind->hasSessionControl());
 
         fakeLogind->deleteLater();
         logind->deleteLater();
@@ -0,0 +1,118 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/aurorawaylandbufferref_p.h>
+#include <LiriAuroraCompositor/private/aurorawlclientbuffer_p.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace Aurora::Compositor;
+
+static std::atomic<qint64> allocationCount(0);
+
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void *ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+class FakeBuffer : public Internal::ClientBuffer
+{
+public:
+    FakeBuffer()
+        : Internal::ClientBuffer(nullptr)
+    {
+    }
+
+    QSize size() const override { return QSize(1920, 1080); }
+    WaylandSurface::Origin origin() const override { return WaylandSurface::OriginTopLeft; }
+#if QT_CONFIG(opengl)
+    QOpenGLTexture *toOpenGlTexture(int plane) override
+    {
+        Q_UNUSED(plane);
+        return nullptr;
+    }
+#endif
+};
+
+// The places a buffer reference goes through from attach to the scene graph
+struct CommitPath
+{
+    WaylandBufferRef pending;
+    WaylandBufferRef cached;
+    WaylandBufferRef current;
+    WaylandBufferRef viewNext;
+    WaylandBufferRef viewCurrent;
+    WaylandBufferRef textureProvider;
+    WaylandBufferRef material;
+
+    void commit(Internal::ClientBuffer *buffer)
+    {
+        pending = WaylandBufferRefPrivate::fromBuffer(buffer);
+        cached = std::move(pending);
+        current = std::move(cached);
+        viewNext = current;
+        viewCurrent = viewNext;
+        textureProvider = viewCurrent;
+        material = textureProvider;
+    }
+};
+
+class tst_BufferRef : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void commit();
+    void allocationsPerFrame();
+};
+
+void tst_BufferRef::commit()
+{
+    // Clients usually alternate between two buffers
+    FakeBuffer buffers[2];
+    CommitPath path;
+    int frame = 0;
+
+    QBENCHMARK {
+        path.commit(&buffers[frame++ % 2]);
+    }
+}
+
+void tst_BufferRef::allocationsPerFrame()
+{
+    const int frameCount = 1000;
+
+    FakeBuffer buffers[2];
+    CommitPath path;
+    path.commit(&buffers[1]);
+
+    const qint64 before = allocationCount.load();
+    for (int frame = 0; frame < frameCount; ++frame)
+        path.commit(&buffers[frame % 2]);
+    const qint64 allocations = allocationCount.load() - before;
+
+    // Reported like the other benchmark results, a commit must not allocate
+    QTest::setBenchmarkResult(qreal(allocations) / frameCount, QTest::Events);
+    QCOMPARE(allocations, qint64(0));
+}
+
+QTEST_MAIN(tst_BufferRef)
+
+#include "tst_bench_bufferref.moc"
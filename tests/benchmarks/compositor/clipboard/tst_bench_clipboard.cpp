@@ -0,0 +1,358 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QMimeData>
+#include <QtCore/QSocketNotifier>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandOutput>
+#include <LiriAuroraCompositor/WaylandSeat>
+#include <LiriAuroraCompositor/WaylandSurface>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "benchclient.h"
+
+using namespace Aurora::Compositor;
+
+static const char *mimeType = "image/png";
+
+class Compositor : public WaylandCompositor
+{
+public:
+    QMimeData retained;
+    bool received = false;
+
+protected:
+    void retainedSelectionReceived(QMimeData *mimeData) override
+    {
+        const auto formats = mimeData->formats();
+        for (const QString &format : formats)
+            retained.setData(format, mimeData->data(format));
+        received = true;
+    }
+};
+
+class Client : public BenchClient
+{
+public:
+    using BenchClient::BenchClient;
+    ~Client() override;
+
+    wl_compositor *compositor = nullptr;
+    wl_seat *seat = nullptr;
+    wl_data_device_manager *dataDeviceManager = nullptr;
+    wl_data_device *dataDevice = nullptr;
+    wl_surface *surface = nullptr;
+
+    // Source side
+    wl_data_source *source = nullptr;
+    QByteArray payload;
+    qsizetype written = 0;
+    QSocketNotifier *writeNotifier = nullptr;
+
+    // Receiving side
+    wl_data_offer *selection = nullptr;
+    QByteArray received;
+    bool receivedAll = false;
+    QSocketNotifier *readNotifier = nullptr;
+
+protected:
+    void handleGlobal(wl_registry *registry, uint32_t id,
+                      const char *interface, uint32_t version) override
+    {
+        Q_UNUSED(version);
+        if (qstrcmp(interface, "wl_compositor") == 0)
+            compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+        else if (qstrcmp(interface, "wl_seat") == 0 && !seat)
+            seat = static_cast<wl_seat *>(wl_registry_bind(registry, id, &wl_seat_interface, 1));
+        else if (qstrcmp(interface, "wl_data_device_manager") == 0)
+            dataDeviceManager = static_cast<wl_data_device_manager *>(wl_registry_bind(registry, id, &wl_data_device_manager_interface, 1));
+    }
+};
+
+static void sourceTarget(void *data, wl_data_source *source, const char *mimeType)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(source);
+    Q_UNUSED(mimeType);
+}
+
+// The source writes without blocking, like a well behaved client would
+static void sourceSend(void *data, wl_data_source *source, const char *mimeType, int32_t fd)
+{
+    Q_UNUSED(source);
+    Q_UNUSED(mimeType);
+
+    auto *client = static_cast<Client *>(data);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    client->written = 0;
+
+    auto writeData = [client, fd]() {
+        while (client->written < client->payload.size()) {
+            const ssize_t n = ::write(fd, client->payload.constData() + client->written,
+                                      client->payload.size() - client->written);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && errno == EAGAIN)
+                return;
+            if (n < 0)
+                break;
+            client->written += n;
+        }
+
+        client->writeNotifier->deleteLater();
+        client->writeNotifier = nullptr;
+        close(fd);
+    };
+
+    client->writeNotifier = new QSocketNotifier(fd, QSocketNotifier::Write);
+    QObject::connect(client->writeNotifier, &QSocketNotifier::activated, writeData);
+}
+
+static void sourceCancelled(void *data, wl_data_source *source)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(source);
+}
+
+static const wl_data_source_listener sourceListener = {
+    sourceTarget,
+    sourceSend,
+    sourceCancelled,
+    nullptr,
+    nullptr,
+    nullptr,
+};
+
+static void deviceDataOffer(void *data, wl_data_device *device, wl_data_offer *offer)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(device);
+    Q_UNUSED(offer);
+}
+
+static void deviceEnter(void *data, wl_data_device *device, uint32_t serial, wl_surface *surface,
+                        wl_fixed_t x, wl_fixed_t y, wl_data_offer *offer)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(device);
+    Q_UNUSED(serial);
+    Q_UNUSED(surface);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    Q_UNUSED(offer);
+}
+
+static void deviceLeave(void *data, wl_data_device *device)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(device);
+}
+
+static void deviceMotion(void *data, wl_data_device *device, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(device);
+    Q_UNUSED(time);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+}
+
+static void deviceDrop(void *data, wl_data_device *device)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(device);
+}
+
+static void deviceSelection(void *data, wl_data_device *device, wl_data_offer *offer)
+{
+    Q_UNUSED(device);
+
+    auto *client = static_cast<Client *>(data);
+    if (client->selection)
+        wl_data_offer_destroy(client->selection);
+    client->selection = offer;
+}
+
+static const wl_data_device_listener deviceListener = {
+    deviceDataOffer,
+    deviceEnter,
+    deviceLeave,
+    deviceMotion,
+    deviceDrop,
+    deviceSelection,
+};
+
+Client::~Client()
+{
+    delete writeNotifier;
+    delete readNotifier;
+
+    if (selection)
+        wl_data_offer_destroy(selection);
+    if (source)
+        wl_data_source_destroy(source);
+    if (dataDevice)
+        wl_data_device_destroy(dataDevice);
+    if (dataDeviceManager)
+        wl_data_device_manager_destroy(dataDeviceManager);
+    if (seat)
+        wl_seat_destroy(seat);
+    if (surface)
+        wl_surface_destroy(surface);
+    if (compositor)
+        wl_compositor_destroy(compositor);
+}
+
+// Receives the selection without blocking
+static void receiveSelection(Client *client)
+{
+    int fd[2];
+    if (pipe2(fd, O_CLOEXEC | O_NONBLOCK) == -1)
+        return;
+
+    wl_data_offer_receive(client->selection, mimeType, fd[1]);
+    close(fd[1]);
+    wl_display_flush(client->display);
+
+    client->received.clear();
+    client->received.reserve(client->payload.size());
+    client->receivedAll = false;
+
+    client->readNotifier = new QSocketNotifier(fd[0], QSocketNotifier::Read);
+    QObject::connect(client->readNotifier, &QSocketNotifier::activated, [client, fd]() {
+        char buffer[65536];
+        for (;;) {
+            const ssize_t n = ::read(fd[0], buffer, sizeof(buffer));
+            if (n > 0) {
+                client->received.append(buffer, n);
+                continue;
+            }
+            if (n < 0 && (errno == EINTR))
+                continue;
+            if (n < 0 && errno == EAGAIN)
+                return;
+            break;
+        }
+
+        client->readNotifier->deleteLater();
+        client->readNotifier = nullptr;
+        close(fd[0]);
+        client->receivedAll = true;
+    });
+}
+
+class tst_Clipboard : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void copy_data();
+    void copy();
+};
+
+void tst_Clipboard::copy_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::addRow("1 MB") << 1024 * 1024;
+    QTest::addRow("100 MB") << 100 * 1024 * 1024;
+}
+
+void tst_Clipboard::copy()
+{
+    QFETCH(int, size);
+
+    const char *socketName = "aurora-bench-clipboard";
+
+    Compositor compositor;
+    compositor.setSocketName(socketName);
+    compositor.setRetainedSelectionEnabled(true);
+    auto *output = new WaylandOutput(&compositor, nullptr);
+    WaylandOutputMode mode(QSize(1920, 1080), 60000);
+    output->addMode(mode, true);
+    output->setCurrentMode(mode);
+    compositor.setDefaultOutput(output);
+    compositor.create();
+
+    QList<WaylandSurface *> surfaces;
+    connect(&compositor, &WaylandCompositor::surfaceCreated, this, [&surfaces](WaylandSurface *surface) {
+        surfaces.append(surface);
+    });
+
+    Client source(socketName);
+    Client target(socketName);
+    QVERIFY(source.display && target.display);
+
+    for (Client *client : { &source, &target }) {
+        client->watchDisplay();
+        wl_display_flush(client->display);
+        QTRY_VERIFY(client->compositor && client->seat && client->dataDeviceManager);
+        client->surface = wl_compositor_create_surface(client->compositor);
+        client->dataDevice = wl_data_device_manager_get_data_device(client->dataDeviceManager, client->seat);
+        wl_data_device_add_listener(client->dataDevice, &deviceListener, client);
+        wl_display_flush(client->display);
+    }
+    QTRY_COMPARE(surfaces.size(), 2);
+
+    // An image that doesn't compress, like a real one
+    source.payload.resize(size);
+    quint32 value = 1;
+    for (int i = 0; i < size; ++i) {
+        value = value * 1664525 + 1013904223;
+        source.payload[i] = char(value >> 24);
+    }
+
+    // Watch how long the event loop doesn't run while copying
+    QElapsedTimer tick;
+    qint64 maxStall = 0;
+    QTimer frameTimer;
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    frameTimer.setInterval(1);
+    connect(&frameTimer, &QTimer::timeout, this, [&tick, &maxStall]() {
+        maxStall = qMax(maxStall, tick.restart());
+    });
+
+    QElapsedTimer timer;
+    timer.start();
+    tick.start();
+    frameTimer.start();
+
+    // Copy: the compositor retains the data from the source client
+    source.source = wl_data_device_manager_create_data_source(source.dataDeviceManager);
+    wl_data_source_add_listener(source.source, &sourceListener, &source);
+    wl_data_source_offer(source.source, mimeType);
+    wl_data_device_set_selection(source.dataDevice, source.source, 0);
+    wl_display_flush(source.display);
+    QTRY_VERIFY_WITH_TIMEOUT(compositor.received, 60000);
+    const qint64 retainElapsed = timer.nsecsElapsed();
+
+    // Paste: the compositor serves the retained data to the target client,
+    // its offer is sent right after the one of the source client
+    WaylandSeat *seat = compositor.defaultSeat();
+    QVERIFY(seat->setKeyboardFocus(surfaces.at(1)));
+    compositor.overrideSelection(&compositor.retained);
+    QTRY_VERIFY(target.selection);
+    receiveSelection(&target);
+    QTRY_VERIFY_WITH_TIMEOUT(target.receivedAll, 60000);
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    frameTimer.stop();
+
+    QTest::setBenchmarkResult(qreal(elapsed) / 1000000, QTest::WalltimeMilliseconds);
+
+    QCOMPARE(compositor.retained.data(QString::fromLatin1(mimeType)).size(), size);
+    QCOMPARE(target.received.size(), size);
+    QVERIFY(target.received == source.payload);
+    qDebug() << "retained in" << retainElapsed / 1000000 << "ms, served in"
+             << (elapsed - retainElapsed) / 1000000 << "ms, longest event loop stall"
+             << maxStall << "ms";
+}
+
+QTEST_MAIN(tst_Clipboard)
+
+#include "tst_bench_clipboard.moc"
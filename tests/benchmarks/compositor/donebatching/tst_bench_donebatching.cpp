@@ -0,0 +1,159 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandWlrForeignToplevelManagerV1>
+
+#include <wayland-client.h>
+#include <wayland-server.h>
+
+#include <aurora-client-wlr-foreign-toplevel-management-unstable-v1.h>
+
+#include "benchclient.h"
+
+using namespace Aurora::Compositor;
+
+class ToplevelManager : public Aurora::Client::PrivateClient::zwlr_foreign_toplevel_manager_v1
+{
+public:
+    using zwlr_foreign_toplevel_manager_v1::zwlr_foreign_toplevel_manager_v1;
+
+    int toplevels = 0;
+
+protected:
+    // Handle events are counted by the compositor, no need for a listener
+    void zwlr_foreign_toplevel_manager_v1_toplevel(struct ::zwlr_foreign_toplevel_handle_v1 *toplevel) override
+    {
+        Q_UNUSED(toplevel);
+        ++toplevels;
+    }
+};
+
+class Client : public BenchClient
+{
+public:
+    using BenchClient::BenchClient;
+    ~Client() override;
+
+    ToplevelManager *manager = nullptr;
+
+protected:
+    void handleGlobal(wl_registry *registry, uint32_t id,
+                      const char *interface, uint32_t version) override
+    {
+        if (qstrcmp(interface, "zwlr_foreign_toplevel_manager_v1") == 0)
+            manager = new ToplevelManager(registry, id, qMin<uint32_t>(version, 3));
+    }
+};
+
+Client::~Client()
+{
+    delete manager;
+}
+
+struct EventCounter
+{
+    int events = 0;
+    int doneEvents = 0;
+};
+
+static void protocolLogger(void *data, wl_protocol_logger_type type,
+                           const wl_protocol_logger_message *message)
+{
+    if (type != WL_PROTOCOL_LOGGER_EVENT)
+        return;
+    if (qstrcmp(wl_resource_get_class(message->resource), "zwlr_foreign_toplevel_handle_v1") != 0)
+        return;
+
+    auto *counter = static_cast<EventCounter *>(data);
+    counter->events++;
+    if (qstrcmp(message->message->name, "done") == 0)
+        counter->doneEvents++;
+}
+
+class tst_DoneBatching : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void workspaceSwitch_data();
+    void workspaceSwitch();
+};
+
+void tst_DoneBatching::workspaceSwitch_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::addRow("200 windows") << 200;
+}
+
+// Switching workspace minimizes the windows of the old workspace,
+// restores the ones of the new workspace and moves the focus: every
+// window changes more than one property at once
+void tst_DoneBatching::workspaceSwitch()
+{
+    QFETCH(int, count);
+
+    const char *socketName = "aurora-bench-donebatching";
+
+    WaylandCompositor compositor;
+    compositor.setSocketName(socketName);
+    auto *manager = new WaylandWlrForeignToplevelManagerV1(&compositor);
+    compositor.create();
+    manager->initialize();
+
+    QList<WaylandWlrForeignToplevelHandleV1 *> handles;
+    for (int i = 0; i < count; ++i) {
+        auto *handle = new WaylandWlrForeignToplevelHandleV1(&compositor);
+        handle->setCompositor(&compositor);
+        handle->setManager(manager);
+        handle->setAppId(QStringLiteral("org.example.App%1").arg(i));
+        handle->setTitle(QStringLiteral("Window %1").arg(i));
+        handle->setMinimized(i % 2);
+        handle->initialize();
+        handles.append(handle);
+    }
+
+    Client client(socketName);
+    QVERIFY(client.display);
+    client.watchDisplay();
+    wl_display_flush(client.display);
+    QTRY_VERIFY(client.manager);
+    wl_display_flush(client.display);
+    QTRY_COMPARE(client.manager->toplevels, count);
+
+    EventCounter counter;
+    auto *logger = wl_display_add_protocol_logger(compositor.display(), protocolLogger, &counter);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int i = 0; i < count; ++i) {
+        auto *handle = handles.at(i);
+        const bool minimized = !handle->isMinimized();
+        handle->setMinimized(minimized);
+        handle->setActivated(!minimized && i == count - 1);
+        handle->setTitle(QStringLiteral("Window %1 (%2)").arg(i).arg(minimized ? "hidden" : "shown"));
+    }
+    compositor.processWaylandEvents();
+
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    wl_protocol_logger_destroy(logger);
+
+    qDebug() << counter.events << "events," << counter.doneEvents << "done for" << count
+             << "windows in" << elapsed / 1000 << "us";
+
+    // One done per window, no matter how many properties changed
+    QCOMPARE(counter.doneEvents, count);
+
+    QTest::setBenchmarkResult(counter.events, QTest::Events);
+
+    qDeleteAll(handles);
+}
+
+QTEST_MAIN(tst_DoneBatching)
+
+#include "tst_bench_donebatching.moc"
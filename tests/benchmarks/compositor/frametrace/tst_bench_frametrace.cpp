@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/auroraframetracer_p.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Aurora::Compositor::Internal;
+
+class tst_FrameTrace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void scope_data();
+    void scope();
+    void concurrentRecord_data();
+    void concurrentRecord();
+    void events();
+
+private:
+    void startRecording();
+
+    bool m_recording = false;
+};
+
+void tst_FrameTrace::init()
+{
+    m_recording = false;
+}
+
+void tst_FrameTrace::cleanup()
+{
+    if (m_recording)
+        FrameTracer::instance()->release();
+}
+
+void tst_FrameTrace::startRecording()
+{
+    FrameTracer::instance()->acquire();
+    m_recording = true;
+}
+
+void tst_FrameTrace::scope_data()
+{
+    QTest::addColumn<bool>("active");
+
+    QTest::addRow("disabled") << false;
+    QTest::addRow("enabled") << true;
+}
+
+// What every instrumented stage pays
+void tst_FrameTrace::scope()
+{
+    QFETCH(bool, active);
+
+    if (active)
+        startRecording();
+
+    QBENCHMARK {
+        FrameTracer::Scope trace(FrameTracer::SurfaceCommit, 3);
+    }
+}
+
+void tst_FrameTrace::concurrentRecord_data()
+{
+    QTest::addColumn<int>("threadCount");
+
+    QTest::addRow("1 thread") << 1;
+    QTest::addRow("2 threads") << 2;
+    QTest::addRow("4 threads") << 4;
+}
+
+// The render thread and the main thread write at the same time
+void tst_FrameTrace::concurrentRecord()
+{
+    QFETCH(int, threadCount);
+
+    auto *tracer = FrameTracer::instance();
+    startRecording();
+
+    const int eventsPerThread = 100000;
+
+    QBENCHMARK {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back([tracer, i]() {
+                for (int j = 0; j < eventsPerThread; ++j)
+                    tracer->record(FrameTracer::PaintNodeUpdate, j + 1, j + 2, i, 0);
+            });
+        }
+        for (auto &thread : threads)
+            thread.join();
+    }
+}
+
+// Collecting the statistics reads the whole buffer
+void tst_FrameTrace::events()
+{
+    auto *tracer = FrameTracer::instance();
+    startRecording();
+    for (quint64 i = 0; i < FrameTracer::Capacity; ++i)
+        tracer->record(FrameTracer::FrameCallbacks, i + 1, i + 2, 0, 0);
+
+    qsizetype count = 0;
+    QBENCHMARK {
+        count = tracer->events().size();
+    }
+    QCOMPARE(count, qsizetype(FrameTracer::Capacity));
+}
+
+QTEST_GUILESS_MAIN(tst_FrameTrace)
+
+#include "tst_bench_frametrace.moc"
@@ -0,0 +1,248 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QtMath>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/WaylandCompositor>
+#include <LiriAuroraCompositor/WaylandOutput>
+#include <LiriAuroraCompositor/WaylandPointer>
+#include <LiriAuroraCompositor/WaylandSeat>
+#include <LiriAuroraCompositor/WaylandSurface>
+#include <LiriAuroraCompositor/WaylandView>
+
+#include "benchclient.h"
+
+using namespace Aurora::Compositor;
+
+// One second of input replayed at 60 frames per second
+static const int frameRate = 60;
+
+class Client : public BenchClient
+{
+public:
+    using BenchClient::BenchClient;
+    ~Client() override;
+
+    wl_compositor *compositor = nullptr;
+    wl_seat *seat = nullptr;
+    wl_pointer *pointer = nullptr;
+    wl_surface *surface = nullptr;
+
+    bool entered = false;
+    int motions = 0;
+    int frames = 0;
+
+protected:
+    void handleGlobal(wl_registry *registry, uint32_t id,
+                      const char *interface, uint32_t version) override
+    {
+        if (qstrcmp(interface, "wl_compositor") == 0)
+            compositor = static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+        else if (qstrcmp(interface, "wl_seat") == 0 && !seat)
+            seat = static_cast<wl_seat *>(wl_registry_bind(registry, id, &wl_seat_interface, qMin<uint32_t>(version, 5)));
+    }
+};
+
+static void pointerEnter(void *data, wl_pointer *pointer, uint32_t serial, wl_surface *surface,
+                         wl_fixed_t x, wl_fixed_t y)
+{
+    Q_UNUSED(pointer);
+    Q_UNUSED(serial);
+    Q_UNUSED(surface);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    static_cast<Client *>(data)->entered = true;
+}
+
+static void pointerLeave(void *data, wl_pointer *pointer, uint32_t serial, wl_surface *surface)
+{
+    Q_UNUSED(pointer);
+    Q_UNUSED(serial);
+    Q_UNUSED(surface);
+    static_cast<Client *>(data)->entered = false;
+}
+
+static void pointerMotion(void *data, wl_pointer *pointer, uint32_t time, wl_fixed_t x, wl_fixed_t y)
+{
+    Q_UNUSED(pointer);
+    Q_UNUSED(time);
+    Q_UNUSED(x);
+    Q_UNUSED(y);
+    static_cast<Client *>(data)->motions++;
+}
+
+static void pointerButton(void *data, wl_pointer *pointer, uint32_t serial, uint32_t time,
+                          uint32_t button, uint32_t state)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(pointer);
+    Q_UNUSED(serial);
+    Q_UNUSED(time);
+    Q_UNUSED(button);
+    Q_UNUSED(state);
+}
+
+static void pointerAxis(void *data, wl_pointer *pointer, uint32_t time, uint32_t axis, wl_fixed_t value)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(pointer);
+    Q_UNUSED(time);
+    Q_UNUSED(axis);
+    Q_UNUSED(value);
+}
+
+static void pointerFrame(void *data, wl_pointer *pointer)
+{
+    Q_UNUSED(pointer);
+    static_cast<Client *>(data)->frames++;
+}
+
+static void pointerAxisSource(void *data, wl_pointer *pointer, uint32_t source)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(pointer);
+    Q_UNUSED(source);
+}
+
+static void pointerAxisStop(void *data, wl_pointer *pointer, uint32_t time, uint32_t axis)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(pointer);
+    Q_UNUSED(time);
+    Q_UNUSED(axis);
+}
+
+static void pointerAxisDiscrete(void *data, wl_pointer *pointer, uint32_t axis, int32_t discrete)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(pointer);
+    Q_UNUSED(axis);
+    Q_UNUSED(discrete);
+}
+
+static const wl_pointer_listener pointerListener = {
+    pointerEnter,
+    pointerLeave,
+    pointerMotion,
+    pointerButton,
+    pointerAxis,
+    pointerFrame,
+    pointerAxisSource,
+    pointerAxisStop,
+    pointerAxisDiscrete,
+};
+
+Client::~Client()
+{
+    if (pointer)
+        wl_pointer_destroy(pointer);
+    if (seat)
+        wl_seat_destroy(seat);
+    if (surface)
+        wl_surface_destroy(surface);
+    if (compositor)
+        wl_compositor_destroy(compositor);
+}
+
+class tst_PointerMotion : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void replay_data();
+    void replay();
+};
+
+void tst_PointerMotion::replay_data()
+{
+    QTest::addColumn<int>("eventRate");
+    QTest::addColumn<bool>("coalesced");
+
+    const QList<int> rates = { 125, 1000, 8000 };
+    for (int rate : rates) {
+        QTest::addRow("%d Hz immediate", rate) << rate << false;
+        QTest::addRow("%d Hz coalesced", rate) << rate << true;
+    }
+}
+
+void tst_PointerMotion::replay()
+{
+    QFETCH(int, eventRate);
+    QFETCH(bool, coalesced);
+
+    const char *socketName = "aurora-bench-pointermotion";
+
+    WaylandCompositor compositor;
+    compositor.setSocketName(socketName);
+    auto *output = new WaylandOutput(&compositor, nullptr);
+    WaylandOutputMode mode(QSize(1920, 1080), frameRate * 1000);
+    output->addMode(mode, true);
+    output->setCurrentMode(mode);
+    compositor.setDefaultOutput(output);
+    compositor.create();
+
+    WaylandSurface *waylandSurface = nullptr;
+    connect(&compositor, &WaylandCompositor::surfaceCreated, this, [&waylandSurface](WaylandSurface *surface) {
+        waylandSurface = surface;
+    });
+
+    Client client(socketName);
+    QVERIFY(client.display);
+
+    auto pump = [&compositor, &client]() {
+        client.dispatch();
+        compositor.processWaylandEvents();
+        client.dispatch();
+    };
+
+    QTRY_VERIFY_WITH_TIMEOUT((pump(), client.compositor && client.seat), 5000);
+    client.surface = wl_compositor_create_surface(client.compositor);
+    client.pointer = wl_seat_get_pointer(client.seat);
+    wl_pointer_add_listener(client.pointer, &pointerListener, &client);
+    QTRY_VERIFY_WITH_TIMEOUT((pump(), waylandSurface != nullptr), 5000);
+
+    WaylandView view;
+    view.setSurface(waylandSurface);
+    if (coalesced)
+        view.setOutput(output);
+
+    WaylandSeat *seat = compositor.defaultSeat();
+    QVERIFY(seat && seat->pointer());
+    seat->sendMouseMoveEvent(&view, QPointF(1, 1), QPointF(1, 1));
+    QTRY_VERIFY_WITH_TIMEOUT((pump(), client.entered), 5000);
+
+    // A mouse moving along a circle with sub-pixel steps
+    const int eventsPerFrame = qMax(1, eventRate / frameRate);
+    const int eventCount = eventsPerFrame * frameRate;
+    QList<QPointF> trace;
+    trace.reserve(eventCount);
+    for (int i = 0; i < eventCount; ++i) {
+        const qreal angle = 2 * M_PI * i / eventCount;
+        trace.append(QPointF(500 + 400 * qCos(angle), 500 + 400 * qSin(angle)));
+    }
+
+    client.motions = 0;
+    client.frames = 0;
+
+    // Input events of a frame, the frame, and the client reading its events
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < frameRate; ++frame) {
+        for (int i = frame * eventsPerFrame; i < (frame + 1) * eventsPerFrame; ++i)
+            seat->sendMouseMoveEvent(&view, trace.at(i), trace.at(i));
+        output->sendFrameCallbacks();
+        client.dispatch();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    QTest::setBenchmarkResult(qreal(elapsed) / eventCount, QTest::WalltimeNanoseconds);
+
+    QTRY_VERIFY_WITH_TIMEOUT((pump(), client.motions >= (coalesced ? frameRate : eventCount)), 5000);
+    QCOMPARE(client.motions, coalesced ? frameRate : eventCount);
+    qDebug() << eventCount << "events," << client.motions << "motion events," << client.frames << "frames";
+}
+
+QTEST_MAIN(tst_PointerMotion)
+
+#include "tst_bench_pointermotion.moc"
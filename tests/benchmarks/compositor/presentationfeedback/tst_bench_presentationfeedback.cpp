@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/aurorawaylandpresentationfeedbacktracker_p.h>
+
+using namespace Aurora::Compositor;
+
+static const int feedbackPerFrame = 1000;
+
+class Tracker : public Internal::PresentationFeedbackTracker
+{
+public:
+    int presented = 0;
+    int discarded = 0;
+
+protected:
+    const void *windowForSurface(const void *surface) const override
+    {
+        Q_UNUSED(surface);
+        return this;
+    }
+
+    void feedbackPresented(Internal::PresentationFeedbackNode *node, const void *window,
+                           const Presentation &presentation) override
+    {
+        Q_UNUSED(node);
+        Q_UNUSED(window);
+        Q_UNUSED(presentation);
+        ++presented;
+    }
+
+    void feedbackDiscarded(Internal::PresentationFeedbackNode *node) override
+    {
+        Q_UNUSED(node);
+        ++discarded;
+    }
+};
+
+class tst_PresentationFeedback : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void frame_data();
+    void frame();
+};
+
+void tst_PresentationFeedback::frame_data()
+{
+    QTest::addColumn<int>("surfaceCount");
+
+    QTest::newRow("1 surface") << 1;
+    QTest::newRow("10 surfaces") << 10;
+    QTest::newRow("1000 surfaces") << 1000;
+}
+
+void tst_PresentationFeedback::frame()
+{
+    QFETCH(int, surfaceCount);
+
+    Tracker tracker;
+    const void *window = &tracker;
+    std::vector<Internal::PresentationFeedbackNode> nodes(feedbackPerFrame);
+    std::vector<char> surfaces(surfaceCount);
+
+    Internal::PresentationFeedbackTracker::Presentation presentation;
+    presentation.refresh_nsec = 16666666;
+
+    // Request, commit, synchronize and present, like a client per surface would
+    QBENCHMARK {
+        for (int i = 0; i < feedbackPerFrame; ++i)
+            tracker.addFeedback(&nodes[i], &surfaces[i % surfaceCount]);
+        for (const char &surface : surfaces)
+            tracker.surfaceCommitted(&surface);
+        tracker.synchronize(window);
+        tracker.present(window, presentation);
+        ++presentation.sequence;
+    }
+
+    QCOMPARE(tracker.discarded, 0);
+    QCOMPARE(tracker.presented % feedbackPerFrame, 0);
+    QVERIFY(tracker.presented > 0);
+}
+
+QTEST_MAIN(tst_PresentationFeedback)
+
+#include "tst_bench_presentationfeedback.moc"
@@ -0,0 +1,75 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtCore/QAbstractEventDispatcher>
+
+#include "benchclient.h"
+
+#include <poll.h>
+
+const wl_registry_listener BenchClient::s_registryListener = {
+    BenchClient::registryGlobal,
+    BenchClient::registryGlobalRemove,
+};
+
+BenchClient::BenchClient(const char *socketName)
+    : display(wl_display_connect(socketName))
+{
+    if (!display)
+        return;
+
+    registry = wl_display_get_registry(display);
+    wl_registry_add_listener(registry, &s_registryListener, this);
+}
+
+BenchClient::~BenchClient()
+{
+    delete m_displayNotifier;
+
+    if (registry)
+        wl_registry_destroy(registry);
+    if (display)
+        wl_display_disconnect(display);
+}
+
+void BenchClient::watchDisplay()
+{
+    if (!display || m_displayNotifier)
+        return;
+
+    m_displayNotifier = new QSocketNotifier(wl_display_get_fd(display), QSocketNotifier::Read);
+    QObject::connect(m_displayNotifier, &QSocketNotifier::activated, [this]() { dispatch(); });
+    QObject::connect(QAbstractEventDispatcher::instance(), &QAbstractEventDispatcher::aboutToBlock,
+                     m_displayNotifier, [this]() { wl_display_flush(display); });
+}
+
+// Reads what the compositor sent without blocking, the compositor
+// runs on the same thread
+void BenchClient::dispatch()
+{
+    wl_display_flush(display);
+
+    while (wl_display_prepare_read(display) != 0)
+        wl_display_dispatch_pending(display);
+
+    pollfd pfd = { wl_display_get_fd(display), POLLIN, 0 };
+    if (::poll(&pfd, 1, 0) > 0)
+        wl_display_read_events(display);
+    else
+        wl_display_cancel_read(display);
+
+    wl_display_dispatch_pending(display);
+}
+
+void BenchClient::registryGlobal(void *data, wl_registry *registry, uint32_t id,
+                                 const char *interface, uint32_t version)
+{
+    static_cast<BenchClient *>(data)->handleGlobal(registry, id, interface, version);
+}
+
+void BenchClient::registryGlobalRemove(void *data, wl_registry *registry, uint32_t id)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(registry);
+    Q_UNUSED(id);
+}
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#pragma once
+
+#include <QtCore/QSocketNotifier>
+
+#include <wayland-client.h>
+
+/*
+ * Wayland client for the benchmarks, connected to a compositor that
+ * runs on the same thread.
+ *
+ * Subclasses bind the globals they need in handleGlobal() and destroy
+ * their proxies in their destructor.
+ */
+class BenchClient
+{
+public:
+    explicit BenchClient(const char *socketName);
+    virtual ~BenchClient();
+
+    // Dispatches the events as soon as they arrive, from the event loop
+    void watchDisplay();
+
+    void dispatch();
+
+    wl_display *display = nullptr;
+    wl_registry *registry = nullptr;
+
+protected:
+    virtual void handleGlobal(wl_registry *registry, uint32_t id,
+                              const char *interface, uint32_t version) = 0;
+
+private:
+    static void registryGlobal(void *data, wl_registry *registry, uint32_t id,
+                               const char *interface, uint32_t version);
+    static void registryGlobalRemove(void *data, wl_registry *registry, uint32_t id);
+
+    static const wl_registry_listener s_registryListener;
+
+    QSocketNotifier *m_displayNotifier = nullptr;
+};
@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtOpenGL/QOpenGLTexture>
+#include <QtTest/QtTest>
+
+#include <LiriAuroraCompositor/private/aurorawlshmtextureuploader_p.h>
+
+using namespace Aurora::Compositor;
+
+class tst_ShmUpload : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void upload_data();
+    void upload();
+    void convert_data();
+    void convert();
+
+private:
+    QOffscreenSurface *m_surface = nullptr;
+    QOpenGLContext *m_context = nullptr;
+};
+
+void tst_ShmUpload::initTestCase()
+{
+    m_surface = new QOffscreenSurface;
+    m_surface->create();
+
+    m_context = new QOpenGLContext;
+    if (!m_context->create() || !m_context->makeCurrent(m_surface)) {
+        delete m_context;
+        m_context = nullptr;
+    }
+}
+
+void tst_ShmUpload::cleanupTestCase()
+{
+    if (m_context)
+        m_context->doneCurrent();
+    delete m_context;
+    delete m_surface;
+}
+
+static void addRows()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<QImage::Format>("format");
+
+    const QList<QPair<QByteArray, QSize>> sizes = {
+        { QByteArrayLiteral("1080p"), QSize(1920, 1080) },
+        { QByteArrayLiteral("4K"), QSize(3840, 2160) },
+    };
+
+    // wl_shm ARGB8888, XRGB8888 and RGB565
+    const QList<QPair<QByteArray, QImage::Format>> formats = {
+        { QByteArrayLiteral("ARGB8888"), QImage::Format_ARGB32_Premultiplied },
+        { QByteArrayLiteral("XRGB8888"), QImage::Format_RGB32 },
+        { QByteArrayLiteral("RGB565"), QImage::Format_RGB16 },
+    };
+
+    for (const auto &size : sizes) {
+        for (const auto &format : formats)
+            QTest::newRow(size.first + ' ' + format.first) << size.second << format.second;
+    }
+}
+
+void tst_ShmUpload::upload_data()
+{
+    addRows();
+}
+
+void tst_ShmUpload::upload()
+{
+    if (!m_context)
+        QSKIP("OpenGL is not available");
+
+    QFETCH(QSize, size);
+    QFETCH(QImage::Format, format);
+
+    QImage image(size, format);
+    image.fill(Qt::red);
+
+    QOpenGLTexture texture(QOpenGLTexture::Target2D);
+    texture.create();
+    texture.bind();
+
+    Internal::ShmTextureUploader uploader;
+    uploader.prepare(m_context, format);
+    uploader.upload(image, image.rect(), true);
+    if (format == QImage::Format_RGB16)
+        QCOMPARE(uploader.uploadPath(), Internal::ShmTextureUploader::NativeUpload);
+
+    // Every commit damages the whole buffer
+    QBENCHMARK {
+        uploader.upload(image, image.rect(), false);
+        glFinish();
+    }
+}
+
+void tst_ShmUpload::convert_data()
+{
+    addRows();
+}
+
+void tst_ShmUpload::convert()
+{
+    QFETCH(QSize, size);
+    QFETCH(QImage::Format, format);
+
+    if (format == QImage::Format_RGB16)
+        QSKIP("RGB565 is always uploaded natively");
+
+    QImage image(size, format);
+    image.fill(Qt::red);
+    QImage staging(size, QImage::Format_RGBA8888_Premultiplied);
+
+    QBENCHMARK {
+        Internal::convertRgb32Pixels(image.constBits(), image.bytesPerLine(),
+                                     staging.bits(), staging.bytesPerLine(),
+                                     size.width(), size.height(),
+                                     true, format == QImage::Format_RGB32);
+    }
+}
+
+QTEST_MAIN(tst_ShmUpload)
+
+#include "tst_bench_shmupload.moc"
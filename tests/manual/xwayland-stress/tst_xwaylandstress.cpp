@@ -0,0 +1,209 @@
+// SPDX-FileCopyrightText: 2024 Pier Luigi Fiorini <pierluigi.fiorini@gmail.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+// Maps hundreds of X windows at once while a Wayland client keeps
+// doing round trips with the compositor.
+//
+// Run it from a terminal inside a compositor with XWayland enabled,
+// for example qml-compositor nested in another session: it uses
+// DISPLAY and WAYLAND_DISPLAY to connect.
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QVector>
+#include <QtTest/QtTest>
+
+#include <wayland-client.h>
+#include <xcb/xcb.h>
+
+#include <algorithm>
+
+#include <poll.h>
+
+class WaylandPinger
+{
+public:
+    WaylandPinger();
+    ~WaylandPinger();
+
+    bool isValid() const { return display != nullptr; }
+
+    // Sends a new round trip when the previous one is done
+    void ping();
+    void dispatch();
+
+    wl_display *display = nullptr;
+    wl_callback *callback = nullptr;
+    QElapsedTimer timer;
+    QVector<qint64> latencies;
+};
+
+static void callbackDone(void *data, wl_callback *callback, uint32_t time)
+{
+    Q_UNUSED(time);
+
+    auto *pinger = static_cast<WaylandPinger *>(data);
+    pinger->latencies.append(pinger->timer.nsecsElapsed() / 1000);
+    wl_callback_destroy(callback);
+    pinger->callback = nullptr;
+}
+
+static const wl_callback_listener callbackListener = {
+    callbackDone,
+};
+
+WaylandPinger::WaylandPinger()
+    : display(wl_display_connect(nullptr))
+{
+}
+
+WaylandPinger::~WaylandPinger()
+{
+    if (callback)
+        wl_callback_destroy(callback);
+    if (display)
+        wl_display_disconnect(display);
+}
+
+void WaylandPinger::ping()
+{
+    if (callback)
+        return;
+
+    timer.start();
+    callback = wl_display_sync(display);
+    wl_callback_add_listener(callback, &callbackListener, this);
+    wl_display_flush(display);
+}
+
+void WaylandPinger::dispatch()
+{
+    while (wl_display_prepare_read(display) != 0)
+        wl_display_dispatch_pending(display);
+
+    pollfd pfd = { wl_display_get_fd(display), POLLIN, 0 };
+    if (::poll(&pfd, 1, 0) > 0)
+        wl_display_read_events(display);
+    else
+        wl_display_cancel_read(display);
+
+    wl_display_dispatch_pending(display);
+}
+
+class tst_XWaylandStress : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void mapWindows_data();
+    void mapWindows();
+
+private:
+    xcb_connection_t *m_connection = nullptr;
+    xcb_screen_t *m_screen = nullptr;
+};
+
+void tst_XWaylandStress::initTestCase()
+{
+    if (qEnvironmentVariableIsEmpty("DISPLAY") || qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY"))
+        QSKIP("Run this inside a compositor with XWayland");
+
+    m_connection = xcb_connect(nullptr, nullptr);
+    QVERIFY(!xcb_connection_has_error(m_connection));
+    m_screen = xcb_setup_roots_iterator(xcb_get_setup(m_connection)).data;
+    QVERIFY(m_screen);
+}
+
+void tst_XWaylandStress::cleanupTestCase()
+{
+    if (m_connection)
+        xcb_disconnect(m_connection);
+}
+
+void tst_XWaylandStress::mapWindows_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::addRow("100 windows") << 100;
+    QTest::addRow("300 windows") << 300;
+    QTest::addRow("500 windows") << 500;
+}
+
+void tst_XWaylandStress::mapWindows()
+{
+    QFETCH(int, count);
+
+    WaylandPinger pinger;
+    QVERIFY(pinger.isValid());
+
+    // Windows with the properties the window manager reads when mapping
+    QVector<xcb_window_t> windows;
+    windows.reserve(count);
+    const quint32 eventMask = XCB_EVENT_MASK_STRUCTURE_NOTIFY;
+    for (int i = 0; i < count; ++i) {
+        const xcb_window_t window = xcb_generate_id(m_connection);
+        xcb_create_window(m_connection, XCB_COPY_FROM_PARENT, window, m_screen->root,
+                          (i % 20) * 40, (i / 20) * 30, 200, 150, 0,
+                          XCB_WINDOW_CLASS_INPUT_OUTPUT, m_screen->root_visual,
+                          XCB_CW_EVENT_MASK, &eventMask);
+
+        const QByteArray title = QByteArray("stress ") + QByteArray::number(i);
+        xcb_change_property(m_connection, XCB_PROP_MODE_REPLACE, window,
+                            XCB_ATOM_WM_NAME, XCB_ATOM_STRING, 8,
+                            title.size(), title.constData());
+        const char wmClass[] = "stress\0Stress";
+        xcb_change_property(m_connection, XCB_PROP_MODE_REPLACE, window,
+                            XCB_ATOM_WM_CLASS, XCB_ATOM_STRING, 8,
+                            sizeof(wmClass), wmClass);
+
+        windows.append(window);
+    }
+    xcb_flush(m_connection);
+
+    // Map them all at once and wait until the window manager lets them through
+    QElapsedTimer timer;
+    timer.start();
+    for (xcb_window_t window : std::as_const(windows))
+        xcb_map_window(m_connection, window);
+    xcb_flush(m_connection);
+
+    int mapped = 0;
+    while (mapped < count && timer.elapsed() < 30000) {
+        pinger.ping();
+
+        pollfd pfds[2] = {
+            { xcb_get_file_descriptor(m_connection), POLLIN, 0 },
+            { wl_display_get_fd(pinger.display), POLLIN, 0 },
+        };
+        ::poll(pfds, 2, 10);
+
+        while (xcb_generic_event_t *event = xcb_poll_for_event(m_connection)) {
+            if ((event->response_type & ~0x80) == XCB_MAP_NOTIFY)
+                ++mapped;
+            free(event);
+        }
+        pinger.dispatch();
+    }
+    const qint64 mapTime = timer.elapsed();
+
+    for (xcb_window_t window : std::as_const(windows))
+        xcb_destroy_window(m_connection, window);
+    xcb_flush(m_connection);
+
+    QCOMPARE(mapped, count);
+    QVERIFY(!pinger.latencies.isEmpty());
+
+    std::sort(pinger.latencies.begin(), pinger.latencies.end());
+    const qint64 median = pinger.latencies.at(pinger.latencies.size() / 2);
+    const qint64 worst = pinger.latencies.last();
+    qDebug() << count << "windows mapped in" << mapTime << "ms, Wayland round trip median"
+             << median << "us, worst" << worst << "us";
+
+    QTest::setBenchmarkResult(mapTime, QTest::WalltimeMilliseconds);
+}
+
+QTEST_GUILESS_MAIN(tst_XWaylandStress)
+
+#include "tst_xwaylandstress.moc"